@@ -0,0 +1,613 @@
+﻿// GLRayPickupBench.cpp : ウィンドウや OpenGL コンテキストなしで、点群のピッキングの性能を計測するコンソール アプリケーション。
+// 点数（10^3 から 10^8 まで 10 倍ずつ）、点群の分布、カメラ姿勢の組み合わせごとに、
+// ワールド座標系・スクリーン座標系のピッキングと矩形選択の 1 回あたりの時間、1 点あたりの時間、毎秒の回数、メモリ量を計測し、
+// コンソールに表として出力するとともに、回帰の追跡用に JSON ファイルに書き出す。
+//
+// --replay を指定すると、GLRayPickupTest で記録した入力イベントのトレース（F5 キー）を再生して、イベントの種類ごとの処理時間の分布と、
+// 再生後の選択状態のハッシュ値を出力する。同じトレースを別のビルドで再生すれば、遅延と選択結果を比べられる。
+//
+// 使い方: GLRayPickupBench [--min-points N] [--max-points N] [--threads N] [--seconds S] [--order morton|generation] [--json PATH]
+//         GLRayPickupBench --replay TRACE [--threads N] [--json PATH]
+//
+
+#include "stdafx.h"
+#include "MyPointPicker.hpp"
+#include "MyPointGenerator.hpp"
+#include "MyMortonOrder.hpp"
+#include "MyGLHelper.hpp"
+#include "MyCpuFeatures.hpp"
+#include "MyInputReplayer.hpp"
+#include <cstdio>
+
+
+namespace
+{
+	const int ViewportWidth = 800;
+	const int ViewportHeight = 600;
+	// GLRayPickupTest と同じ交差マージン。
+	const float IntersectMarginInWorld = 0.2f;
+	const float IntersectMarginInScreen = 2.0f;
+	// 点群の大きさ。GLRayPickupTest の InitializeApp() で生成する球面分布の半径に合わせる。
+	const float CloudRadius = 10.0f;
+	// 1 種類の計測に使う問い合わせの数の上限。時間の上限に達したら打ち切る。
+	const size_t MaxQueriesNum = 1000;
+
+	using MyPointGenerator::Distribution;
+	using MyPointGenerator::GetDistributionName;
+
+	struct CameraPose
+	{
+		const char* Name;
+		MyVector3F Eye;
+		MyVector3F At;
+	};
+
+	// GLRayPickupTest の既定のカメラ（点群全体が画面中央に小さく映る）、検証用の固定カメラ（点群が画面いっぱいに映る）、
+	// 点群の表面に近づいたカメラ（大半の点が画面外）、点群の内側のカメラ（点群の半分が視点の後方）。
+	const CameraPose CameraPoses[] =
+	{
+		{ "overview", MyVector3F(0, 0, 80), MyVector3F(0, 0, 0) },
+		{ "fit", MyVector3F(3, 5, 30), MyVector3F(0, 0, 0) },
+		{ "close", MyVector3F(0, 2, 13), MyVector3F(0, 0, 8) },
+		{ "inside", MyVector3F(0, 0, 0), MyVector3F(1, 0.2f, 0.5f) },
+	};
+
+	struct BenchOptions
+	{
+		size_t MinPointsNum = 1000;
+		size_t MaxPointsNum = 100 * 1000 * 1000;
+		unsigned ThreadsNum = 0; //!< 0 の場合はハードウェア スレッド数。<br>
+		double SecondsPerOperation = 0.5; //!< 1 種類の計測にかける時間の目安。<br>
+		bool ReordersByMortonCode = true; //!< 生成した点群を Morton 順に並べ替えてから計測する（GLRayPickupTest と同じ）。<br>
+		std::string JsonFilePath; //!< 空の場合は DefaultJsonFilePath または DefaultReplayJsonFilePath。<br>
+		std::string ReplayFilePath; //!< 空でなければ、計測の代わりにこの入力トレースを再生する。<br>
+	};
+
+	const char* const DefaultJsonFilePath = "GLRayPickupBench.json";
+	const char* const DefaultReplayJsonFilePath = "GLRayPickupReplay.json";
+
+	//! 1 種類の操作の計測結果。<br>
+	struct OperationResult
+	{
+		const char* Name;
+		size_t QueriesNum;
+		double SecondsPerQuery;
+		double AverageHitsNum; //!< 問い合わせ 1 回あたりの、列挙・選択された点数の平均。<br>
+	};
+
+	struct CameraResult
+	{
+		const char* CameraName;
+		size_t PickerBytes; //!< タイル グリッドと作業領域。<br>
+		std::vector<OperationResult> Operations;
+	};
+
+	struct CloudResult
+	{
+		size_t PointsNum;
+		Distribution DistributionType;
+		size_t StoreBytes;
+		size_t OctreeBytes;
+		double ReorderSeconds; //!< Morton 順への並べ替え。並べ替えない場合は 0。<br>
+		double OctreeBuildSeconds;
+		std::vector<CameraResult> Cameras;
+	};
+
+	typedef std::chrono::steady_clock Clock;
+
+	double GetElapsedSeconds(const Clock::time_point& startTime)
+	{
+		return std::chrono::duration<double>(Clock::now() - startTime).count();
+	}
+
+	// 問い合わせに使うスクリーン位置。半数は点の投影位置の近く（ヒットする）、残りはビューポート内のランダムな位置。
+	void GenerateQueryScreenPositions(const MyPointCloudStore& store, const MyMatrix4x4F& matToScreen, std::mt19937& random,
+		std::vector<MyVector2F>& outPositions)
+	{
+		outPositions.clear();
+		std::uniform_real_distribution<float> uniformX(0, float(ViewportWidth));
+		std::uniform_real_distribution<float> uniformY(0, float(ViewportHeight));
+		for (size_t attempt = 0; outPositions.size() < MaxQueriesNum / 2 && attempt < MaxQueriesNum * 10; ++attempt)
+		{
+			const MyVector4F vClip = matToScreen * MyVector4F(store.GetPosition(random() % store.GetPointsNum()), 1);
+			if (vClip.w <= 0)
+			{
+				continue;
+			}
+			const MyVector2F vScreen(vClip.x / vClip.w, vClip.y / vClip.w);
+			if (vScreen.x >= 0 && vScreen.x < ViewportWidth && vScreen.y >= 0 && vScreen.y < ViewportHeight)
+			{
+				outPositions.push_back(vScreen + MyVector2F(uniformX(random) / ViewportWidth - 0.5f, uniformY(random) / ViewportHeight - 0.5f));
+			}
+		}
+		while (outPositions.size() < MaxQueriesNum)
+		{
+			outPositions.push_back(MyVector2F(uniformX(random), uniformY(random)));
+		}
+		std::shuffle(outPositions.begin(), outPositions.end(), random);
+	}
+
+	// queryFunc(queryIndex) を時間の上限まで（最低 1 回、最大 queriesNum 回）繰り返して、1 回あたりの時間を計測する。
+	// queryFunc は列挙・選択した点数を返す。
+	template<typename TQueryFunc> OperationResult MeasureOperation(const char* pName, size_t queriesNum, double maxSeconds, TQueryFunc queryFunc)
+	{
+		OperationResult result = { pName, 0, 0, 0 };
+		size_t totalHitsNum = 0;
+		const Clock::time_point startTime = Clock::now();
+		double elapsedSeconds = 0;
+		do
+		{
+			totalHitsNum += queryFunc(result.QueriesNum);
+			++result.QueriesNum;
+			elapsedSeconds = GetElapsedSeconds(startTime);
+		} while (result.QueriesNum < queriesNum && elapsedSeconds < maxSeconds);
+		result.SecondsPerQuery = elapsedSeconds / result.QueriesNum;
+		result.AverageHitsNum = double(totalHitsNum) / result.QueriesNum;
+		return result;
+	}
+
+	CameraResult MeasureCamera(MyJobSystem& jobSystem, MyPointCloudStore& store, const MyPointOctree& octree, const CameraPose& pose,
+		const BenchOptions& options, std::mt19937& random)
+	{
+		const MyGLHelper::Viewport viewport = { 0, 0, ViewportWidth, ViewportHeight, 0.0f, 1.0f };
+		const MyGLHelper::PerspectiveParam persParam = { 45.0f, 0.1f, 1000.0f };
+		const MyMatrix4x4F matView = MyGLHelper::CreateMatrixLookAt(MyGLHelper::CameraParam(pose.Eye, pose.At, MyVector3F(0, 1, 0)));
+		const MyMatrix4x4F matProj = MyGLHelper::CreateMatrixPerspectiveFov(viewport, persParam);
+		const MyMatrix4x4F matToScreen = MyGLHelper::CreateMatrixTransformWorldCoordToScreenCoord(matView, matProj, viewport);
+		MyMatrix4x4F matUnproj;
+		MyGLHelper::CreateMatrixUnProjectionScreenCoordToWorldCoord(matUnproj, matView, matProj, viewport);
+
+		std::vector<MyVector2F> screenPositions;
+		GenerateQueryScreenPositions(store, matToScreen, random, screenPositions);
+		std::vector<MyVector3F> rayPositions(screenPositions.size() * 2);
+		for (size_t q = 0; q < screenPositions.size(); ++q)
+		{
+			MyPointPicker::CalcUnProjectedRayPositions(matUnproj, screenPositions[q].x, screenPositions[q].y, rayPositions[q * 2], rayPositions[q * 2 + 1]);
+		}
+		std::vector<int> rects(MaxQueriesNum * 4);
+		for (size_t q = 0; q < MaxQueriesNum; ++q)
+		{
+			const int x0 = int(random() % ViewportWidth);
+			const int x1 = int(random() % ViewportWidth);
+			const int y0 = int(random() % ViewportHeight);
+			const int y1 = int(random() % ViewportHeight);
+			rects[q * 4 + 0] = std::min(x0, x1);
+			rects[q * 4 + 1] = std::min(y0, y1);
+			rects[q * 4 + 2] = std::max(x0, x1);
+			rects[q * 4 + 3] = std::max(y0, y1);
+		}
+
+		CameraResult result = { pose.Name, 0, {} };
+		MyPointPicker picker(jobSystem);
+		std::vector<uint32_t> hitIndices;
+		const double maxSeconds = options.SecondsPerOperation;
+		const MyPointPicker::PickMode worldModes[] = { MyPointPicker::PickMode_All, MyPointPicker::PickMode_Nearest, MyPointPicker::PickMode_TopK };
+		const char* worldModeNames[] = { "world_all", "world_nearest", "world_top8" };
+		for (int m = 0; m < 3; ++m)
+		{
+			picker.SetPickMode(worldModes[m]);
+			result.Operations.push_back(MeasureOperation(worldModeNames[m], MaxQueriesNum, maxSeconds, [&](size_t q)
+			{
+				picker.QueryPointsInWorld(store, octree, rayPositions[q * 2], rayPositions[q * 2 + 1], IntersectMarginInWorld, hitIndices);
+				return hitIndices.size();
+			}));
+		}
+
+		// タイル グリッドの構築は、カメラが動いた直後の最初のホバー判定で発生する。
+		MyScreenTileGrid screenTileGrid;
+		uint64_t positionsVersion = store.GetPositionsVersion();
+		result.Operations.push_back(MeasureOperation("screen_grid_build", MaxQueriesNum, maxSeconds, [&](size_t)
+		{
+			// 位置のバージョンだけを変えて、同じ点群で再構築させる。
+			screenTileGrid.Build(matToScreen, ViewportWidth, ViewportHeight,
+				store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), store.GetPointsNum(), ++positionsVersion);
+			return store.GetPointsNum();
+		}));
+
+		picker.SetPickMode(MyPointPicker::PickMode_Nearest);
+		const auto queryScreen = [&](size_t q)
+		{
+			picker.QueryPointsInScreen(store, matToScreen, ViewportWidth, ViewportHeight,
+				screenPositions[q].x, screenPositions[q].y, IntersectMarginInScreen,
+				rayPositions[q * 2], rayPositions[q * 2 + 1], hitIndices);
+			return hitIndices.size();
+		};
+		// 最初の 1 回でタイル グリッドを構築しておく。
+		queryScreen(0);
+		result.Operations.push_back(MeasureOperation("screen_hover_nearest", MaxQueriesNum, maxSeconds, queryScreen));
+		picker.SetPickMode(MyPointPicker::PickMode_All);
+		result.Operations.push_back(MeasureOperation("screen_hover_all", MaxQueriesNum, maxSeconds, queryScreen));
+
+		std::vector<uint64_t> hitMaskWords(store.GetSelectionWordsNum());
+		result.Operations.push_back(MeasureOperation("screen_click_all", MaxQueriesNum, maxSeconds, [&](size_t q)
+		{
+			picker.CheckPointsIntersectWithScreenPosParallel(store, matToScreen,
+				screenPositions[q].x, screenPositions[q].y, IntersectMarginInScreen, hitMaskWords.data());
+			return MyBitsetOps::CountBits(hitMaskWords.data(), hitMaskWords.size());
+		}));
+		// クリックによる選択の反転。交差判定に加えて、交差した点の集合を作って選択状態に反映するまでを含む。
+		result.Operations.push_back(MeasureOperation("screen_click_toggle", MaxQueriesNum, maxSeconds, [&](size_t q)
+		{
+			picker.SelectPointsIntersectWithScreenPosParallel(store, matToScreen,
+				screenPositions[q].x, screenPositions[q].y, IntersectMarginInScreen, MyBitsetOps::SetOperation_SymmetricDifference);
+			return picker.GetLastHitSet().GetCardinality();
+		}));
+
+		result.Operations.push_back(MeasureOperation("rect_frustum", MaxQueriesNum, maxSeconds, [&](size_t q)
+		{
+			picker.SelectPointsIntersectWithScreenRectByFrustum(store, octree, matToScreen, matUnproj,
+				rects[q * 4 + 0], rects[q * 4 + 1], rects[q * 4 + 2], rects[q * 4 + 3], MyBitsetOps::SetOperation_Replace);
+			return store.CountSelected();
+		}));
+		result.Operations.push_back(MeasureOperation("rect_parallel", MaxQueriesNum, maxSeconds, [&](size_t q)
+		{
+			picker.SelectPointsIntersectWithScreenRectParallel(store, matToScreen,
+				rects[q * 4 + 0], rects[q * 4 + 1], rects[q * 4 + 2], rects[q * 4 + 3], MyBitsetOps::SetOperation_Replace);
+			return store.CountSelected();
+		}));
+		store.ClearSelection();
+
+		result.PickerBytes = picker.GetMemoryBytes();
+		return result;
+	}
+
+	void PrintCloudResult(const CloudResult& cloud)
+	{
+		const double pointsNum = double(cloud.PointsNum);
+		printf("points %zu, %s: store %.1f MB, octree %.1f MB, reorder %.2f ms, octree build %.2f ms (%.2f ns/point)\n",
+			cloud.PointsNum, GetDistributionName(cloud.DistributionType),
+			cloud.StoreBytes / 1048576.0, cloud.OctreeBytes / 1048576.0, cloud.ReorderSeconds * 1e3,
+			cloud.OctreeBuildSeconds * 1e3, cloud.OctreeBuildSeconds * 1e9 / pointsNum);
+		for (const auto& camera : cloud.Cameras)
+		{
+			printf("  camera %s: picker %.1f MB\n", camera.CameraName, camera.PickerBytes / 1048576.0);
+			for (const auto& op : camera.Operations)
+			{
+				printf("    %-22s %12.3f us/query %12.4f ns/point %14.1f queries/s %12.1f hits (%zu queries)\n",
+					op.Name, op.SecondsPerQuery * 1e6, op.SecondsPerQuery * 1e9 / pointsNum, 1 / op.SecondsPerQuery,
+					op.AverageHitsNum, op.QueriesNum);
+			}
+		}
+		fflush(stdout);
+	}
+
+	bool WriteJsonFile(const char* pFilePath, const BenchOptions& options, unsigned threadsNum, const std::vector<CloudResult>& clouds,
+		const std::vector<std::pair<size_t, Distribution>>& skipped)
+	{
+		FILE* pFile = nullptr;
+		if (fopen_s(&pFile, pFilePath, "w") != 0 || !pFile)
+		{
+			return false;
+		}
+		fprintf(pFile, "{\n");
+		fprintf(pFile, "  \"benchmark\": \"GLRayPickupBench\",\n");
+		fprintf(pFile, "  \"threads\": %u,\n", threadsNum);
+		fprintf(pFile, "  \"simd\": \"%s\",\n", MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::GetActiveSimdLevel()));
+		fprintf(pFile, "  \"viewport\": [%d, %d],\n", ViewportWidth, ViewportHeight);
+		fprintf(pFile, "  \"intersect_margin_world\": %g,\n", IntersectMarginInWorld);
+		fprintf(pFile, "  \"intersect_margin_screen\": %g,\n", IntersectMarginInScreen);
+		fprintf(pFile, "  \"seconds_per_operation\": %g,\n", options.SecondsPerOperation);
+		fprintf(pFile, "  \"point_order\": \"%s\",\n", options.ReordersByMortonCode ? "morton" : "generation");
+		fprintf(pFile, "  \"results\": [");
+		for (size_t c = 0; c < clouds.size(); ++c)
+		{
+			const CloudResult& cloud = clouds[c];
+			const double pointsNum = double(cloud.PointsNum);
+			fprintf(pFile, "%s\n    {\n", (c > 0) ? "," : "");
+			fprintf(pFile, "      \"points\": %zu,\n", cloud.PointsNum);
+			fprintf(pFile, "      \"distribution\": \"%s\",\n", GetDistributionName(cloud.DistributionType));
+			fprintf(pFile, "      \"store_bytes\": %zu,\n", cloud.StoreBytes);
+			fprintf(pFile, "      \"octree_bytes\": %zu,\n", cloud.OctreeBytes);
+			fprintf(pFile, "      \"reorder_ns_per_point\": %.6g,\n", cloud.ReorderSeconds * 1e9 / pointsNum);
+			fprintf(pFile, "      \"octree_build_ns_per_point\": %.6g,\n", cloud.OctreeBuildSeconds * 1e9 / pointsNum);
+			fprintf(pFile, "      \"cameras\": [");
+			for (size_t k = 0; k < cloud.Cameras.size(); ++k)
+			{
+				const CameraResult& camera = cloud.Cameras[k];
+				fprintf(pFile, "%s\n        {\n", (k > 0) ? "," : "");
+				fprintf(pFile, "          \"camera\": \"%s\",\n", camera.CameraName);
+				fprintf(pFile, "          \"picker_bytes\": %zu,\n", camera.PickerBytes);
+				fprintf(pFile, "          \"operations\": [");
+				for (size_t o = 0; o < camera.Operations.size(); ++o)
+				{
+					const OperationResult& op = camera.Operations[o];
+					fprintf(pFile, "%s\n            { \"name\": \"%s\", \"queries\": %zu, \"ns_per_query\": %.6g, \"ns_per_point\": %.6g, \"queries_per_sec\": %.6g, \"average_hits\": %.6g }",
+						(o > 0) ? "," : "", op.Name, op.QueriesNum,
+						op.SecondsPerQuery * 1e9, op.SecondsPerQuery * 1e9 / pointsNum, 1 / op.SecondsPerQuery, op.AverageHitsNum);
+				}
+				fprintf(pFile, "\n          ]\n        }");
+			}
+			fprintf(pFile, "\n      ]\n    }");
+		}
+		fprintf(pFile, "\n  ],\n");
+		fprintf(pFile, "  \"skipped\": [");
+		for (size_t s = 0; s < skipped.size(); ++s)
+		{
+			fprintf(pFile, "%s\n    { \"points\": %zu, \"distribution\": \"%s\", \"reason\": \"out of memory\" }",
+				(s > 0) ? "," : "", skipped[s].first, GetDistributionName(skipped[s].second));
+		}
+		fprintf(pFile, "\n  ]\n}\n");
+		fclose(pFile);
+		return true;
+	}
+
+	// --threads に指定できるスレッド数の上限。
+	const unsigned MaxThreadsOptionValue = 1024;
+
+	// 数値のオプションの値を解釈する。値の全体を数値として解釈でき、[minValue, maxValue] の範囲内にある場合だけ true を返す。
+	// 点数は "1e8" のような指数表記も受け付けるので、整数も strtod() で解釈してから整数であることを確かめる。
+	bool ParseNumberOption(const char* pValue, double minValue, double maxValue, bool requiresInteger, double& outValue)
+	{
+		char* pEnd = nullptr;
+		const double value = std::strtod(pValue, &pEnd);
+		if (pEnd == pValue || *pEnd != '\0' || !std::isfinite(value) || value < minValue || value > maxValue ||
+			(requiresInteger && value != std::floor(value)))
+		{
+			return false;
+		}
+		outValue = value;
+		return true;
+	}
+
+	bool ParseOptions(int argc, char* argv[], BenchOptions& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (i + 1 >= argc)
+			{
+				printf("Missing value for %s.\n", arg.c_str());
+				return false;
+			}
+			const char* pValue = argv[++i];
+			double value = 0;
+			if (arg == "--min-points" || arg == "--max-points")
+			{
+				// 点のインデックスは uint32_t で扱う。
+				if (!ParseNumberOption(pValue, 1, double(UINT32_MAX), true, value))
+				{
+					printf("Invalid point count for %s: %s\n", arg.c_str(), pValue);
+					return false;
+				}
+				(arg == "--min-points" ? options.MinPointsNum : options.MaxPointsNum) = size_t(value);
+			}
+			else if (arg == "--threads")
+			{
+				if (!ParseNumberOption(pValue, 0, MaxThreadsOptionValue, true, value))
+				{
+					printf("Invalid thread count for %s: %s (0 to %u)\n", arg.c_str(), pValue, MaxThreadsOptionValue);
+					return false;
+				}
+				options.ThreadsNum = unsigned(value);
+			}
+			else if (arg == "--seconds")
+			{
+				if (!ParseNumberOption(pValue, 0, std::numeric_limits<double>::max(), false, value) || value <= 0)
+				{
+					printf("Invalid duration for %s: %s\n", arg.c_str(), pValue);
+					return false;
+				}
+				options.SecondsPerOperation = value;
+			}
+			else if (arg == "--order")
+			{
+				if (strcmp(pValue, "morton") != 0 && strcmp(pValue, "generation") != 0)
+				{
+					printf("Invalid order for %s: %s\n", arg.c_str(), pValue);
+					return false;
+				}
+				options.ReordersByMortonCode = (strcmp(pValue, "morton") == 0);
+			}
+			else if (arg == "--json")
+			{
+				options.JsonFilePath = pValue;
+			}
+			else if (arg == "--replay")
+			{
+				options.ReplayFilePath = pValue;
+			}
+			else
+			{
+				printf("Unknown option %s.\n", arg.c_str());
+				return false;
+			}
+		}
+		if (options.MinPointsNum > options.MaxPointsNum)
+		{
+			printf("--min-points (%zu) exceeds --max-points (%zu).\n", options.MinPointsNum, options.MaxPointsNum);
+			return false;
+		}
+		return true;
+	}
+
+	const char* const EventTypeNames[MyInputTrace::EventType_Count] = { "button", "drag", "move", "wheel", "key", "reshape" };
+
+	void PrintLatencyRow(const char* pName, const MyLatencyHistogram& histogram)
+	{
+		printf("  %-8s %8llu events %10.3f us p50 %10.3f us p99 %10.3f us max %10.3f us mean\n", pName,
+			static_cast<unsigned long long>(histogram.GetTotalCount()), histogram.GetValueAtPercentile(50) * 1e-3,
+			histogram.GetValueAtPercentile(99) * 1e-3, histogram.GetMaxValue() * 1e-3, histogram.GetMeanValue() * 1e-3);
+	}
+
+	void WriteLatencyJson(FILE* pFile, const char* pName, const MyLatencyHistogram& histogram, bool isLast)
+	{
+		fprintf(pFile, "    { \"type\": \"%s\", \"events\": %llu, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu, \"max_ns\": %llu, \"mean_ns\": %.6g }%s\n",
+			pName, static_cast<unsigned long long>(histogram.GetTotalCount()),
+			static_cast<unsigned long long>(histogram.GetValueAtPercentile(50)), static_cast<unsigned long long>(histogram.GetValueAtPercentile(90)),
+			static_cast<unsigned long long>(histogram.GetValueAtPercentile(99)), static_cast<unsigned long long>(histogram.GetMaxValue()),
+			histogram.GetMeanValue(), isLast ? "" : ",");
+	}
+
+	bool WriteReplayJsonFile(const char* pFilePath, const char* pTraceFilePath, unsigned threadsNum, const MyInputTrace& trace,
+		const MyInputReplayer::Result& result)
+	{
+		FILE* pFile = nullptr;
+		if (fopen_s(&pFile, pFilePath, "w") != 0 || !pFile)
+		{
+			return false;
+		}
+		const MyInputTrace::InitialState& state = trace.GetInitialState();
+		fprintf(pFile, "{\n");
+		fprintf(pFile, "  \"benchmark\": \"GLRayPickupReplay\",\n");
+		fprintf(pFile, "  \"trace\": \"%s\",\n", pTraceFilePath);
+		fprintf(pFile, "  \"threads\": %u,\n", threadsNum);
+		fprintf(pFile, "  \"simd\": \"%s\",\n", MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::GetActiveSimdLevel()));
+		fprintf(pFile, "  \"points\": %llu,\n", static_cast<unsigned long long>(state.PointsNum));
+		fprintf(pFile, "  \"distribution\": \"%s\",\n", GetDistributionName(Distribution(state.Distribution)));
+		fprintf(pFile, "  \"seed\": %llu,\n", static_cast<unsigned long long>(state.Seed));
+		fprintf(pFile, "  \"events\": %zu,\n", result.EventsNum);
+		fprintf(pFile, "  \"trace_seconds\": %.6g,\n", result.TraceSeconds);
+		fprintf(pFile, "  \"replay_seconds\": %.6g,\n", result.ReplaySeconds);
+		fprintf(pFile, "  \"hover_queries\": %llu,\n", static_cast<unsigned long long>(result.HoverQueriesNum));
+		fprintf(pFile, "  \"hover_hits\": %llu,\n", static_cast<unsigned long long>(result.HoverHitsNum));
+		fprintf(pFile, "  \"hover_hash\": \"%016llx\",\n", static_cast<unsigned long long>(result.HoverHash));
+		fprintf(pFile, "  \"selected\": %zu,\n", result.SelectedNum);
+		fprintf(pFile, "  \"selection_hash\": \"%016llx\",\n", static_cast<unsigned long long>(result.SelectionHash));
+		fprintf(pFile, "  \"undoable\": %zu,\n", result.UndoableNum);
+		fprintf(pFile, "  \"latencies\": [\n");
+		for (int t = 0; t < MyInputTrace::EventType_Count; ++t)
+		{
+			WriteLatencyJson(pFile, EventTypeNames[t], result.EventLatencies[t], false);
+		}
+		WriteLatencyJson(pFile, "all", result.AllLatencies, true);
+		fprintf(pFile, "  ]\n}\n");
+		fclose(pFile);
+		return true;
+	}
+
+	// トレースの初期状態と同じ点群を生成して、入力イベントを再生する。
+	int RunReplay(MyJobSystem& jobSystem, const BenchOptions& options)
+	{
+		MyInputTrace trace;
+		std::string errorMessage;
+		if (!trace.ReadFile(options.ReplayFilePath.c_str(), errorMessage))
+		{
+			printf("%s\n", errorMessage.c_str());
+			return 1;
+		}
+		const MyInputTrace::InitialState& state = trace.GetInitialState();
+		if (state.Distribution >= uint32_t(MyPointGenerator::Distribution_Count))
+		{
+			printf("Unknown distribution %u in %s.\n", state.Distribution, options.ReplayFilePath.c_str());
+			return 1;
+		}
+		const size_t pointsNum = size_t(state.PointsNum);
+		printf("Replaying %s: %zu events over %zu points (%s, seed %llu)\n", options.ReplayFilePath.c_str(), trace.GetEvents().size(),
+			pointsNum, GetDistributionName(Distribution(state.Distribution)), static_cast<unsigned long long>(state.Seed));
+
+		// GLRayPickupTest の InitializeApp() と同じく、生成した点群を Morton 順に並べ替えてから八分木を構築する。
+		MyPointCloudStore store;
+		MyPointGenerator::GeneratePointsParallel(jobSystem, store, pointsNum, Distribution(state.Distribution), state.CloudRadius, state.Seed);
+		std::vector<uint32_t> order;
+		MyMortonOrder::SortByMortonCodeParallel(jobSystem, store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), pointsNum, order);
+		MyMortonOrder::ReorderStoreParallel(jobSystem, store, order);
+		MyPointOctree octree;
+		octree.Build(uint32_t(pointsNum), [&store](uint32_t index) { return store.GetPosition(index); });
+
+		MyInputReplayer replayer(jobSystem, IntersectMarginInWorld, IntersectMarginInScreen);
+		MyInputReplayer::Result result;
+		if (!replayer.Replay(trace, store, octree, result, errorMessage))
+		{
+			printf("%s\n", errorMessage.c_str());
+			return 1;
+		}
+		printf("Replayed in %.3f sec (recorded over %.3f sec)\n", result.ReplaySeconds, result.TraceSeconds);
+		for (int t = 0; t < MyInputTrace::EventType_Count; ++t)
+		{
+			if (result.EventLatencies[t].GetTotalCount() > 0)
+			{
+				PrintLatencyRow(EventTypeNames[t], result.EventLatencies[t]);
+			}
+		}
+		PrintLatencyRow("all", result.AllLatencies);
+		printf("Hover: %llu queries, %llu hits, hash %016llx\n", static_cast<unsigned long long>(result.HoverQueriesNum),
+			static_cast<unsigned long long>(result.HoverHitsNum), static_cast<unsigned long long>(result.HoverHash));
+		printf("Selection: %zu selected, hash %016llx, %zu undoable\n", result.SelectedNum,
+			static_cast<unsigned long long>(result.SelectionHash), result.UndoableNum);
+
+		const char* pJsonFilePath = options.JsonFilePath.empty() ? DefaultReplayJsonFilePath : options.JsonFilePath.c_str();
+		if (!WriteReplayJsonFile(pJsonFilePath, options.ReplayFilePath.c_str(), jobSystem.GetMaxThreadsNum(), trace, result))
+		{
+			printf("Failed to write %s.\n", pJsonFilePath);
+			return 1;
+		}
+		printf("Results written to %s.\n", pJsonFilePath);
+		return 0;
+	}
+} // end of namespace
+
+
+int main(int argc, char* argv[])
+{
+	BenchOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		puts("Usage: GLRayPickupBench [--min-points N] [--max-points N] [--threads N] [--seconds S] [--order morton|generation] [--json PATH]");
+		puts("       GLRayPickupBench --replay TRACE [--threads N] [--json PATH]");
+		return 1;
+	}
+
+	MyJobSystem jobSystem(options.ThreadsNum);
+	printf("GLRayPickupBench: %u threads, SIMD %s, %dx%d viewport\n",
+		jobSystem.GetMaxThreadsNum(), MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::GetActiveSimdLevel()), ViewportWidth, ViewportHeight);
+	if (!options.ReplayFilePath.empty())
+	{
+		return RunReplay(jobSystem, options);
+	}
+
+	std::vector<CloudResult> clouds;
+	std::vector<std::pair<size_t, Distribution>> skipped;
+	for (size_t pointsNum = options.MinPointsNum; pointsNum <= options.MaxPointsNum; pointsNum *= 10)
+	{
+		for (int d = 0; d < MyPointGenerator::Distribution_Count; ++d)
+		{
+			const Distribution distribution = Distribution(d);
+			// 点数と分布ごとに乱数系列を固定して、実行ごとに同じ点群と問い合わせで計測する。
+			// 点群はスレッド数によらず同じになるので、スレッド数を変えた計測結果どうしも比べられる。
+			const uint64_t seed = pointsNum * MyPointGenerator::Distribution_Count + d;
+			std::mt19937 random(static_cast<uint32_t>(seed));
+			try
+			{
+				MyPointCloudStore store;
+				MyPointGenerator::GeneratePointsParallel(jobSystem, store, pointsNum, distribution, CloudRadius, seed);
+				const Clock::time_point reorderStartTime = Clock::now();
+				if (options.ReordersByMortonCode)
+				{
+					std::vector<uint32_t> order;
+					MyMortonOrder::SortByMortonCodeParallel(jobSystem, store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), pointsNum, order);
+					MyMortonOrder::ReorderStoreParallel(jobSystem, store, order);
+				}
+				const double reorderSeconds = options.ReordersByMortonCode ? GetElapsedSeconds(reorderStartTime) : 0.0;
+				MyPointOctree octree;
+				const Clock::time_point buildStartTime = Clock::now();
+				octree.Build(uint32_t(pointsNum), [&store](uint32_t index) { return store.GetPosition(index); });
+				const double octreeBuildSeconds = GetElapsedSeconds(buildStartTime);
+				CloudResult cloud = { pointsNum, distribution, store.GetMemoryBytes(), octree.GetMemoryBytes(), reorderSeconds, octreeBuildSeconds, {} };
+				for (const auto& pose : CameraPoses)
+				{
+					cloud.Cameras.push_back(MeasureCamera(jobSystem, store, octree, pose, options, random));
+				}
+				PrintCloudResult(cloud);
+				clouds.push_back(cloud);
+			}
+			catch (const std::bad_alloc&)
+			{
+				printf("points %zu, %s: skipped (out of memory)\n", pointsNum, GetDistributionName(distribution));
+				skipped.push_back(std::make_pair(pointsNum, distribution));
+			}
+		}
+		if (pointsNum > options.MaxPointsNum / 10)
+		{
+			break;
+		}
+	}
+
+	const char* pJsonFilePath = options.JsonFilePath.empty() ? DefaultJsonFilePath : options.JsonFilePath.c_str();
+	if (!WriteJsonFile(pJsonFilePath, options, jobSystem.GetMaxThreadsNum(), clouds, skipped))
+	{
+		printf("Failed to write %s.\n", pJsonFilePath);
+		return 1;
+	}
+	printf("Results written to %s.\n", pJsonFilePath);
+	return 0;
+}
@@ -1,691 +1,1810 @@
-﻿#include "stdafx.h"
-#include "MyTrackball.hpp"
-#include "MyCollisionHelper.hpp"
-#include "MyGLHelper.hpp"
-
-
-#pragma comment(lib, "glew32.lib")
-
-
-namespace
-{
-	// ワールド座標系での交差判定のマージン[Length]。
-	const float IntersectMarginInWolrd = 0.2f;
-	// スクリーン座標系での交差判定のマージン[Pixels]。
-	const float IntersectMarginInScreen = 2.0f;
-
-
-#pragma region // グローバル変数。//
-
-	MyGLHelper::Viewport g_viewport = { 0, 0, 0, 0, 0.0f, 1.0f };
-	const MyGLHelper::PerspectiveParam g_persParam = { 45.0f, 0.1f, 1000.0f };
-	MyGLHelper::CameraParam g_camera(MyVector3F(0, 0, 80), MyVector3F(0, 0, 0), MyVector3F(0, 1, 0));
-
-	class MouseData
-	{
-	public:
-		bool IsLeftButtonPressed = false;
-		bool IsMiddleButtonPressed = false;
-		bool IsRightButtonPressed = false;
-		MyVector2I DragStartPosL = {};
-		MyVector2I DragStartPosM = {};
-		MyVector2I DragStartPosR = {};
-		MyVector2I CurrentPos = {};
-	public:
-		MouseData()
-		{}
-	public:
-		void GetNormalizedLDraggingRect(int& rectL, int& rectT, int& rectR, int& rectB) const
-		{
-			// 左上座標＜右下座標となるように正規化する。
-			if (this->CurrentPos.x < this->DragStartPosL.x)
-			{
-				rectL = this->CurrentPos.x;
-				rectR = this->DragStartPosL.x;
-			}
-			else
-			{
-				rectL = this->DragStartPosL.x;
-				rectR = this->CurrentPos.x;
-			}
-			if (this->CurrentPos.y < this->DragStartPosL.y)
-			{
-				rectT = this->CurrentPos.y;
-				rectB = this->DragStartPosL.y;
-			}
-			else
-			{
-				rectT = this->DragStartPosL.y;
-				rectB = this->CurrentPos.y;
-			}
-		}
-	};
-	MouseData g_mouseData;
-
-	MyTrackball g_myMeshTrackball;
-
-	struct MyPointData
-	{
-		MyVector3F Position; // ワールド位置座標。
-		MyVector4F Color;
-		bool IsSelected; // マウス クリックなどにより選択されているかどうか。
-	};
-
-	std::vector<MyPointData> g_pointCloudVertices;
-
-	bool g_rendersCoordAxes = true;
-	bool g_usesWorldUnitAsIntersectMargin = false;
-
-#pragma endregion
-
-
-	void WaitForUserInput()
-	{
-		puts("Press any...");
-		_getch();
-	}
-
-	void MyGLDrawString(void* pGlutFontType, const char* pStr)
-	{
-		while (*pStr)
-		{
-			glutBitmapCharacter(pGlutFontType, *pStr);
-			++pStr;
-		}
-	}
-} // end of namespace
-
-void InitializeApp()
-{
-	// GLEW の初期化。
-	// これにより、Windows で OpenGL 1.2 以上を利用するのが楽になる。
-	// 実際に OpenGL 1.2 以上の Features (Extensions) にハードウェアおよびドライバーが対応しているかどうか不明な環境で実行する際は、
-	// バージョン情報やエントリーポイントをつぶさに調べる必要がある。
-	if (glewInit() != GLEW_OK)
-	{
-		puts("Error : Failed to initialize GLEW!!");
-		WaitForUserInput();
-		exit(-1);
-	}
-
-	// 点群の頂点データを設定。
-	const int pointsNum = 1000;
-	const float radius = 10;
-	g_pointCloudVertices.resize(pointsNum);
-	for (int i = 0; i < pointsNum; ++i)
-	{
-		MyPointData& point = g_pointCloudVertices[i];
-		MyVector3F& pos = point.Position;
-		// ランダム位置ベクトルを正規化して、点群を球面分布させる。
-		// ただし、もし偶然にも (x, y, z) = (0, 0, 0) だった場合は、原点を指す点が混ざることになる。
-		pos.x = MyMath::GetMyNormalRandF();
-		pos.y = MyMath::GetMyNormalRandF();
-		pos.z = MyMath::GetMyNormalRandF();
-		pos = glm::normalize(pos);
-		pos *= radius;
-		// 色は象限ごとに分けてみる。X, Y, Z 成分がすべて正ならば黄色、すべて負ならばシアン、さもなくば白。
-		if (pos.x > 0 && pos.y > 0 && pos.z > 0)
-		{
-			point.Color = MyColorFYellow;
-		}
-		else if (pos.x < 0 && pos.y < 0 && pos.z < 0)
-		{
-			point.Color = MyColorFCyan;
-		}
-		else
-		{
-			point.Color = MyColorFWhite;
-		}
-		point.IsSelected = false;
-	}
-}
-
-namespace
-{
-	void CalcUnProjectedRayPositions(MyVector3F& vWCoord0, MyVector3F& vWCoord1, const MyMatrix4x4F& matView, const MyMatrix4x4F& matProj)
-	{
-		// マウス位置 vS をワールド座標 vW に変換するには、
-		// vS = Mviewport * Mproj * Mview * vW であることから、
-		// vW = Mview^-1 * Mproj^-1 * Mviewport^-1 * vS を計算してやればよい。
-		// 逆プロジェクション変換を行なうユーティリティは、GLU の gluUnProject() や GLM の glm::unProject() が存在する。
-		// ここではビューポート設定値などをもとに逆プロジェクション行列そのものを計算してみる。
-		// なお、一般的な各種 3D 変換行列の計算アルゴリズムは、GLM のヘッダーにすべて書かれてある。
-
-		// 変換行列の計算を含めて、CPU プログラム側で完全にオフスクリーン実行すれば、OpenGL ES のバージョンにも依存しないし、Direct3D でも使える。
-		// なお、変換結果はここで入力する仮想深度値に左右されるので注意。
-		// 変換結果の座標値をそのまま利用するのではなく、交差判定に使う無限直線を算出するために Near 側と Far 側をペアで使う。
-		// 
-		// もし最前面にある物体のみを取得したい場合、OpenGL レンダリングを実行した後で glReadPixels() を使って、
-		// あるピクセル位置に書き込まれた深度情報を取得して利用することもできる。
-		// もしくは glSelectBuffer(), glRenderMode(GL_SELECT), gluPickMatrix() を使う方法もある。
-		// ただしこれらの方法が OpenGL ES でも利用できるとは限らないので注意。
-		MyMatrix4x4F matUnproj;
-		MyGLHelper::CreateMatrixUnProjectionScreenCoordToWorldCoord(matUnproj, matView, matProj, g_viewport);
-		vWCoord0 = MyGLHelper::TransformVector3Coord(matUnproj, MyVector3F(g_mouseData.CurrentPos.x, g_mouseData.CurrentPos.y, 0));
-		vWCoord1 = MyGLHelper::TransformVector3Coord(matUnproj, MyVector3F(g_mouseData.CurrentPos.x, g_mouseData.CurrentPos.y, 1));
-	}
-
-	MyMatrix4x4F CalcViewMatrix()
-	{
-		const MyMatrix4x4F matLookAt = MyGLHelper::CreateMatrixLookAt(g_camera);
-
-		const MyMatrix4x4F matTrackball = g_myMeshTrackball.GetRotationMatrix();
-
-		return matLookAt * matTrackball;
-	}
-
-	MyMatrix4x4F CalcProjectionMatrix()
-	{
-#if 1
-		return MyGLHelper::CreateMatrixPerspectiveFov(g_viewport, g_persParam);
-#else
-		return MyGLHelper::CreateMatrixOrotho(
-			-g_viewport.Width * 0.5f, +g_viewport.Width * 0.5f, -g_viewport.Height * 0.5f, +g_viewport.Height * 0.5f,
-			g_persParam.Near, g_persParam.Far);
-#endif
-	}
-
-	MyMatrix4x4F CalcTransformMatrixWorldCoordToScreenCoord()
-	{
-		return MyGLHelper::CreateMatrixTransformWorldCoordToScreenCoord(
-			CalcViewMatrix(), CalcProjectionMatrix(), g_viewport);
-	}
-} // end of namespace
-
-void Idle()
-{
-	glutPostRedisplay();
-}
-
-void Reshape(int w, int h)
-{
-	g_viewport.Width = std::max(w, 1);
-	g_viewport.Height = std::max(h, 1);
-
-	g_myMeshTrackball.OnResize(g_viewport.Width, g_viewport.Height);
-}
-
-void Display()
-{
-	const MyVector4F backColor = MyColorFDodgerBlue;
-	glClearColor(backColor.r, backColor.g, backColor.b, backColor.a);
-
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	// プロジェクション行列の設定。
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-#if 0
-#if 1
-	gluPerspective(g_persParam.Fov, static_cast<double>(g_viewport.Width) / g_viewport.Height, g_persParam.Near, g_persParam.Far);
-#else
-	glOrtho(
-		-g_viewport.Width * 0.5f, +g_viewport.Width * 0.5f, -g_viewport.Height * 0.5f, +g_viewport.Height * 0.5f,
-		g_persParam.Near, g_persParam.Far);
-#endif
-#else
-	const MyMatrix4x4F matProj = CalcProjectionMatrix();
-	glMultMatrixf(&matProj[0][0]);
-#endif
-
-	glMatrixMode(GL_MODELVIEW);
-	glViewport(g_viewport.X, g_viewport.Y, g_viewport.Width, g_viewport.Height);
-
-	// 視点の設定。
-#if 0
-	gluLookAt(
-		g_camera.Eye.x, g_camera.Eye.y, g_camera.Eye.z,
-		g_camera.At.x, g_camera.At.y, g_camera.At.z,
-		g_camera.Up.x, g_camera.Up.y, g_camera.Up.z);
-
-	glMultMatrixf(g_myMeshTrackball.GetRotationMatrixAsArray());
-#else
-	const MyMatrix4x4F matView = CalcViewMatrix();
-	glMultMatrixf(&matView[0][0]);
-#endif
-
-	glDisable(GL_BLEND);
-	glEnable(GL_DEPTH_TEST);
-	glDepthMask(true);
-	// トラックボール中心を原点とした座標軸の描画。
-	if (g_rendersCoordAxes)
-	{
-		glDisable(GL_LIGHTING);
-		glBegin(GL_LINES);
-		const float coordLength = 20.0f;
-
-		glColor4fv(&MyColorFRed.r);
-		glVertex3f(0, 0, 0);
-		glVertex3f(coordLength, 0, 0);
-
-		glColor4fv(&MyColorFLime.r);
-		glVertex3f(0, 0, 0);
-		glVertex3f(0, coordLength, 0);
-
-		glColor4fv(&MyColorFBlue.r);
-		glVertex3f(0, 0, 0);
-		glVertex3f(0, 0, coordLength);
-
-		glEnd();
-		glEnable(GL_LIGHTING);
-	}
-
-	MyVector3F vWCoord0, vWCoord1;
-	// 点群の描画。
-	// 同時に、マウス カーソル位置を通り画面に直交するレイと、点との交差判定を行なう。
-	{
-		// もし交差判定の結果を CPU 側で持つ必要がない場合、判定計算を GPU 側（GLSL 頂点シェーダー側）で行なうこともできなくはない。
-		glDisable(GL_LIGHTING);
-		glPointSize(2.0f);
-		glBegin(GL_POINTS);
-
-		// マウス位置をワールド座標に変換する。
-		CalcUnProjectedRayPositions(vWCoord0, vWCoord1, matView, matProj);
-
-		// 点群の交差判定と描画をまとめて行なう。
-		if (g_usesWorldUnitAsIntersectMargin)
-		{
-			// レイをワールド座標へ射影して、点群の各点（小さな球）との交差判定を行なう。
-			const size_t pointsNum = g_pointCloudVertices.size();
-			for (size_t i = 0; i < pointsNum; ++i)
-			{
-				const MyPointData& point = g_pointCloudVertices[i];
-
-				// 画面を貫く無限直線と、ターゲット位置を中心とし交差マージンを半径とする球の交差を調べる。
-				const bool intersects = MyCollision::CheckLineIntersectWithSphere(
-					vWCoord0, vWCoord1, point.Position, IntersectMarginInWolrd);
-
-				const MyVector4F pointColor = intersects ? MyColorFMagenta : (point.IsSelected ? MyColorFBlack : point.Color);
-				glColor4fv(&pointColor.r);
-				glVertex3fv(&point.Position.x);
-			}
-		}
-		else
-		{
-			// 点群の各点を CPU でスクリーン座標変換し、マウス位置と交差するかどうかを調べる。
-			const MyMatrix4x4F matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
-
-			const size_t pointsNum = g_pointCloudVertices.size();
-			for (size_t i = 0; i < pointsNum; ++i)
-			{
-				MyPointData& point = g_pointCloudVertices[i];
-				const MyVector3F vScreen = MyGLHelper::TransformVector3Coord(matToScreen, point.Position);
-				const float mouseX = float(g_mouseData.CurrentPos.x);
-				const float mouseY = float(g_mouseData.CurrentPos.y);
-				const bool intersects = MyCollision::CheckIntersectWithAABBparameterizedMinMax2D(
-					mouseX, mouseY,
-					vScreen.x - IntersectMarginInScreen,
-					vScreen.y - IntersectMarginInScreen,
-					vScreen.x + IntersectMarginInScreen,
-					vScreen.y + IntersectMarginInScreen);
-
-				const MyVector4F pointColor = intersects ? MyColorFMagenta : (point.IsSelected ? MyColorFBlack : point.Color);
-				glColor4fv(&pointColor.r);
-				glVertex3fv(&point.Position.x);
-			}
-		}
-
-		// もし、シーンの拡大縮小（カメラのズームイン・ズームアウト）に関わらず、
-		// 点群の各点が常に一定サイズの OpenGL ポイント プリミティブで描画される場合、
-		// スクリーン座標系での交差判定のほうが都合がよい。
-		// 逆に、カメラが接近すると実サイズを模した多ポリゴンの球で描画されるなど、
-		// 描画される点の大きさがシーンの拡大縮小に左右される場合、
-		// ワールド座標系での交差判定のほうが都合がよい。
-		// 各々のメリットは交差判定マージンをどの座標系で設定するのか、にもよるので、
-		// それを加味してどの座標系での交差判定を行なうかを決定するとよい。
-
-		glEnd();
-		glEnable(GL_LIGHTING);
-	}
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	if (g_mouseData.IsLeftButtonPressed)
-	{
-
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		// 左上を原点とするマウスの 2D 座標を直接指定できるように、正射影する。
-		gluOrtho2D(0, g_viewport.Width, g_viewport.Height, 0);
-
-		// スクリーン選択矩形の描画（半透明）。
-		// 深度テストを切って（無視して）最前面に描画する。深度バッファへの書き込みも禁止しておく。
-		glDisable(GL_LIGHTING);
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		glDisable(GL_DEPTH_TEST);
-		glDepthMask(false);
-
-		{
-			int rectL = 0;
-			int rectT = 0;
-			int rectR = 0;
-			int rectB = 0;
-			g_mouseData.GetNormalizedLDraggingRect(rectL, rectT, rectR, rectB);
-
-			glColor4f(0.0f, 0.4f, 0.4f, 0.5f);
-			glRecti(rectL, rectT, rectR, rectB);
-
-			glColor4f(0.4f, 0.8f, 1.0f, 1.0f);
-			glBegin(GL_LINE_LOOP);
-			glVertex2d(rectL, rectT);
-			glVertex2d(rectR, rectT);
-			glVertex2d(rectR, rectB);
-			glVertex2d(rectL, rectB);
-			glEnd();
-		}
-
-		glEnable(GL_DEPTH_TEST);
-		glDepthMask(true);
-	}
-
-	// メッセージの描画。
-	{
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-
-		glDisable(GL_BLEND);
-		static char message[1024];
-		const int fontSize = 18;
-		const int offsetAmt = 2;
-		// glRasterPos*() と違い、glWindowPos*() は OpenGL 1.4 の機能。
-
-		glColor4fv(&MyColorFWhite.r);
-
-		sprintf_s(message, "Mouse0(%4d, %4d, 0) = World0(%+8.2f, %+8.2f, %+8.2f)",
-			g_mouseData.CurrentPos.x, g_mouseData.CurrentPos.y,
-			vWCoord0.x, vWCoord0.y, vWCoord0.z);
-		glWindowPos2i(offsetAmt, g_viewport.Height - (fontSize + offsetAmt) * 1);
-		MyGLDrawString(GLUT_BITMAP_9_BY_15, message);
-
-		sprintf_s(message, "Mouse1(%4d, %4d, 1) = World1(%+8.2f, %+8.2f, %+8.2f)",
-			g_mouseData.CurrentPos.x, g_mouseData.CurrentPos.y,
-			vWCoord1.x, vWCoord1.y, vWCoord1.z);
-		glWindowPos2i(offsetAmt, g_viewport.Height - (fontSize + offsetAmt) * 2);
-		MyGLDrawString(GLUT_BITMAP_9_BY_15, message);
-
-		glColor4fv(&MyColorFLime.r);
-
-		sprintf_s(message, "L-Click/L-Drag:Select, R-Drag:Rotation, Wheel:Zoom");
-		glWindowPos2i(offsetAmt, g_viewport.Height - (fontSize + offsetAmt) * 3);
-		MyGLDrawString(GLUT_BITMAP_9_BY_15, message);
-	}
-
-	glutSwapBuffers();
-}
-
-void Mouse(int button, int state, int x, int y)
-{
-	switch (button)
-	{
-	case GLUT_LEFT_BUTTON:
-		g_mouseData.IsLeftButtonPressed = (state == GLUT_DOWN);
-		if (g_mouseData.IsLeftButtonPressed)
-		{
-			g_mouseData.DragStartPosL = MyVector2I(x, y);
-		}
-		else
-		{
-			// ドラッグ開始位置と終了位置がほぼ同じ場合、小範囲ピッキングとみなす。
-			// 異なる場合は広範囲矩形選択とみなす。
-			// 交差判定の計算量は O(n) となる。
-			const MyVector2I vDiff = g_mouseData.DragStartPosL - MyVector2I(x, y);
-			if (MyMath::GetVectorLength(vDiff) < 2)
-			{
-				if (g_usesWorldUnitAsIntersectMargin)
-				{
-					// レイをワールド座標へ射影して、点群の各点（小さな球）との交差判定を行なう。
-					const MyMatrix4x4F matView = CalcViewMatrix();
-					const MyMatrix4x4F matProj = CalcProjectionMatrix();
-					MyVector3F vWCoord0, vWCoord1;
-					CalcUnProjectedRayPositions(vWCoord0, vWCoord1, matView, matProj);
-
-					const size_t pointsNum = g_pointCloudVertices.size();
-					for (size_t i = 0; i < pointsNum; ++i)
-					{
-						MyPointData& point = g_pointCloudVertices[i];
-
-						// 画面を貫く無限直線と、ターゲット位置を中心とし交差マージンを半径とする球の交差を調べる。
-						const bool intersects = MyCollision::CheckLineIntersectWithSphere(
-							vWCoord0, vWCoord1, point.Position, IntersectMarginInWolrd);
-						// 交差している場合、選択状態を反転。交差していない場合、変更しない。
-						if (intersects)
-						{
-							point.IsSelected = !point.IsSelected;
-						}
-					}
-				}
-				else
-				{
-					// 点群の各点を CPU でスクリーン座標変換し、マウス位置と交差するかどうかを調べる。
-					// 変換結果の深度値（スクリーン座標系における Z 座標）を使えば、画面手前のオブジェクトだけ選択する、ということもできる。
-					const MyMatrix4x4F matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
-
-					const size_t pointsNum = g_pointCloudVertices.size();
-					for (size_t i = 0; i < pointsNum; ++i)
-					{
-						MyPointData& point = g_pointCloudVertices[i];
-						const MyVector3F vScreen = MyGLHelper::TransformVector3Coord(matToScreen, point.Position);
-						const float mouseX = float(g_mouseData.CurrentPos.x);
-						const float mouseY = float(g_mouseData.CurrentPos.y);
-						const bool intersects = MyCollision::CheckIntersectWithAABBparameterizedMinMax2D(
-							mouseX, mouseY,
-							vScreen.x - IntersectMarginInScreen,
-							vScreen.y - IntersectMarginInScreen,
-							vScreen.x + IntersectMarginInScreen,
-							vScreen.y + IntersectMarginInScreen);
-						// 交差している場合、選択状態を反転。交差していない場合、変更しない。
-						if (intersects)
-						{
-							point.IsSelected = !point.IsSelected;
-						}
-					}
-				}
-			}
-			else
-			{
-				// 点群の各点を CPU でスクリーン座標変換し、ドラッグによる選択矩形と交差するかどうかを調べる。
-				// スクリーン選択矩形をワールド座標系に射影して交差判定をするのは非常に複雑になり、非効率。
-				const MyMatrix4x4F matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
-				int rectL = 0;
-				int rectT = 0;
-				int rectR = 0;
-				int rectB = 0;
-				g_mouseData.GetNormalizedLDraggingRect(rectL, rectT, rectR, rectB);
-				const size_t pointsNum = g_pointCloudVertices.size();
-				for (size_t i = 0; i < pointsNum; ++i)
-				{
-					MyPointData& point = g_pointCloudVertices[i];
-					const MyVector3F vScreen = MyGLHelper::TransformVector3Coord(matToScreen, point.Position);
-					const bool intersects = MyCollision::CheckIntersectWithAABBparameterizedMinMax2D(
-						int(vScreen.x), int(vScreen.y), rectL, rectT, rectR, rectB);
-					point.IsSelected = intersects;
-				}
-			}
-		}
-		break;
-	case GLUT_RIGHT_BUTTON:
-		g_mouseData.IsRightButtonPressed = (state == GLUT_DOWN);
-		if (g_mouseData.IsRightButtonPressed)
-		{
-			g_mouseData.DragStartPosR = MyVector2I(x, y);
-			// トラックボール開始。
-			g_myMeshTrackball.OnMouseDragStart(x, y);
-		}
-		else
-		{
-			// トラックボール停止。
-			g_myMeshTrackball.OnMouseDragStop(x, y);
-		}
-		break;
-	default:
-		break;
-	}
-}
-
-// マウス ドラッグ時。
-void Motion(int x, int y)
-{
-	g_mouseData.CurrentPos = MyVector2I(x, y);
-	if (g_mouseData.IsRightButtonPressed)
-	{
-		// トラックボール移動。
-		g_myMeshTrackball.OnMouseDragging(x, y);
-	}
-}
-
-// マウス移動時。ドラッグ中は呼ばれない。
-void PassiveMotion(int x, int y)
-{
-	g_mouseData.CurrentPos = MyVector2I(x, y);
-}
-
-void Keyboard(unsigned char key, int x, int y)
-{
-	switch (key)
-	{
-	case '\033':
-		//exit(0);
-		::PostQuitMessage(key);
-		break;
-
-	case 'f':
-		break;
-
-	case 'a':
-		g_rendersCoordAxes = !g_rendersCoordAxes;
-		printf("g_rendersCoordAxes = %d\n", g_rendersCoordAxes);
-		break;
-
-	case 's':
-		g_usesWorldUnitAsIntersectMargin = false;
-		printf("g_usesWorldUnitAsIntersectMargin = %d\n", g_usesWorldUnitAsIntersectMargin);
-		break;
-
-	case 't':
-		break;
-
-	case 'w':
-		g_usesWorldUnitAsIntersectMargin = true;
-		printf("g_usesWorldUnitAsIntersectMargin = %d\n", g_usesWorldUnitAsIntersectMargin);
-		break;
-
-	case 'm':
-		break;
-
-	default:
-		break;
-	}
-}
-
-void Special(int key, int x, int y)
-{
-	switch (key)
-	{
-	case GLUT_KEY_F1:
-		break;
-
-	case GLUT_KEY_F2:
-		break;
-
-	case GLUT_KEY_F3:
-		break;
-
-	case GLUT_KEY_F4:
-		break;
-
-	case GLUT_KEY_F5:
-		break;
-
-	case GLUT_KEY_F6:
-		break;
-
-	case GLUT_KEY_F7:
-		break;
-
-	case GLUT_KEY_F8:
-		break;
-
-	case GLUT_KEY_F9:
-		break;
-
-	case GLUT_KEY_F10:
-		break;
-
-	case GLUT_KEY_F11:
-		break;
-
-	case GLUT_KEY_F12:
-		break;
-
-	case GLUT_KEY_LEFT:
-		break;
-
-	case GLUT_KEY_RIGHT:
-		break;
-
-	case GLUT_KEY_UP:
-		break;
-
-	case GLUT_KEY_DOWN:
-		break;
-
-	case GLUT_KEY_PAGE_UP:
-		break;
-
-	case GLUT_KEY_PAGE_DOWN:
-		break;
-
-	case GLUT_KEY_HOME:
-		break;
-
-	case GLUT_KEY_END:
-		break;
-
-	case GLUT_KEY_INSERT:
-		break;
-	}
-}
-
-void OnMouseWheel(int wheelNumber, int direction, int x, int y)
-{
-	if (direction > 0)
-	{
-		g_camera.Eye.z -= 1;
-		const float LimitDistance = 1;
-		if (g_camera.Eye.z <= LimitDistance)
-		{
-			g_camera.Eye.z = LimitDistance;
-		}
-	}
-	else if (direction < 0)
-	{
-		g_camera.Eye.z += 1;
-	}
-}
-
-int main(int argc, char** argv)
-{
-	glutInit(&argc, argv);
-	glutInitWindowPosition(100, 100);
-	glutInitWindowSize(720, 720);
-	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
-	glutCreateWindow("OpenGL Ray Pickup Test");
-	glutDisplayFunc(Display);
-	glutReshapeFunc(Reshape);
-	glutIdleFunc(Idle);
-	glutMouseFunc(Mouse);
-	glutMotionFunc(Motion);
-	glutPassiveMotionFunc(PassiveMotion);
-	glutKeyboardFunc(Keyboard);
-	glutSpecialFunc(Special);
-	glutMouseWheelFunc(OnMouseWheel);
-	// メイン ウィンドウにクローズ メッセージが投げられたときに、メイン ループを抜ける。
-	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
-
-	InitializeApp();
-
-	glutMainLoop();
-
-	return 0;
-}
+﻿#include "stdafx.h"
+#include "MyTrackball.hpp"
+#include "MyCollisionHelper.hpp"
+#include "MyCollisionBatch.hpp"
+#include "MyGLHelper.hpp"
+#include "MyGLHelperBatch.hpp"
+#include "MyPointOctree.hpp"
+#include "MyPointCloudStore.hpp"
+#include "MyJobSystem.hpp"
+#include "MyScreenTileGrid.hpp"
+#include "MyTransformCache.hpp"
+#include "MyPointCloudRenderer.hpp"
+#include "MyPointCloudLoader.hpp"
+#include "MyPointCache.hpp"
+#include "MyPagedPointCloud.hpp"
+#include "MyPagedPointCloudRenderer.hpp"
+#include "MyPointIngest.hpp"
+#include "MyPointPicker.hpp"
+#include "MyPointGenerator.hpp"
+#include "MyMortonOrder.hpp"
+#include "MySelectionHistory.hpp"
+#include "MyFrameScheduler.hpp"
+#include "MyFrameProfiler.hpp"
+#include "MyInputTrace.hpp"
+#include "MyTextOverlay.hpp"
+#include "MySelfCheck.hpp"
+
+
+#pragma comment(lib, "glew32.lib")
+
+
+namespace
+{
+	// ワールド座標系での交差判定のマージン[Length]。
+	const float IntersectMarginInWolrd = 0.2f;
+	// スクリーン座標系での交差判定のマージン[Pixels]。
+	const float IntersectMarginInScreen = 2.0f;
+
+	// 描画時に使う、パック済みの点の色。
+	const uint32_t PackedColorHovered = MyMath::PackColorToRGBA8(MyColorFMagenta);
+	const uint32_t PackedColorSelected = MyMath::PackColorToRGBA8(MyColorFBlack);
+
+	// ストリーミング入力（'i' キーで開始・停止）の合成センサーの出力レート[Points/s]。
+	const double IngestPointsPerSecond = 2 * 1000 * 1000;
+	// 生産者スレッドとの間のリング バッファの点数。1 点 16 バイト。
+	const size_t IngestRingCapacity = 1024 * 1024;
+	// ストリーミング入力で追加できる点数。取り込み中に点群の配列や頂点バッファを再確保しないように、入力開始時に確保しておく。
+	const size_t IngestCapacityPointsNum = 16 * 1024 * 1024;
+	// 1 フレームで取り込む点数の上限。入力が溜まっていても、1 フレームの処理時間が大きく延びないようにする。
+	const size_t MaxIngestPointsPerFrame = 128 * 1024;
+
+	// フレーム レートの上限（'r' キーで切り替え）[Frames/s]。
+	const double CappedFramesPerSecond = 60;
+	// CPU 時間を計測する処理。ProfilePhaseNames と同じ順序。
+	enum ProfilePhase
+	{
+		ProfilePhase_Frame, //!< Display() 全体。<br>
+		ProfilePhase_Ingest, //!< ストリーミング入力の取り込み。<br>
+		ProfilePhase_Hover, //!< ホバー判定。<br>
+		ProfilePhase_Submit, //!< 表示色バッファの更新と点群の描画コマンドの発行。<br>
+		ProfilePhase_Overlay, //!< メッセージの描画。<br>
+		ProfilePhase_Swap, //!< glutSwapBuffers()。<br>
+		ProfilePhase_Click, //!< クリックによる選択。<br>
+		ProfilePhase_Rect, //!< 矩形による選択。<br>
+		ProfilePhase_Latency, //!< マウス移動のイベントから、ホバー判定の結果を表示したフレームの glutSwapBuffers() までの時間。<br>
+		ProfilePhase_Count,
+	};
+	const char* const ProfilePhaseNames[ProfilePhase_Count] = { "Frame", "Ingest", "Hover", "Submit", "Overlay", "Swap", "Click", "Rect", "Latency" };
+	// マウス移動からホバー表示までの遅延の予算[s]。60 fps の 2 フレーム分を超えたフレームを数える。
+	const double HoverLatencyBudgetSeconds = 2 / CappedFramesPerSecond;
+	// 画面に重ねて表示する文字列の行。MyTextOverlay の行番号。
+	enum OverlayRow
+	{
+		OverlayRow_Mouse0,
+		OverlayRow_Mouse1,
+		OverlayRow_Usage,
+		OverlayRow_Status, //!< ページング、ストリーミング入力、ホバーのいずれかの状態。<br>
+		OverlayRow_Profile, //!< ここから ProfilePhase_Count 行。<br>
+		OverlayRow_Latency = OverlayRow_Profile + ProfilePhase_Count,
+	};
+	// 処理ごとのヒストグラムの書き出し先（'O' キー）。
+	const char* const FrameProfileCsvFilePath = "GLRayPickupProfile.csv";
+	const char* const FrameProfileJsonFilePath = "GLRayPickupProfile.json";
+
+	// F5 キーで記録する入力イベントのトレース。GLRayPickupBench --replay で再生する。
+	const char* const InputTraceFilePath = "GLRayPickupInput.mytrace";
+
+	// ホバー判定をやり直す必要があるダーティ フラグ。選択状態の変化だけならホバー判定の結果は変わらない。
+	const uint32_t HoverDirtyFlags =
+		MyFrameScheduler::DirtyFlag_Hover | MyFrameScheduler::DirtyFlag_Camera | MyFrameScheduler::DirtyFlag_Viewport |
+		MyFrameScheduler::DirtyFlag_Scene | MyFrameScheduler::DirtyFlag_Streaming;
+
+	// 点群ファイルを指定しない場合に生成する点群の点数、半径、乱数のシード。
+	const size_t DefaultGeneratedPointsNum = 1000;
+	const float GeneratedPointCloudRadius = 10.0f;
+	const uint64_t DefaultGeneratedPointCloudSeed = 1;
+	// 総当たりとの比較による検証を行なう点数の上限。これより大きい点群を生成した場合は、検証を省略する。
+	const size_t MaxVerifiedPointsNum = 1000 * 1000;
+
+
+#pragma region // グローバル変数。//
+
+	MyGLHelper::Viewport g_viewport = { 0, 0, 0, 0, 0.0f, 1.0f };
+	MyGLHelper::PerspectiveParam g_persParam = { 45.0f, 0.1f, 1000.0f };
+	MyGLHelper::CameraParam g_camera(MyVector3F(0, 0, 80), MyVector3F(0, 0, 0), MyVector3F(0, 1, 0));
+
+	class MouseData
+	{
+	public:
+		bool IsLeftButtonPressed = false;
+		bool IsMiddleButtonPressed = false;
+		bool IsRightButtonPressed = false;
+		MyVector2I DragStartPosL = {};
+		MyVector2I DragStartPosM = {};
+		MyVector2I DragStartPosR = {};
+		MyVector2I CurrentPos = {};
+	public:
+		MouseData()
+		{}
+	public:
+		void GetNormalizedLDraggingRect(int& rectL, int& rectT, int& rectR, int& rectB) const
+		{
+			// 左上座標＜右下座標となるように正規化する。
+			if (this->CurrentPos.x < this->DragStartPosL.x)
+			{
+				rectL = this->CurrentPos.x;
+				rectR = this->DragStartPosL.x;
+			}
+			else
+			{
+				rectL = this->DragStartPosL.x;
+				rectR = this->CurrentPos.x;
+			}
+			if (this->CurrentPos.y < this->DragStartPosL.y)
+			{
+				rectT = this->CurrentPos.y;
+				rectB = this->DragStartPosL.y;
+			}
+			else
+			{
+				rectT = this->DragStartPosL.y;
+				rectB = this->CurrentPos.y;
+			}
+		}
+	};
+	MouseData g_mouseData;
+
+	MyTrackball g_myMeshTrackball;
+
+	// ビュー・プロジェクション関連の行列のキャッシュ。g_camera, g_viewport, g_persParam を変更したら対応する Invalidate*() を呼ぶこと。
+	MyTransformCache g_transformCache(g_camera, g_viewport, g_persParam, g_myMeshTrackball, MyTransformCache::ProjectionType_Perspective);
+
+	// 点群データ。各点のワールド位置座標、色、マウス クリックなどにより選択されているかどうか、を保持する。
+	MyPointCloudStore g_pointCloud;
+
+	// 点群の空間インデックス。ワールド座標系での交差判定に使う。
+	MyPointOctree g_pointOctree;
+	// 交差判定結果の点インデックス。毎フレームのメモリ確保を避けるため使い回す。
+	std::vector<uint32_t> g_hitPointIndices;
+	// ホバー中の点のビットマスク（64 点単位）。同じく使い回す。
+	std::vector<uint64_t> g_hitMaskWords;
+
+	// 点群全体に対する交差判定や選択状態の更新を並列化するためのジョブ システム。
+	MyJobSystem g_jobSystem;
+
+	// ピッキングと矩形選択。スクリーン座標系でのホバー判定に使うタイル グリッドも保持し、カメラやビューポートが変化したときだけ再構築する。
+	MyPointPicker g_pointPicker(g_jobSystem);
+
+	// 選択操作の取り消し・やり直し。操作ごとに選択状態が変わった点の集合だけを記録する。
+	// 記録に使ってよいメモリ量は、コマンドラインの第 3 引数（MB 単位）で変更できる。
+	MySelectionHistory g_selectionHistory;
+
+	// 点群の描画。位置と表示色をバッファ オブジェクトに保持する。
+	MyPointCloudRenderer g_pointRenderer(PackedColorHovered, PackedColorSelected);
+
+	// マウス位置などのメッセージ。グリフ アトラスを使って、全行を 1 回の描画呼び出しで描画する。
+	MyTextOverlay g_textOverlay;
+
+	// 点群ファイルから作成した量子化キャッシュ。点群ファイルを読み込んだ場合のみ開かれる。
+	MyPointCache g_pointCache;
+	std::string g_pointCacheFilePath;
+
+	// 展開後の点群がメモリ予算に収まらない場合に、量子化キャッシュをチャンク単位でページングして扱う。開かれている間 g_pointCloud は空。
+	MyPagedPointCloud g_pagedPointCloud;
+	MyPagedPointCloudRenderer g_pagedPointRenderer(PackedColorHovered);
+	// 点群の常駐に使ってよいメモリ量。コマンドラインの第 2 引数（MB 単位）で変更できる。
+	size_t g_pagedMemoryBudgetBytes = size_t(1024) * 1024 * 1024;
+	// 視錐台と交差するチャンク（視点からの距離の 2 乗、チャンク インデックス）。近い順に読み込みを要求する。使い回す。
+	std::vector<std::pair<float, uint32_t>> g_pagedVisibleChunks;
+
+	// センサーなどからのストリーミング入力。生産者スレッドからリング バッファ経由で受け取り、毎フレーム点群と八分木に追加する。
+	MyPointIngest g_pointIngest(IngestRingCapacity);
+	// リング バッファから取り出した点。使い回す。
+	std::vector<MyPointIngest::Point> g_ingestedPoints;
+
+	// ストリーミング入力中のフレーム時間の計測。
+	class IngestMonitor
+	{
+	public:
+		std::chrono::steady_clock::time_point LastFrameTime = {};
+		std::chrono::steady_clock::time_point LastReportTime = {};
+		double WorstFrameSeconds = 0; //!< 入力開始後のフレーム間隔の最大値（最悪のヒッチ）。<br>
+		double WorstIngestSeconds = 0; //!< 入力開始後の、1 フレームぶんの取り込み処理時間の最大値。<br>
+		double LastIngestSeconds = 0;
+	};
+	IngestMonitor g_ingestMonitor;
+
+	// 入力イベントで立てたダーティ フラグに基づいて、必要なときだけ描画する。
+	// アイドル時に描画し続けないので、何も操作していなければ CPU をほとんど使わない。
+	MyFrameScheduler g_frameScheduler;
+
+	// フレーム内の処理ごとの CPU 時間。'o' キーで p50/p99 の表示を切り替える。
+	MyFrameProfiler g_frameProfiler;
+	bool g_showsFrameProfile = false;
+
+	// マウス移動からホバー表示までの遅延。'h' キーで、ホバー判定を描画時ではなくイベントの到着時に行なうように切り替える。
+	MyInputLatencyTracker g_hoverLatencyTracker(g_frameProfiler, ProfilePhase_Latency, HoverLatencyBudgetSeconds);
+	bool g_resolvesHoverAtEventTime = false;
+
+	// 入力イベントの記録。再生時に同じ点群を生成し直すので、生成した点群の条件も覚えておく。
+	MyInputRecorder g_inputRecorder;
+	bool g_isPointCloudGenerated = false;
+	MyPointGenerator::Distribution g_generatedDistribution = MyPointGenerator::Distribution_SphereShell;
+	size_t g_generatedPointsNum = 0;
+	uint64_t g_generatedSeed = 0;
+
+	bool g_rendersCoordAxes = true;
+	bool g_usesWorldUnitAsIntersectMargin = false;
+
+#pragma endregion
+
+
+	void WaitForUserInput()
+	{
+		puts("Press any...");
+		_getch();
+	}
+
+	// 検証や計測で使う、固定カメラ（800x600 のビューポート）のワールド→スクリーン変換行列を作成する。
+	MyMatrix4x4F CreateFixedTransformMatrixWorldCoordToScreenCoord()
+	{
+		const MyMatrix4x4F matView = glm::lookAt(MyVector3F(3, 5, 30), MyVector3F(0, 0, 0), MyVector3F(0, 1, 0));
+		const MyMatrix4x4F matProj = glm::perspectiveFov(glm::radians(45.0f), 800.0f, 600.0f, 0.5f, 1000.0f);
+		MyMatrix4x4F matViewport(1.0f);
+		matViewport[0][0] = 400;
+		matViewport[1][1] = -300;
+		matViewport[3][0] = 400;
+		matViewport[3][1] = 300;
+		return matViewport * matProj * matView;
+	}
+
+	// 八分木から点の位置座標を参照するための関数オブジェクト。
+	struct MyPointPositionGetter
+	{
+		MyVector3F operator()(uint32_t index) const
+		{ return g_pointCloud.GetPosition(index); }
+	};
+
+	// 従来の AoS レイアウト（点ごとに位置・色・選択状態をまとめた構造体）。SoA との比較計測にのみ使う。
+	struct MyLegacyPointData
+	{
+		MyVector3F Position;
+		MyVector4F Color;
+		bool IsSelected;
+	};
+
+	// AoS と SoA とで、1 点あたりのメモリ量と、位置座標だけを読む交差判定ループのスループットを計測して表示する。
+	void MeasurePointStoreLayout()
+	{
+		const size_t pointsNum = g_pointCloud.GetPointsNum();
+		if (pointsNum == 0)
+		{
+			return;
+		}
+
+		std::vector<MyLegacyPointData> legacyPoints(pointsNum);
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			legacyPoints[i].Position = g_pointCloud.GetPosition(i);
+			legacyPoints[i].Color = MyMath::UnpackColorFromRGBA8<float>(g_pointCloud.GetPackedColor(i));
+			legacyPoints[i].IsSelected = g_pointCloud.IsSelected(i);
+		}
+
+		// 合計で 1000 万点程度を走査するように繰り返す。
+		const size_t repeatsNum = std::max<size_t>(1, 10 * 1000 * 1000 / pointsNum);
+		const double scannedPointsNum = double(pointsNum) * repeatsNum;
+		const MyVector3F linePos1(0, 0, -100);
+		const MyVector3F linePos2(0, 0, +100);
+		typedef std::chrono::steady_clock Clock;
+
+		size_t aosHitsNum = 0;
+		const auto aosStartTime = Clock::now();
+		for (size_t r = 0; r < repeatsNum; ++r)
+		{
+			for (size_t i = 0; i < pointsNum; ++i)
+			{
+				if (MyCollision::CheckLineIntersectWithSphere(linePos1, linePos2, legacyPoints[i].Position, IntersectMarginInWolrd))
+				{
+					++aosHitsNum;
+				}
+			}
+		}
+		const double aosSeconds = std::chrono::duration<double>(Clock::now() - aosStartTime).count();
+
+		size_t soaHitsNum = 0;
+		const float* pPosX = g_pointCloud.GetPositionsX();
+		const float* pPosY = g_pointCloud.GetPositionsY();
+		const float* pPosZ = g_pointCloud.GetPositionsZ();
+		const auto soaStartTime = Clock::now();
+		for (size_t r = 0; r < repeatsNum; ++r)
+		{
+			for (size_t i = 0; i < pointsNum; ++i)
+			{
+				if (MyCollision::CheckLineIntersectWithSphere(linePos1, linePos2, MyVector3F(pPosX[i], pPosY[i], pPosZ[i]), IntersectMarginInWolrd))
+				{
+					++soaHitsNum;
+				}
+			}
+		}
+		const double soaSeconds = std::chrono::duration<double>(Clock::now() - soaStartTime).count();
+
+		size_t batchHitsNum = 0;
+		const MyCollision::LineSphereBatchQuery query(linePos1, linePos2, IntersectMarginInWolrd);
+		const auto batchStartTime = Clock::now();
+		for (size_t r = 0; r < repeatsNum; ++r)
+		{
+			g_hitPointIndices.clear();
+			MyCollision::CheckLineIntersectWithSphereBatch(query, pPosX, pPosY, pPosZ, 0, pointsNum, g_hitPointIndices);
+			batchHitsNum += g_hitPointIndices.size();
+		}
+		const double batchSeconds = std::chrono::duration<double>(Clock::now() - batchStartTime).count();
+
+		printf("AoS: %.3f bytes/point (%d bytes/point streamed), %.1f Mpoints/s (hits = %d)\n",
+			double(sizeof(MyLegacyPointData)), int(sizeof(MyLegacyPointData)),
+			scannedPointsNum / aosSeconds * 1e-6, int(aosHitsNum));
+		printf("SoA: %.3f bytes/point (%d bytes/point streamed), %.1f Mpoints/s (hits = %d)\n",
+			MyPointCloudStore::GetBytesPerPoint(), int(sizeof(float) * 3),
+			scannedPointsNum / soaSeconds * 1e-6, int(soaHitsNum));
+		printf("SoA + %s batch: %.1f Mpoints/s (hits = %d)\n",
+			MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::GetActiveSimdLevel()),
+			scannedPointsNum / batchSeconds * 1e-6, int(batchHitsNum));
+	}
+
+	// スクリーン座標系での矩形選択とクリック反転を、スレッド数 1 から最大まで変えて計測し、スケーリングを表示する。
+	// 各スレッド数での選択結果が、1 スレッドの場合とビット単位で一致することも確認する。
+	void MeasureSelectionScaling()
+	{
+		// 表示用の点群とは別に、計測用の大きな点群を作る。
+		const size_t pointsNum = 8 * 1000 * 1000;
+		const int repeatsNum = 5;
+		MyPointCloudStore store;
+		MyPointGenerator::GeneratePointsParallel(g_jobSystem, store, pointsNum, MyPointGenerator::Distribution_UniformBox, 10.0f, DefaultGeneratedPointCloudSeed);
+		const MyMatrix4x4F matToScreen = CreateFixedTransformMatrixWorldCoordToScreenCoord();
+		std::vector<uint64_t> expectedRectSelection;
+		std::vector<uint64_t> expectedToggleSelection;
+		typedef std::chrono::steady_clock Clock;
+
+		const unsigned originalThreadsNum = g_jobSystem.GetActiveThreadsNum();
+		double rectSecondsSingle = 0;
+		double toggleSecondsSingle = 0;
+		for (unsigned threadsNum = 1; threadsNum <= g_jobSystem.GetMaxThreadsNum(); ++threadsNum)
+		{
+			g_jobSystem.SetActiveThreadsNum(threadsNum);
+
+			double rectSeconds = std::numeric_limits<double>::max();
+			for (int r = 0; r < repeatsNum; ++r)
+			{
+				const auto startTime = Clock::now();
+				g_pointPicker.SelectPointsIntersectWithScreenRectParallel(store, matToScreen, 200, 150, 600, 450, MyBitsetOps::SetOperation_Replace);
+				rectSeconds = std::min(rectSeconds, std::chrono::duration<double>(Clock::now() - startTime).count());
+			}
+			const std::vector<uint64_t> rectSelection(store.GetSelectionWords(), store.GetSelectionWords() + store.GetSelectionWordsNum());
+
+			// 奇数回反転するので、最終的には 1 回反転した状態になる。
+			double toggleSeconds = std::numeric_limits<double>::max();
+			store.ClearSelection();
+			for (int r = 0; r < repeatsNum; ++r)
+			{
+				const auto startTime = Clock::now();
+				g_pointPicker.SelectPointsIntersectWithScreenPosParallel(store, matToScreen, 400, 300, 20, MyBitsetOps::SetOperation_SymmetricDifference);
+				toggleSeconds = std::min(toggleSeconds, std::chrono::duration<double>(Clock::now() - startTime).count());
+			}
+			const std::vector<uint64_t> toggleSelection(store.GetSelectionWords(), store.GetSelectionWords() + store.GetSelectionWordsNum());
+
+			if (threadsNum == 1)
+			{
+				rectSecondsSingle = rectSeconds;
+				toggleSecondsSingle = toggleSeconds;
+				expectedRectSelection = rectSelection;
+				expectedToggleSelection = toggleSelection;
+			}
+			const bool isIdentical = (rectSelection == expectedRectSelection) && (toggleSelection == expectedToggleSelection);
+			printf("%2u threads: rect %7.2f ms (%6.1f Mpoints/s, x%.2f), click %7.2f ms (x%.2f), identical = %d\n",
+				threadsNum,
+				rectSeconds * 1e3, pointsNum / rectSeconds * 1e-6, rectSecondsSingle / rectSeconds,
+				toggleSeconds * 1e3, toggleSecondsSingle / toggleSeconds,
+				isIdentical);
+		}
+		g_jobSystem.SetActiveThreadsNum(originalThreadsNum);
+	}
+	// ランダムな点群を生成する。点の位置は (seed, 点のインデックス) だけから決まるので、スレッド数によらず同じ点群になる。
+	void GenerateRandomPointCloud(MyPointGenerator::Distribution distribution, size_t pointsNum, uint64_t seed)
+	{
+		typedef std::chrono::steady_clock Clock;
+		const auto startTime = Clock::now();
+		MyPointGenerator::GeneratePointsParallel(g_jobSystem, g_pointCloud, pointsNum, distribution, GeneratedPointCloudRadius, seed);
+		// 色は象限ごとに分けてみる。X, Y, Z 成分がすべて正ならば黄色、すべて負ならばシアン、さもなくば白。
+		// 3 色しかないので、パレットのインデックス（1 点 1 バイト）で持つ。
+		enum { PaletteIndexWhite, PaletteIndexYellow, PaletteIndexCyan };
+		const uint32_t palette[] =
+		{
+			MyMath::PackColorToRGBA8(MyColorFWhite),
+			MyMath::PackColorToRGBA8(MyColorFYellow),
+			MyMath::PackColorToRGBA8(MyColorFCyan),
+		};
+		g_pointCloud.SetPalette(palette, sizeof(palette) / sizeof(palette[0]));
+		const float* pPosX = g_pointCloud.GetPositionsX();
+		const float* pPosY = g_pointCloud.GetPositionsY();
+		const float* pPosZ = g_pointCloud.GetPositionsZ();
+		uint8_t* pPaletteIndices = g_pointCloud.GetPaletteIndices();
+		g_jobSystem.ParallelFor(pointsNum, MyPointGenerator::ChunkPointsNum, [=](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				if (pPosX[i] > 0 && pPosY[i] > 0 && pPosZ[i] > 0)
+				{
+					pPaletteIndices[i] = PaletteIndexYellow;
+				}
+				else if (pPosX[i] < 0 && pPosY[i] < 0 && pPosZ[i] < 0)
+				{
+					pPaletteIndices[i] = PaletteIndexCyan;
+				}
+				else
+				{
+					pPaletteIndices[i] = PaletteIndexWhite;
+				}
+			}
+		});
+		g_pointCloud.NotifyColorsModified();
+		const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		printf("Generated %zu points (%s, seed %llu) in %.3f sec = %.1f Mpoints/s\n",
+			pointsNum, MyPointGenerator::GetDistributionName(distribution), static_cast<unsigned long long>(seed),
+			seconds, pointsNum / seconds * 1e-6);
+	}
+
+	// 点群を Morton 順に並べ替えて、空間的に近い点をメモリ上でも連続させる。空間インデックスの構築前に行なうこと。
+	// 読み込んだ点群は量子化キャッシュ（Morton 順）からデコードするので、既にこの順序になっている。
+	void ReorderPointCloudByMortonCode()
+	{
+		typedef std::chrono::steady_clock Clock;
+		const auto startTime = Clock::now();
+		std::vector<uint32_t> order;
+		MyMortonOrder::SortByMortonCodeParallel(g_jobSystem,
+			g_pointCloud.GetPositionsX(), g_pointCloud.GetPositionsY(), g_pointCloud.GetPositionsZ(), g_pointCloud.GetPointsNum(), order);
+		MyMortonOrder::ReorderStoreParallel(g_jobSystem, g_pointCloud, order);
+		const double seconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+		printf("Reordered %zu points by Morton code in %.3f sec = %.1f Mpoints/s\n",
+			g_pointCloud.GetPointsNum(), seconds, g_pointCloud.GetPointsNum() / seconds * 1e-6);
+	}
+
+	// "<分布名>:<点数>[:<シード>]" の形式の文字列を、生成する点群の指定として解釈する。
+	// 分布名は MyPointGenerator::GetDistributionName() の名前で、1 文字のドライブ名を含むファイル パスとは区別できる。
+	// 点数は 1～UINT32_MAX の整数（"1e8" のような指数表記も可）、シードは 10 進の整数で、どちらも末尾まで解釈できなければ失敗とする。
+	// 失敗した場合は出力引数を変更しない。
+	bool ParseGeneratedPointCloudSpec(const char* pSpec, MyPointGenerator::Distribution& outDistribution, size_t& outPointsNum, uint64_t& outSeed)
+	{
+		const char* pColon = strchr(pSpec, ':');
+		if (!pColon)
+		{
+			return false;
+		}
+		const std::string distributionName(pSpec, pColon);
+		MyPointGenerator::Distribution distribution;
+		if (!MyPointGenerator::FindDistributionByName(distributionName.c_str(), distribution))
+		{
+			return false;
+		}
+		const char* pPointsNumText = pColon + 1;
+		char* pEnd = nullptr;
+		const double pointsNum = strtod(pPointsNumText, &pEnd);
+		if (pEnd == pPointsNumText || !std::isfinite(pointsNum) || pointsNum < 1 || pointsNum > double(UINT32_MAX) || pointsNum != std::floor(pointsNum))
+		{
+			printf("Invalid point count in \"%s\".\n", pSpec);
+			return false;
+		}
+		uint64_t seed = DefaultGeneratedPointCloudSeed;
+		if (*pEnd == ':')
+		{
+			// strtoull() は先頭の空白や符号も受け付けるので、数字で始まることを先に確かめる。
+			const char* pSeedText = pEnd + 1;
+			errno = 0;
+			seed = strtoull(pSeedText, &pEnd, 10);
+			if (!isdigit(static_cast<unsigned char>(*pSeedText)) || errno == ERANGE || *pEnd != '\0')
+			{
+				printf("Invalid seed in \"%s\".\n", pSpec);
+				return false;
+			}
+		}
+		else if (*pEnd != '\0')
+		{
+			printf("Invalid point count in \"%s\".\n", pSpec);
+			return false;
+		}
+		outDistribution = distribution;
+		outPointsNum = size_t(pointsNum);
+		outSeed = seed;
+		return true;
+	}
+
+	// 回転式の LiDAR を模した合成センサー。生産者スレッドで呼ばれるので、rand() ではなく自前の乱数生成器を使う。
+	// 方位角を回しながら仰角方向に並んだ複数のチャンネルで走査し、原点を囲む凹凸のある壁面上の点を出力する。
+	// 1 回転ごとに方位角と仰角の走査線を少しずらすので、点は重ならずに増え続ける。
+	struct SyntheticSensor
+	{
+		static const int ChannelsNum = 32;
+
+		std::mt19937 Random;
+		std::normal_distribution<float> Noise;
+		double Azimuth;
+		double Precession;
+
+		SyntheticSensor()
+			: Random(12345)
+			, Noise(0.0f, 0.02f)
+			, Azimuth(0)
+			, Precession(0)
+		{}
+
+		size_t operator()(MyPointIngest::Point* pOutPoints, size_t maxCount)
+		{
+			const double azimuthStep = 0.2 * MyMath::F_PI / 180;
+			const size_t columnsNum = maxCount / ChannelsNum;
+			for (size_t col = 0; col < columnsNum; ++col)
+			{
+				Azimuth += azimuthStep;
+				if (Azimuth >= 2 * MyMath::F_PI)
+				{
+					Azimuth -= 2 * MyMath::F_PI;
+					Precession += 0.37;
+				}
+				const float azimuth = float(Azimuth + Precession * azimuthStep);
+				const double channelOffset = Precession - std::floor(Precession);
+				for (int ch = 0; ch < ChannelsNum; ++ch)
+				{
+					// 仰角は -30 度から +30 度。
+					const float elevation = float((ch + channelOffset) / ChannelsNum - 0.5) * (MyMath::F_PI / 3);
+					const float radius = 15.0f + 0.8f * std::sin(azimuth * 7) * std::cos(elevation * 5) + Noise(Random);
+					const float cosElevation = std::cos(elevation);
+					MyPointIngest::Point& point = pOutPoints[col * ChannelsNum + ch];
+					point.X = radius * cosElevation * std::cos(azimuth);
+					point.Y = radius * std::sin(elevation);
+					point.Z = radius * cosElevation * std::sin(azimuth);
+					// 色は仰角で変える。
+					const float t = float(ch) / (ChannelsNum - 1);
+					point.PackedColor = MyMath::PackColorToRGBA8(MyVector4F(1.0f - t, 0.5f + 0.5f * t, t, 1.0f));
+				}
+			}
+			return columnsNum * ChannelsNum;
+		}
+	};
+
+	// ストリーミング入力の統計をコンソールに出力する。
+	void ReportPointIngest()
+	{
+		const MyPointIngest::Stats stats = g_pointIngest.GetStats();
+		printf("Ingest: %.2f Mpts/s consumed (%.2f Mpts/s produced), %llu points queued-in, %llu dropped, worst frame %.2f ms, worst ingest %.2f ms\n",
+			stats.GetConsumedPointsPerSec() * 1e-6, stats.GetProducedPointsPerSec() * 1e-6,
+			static_cast<unsigned long long>(stats.ConsumedNum), static_cast<unsigned long long>(stats.DroppedNum),
+			g_ingestMonitor.WorstFrameSeconds * 1e3, g_ingestMonitor.WorstIngestSeconds * 1e3);
+	}
+
+	void StartPointIngest()
+	{
+		// 取り込み中に配列や頂点バッファが再確保されると、そのフレームが大きく遅れるので、先に確保しておく。
+		// センサーの点の色はパレットに収まらないので、途中で展開せずに済むように色も RGBA8 にしておく。
+		g_pointCloud.ExpandColors();
+		g_pointCloud.Reserve(g_pointCloud.GetPointsNum() + IngestCapacityPointsNum);
+		g_ingestMonitor = IngestMonitor();
+		g_ingestMonitor.LastFrameTime = g_ingestMonitor.LastReportTime = std::chrono::steady_clock::now();
+		g_pointIngest.Start(SyntheticSensor(), IngestPointsPerSecond);
+	}
+
+	void StopPointIngest()
+	{
+		g_pointIngest.Stop();
+		ReportPointIngest();
+	}
+
+	// リング バッファに届いている点を取り出して、点群と八分木に追加する。描画の前に毎フレーム呼ぶ。
+	// スクリーン座標系のタイル グリッドには、交差判定の際に追加分だけが反映される。
+	void IngestStreamedPoints()
+	{
+		if (!g_pointIngest.IsRunning())
+		{
+			return;
+		}
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point beginTime = Clock::now();
+		const double frameSeconds = std::chrono::duration<double>(beginTime - g_ingestMonitor.LastFrameTime).count();
+		g_ingestMonitor.WorstFrameSeconds = std::max(g_ingestMonitor.WorstFrameSeconds, frameSeconds);
+		g_ingestMonitor.LastFrameTime = beginTime;
+
+		const size_t freeNum = g_pointCloud.GetCapacity() - g_pointCloud.GetPointsNum();
+		g_ingestedPoints.resize(MaxIngestPointsPerFrame);
+		const size_t poppedNum = g_pointIngest.Pop(g_ingestedPoints.data(), std::min(MaxIngestPointsPerFrame, freeNum));
+		for (size_t i = 0; i < poppedNum; ++i)
+		{
+			const MyPointIngest::Point& point = g_ingestedPoints[i];
+			const uint32_t index = uint32_t(g_pointCloud.GetPointsNum());
+			g_pointCloud.AppendPoint(MyVector3F(point.X, point.Y, point.Z), point.PackedColor);
+			g_pointOctree.Insert(index, MyPointPositionGetter());
+		}
+
+		const Clock::time_point endTime = Clock::now();
+		g_ingestMonitor.LastIngestSeconds = std::chrono::duration<double>(endTime - beginTime).count();
+		g_ingestMonitor.WorstIngestSeconds = std::max(g_ingestMonitor.WorstIngestSeconds, g_ingestMonitor.LastIngestSeconds);
+		if (poppedNum == freeNum)
+		{
+			puts("Ingest: reached the reserved capacity.");
+			StopPointIngest();
+		}
+		else if (std::chrono::duration<double>(endTime - g_ingestMonitor.LastReportTime).count() >= 1.0)
+		{
+			ReportPointIngest();
+			g_ingestMonitor.LastReportTime = endTime;
+		}
+	}
+
+	// 点群ファイルを読み込み、点群全体が見えるようにカメラと投影の範囲を調整する。
+	// 初めて読み込むファイルからは量子化キャッシュ（元のファイル名 + MyPointCache::FileExtension）を作成し、
+	// 次回からは元のファイルが更新されていない限りキャッシュを読み込む。キャッシュ ファイルを直接指定することもできる。
+	// 初回もキャッシュからデコードし直すので、点の順序と位置座標は毎回同じになる。
+	// 展開後の点群が g_pagedMemoryBudgetBytes を超える場合は、全点をデコードせずに g_pagedPointCloud でページングする。
+	// 予算内の場合は全点を単精度の点群にデコードし、キャッシュのマップは初期化の最後（デバッグ ビルドでの検証の後）で解除する。
+	bool LoadPointCloudFile(const char* pFilePath)
+	{
+		typedef std::chrono::steady_clock Clock;
+		const std::string cachePath = std::string(pFilePath) + MyPointCache::FileExtension;
+		uint64_t sourceFileSize = 0;
+		int64_t sourceWriteTime = 0;
+		const bool isCacheFile = g_pointCache.Open(pFilePath);
+		const bool isCacheUpToDate = isCacheFile ||
+			(MyMappedFile::GetFileStamp(pFilePath, sourceFileSize, sourceWriteTime) &&
+			g_pointCache.Open(cachePath.c_str()) && g_pointCache.IsCreatedFrom(sourceFileSize, sourceWriteTime));
+		if (!isCacheUpToDate)
+		{
+			g_pointCache.Close();
+			MyPointCloudLoader::LoadResult result;
+			std::string errorMessage;
+			if (!MyPointCloudLoader::LoadPointCloudFile(pFilePath, MyMath::PackColorToRGBA8(MyColorFWhite), g_jobSystem, g_pointCloud, result, errorMessage))
+			{
+				printf("Error : Failed to load \"%s\" : %s\n", pFilePath, errorMessage.c_str());
+				return false;
+			}
+			printf("Loaded \"%s\" (%s, %s) : %u points, %.1f MB in %.3f sec (open %.3f, decode %.3f, recenter %.3f) = %.1f MB/s\n",
+				pFilePath, MyPointCloudLoader::GetFileFormatName(result.Format), result.HasColors ? "colored" : "no colors",
+				unsigned(result.PointsNum), result.FileBytes / (1024.0 * 1024.0),
+				result.TotalSeconds, result.OpenSeconds, result.DecodeSeconds, result.RecenterSeconds,
+				result.GetThroughputMBPerSec());
+
+			const auto writeStartTime = Clock::now();
+			if (!MyPointCache::WriteFile(cachePath.c_str(), g_pointCloud, result.Offset, sourceFileSize, sourceWriteTime, g_jobSystem, errorMessage) ||
+				!g_pointCache.Open(cachePath.c_str()))
+			{
+				// キャッシュを作成できなくても、読み込んだ点群はそのまま使える。
+				printf("Warning : Failed to create the point cache \"%s\" : %s\n", cachePath.c_str(), errorMessage.c_str());
+				printf("Point cloud origin offset = (%.3f, %.3f, %.3f)\n", result.Offset.x, result.Offset.y, result.Offset.z);
+			}
+			else
+			{
+				printf("Created point cache \"%s\" in %.3f sec\n", cachePath.c_str(), std::chrono::duration<double>(Clock::now() - writeStartTime).count());
+			}
+		}
+		if (g_pointCache.IsOpen())
+		{
+			g_pointCacheFilePath = isCacheFile ? std::string(pFilePath) : cachePath;
+		}
+		if (g_pointCache.IsOpen() && g_pointCache.GetPointsNum() * MyPointCloudStore::GetBytesPerPoint() > g_pagedMemoryBudgetBytes)
+		{
+			g_pointCache.Close();
+			g_pointCloud.Clear();
+			if (!g_pagedPointCloud.Open(g_pointCacheFilePath.c_str(), g_pagedMemoryBudgetBytes))
+			{
+				printf("Error : Failed to open the point cache \"%s\" for paging.\n", g_pointCacheFilePath.c_str());
+				return false;
+			}
+			const MyVector3D offset = g_pagedPointCloud.GetOffset();
+			printf("Paging point cache (%u points in %u chunks) within %.1f MB (%u chunk slots)\n",
+				unsigned(g_pagedPointCloud.GetPointsNum()), g_pagedPointCloud.GetChunksNum(),
+				g_pagedPointCloud.GetMemoryBudgetBytes() / (1024.0 * 1024.0), g_pagedPointCloud.GetSlotsNum());
+			printf("Point cloud origin offset = (%.3f, %.3f, %.3f)\n", offset.x, offset.y, offset.z);
+		}
+		else if (g_pointCache.IsOpen())
+		{
+			const auto decodeStartTime = Clock::now();
+			g_pointCache.DecodeToStore(g_pointCloud, g_jobSystem);
+			const double decodeSeconds = std::chrono::duration<double>(Clock::now() - decodeStartTime).count();
+			const MyVector3D offset = g_pointCache.GetOffset();
+			printf("Loaded point cache (%u points, %.1f MB, %.2f bytes/point; float store %.2f bytes/point) in %.3f sec\n",
+				unsigned(g_pointCache.GetPointsNum()), g_pointCache.GetFileSize() / (1024.0 * 1024.0),
+				double(g_pointCache.GetFileSize()) / g_pointCache.GetPointsNum(), MyPointCloudStore::GetBytesPerPoint(),
+				decodeSeconds);
+			printf("Point cloud origin offset = (%.3f, %.3f, %.3f)\n", offset.x, offset.y, offset.z);
+		}
+		// 色を持たないファイルや色数の少ないファイルは、色をパレットのインデックスにして 3 バイト/点を節約する。
+		if (g_pointCloud.GetPointsNum() > 0 && g_pointCloud.CompactColors())
+		{
+			printf("Point colors : %zu-color palette (%.2f bytes/point in store)\n",
+				g_pointCloud.GetPalette().size(), double(g_pointCloud.GetMemoryBytes()) / g_pointCloud.GetPointsNum());
+		}
+
+		// 読み込んだ点群は AABB の中心が原点になっているので、原点からの最大距離を半径として視野に収める。
+		// ページングする場合は点を読まずに済むように、チャンクの AABB の頂点のうち原点から最も遠いものを使う。
+		float radius = 0;
+		for (size_t i = 0; i < g_pointCloud.GetPointsNum(); ++i)
+		{
+			radius = std::max(radius, glm::length(g_pointCloud.GetPosition(i)));
+		}
+		for (uint32_t c = 0; g_pagedPointCloud.IsOpen() && c < g_pagedPointCloud.GetChunksNum(); ++c)
+		{
+			const MyPointCache::ChunkInfo& chunk = g_pagedPointCloud.GetChunk(c);
+			const MyVector3F vFarthest(
+				std::max(std::abs(chunk.BoundsMin[0]), std::abs(chunk.BoundsMax[0])),
+				std::max(std::abs(chunk.BoundsMin[1]), std::abs(chunk.BoundsMax[1])),
+				std::max(std::abs(chunk.BoundsMin[2]), std::abs(chunk.BoundsMax[2])));
+			radius = std::max(radius, glm::length(vFarthest));
+		}
+		const float distance = std::max(radius / std::tan(glm::radians(g_persParam.Fov * 0.5f)), g_camera.Eye.z);
+		g_camera.Eye = MyVector3F(0, 0, distance);
+		g_persParam.Far = std::max(g_persParam.Far, distance + radius * 2);
+		g_transformCache.InvalidateCamera();
+		g_transformCache.InvalidateProjection();
+		return true;
+	}
+} // end of namespace
+
+void InitializeApp(const char* pPointCloudFilePath, size_t pagedMemoryBudgetMB, size_t selectionHistoryBudgetMB)
+{
+	// GLEW の初期化。
+	// これにより、Windows で OpenGL 1.2 以上を利用するのが楽になる。
+	// 実際に OpenGL 1.2 以上の Features (Extensions) にハードウェアおよびドライバーが対応しているかどうか不明な環境で実行する際は、
+	// バージョン情報やエントリーポイントをつぶさに調べる必要がある。
+	if (glewInit() != GLEW_OK)
+	{
+		puts("Error : Failed to initialize GLEW!!");
+		WaitForUserInput();
+		exit(-1);
+	}
+	// 点群の描画に使うバッファ オブジェクトは OpenGL 1.5 の機能。
+	if (!GLEW_VERSION_1_5)
+	{
+		puts("Error : OpenGL 1.5 or later is required!!");
+		WaitForUserInput();
+		exit(-1);
+	}
+	g_pointRenderer.Initialize(true);
+	g_textOverlay.Initialize();
+	for (uint32_t p = 0; p < ProfilePhase_Count; ++p)
+	{
+		const uint32_t phase = g_frameProfiler.AddPhase(ProfilePhaseNames[p]);
+		assert(phase == p);
+	}
+	printf("Point color buffer update = %s\n", g_pointRenderer.UsesPersistentMapping() ? "persistent mapping" : "glBufferSubData");
+
+	if (pagedMemoryBudgetMB > 0)
+	{
+		g_pagedMemoryBudgetBytes = pagedMemoryBudgetMB * 1024 * 1024;
+	}
+
+	// 点群の頂点データを設定。
+	// 点群ファイルが指定されていればそれを読み込み、さもなくば（読み込みに失敗した場合も）球面上のランダムな点群を生成する。
+	// ファイル パスの代わりに "<分布名>:<点数>[:<シード>]" を指定すると、その点群を生成する（例: "clustered:1e8:7"）。
+	MyPointGenerator::Distribution generatedDistribution = MyPointGenerator::Distribution_SphereShell;
+	size_t generatedPointsNum = DefaultGeneratedPointsNum;
+	uint64_t generatedSeed = DefaultGeneratedPointCloudSeed;
+	const bool isGeneratedBySpec = pPointCloudFilePath &&
+		ParseGeneratedPointCloudSpec(pPointCloudFilePath, generatedDistribution, generatedPointsNum, generatedSeed);
+	const bool isLoadedFromFile = !isGeneratedBySpec && pPointCloudFilePath && LoadPointCloudFile(pPointCloudFilePath);
+	if (!isLoadedFromFile)
+	{
+		GenerateRandomPointCloud(generatedDistribution, generatedPointsNum, generatedSeed);
+		ReorderPointCloudByMortonCode();
+		g_isPointCloudGenerated = true;
+		g_generatedDistribution = generatedDistribution;
+		g_generatedPointsNum = generatedPointsNum;
+		g_generatedSeed = generatedSeed;
+	}
+	g_pointCloud.ClearSelection();
+	g_selectionHistory.Clear();
+	if (selectionHistoryBudgetMB > 0)
+	{
+		g_selectionHistory.SetMemoryBudgetBytes(selectionHistoryBudgetMB * 1024 * 1024);
+	}
+
+	// 点群の空間インデックスを構築。
+	g_pointOctree.Build(uint32_t(g_pointCloud.GetPointsNum()), MyPointPositionGetter());
+	printf("SIMD level for batch kernels = %s\n", MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::GetActiveSimdLevel()));
+#ifdef _DEBUG
+	// 総当たりとの比較は点数に比例して時間がかかるので、生成した小さな点群でのみ行なう。
+	MySelfCheck selfCheck(g_jobSystem, g_pointCloud, g_pointOctree, g_pointPicker, CreateFixedTransformMatrixWorldCoordToScreenCoord(),
+		IntersectMarginInWolrd, IntersectMarginInScreen, GeneratedPointCloudRadius);
+	if (!isLoadedFromFile && g_pointCloud.GetPointsNum() <= MaxVerifiedPointsNum)
+	{
+		const bool isGeneratedPointCloudValid = selfCheck.VerifyGeneratedPointCloud();
+		assert(isGeneratedPointCloudValid);
+	}
+	if (g_pointCache.IsOpen())
+	{
+		const bool isPointCacheValid = selfCheck.VerifyPointCache(g_pointCache, g_pointCacheFilePath.c_str());
+		assert(isPointCacheValid);
+	}
+#endif
+	// デコードした点群はキャッシュを参照しないので、マップを解除して、読んだファイルのページを常駐メモリから外す。
+	g_pointCache.Close();
+}
+
+namespace
+{
+	void CalcUnProjectedRayPositions(MyVector3F& vWCoord0, MyVector3F& vWCoord1)
+	{
+		// 逆プロジェクション行列はキャッシュしておき、カメラやビューポートが変化したときだけ計算し直す。
+		MyPointPicker::CalcUnProjectedRayPositions(g_transformCache.GetScreenToWorldMatrix(),
+			float(g_mouseData.CurrentPos.x), float(g_mouseData.CurrentPos.y), vWCoord0, vWCoord1);
+	}
+
+	// 以下の行列はすべて g_transformCache にキャッシュされる。
+	// 平行投影にする場合は、g_transformCache の作成時に MyTransformCache::ProjectionType_Orthographic を指定する。
+
+	const MyMatrix4x4F& CalcViewMatrix()
+	{
+		return g_transformCache.GetViewMatrix();
+	}
+
+	const MyMatrix4x4F& CalcProjectionMatrix()
+	{
+		return g_transformCache.GetProjectionMatrix();
+	}
+
+	const MyMatrix4x4F& CalcTransformMatrixWorldCoordToScreenCoord()
+	{
+		return g_transformCache.GetWorldToScreenMatrix();
+	}
+
+	const MyMatrix4x4F& CalcTransformMatrixScreenCoordToWorldCoord()
+	{
+		return g_transformCache.GetScreenToWorldMatrix();
+	}
+
+	// 選択操作の集合演算を、マウス ボタンを離したときの修飾キーで決める。
+	// Shift で追加、Ctrl で解除、Shift + Ctrl で絞り込み。修飾キーがなければ defaultOp。
+	MyBitsetOps::SetOperation GetSelectionOperationFromModifiers(MyBitsetOps::SetOperation defaultOp)
+	{
+		const int modifiers = glutGetModifiers();
+		const bool isShiftDown = (modifiers & GLUT_ACTIVE_SHIFT) != 0;
+		const bool isCtrlDown = (modifiers & GLUT_ACTIVE_CTRL) != 0;
+		if (isShiftDown && isCtrlDown)
+		{
+			return MyBitsetOps::SetOperation_Intersection;
+		}
+		else if (isShiftDown)
+		{
+			return MyBitsetOps::SetOperation_Union;
+		}
+		else if (isCtrlDown)
+		{
+			return MyBitsetOps::SetOperation_Difference;
+		}
+		return defaultOp;
+	}
+
+	void OnFrameTimer(int)
+	{
+		glutPostRedisplay();
+	}
+
+	// ダーティ フラグを立てて、フレームの描画を要求する。
+	// 次のフレームが始まるまでの要求は 1 回の描画にまとめ、フレーム レートの上限がある場合はタイマーで描画を遅らせる。
+	void RequestFrame(uint32_t dirtyFlags)
+	{
+		double delaySeconds = 0;
+		switch (g_frameScheduler.Invalidate(dirtyFlags, std::chrono::steady_clock::now(), delaySeconds))
+		{
+		case MyFrameScheduler::FrameRequest_PostNow:
+			glutPostRedisplay();
+			break;
+		case MyFrameScheduler::FrameRequest_PostLater:
+			glutTimerFunc(unsigned(std::ceil(delaySeconds * 1000)), OnFrameTimer, 0);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void PrintFrameProfile()
+	{
+		g_frameProfiler.Collect();
+		printf("%-8s %10s %10s %10s %10s %10s\n", "Phase", "Count", "p50[ms]", "p99[ms]", "Max[ms]", "Mean[ms]");
+		for (uint32_t p = 0; p < ProfilePhase_Count; ++p)
+		{
+			const MyLatencyHistogram& histogram = g_frameProfiler.GetHistogram(p);
+			printf("%-8s %10llu %10.3f %10.3f %10.3f %10.3f\n", g_frameProfiler.GetPhaseName(p),
+				static_cast<unsigned long long>(histogram.GetTotalCount()),
+				histogram.GetValueAtPercentile(50) * 1e-6, histogram.GetValueAtPercentile(99) * 1e-6,
+				histogram.GetMaxValue() * 1e-6, histogram.GetMeanValue() * 1e-6);
+		}
+		if (g_frameProfiler.GetDroppedNum() > 0)
+		{
+			printf("(%llu samples dropped)\n", static_cast<unsigned long long>(g_frameProfiler.GetDroppedNum()));
+		}
+		printf("Hover latency (resolved at %s): %llu of %llu frames over %.1f ms, worst %.1f ms\n",
+			g_resolvesHoverAtEventTime ? "event time" : "render time",
+			static_cast<unsigned long long>(g_hoverLatencyTracker.GetOverBudgetFramesNum()),
+			static_cast<unsigned long long>(g_hoverLatencyTracker.GetFramesNum()),
+			g_hoverLatencyTracker.GetBudgetSeconds() * 1e3, g_hoverLatencyTracker.GetWorstFrameLatencySeconds() * 1e3);
+	}
+
+	// 点群の交差判定を行ない、交差した点のインデックスを列挙して、表示色バッファに反映するビットマスクを作る。
+	void ResolveHover(const MyVector3F& vWCoord0, const MyVector3F& vWCoord1)
+	{
+		MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Hover);
+		if (g_usesWorldUnitAsIntersectMargin)
+		{
+			// レイをワールド座標へ射影して、点群の各点（小さな球）との交差判定を行なう。
+			g_pointPicker.QueryPointsInWorld(g_pointCloud, g_pointOctree, vWCoord0, vWCoord1, IntersectMarginInWolrd, g_hitPointIndices);
+		}
+		else
+		{
+			// 点群の各点を CPU でスクリーン座標変換し、マウス位置と交差するかどうかを調べる。
+			const MyMatrix4x4F& matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
+			g_pointPicker.QueryPointsInScreen(g_pointCloud, matToScreen, g_viewport.Width, g_viewport.Height,
+				float(g_mouseData.CurrentPos.x), float(g_mouseData.CurrentPos.y), IntersectMarginInScreen,
+				vWCoord0, vWCoord1, g_hitPointIndices);
+		}
+
+		// 交差した点をビットマスクにして、選択状態と合わせて表示色バッファに反映する。
+		// 点ごとの GL 呼び出しはせず、前フレームから状態が変化した範囲だけを書き換えて、glDrawArrays() 1 回で描画する。
+		g_hitMaskWords.assign(g_pointCloud.GetSelectionWordsNum(), 0);
+		for (auto index : g_hitPointIndices)
+		{
+			g_hitMaskWords[index / MyPointCloudStore::BitsPerSelectionWord] |= uint64_t(1) << (index % MyPointCloudStore::BitsPerSelectionWord);
+		}
+	}
+
+	// マウス移動のイベントを受けて、遅延の計測を始める。
+	// イベント時刻でのホバー判定が有効な場合は、ここで判定を済ませておき、描画時にはカメラなどが変わった場合だけやり直す。
+	// ページングされた点群では、常駐しているチャンクが描画時に決まるので、常に描画時に判定する。
+	void OnHoverInput(bool resolvesNow)
+	{
+		g_hoverLatencyTracker.OnInput(MyInputLatencyTracker::Clock::now());
+		if (g_resolvesHoverAtEventTime && resolvesNow && !g_pagedPointCloud.IsOpen())
+		{
+			MyVector3F vWCoord0, vWCoord1;
+			CalcUnProjectedRayPositions(vWCoord0, vWCoord1);
+			ResolveHover(vWCoord0, vWCoord1);
+		}
+	}
+
+	// 入力イベントの記録を開始・停止する。
+	// 再生時には点群を生成し直して同じ操作を行なうので、生成した点群を変更していない場合だけ記録できる。
+	void ToggleInputRecording()
+	{
+		if (g_inputRecorder.IsRecording())
+		{
+			std::string errorMessage;
+			const size_t eventsNum = g_inputRecorder.GetEventsNum();
+			if (g_inputRecorder.Stop(InputTraceFilePath, errorMessage))
+			{
+				printf("Input recording stopped: %zu events written to \"%s\".\n", eventsNum, InputTraceFilePath);
+			}
+			else
+			{
+				printf("Error : %s\n", errorMessage.c_str());
+			}
+			return;
+		}
+		if (!g_isPointCloudGenerated || g_pagedPointCloud.IsOpen() || g_pointIngest.IsRunning() ||
+			g_pointCloud.GetPointsNum() != g_generatedPointsNum)
+		{
+			puts("Input recording requires an unmodified generated point cloud (not loaded from a file nor streamed).");
+			return;
+		}
+		if (g_mouseData.IsLeftButtonPressed || g_mouseData.IsRightButtonPressed)
+		{
+			puts("Release the mouse buttons before starting input recording.");
+			return;
+		}
+		MyInputTrace::InitialState state = {};
+		state.PointsNum = g_generatedPointsNum;
+		state.Seed = g_generatedSeed;
+		state.PositionsHash = MyInputTrace::CalcPositionsHash(g_pointCloud);
+		state.Distribution = uint32_t(g_generatedDistribution);
+		state.CloudRadius = GeneratedPointCloudRadius;
+		state.ViewportWidth = g_viewport.Width;
+		state.ViewportHeight = g_viewport.Height;
+		state.Fov = g_persParam.Fov;
+		state.Near = g_persParam.Near;
+		state.Far = g_persParam.Far;
+		const MyVector3F* const cameraVectors[] = { &g_camera.Eye, &g_camera.At, &g_camera.Up };
+		float* const stateVectors[] = { state.CameraEye, state.CameraAt, state.CameraUp };
+		for (int v = 0; v < 3; ++v)
+		{
+			stateVectors[v][0] = cameraVectors[v]->x;
+			stateVectors[v][1] = cameraVectors[v]->y;
+			stateVectors[v][2] = cameraVectors[v]->z;
+		}
+		const MyQuaternion4F& rotation = g_myMeshTrackball.GetRotation();
+		state.TrackballRotation[0] = rotation.w;
+		state.TrackballRotation[1] = rotation.x;
+		state.TrackballRotation[2] = rotation.y;
+		state.TrackballRotation[3] = rotation.z;
+		state.PickMode = uint32_t(g_pointPicker.GetPickMode());
+		state.UsesWorldUnitAsIntersectMargin = g_usesWorldUnitAsIntersectMargin;
+		g_inputRecorder.Start(state, g_pointCloud);
+		printf("Input recording started (F5 to stop): %zu points, %u selected.\n", g_pointCloud.GetPointsNum(), uint32_t(g_pointCloud.CountSelected()));
+	}
+
+	// ページングされた点群の交差判定と描画。
+	// 視錐台と交差するチャンクを視点に近い順に要求し、常駐しているチャンクだけを交差判定・描画する。
+	// スクリーン座標系での判定はタイル グリッドに全点が必要なので、常にワールド座標系で判定する。
+	void UpdateAndDrawPagedPointCloud(const MyVector3F& vWCoord0, const MyVector3F& vWCoord1)
+	{
+		g_pagedPointCloud.BeginFrame();
+
+		// ホバー判定に必要なチャンクを先に要求して、描画のための要求より優先させる。
+		{
+			MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Hover);
+			g_pagedPointCloud.QueryLineIntersectWithSphere(vWCoord0, vWCoord1, IntersectMarginInWolrd, g_hitPointIndices);
+			g_pointPicker.KeepFrontMostHits(g_hitPointIndices, vWCoord0, vWCoord1,
+				[](uint32_t index) { return g_pagedPointCloud.GetResidentPosition(index); });
+		}
+		MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Submit);
+
+		const MyMatrix4x4F& matUnproj = CalcTransformMatrixScreenCoordToWorldCoord();
+		MyVector4F planes[4];
+		MyGLHelper::CreateFrustumPlanesFromScreenRect(planes, matUnproj, 0, 0, float(g_viewport.Width), float(g_viewport.Height));
+		const MyVector3F vEye = MyGLHelper::TransformVector3Coord(matUnproj, MyVector3F(g_viewport.Width * 0.5f, g_viewport.Height * 0.5f, 0));
+		g_pagedVisibleChunks.clear();
+		for (uint32_t c = 0; c < g_pagedPointCloud.GetChunksNum(); ++c)
+		{
+			const MyPointCache::ChunkInfo& chunk = g_pagedPointCloud.GetChunk(c);
+			const MyVector3F boundsMin(chunk.BoundsMin[0], chunk.BoundsMin[1], chunk.BoundsMin[2]);
+			const MyVector3F boundsMax(chunk.BoundsMax[0], chunk.BoundsMax[1], chunk.BoundsMax[2]);
+			if (MyCollision::ClassifyAABBWithPlanes(boundsMin, boundsMax, planes, 4) == MyCollision::ContainmentType_Disjoint)
+			{
+				continue;
+			}
+			const MyVector3F vToCenter = (boundsMin + boundsMax) * 0.5f - vEye;
+			g_pagedVisibleChunks.push_back(std::make_pair(glm::dot(vToCenter, vToCenter), c));
+		}
+		std::sort(g_pagedVisibleChunks.begin(), g_pagedVisibleChunks.end());
+		for (const auto& visibleChunk : g_pagedVisibleChunks)
+		{
+			g_pagedPointCloud.RequestChunk(visibleChunk.second);
+		}
+
+		g_pagedPointRenderer.Update(g_pagedPointCloud, g_hitPointIndices);
+		g_pagedPointRenderer.Draw(g_pagedPointCloud);
+	}
+} // end of namespace
+
+void FinalizeApp()
+{
+	// バッファ オブジェクトは OpenGL コンテキストが破棄される前に解放する。
+	g_pointRenderer.Release();
+	g_textOverlay.Release();
+	g_pagedPointRenderer.Release();
+	// I/O スレッドと生産者スレッドをメイン ループの終了前に止めておく。
+	g_pagedPointCloud.Close();
+	g_pointIngest.Stop();
+}
+
+void Reshape(int w, int h)
+{
+	g_inputRecorder.Record(MyInputTrace::EventType_Reshape, 0, 0, 0, w, h);
+	g_viewport.Width = std::max(w, 1);
+	g_viewport.Height = std::max(h, 1);
+	g_transformCache.InvalidateViewport();
+
+	g_myMeshTrackball.OnResize(g_viewport.Width, g_viewport.Height);
+	RequestFrame(MyFrameScheduler::DirtyFlag_Viewport);
+}
+
+void Display()
+{
+	// ウィンドウの再表示など、要求なしに呼ばれた場合のダーティ フラグは 0。
+	const auto frameBeginTime = std::chrono::steady_clock::now();
+	const uint32_t dirtyFlags = g_frameScheduler.BeginFrame(frameBeginTime);
+	// ここまでに届いたマウス移動を、このフレームで表示する。
+	g_hoverLatencyTracker.BeginFrame();
+
+	const MyVector4F backColor = MyColorFDodgerBlue;
+	glClearColor(backColor.r, backColor.g, backColor.b, backColor.a);
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// プロジェクション行列の設定。
+	glMatrixMode(GL_PROJECTION);
+	glLoadIdentity();
+#if 0
+#if 1
+	gluPerspective(g_persParam.Fov, static_cast<double>(g_viewport.Width) / g_viewport.Height, g_persParam.Near, g_persParam.Far);
+#else
+	glOrtho(
+		-g_viewport.Width * 0.5f, +g_viewport.Width * 0.5f, -g_viewport.Height * 0.5f, +g_viewport.Height * 0.5f,
+		g_persParam.Near, g_persParam.Far);
+#endif
+#else
+	const MyMatrix4x4F& matProj = CalcProjectionMatrix();
+	glMultMatrixf(&matProj[0][0]);
+#endif
+
+	glMatrixMode(GL_MODELVIEW);
+	glViewport(g_viewport.X, g_viewport.Y, g_viewport.Width, g_viewport.Height);
+
+	// 視点の設定。
+#if 0
+	gluLookAt(
+		g_camera.Eye.x, g_camera.Eye.y, g_camera.Eye.z,
+		g_camera.At.x, g_camera.At.y, g_camera.At.z,
+		g_camera.Up.x, g_camera.Up.y, g_camera.Up.z);
+
+	glMultMatrixf(g_myMeshTrackball.GetRotationMatrixAsArray());
+#else
+	const MyMatrix4x4F& matView = CalcViewMatrix();
+	glMultMatrixf(&matView[0][0]);
+#endif
+
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(true);
+	// トラックボール中心を原点とした座標軸の描画。
+	if (g_rendersCoordAxes)
+	{
+		glDisable(GL_LIGHTING);
+		glBegin(GL_LINES);
+		const float coordLength = 20.0f;
+
+		glColor4fv(&MyColorFRed.r);
+		glVertex3f(0, 0, 0);
+		glVertex3f(coordLength, 0, 0);
+
+		glColor4fv(&MyColorFLime.r);
+		glVertex3f(0, 0, 0);
+		glVertex3f(0, coordLength, 0);
+
+		glColor4fv(&MyColorFBlue.r);
+		glVertex3f(0, 0, 0);
+		glVertex3f(0, 0, coordLength);
+
+		glEnd();
+		glEnable(GL_LIGHTING);
+	}
+
+	MyVector3F vWCoord0, vWCoord1;
+	// 点群の描画。
+	// 同時に、マウス カーソル位置を通り画面に直交するレイと、点との交差判定を行なう。
+	{
+		// もし交差判定の結果を CPU 側で持つ必要がない場合、判定計算を GPU 側（GLSL 頂点シェーダー側）で行なうこともできなくはない。
+		glDisable(GL_LIGHTING);
+		glPointSize(2.0f);
+
+		// マウス位置をワールド座標に変換する。
+		CalcUnProjectedRayPositions(vWCoord0, vWCoord1);
+
+		if (g_pagedPointCloud.IsOpen())
+		{
+			UpdateAndDrawPagedPointCloud(vWCoord0, vWCoord1);
+		}
+		else
+		{
+			if (g_pointIngest.IsRunning())
+			{
+				MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Ingest);
+				IngestStreamedPoints();
+			}
+
+			// 点群の交差判定を行ない、交差した点のインデックスを列挙する。
+			// マウス位置、カメラ、点群のいずれも変わっていなければ、前のフレームの結果をそのまま使う。
+			// イベント時刻でのホバー判定が有効な場合、マウス位置の変化だけなら判定は済んでいる。
+			const uint32_t hoverQueryFlags = g_resolvesHoverAtEventTime ? (HoverDirtyFlags & ~MyFrameScheduler::DirtyFlag_Hover) : HoverDirtyFlags;
+			if (dirtyFlags & hoverQueryFlags)
+			{
+				ResolveHover(vWCoord0, vWCoord1);
+			}
+			MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Submit);
+			g_pointRenderer.Update(g_pointCloud, g_hitMaskWords.data());
+			g_pointRenderer.Draw();
+		}
+
+		// もし、シーンの拡大縮小（カメラのズームイン・ズームアウト）に関わらず、
+		// 点群の各点が常に一定サイズの OpenGL ポイント プリミティブで描画される場合、
+		// スクリーン座標系での交差判定のほうが都合がよい。
+		// 逆に、カメラが接近すると実サイズを模した多ポリゴンの球で描画されるなど、
+		// 描画される点の大きさがシーンの拡大縮小に左右される場合、
+		// ワールド座標系での交差判定のほうが都合がよい。
+		// 各々のメリットは交差判定マージンをどの座標系で設定するのか、にもよるので、
+		// それを加味してどの座標系での交差判定を行なうかを決定するとよい。
+
+		glEnable(GL_LIGHTING);
+	}
+
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	if (g_mouseData.IsLeftButtonPressed)
+	{
+
+		glMatrixMode(GL_PROJECTION);
+		glLoadIdentity();
+		// 左上を原点とするマウスの 2D 座標を直接指定できるように、正射影する。
+		gluOrtho2D(0, g_viewport.Width, g_viewport.Height, 0);
+
+		// スクリーン選択矩形の描画（半透明）。
+		// 深度テストを切って（無視して）最前面に描画する。深度バッファへの書き込みも禁止しておく。
+		glDisable(GL_LIGHTING);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDisable(GL_DEPTH_TEST);
+		glDepthMask(false);
+
+		{
+			int rectL = 0;
+			int rectT = 0;
+			int rectR = 0;
+			int rectB = 0;
+			g_mouseData.GetNormalizedLDraggingRect(rectL, rectT, rectR, rectB);
+
+			glColor4f(0.0f, 0.4f, 0.4f, 0.5f);
+			glRecti(rectL, rectT, rectR, rectB);
+
+			glColor4f(0.4f, 0.8f, 1.0f, 1.0f);
+			glBegin(GL_LINE_LOOP);
+			glVertex2d(rectL, rectT);
+			glVertex2d(rectR, rectT);
+			glVertex2d(rectR, rectB);
+			glVertex2d(rectL, rectB);
+			glEnd();
+		}
+
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(true);
+	}
+
+	// メッセージの描画。
+	{
+		MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Overlay);
+		glDisable(GL_BLEND);
+		static char message[1024];
+		const int fontSize = 18;
+		const int offsetAmt = 2;
+		const auto getBaselineY = [=](int row) { return (fontSize + offsetAmt) * row; };
+
+		// 各行の文字列は、表示する値が前のフレームから変わったときだけ整形し直す。
+		// 文字列が変わらなければ頂点も作り直さず、前のフレームと同じバッファを描画するだけになる。
+		const float mouseKey0[] = { float(g_mouseData.CurrentPos.x), float(g_mouseData.CurrentPos.y), vWCoord0.x, vWCoord0.y, vWCoord0.z };
+		if (g_textOverlay.IsLineKeyChanged(OverlayRow_Mouse0, mouseKey0))
+		{
+			sprintf_s(message, "Mouse0(%4d, %4d, 0) = World0(%+8.2f, %+8.2f, %+8.2f)",
+				g_mouseData.CurrentPos.x, g_mouseData.CurrentPos.y,
+				vWCoord0.x, vWCoord0.y, vWCoord0.z);
+			g_textOverlay.SetLine(OverlayRow_Mouse0, offsetAmt, getBaselineY(1), message, MyColorFWhite);
+		}
+
+		const float mouseKey1[] = { float(g_mouseData.CurrentPos.x), float(g_mouseData.CurrentPos.y), vWCoord1.x, vWCoord1.y, vWCoord1.z };
+		if (g_textOverlay.IsLineKeyChanged(OverlayRow_Mouse1, mouseKey1))
+		{
+			sprintf_s(message, "Mouse1(%4d, %4d, 1) = World1(%+8.2f, %+8.2f, %+8.2f)",
+				g_mouseData.CurrentPos.x, g_mouseData.CurrentPos.y,
+				vWCoord1.x, vWCoord1.y, vWCoord1.z);
+			g_textOverlay.SetLine(OverlayRow_Mouse1, offsetAmt, getBaselineY(2), message, MyColorFWhite);
+		}
+
+		const int pickModeKey = g_pointPicker.GetPickMode();
+		if (g_textOverlay.IsLineKeyChanged(OverlayRow_Usage, pickModeKey))
+		{
+			sprintf_s(message, "L-Click/L-Drag:Select, R-Drag:Rotation, Wheel:Zoom, K:Pick(%s)", MyPointPicker::GetPickModeName(g_pointPicker.GetPickMode()));
+			g_textOverlay.SetLine(OverlayRow_Usage, offsetAmt, getBaselineY(3), message, MyColorFLime);
+		}
+
+		// 4 行目は、ページング、ストリーミング入力、ホバーのいずれかの状態。キーの先頭の値で区別する。
+		if (g_pagedPointCloud.IsOpen())
+		{
+			const MyPagedPointCloud::Stats& stats = g_pagedPointCloud.GetStats();
+			const uint64_t statusKey[] = { 1, g_pagedPointCloud.GetResidentChunksNum(), g_pagedPointCloud.GetChunksNum(), g_pagedPointCloud.GetPendingLoadsNum(),
+				stats.HitsNum, stats.MissesNum, stats.EvictionsNum };
+			if (g_textOverlay.IsLineKeyChanged(OverlayRow_Status, statusKey))
+			{
+				sprintf_s(message, "Paged: %u/%u chunks resident, %u loading, hit %llu, miss %llu, evicted %llu",
+					g_pagedPointCloud.GetResidentChunksNum(), g_pagedPointCloud.GetChunksNum(), g_pagedPointCloud.GetPendingLoadsNum(),
+					static_cast<unsigned long long>(stats.HitsNum), static_cast<unsigned long long>(stats.MissesNum),
+					static_cast<unsigned long long>(stats.EvictionsNum));
+				g_textOverlay.SetLine(OverlayRow_Status, offsetAmt, getBaselineY(4), message, MyColorFLime);
+			}
+		}
+		else if (g_pointIngest.IsRunning())
+		{
+			const MyPointIngest::Stats stats = g_pointIngest.GetStats();
+			const double statusKey[] = { 2, stats.GetConsumedPointsPerSec(), double(g_pointCloud.GetPointsNum()), double(stats.DroppedNum),
+				g_ingestMonitor.WorstFrameSeconds, g_ingestMonitor.WorstIngestSeconds };
+			if (g_textOverlay.IsLineKeyChanged(OverlayRow_Status, statusKey))
+			{
+				sprintf_s(message, "Ingest: %.2f Mpts/s, %u points, dropped %llu, worst frame %.1f ms, worst ingest %.1f ms",
+					stats.GetConsumedPointsPerSec() * 1e-6, uint32_t(g_pointCloud.GetPointsNum()),
+					static_cast<unsigned long long>(stats.DroppedNum),
+					g_ingestMonitor.WorstFrameSeconds * 1e3, g_ingestMonitor.WorstIngestSeconds * 1e3);
+				g_textOverlay.SetLine(OverlayRow_Status, offsetAmt, getBaselineY(4), message, MyColorFLime);
+			}
+		}
+		else if (!g_hitPointIndices.empty())
+		{
+			// 点群は Morton 順に並べ替えてあるので、読み込み・生成時のインデックスに戻して表示する。
+			const uint32_t frontIndex = g_hitPointIndices.front();
+			const uint64_t statusKey[] = { 3, frontIndex, g_hitPointIndices.size() };
+			if (g_textOverlay.IsLineKeyChanged(OverlayRow_Status, statusKey))
+			{
+				const MyVector3F frontPos = g_pointCloud.GetPosition(frontIndex);
+				sprintf_s(message, "Hover: point #%u (%+8.2f, %+8.2f, %+8.2f), %u hits",
+					g_pointCloud.GetOriginalIndex(frontIndex), frontPos.x, frontPos.y, frontPos.z, uint32_t(g_hitPointIndices.size()));
+				g_textOverlay.SetLine(OverlayRow_Status, offsetAmt, getBaselineY(4), message, MyColorFLime);
+			}
+		}
+		else
+		{
+			g_textOverlay.HideLine(OverlayRow_Status);
+		}
+
+		if (g_showsFrameProfile)
+		{
+			// 前のフレームまでの計測値を集計して、処理ごとの p50/p99 を表示する。
+			g_frameProfiler.Collect();
+			for (uint32_t p = 0; p < ProfilePhase_Count; ++p)
+			{
+				const MyLatencyHistogram& histogram = g_frameProfiler.GetHistogram(p);
+				const uint64_t profileKey[] = { histogram.GetValueAtPercentile(50), histogram.GetValueAtPercentile(99), histogram.GetMaxValue(), histogram.GetTotalCount() };
+				if (g_textOverlay.IsLineKeyChanged(OverlayRow_Profile + p, profileKey))
+				{
+					sprintf_s(message, "%-7s p50 %7.3f ms, p99 %7.3f ms, max %7.3f ms (%llu)", g_frameProfiler.GetPhaseName(p),
+						histogram.GetValueAtPercentile(50) * 1e-6, histogram.GetValueAtPercentile(99) * 1e-6, histogram.GetMaxValue() * 1e-6,
+						static_cast<unsigned long long>(histogram.GetTotalCount()));
+					g_textOverlay.SetLine(OverlayRow_Profile + p, offsetAmt, getBaselineY(6 + p), message, MyColorFYellow);
+				}
+			}
+			const double latencyKey[] = { double(g_resolvesHoverAtEventTime), double(g_hoverLatencyTracker.IsLastFrameOverBudget()),
+				g_hoverLatencyTracker.GetLastFrameLatencySeconds(), g_hoverLatencyTracker.GetWorstFrameLatencySeconds(),
+				double(g_hoverLatencyTracker.GetOverBudgetFramesNum()), double(g_hoverLatencyTracker.GetFramesNum()) };
+			if (g_textOverlay.IsLineKeyChanged(OverlayRow_Latency, latencyKey))
+			{
+				sprintf_s(message, "Hover at %s: last %.1f ms, worst %.1f ms, %llu/%llu frames over %.1f ms",
+					g_resolvesHoverAtEventTime ? "event" : "render",
+					g_hoverLatencyTracker.GetLastFrameLatencySeconds() * 1e3, g_hoverLatencyTracker.GetWorstFrameLatencySeconds() * 1e3,
+					static_cast<unsigned long long>(g_hoverLatencyTracker.GetOverBudgetFramesNum()),
+					static_cast<unsigned long long>(g_hoverLatencyTracker.GetFramesNum()), g_hoverLatencyTracker.GetBudgetSeconds() * 1e3);
+				// 直前のフレームの遅延が予算を超えていれば赤で示す。
+				g_textOverlay.SetLine(OverlayRow_Latency, offsetAmt, getBaselineY(6 + ProfilePhase_Count), message,
+					g_hoverLatencyTracker.IsLastFrameOverBudget() ? MyColorFRed : MyColorFYellow);
+			}
+		}
+		else
+		{
+			for (uint32_t p = 0; p < ProfilePhase_Count; ++p)
+			{
+				g_textOverlay.HideLine(OverlayRow_Profile + p);
+			}
+			g_textOverlay.HideLine(OverlayRow_Latency);
+		}
+
+		// 全行をまとめて 1 回で描画する。
+		g_textOverlay.Draw(g_viewport.Width, g_viewport.Height);
+	}
+
+	{
+		MyProfileScope profileScope(g_frameProfiler, ProfilePhase_Swap);
+		glutSwapBuffers();
+	}
+
+	const auto frameEndTime = std::chrono::steady_clock::now();
+	g_frameProfiler.Record(ProfilePhase_Frame, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(frameEndTime - frameBeginTime).count()));
+	g_hoverLatencyTracker.EndFrame(frameEndTime);
+	g_frameScheduler.EndFrame(frameEndTime);
+	// ストリーミング入力やチャンクの読み込みが続いている間は、入力イベントがなくても次のフレームを描画する。
+	if (g_pointIngest.IsRunning() || (g_pagedPointCloud.IsOpen() && g_pagedPointCloud.GetPendingLoadsNum() > 0))
+	{
+		RequestFrame(MyFrameScheduler::DirtyFlag_Streaming);
+	}
+}
+
+void Mouse(int button, int state, int x, int y)
+{
+	g_inputRecorder.Record(MyInputTrace::EventType_MouseButton, button, state, glutGetModifiers(), x, y);
+	// 選択状態と選択矩形の表示が変わる。
+	uint32_t dirtyFlags = MyFrameScheduler::DirtyFlag_Selection;
+	switch (button)
+	{
+	case GLUT_LEFT_BUTTON:
+		g_mouseData.IsLeftButtonPressed = (state == GLUT_DOWN);
+		if (g_mouseData.IsLeftButtonPressed)
+		{
+			g_mouseData.DragStartPosL = MyVector2I(x, y);
+		}
+		else
+		{
+			// ドラッグ開始位置と終了位置がほぼ同じ場合、小範囲ピッキングとみなす。
+			// 異なる場合は広範囲矩形選択とみなす。
+			// ワールド座標系での小範囲ピッキングは八分木で枝刈りするので、レイ近傍の点だけを判定すれば済む。
+			// 手前の点だけを選択する場合は、八分木を手前から走査して、必要な点数が見つかった時点で打ち切る。
+			// スクリーン座標系ですべての点を対象とする場合の交差判定の計算量は O(n) となる。
+			const MyVector2I vDiff = g_mouseData.DragStartPosL - MyVector2I(x, y);
+			const char* pSelectionLabel = nullptr;
+			const bool isClick = MyMath::GetVectorLength(vDiff) < 2;
+			MyProfileScope profileScope(g_frameProfiler, isClick ? ProfilePhase_Click : ProfilePhase_Rect);
+			if (isClick)
+			{
+				// 修飾キーがなければ、交差している点の選択状態を反転し、交差していない点は変更しない。
+				const MyBitsetOps::SetOperation op = GetSelectionOperationFromModifiers(MyBitsetOps::SetOperation_SymmetricDifference);
+				pSelectionLabel = "Click";
+				MyVector3F vWCoord0, vWCoord1;
+				CalcUnProjectedRayPositions(vWCoord0, vWCoord1);
+				if (g_usesWorldUnitAsIntersectMargin)
+				{
+					// レイをワールド座標へ射影して、点群の各点（小さな球）との交差判定を行なう。
+					g_pointPicker.QueryPointsInWorld(g_pointCloud, g_pointOctree, vWCoord0, vWCoord1, IntersectMarginInWolrd, g_hitPointIndices);
+					g_pointPicker.SelectPoints(g_pointCloud, g_hitPointIndices, op);
+				}
+				else if (g_pointPicker.GetPickMode() == MyPointPicker::PickMode_All)
+				{
+					// 点群の各点を CPU でスクリーン座標変換し、マウス位置と交差するかどうかを調べる。
+					const MyMatrix4x4F& matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
+					g_pointPicker.SelectPointsIntersectWithScreenPosParallel(g_pointCloud, matToScreen,
+						float(g_mouseData.CurrentPos.x), float(g_mouseData.CurrentPos.y), IntersectMarginInScreen, op);
+				}
+				else
+				{
+					// 手前の点だけを選択する場合は、ホバー判定と同じくタイル グリッドで近傍の点を集めてから、レイ上の位置で並べ替える。
+					const MyMatrix4x4F& matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
+					g_pointPicker.QueryPointsInScreen(g_pointCloud, matToScreen, g_viewport.Width, g_viewport.Height,
+						float(g_mouseData.CurrentPos.x), float(g_mouseData.CurrentPos.y), IntersectMarginInScreen,
+						vWCoord0, vWCoord1, g_hitPointIndices);
+					g_pointPicker.SelectPoints(g_pointCloud, g_hitPointIndices, op);
+				}
+			}
+			else
+			{
+				// ドラッグによる選択矩形と交差する点を選択する。修飾キーがなければ、交差する点だけが選択された状態にする。
+				// 選択矩形をワールド座標系の視錐台に変換し、八分木のノード単位で内外判定することで、
+				// 点ごとのスクリーン座標変換は視錐台の境界付近の点だけで済ませる。
+				const MyMatrix4x4F& matToScreen = CalcTransformMatrixWorldCoordToScreenCoord();
+				const MyMatrix4x4F& matUnproj = CalcTransformMatrixScreenCoordToWorldCoord();
+				int rectL = 0;
+				int rectT = 0;
+				int rectR = 0;
+				int rectB = 0;
+				g_mouseData.GetNormalizedLDraggingRect(rectL, rectT, rectR, rectB);
+				g_pointPicker.SelectPointsIntersectWithScreenRectByFrustum(g_pointCloud, g_pointOctree, matToScreen, matUnproj, rectL, rectT, rectR, rectB,
+					GetSelectionOperationFromModifiers(MyBitsetOps::SetOperation_Replace));
+				pSelectionLabel = "Rect";
+			}
+			// 選択状態が変わった点の集合を、取り消し用の差分として記録する。
+			g_selectionHistory.Record(g_pointPicker.GetLastChangedSet(), pSelectionLabel);
+			const MySelectionSet& hitSet = g_pointPicker.GetLastHitSet();
+			printf("Selection: %u hits (%u containers, %u bitmaps), %u changed, %u selected, history %u ops (%.1f KB)\n",
+				uint32_t(hitSet.GetCardinality()), uint32_t(hitSet.GetContainersNum()), uint32_t(hitSet.GetBitmapContainersNum()),
+				uint32_t(g_pointPicker.GetLastChangedSet().GetCardinality()), uint32_t(g_pointCloud.CountSelected()),
+				uint32_t(g_selectionHistory.GetUndoableNum()), g_selectionHistory.GetMemoryBytes() / 1024.0);
+		}
+		break;
+	case GLUT_RIGHT_BUTTON:
+		g_mouseData.IsRightButtonPressed = (state == GLUT_DOWN);
+		if (g_mouseData.IsRightButtonPressed)
+		{
+			g_mouseData.DragStartPosR = MyVector2I(x, y);
+			// トラックボール開始。
+			g_myMeshTrackball.OnMouseDragStart(x, y);
+		}
+		else
+		{
+			// トラックボール停止。
+			g_myMeshTrackball.OnMouseDragStop(x, y);
+		}
+		// Motion() と同様にカメラの変化として扱う。回転中に保留したホバー判定も、ボタンを離した時点でやり直される。
+		dirtyFlags |= MyFrameScheduler::DirtyFlag_Camera;
+		break;
+	default:
+		break;
+	}
+	RequestFrame(dirtyFlags);
+}
+
+// マウス ドラッグ時。
+void Motion(int x, int y)
+{
+	g_inputRecorder.Record(MyInputTrace::EventType_Motion, 0, 0, 0, x, y);
+	g_mouseData.CurrentPos = MyVector2I(x, y);
+	// トラックボールの回転中はカメラが変わるので、ホバー判定は描画時に行なう。
+	OnHoverInput(!g_mouseData.IsRightButtonPressed);
+	uint32_t dirtyFlags = MyFrameScheduler::DirtyFlag_Hover;
+	if (g_mouseData.IsRightButtonPressed)
+	{
+		// トラックボール移動。
+		g_myMeshTrackball.OnMouseDragging(x, y);
+		dirtyFlags |= MyFrameScheduler::DirtyFlag_Camera;
+	}
+	if (g_mouseData.IsLeftButtonPressed)
+	{
+		dirtyFlags |= MyFrameScheduler::DirtyFlag_Selection;
+	}
+	RequestFrame(dirtyFlags);
+}
+
+// マウス移動時。ドラッグ中は呼ばれない。
+void PassiveMotion(int x, int y)
+{
+	g_inputRecorder.Record(MyInputTrace::EventType_PassiveMotion, 0, 0, 0, x, y);
+	g_mouseData.CurrentPos = MyVector2I(x, y);
+	OnHoverInput(true);
+	RequestFrame(MyFrameScheduler::DirtyFlag_Hover);
+}
+
+void Keyboard(unsigned char key, int x, int y)
+{
+	g_inputRecorder.Record(MyInputTrace::EventType_Keyboard, key, 0, glutGetModifiers(), x, y);
+	switch (key)
+	{
+	case '\033':
+		//exit(0);
+		::PostQuitMessage(key);
+		break;
+
+	case 'f':
+		break;
+
+	case 'a':
+		g_rendersCoordAxes = !g_rendersCoordAxes;
+		printf("g_rendersCoordAxes = %d\n", g_rendersCoordAxes);
+		break;
+
+	case 's':
+		g_usesWorldUnitAsIntersectMargin = false;
+		printf("g_usesWorldUnitAsIntersectMargin = %d\n", g_usesWorldUnitAsIntersectMargin);
+		break;
+
+	case 't':
+		break;
+
+	case 'w':
+		g_usesWorldUnitAsIntersectMargin = true;
+		printf("g_usesWorldUnitAsIntersectMargin = %d\n", g_usesWorldUnitAsIntersectMargin);
+		break;
+
+	case 'm':
+		// 点群データのメモリ レイアウトによる走査スループットの違いを計測する。
+		MeasurePointStoreLayout();
+		break;
+
+	case 'p':
+		// スクリーン座標系での選択処理の、スレッド数に対するスケーリングを計測する。
+		MeasureSelectionScaling();
+		break;
+
+	case 'k':
+		// ピッキングの対象（最も手前の点、手前から数点、すべての点）を切り替える。
+		g_pointPicker.SetPickMode(MyPointPicker::PickMode((g_pointPicker.GetPickMode() + 1) % MyPointPicker::PickMode_Count));
+		printf("PickMode = %s\n", MyPointPicker::GetPickModeName(g_pointPicker.GetPickMode()));
+		break;
+
+	case 'v':
+		// 全点の選択状態を反転する。
+		g_pointCloud.InvertSelection();
+		g_selectionHistory.RecordInvertAll(g_pointCloud.GetPointsNum(), "Invert");
+		printf("Selection inverted: %u selected\n", uint32_t(g_pointCloud.CountSelected()));
+		break;
+
+	case 'c':
+		{
+			// 空集合で置き換えて、選択されていた点を取り消し用の差分として記録する。
+			MySelectionSet changes;
+			g_pointCloud.ApplySelection(MyBitsetOps::SetOperation_Replace, MySelectionSet(), &changes);
+			g_selectionHistory.Record(changes, "Clear");
+			puts("Selection cleared.");
+		}
+		break;
+
+	case 'z':
+	case 'Z' - '@': // Ctrl+Z
+		{
+			const char* pLabel = g_selectionHistory.Undo(g_pointCloud);
+			printf("Undo %s: %u undoable, %u redoable\n", pLabel ? pLabel : "(none)",
+				uint32_t(g_selectionHistory.GetUndoableNum()), uint32_t(g_selectionHistory.GetRedoableNum()));
+		}
+		break;
+
+	case 'y':
+	case 'Y' - '@': // Ctrl+Y
+		{
+			const char* pLabel = g_selectionHistory.Redo(g_pointCloud);
+			printf("Redo %s: %u undoable, %u redoable\n", pLabel ? pLabel : "(none)",
+				uint32_t(g_selectionHistory.GetUndoableNum()), uint32_t(g_selectionHistory.GetRedoableNum()));
+		}
+		break;
+
+	case 'r':
+		// フレーム レートの上限を、なし → 固定 → 適応 の順に切り替える。
+		if (g_frameScheduler.GetMaxFramesPerSecond() <= 0)
+		{
+			g_frameScheduler.SetFrameRateCap(CappedFramesPerSecond, false);
+		}
+		else if (!g_frameScheduler.IsAdaptive())
+		{
+			g_frameScheduler.SetFrameRateCap(CappedFramesPerSecond, true);
+		}
+		else
+		{
+			g_frameScheduler.SetFrameRateCap(0, false);
+		}
+		{
+			const MyFrameScheduler::Stats& stats = g_frameScheduler.GetStats();
+			printf("Frame rate cap = %.0f fps%s; %llu frames for %llu invalidations (%llu coalesced, %llu deferred), average frame %.2f ms\n",
+				g_frameScheduler.GetMaxFramesPerSecond(), g_frameScheduler.IsAdaptive() ? " (adaptive)" : "",
+				static_cast<unsigned long long>(stats.FramesNum), static_cast<unsigned long long>(stats.InvalidationsNum),
+				static_cast<unsigned long long>(stats.CoalescedNum), static_cast<unsigned long long>(stats.DeferredNum),
+				g_frameScheduler.GetAverageFrameSeconds() * 1e3);
+		}
+		break;
+
+	case 'o':
+		// 処理ごとの CPU 時間の表示を切り替える。表示を始めるときに計測値をリセットし、やめるときにコンソールに出力する。
+		g_showsFrameProfile = !g_showsFrameProfile;
+		if (g_showsFrameProfile)
+		{
+			g_frameProfiler.Reset();
+			g_hoverLatencyTracker.Reset();
+		}
+		else
+		{
+			PrintFrameProfile();
+		}
+		break;
+
+	case 'O':
+		// 処理ごとのヒストグラムをファイルに書き出す。
+		g_frameProfiler.Collect();
+		if (g_frameProfiler.WriteCsvFile(FrameProfileCsvFilePath) && g_frameProfiler.WriteJsonFile(FrameProfileJsonFilePath))
+		{
+			printf("Frame profile written to \"%s\" and \"%s\".\n", FrameProfileCsvFilePath, FrameProfileJsonFilePath);
+		}
+		else
+		{
+			puts("Error : Failed to write the frame profile.");
+		}
+		break;
+
+	case 'h':
+		// ホバー判定を、描画時に 1 回行なうか、マウス移動のイベントごとに行なうかを切り替える。
+		// イベントごとに行なうとフレームの処理が短くなる代わりに、1 フレームに複数のイベントが届くと判定の回数が増える。
+		g_resolvesHoverAtEventTime = !g_resolvesHoverAtEventTime;
+		g_hoverLatencyTracker.Reset();
+		printf("Hover resolved at %s time.\n", g_resolvesHoverAtEventTime ? "event" : "render");
+		break;
+
+	case 'i':
+		// 合成センサーからのストリーミング入力を開始・停止する。
+		if (g_pagedPointCloud.IsOpen())
+		{
+			puts("Streaming ingest is not supported for paged point clouds.");
+		}
+		else if (g_inputRecorder.IsRecording())
+		{
+			// 記録した操作は生成し直した点群で再生するので、点群を変更しない。
+			puts("Streaming ingest is not available while recording input.");
+		}
+		else if (g_pointIngest.IsRunning())
+		{
+			StopPointIngest();
+		}
+		else
+		{
+			StartPointIngest();
+		}
+		break;
+
+	default:
+		break;
+	}
+	// キーによって表示の設定、選択状態、点群のいずれかが変わるので、すべて描画し直す。
+	RequestFrame(MyFrameScheduler::DirtyFlag_All);
+}
+
+void Special(int key, int x, int y)
+{
+	switch (key)
+	{
+	case GLUT_KEY_F1:
+		break;
+
+	case GLUT_KEY_F2:
+		break;
+
+	case GLUT_KEY_F3:
+		break;
+
+	case GLUT_KEY_F4:
+		break;
+
+	case GLUT_KEY_F5:
+		// 入力イベントの記録を開始・停止する。
+		ToggleInputRecording();
+		break;
+
+	case GLUT_KEY_F6:
+		break;
+
+	case GLUT_KEY_F7:
+		break;
+
+	case GLUT_KEY_F8:
+		break;
+
+	case GLUT_KEY_F9:
+		break;
+
+	case GLUT_KEY_F10:
+		break;
+
+	case GLUT_KEY_F11:
+		break;
+
+	case GLUT_KEY_F12:
+		break;
+
+	case GLUT_KEY_LEFT:
+		break;
+
+	case GLUT_KEY_RIGHT:
+		break;
+
+	case GLUT_KEY_UP:
+		break;
+
+	case GLUT_KEY_DOWN:
+		break;
+
+	case GLUT_KEY_PAGE_UP:
+		break;
+
+	case GLUT_KEY_PAGE_DOWN:
+		break;
+
+	case GLUT_KEY_HOME:
+		break;
+
+	case GLUT_KEY_END:
+		break;
+
+	case GLUT_KEY_INSERT:
+		break;
+	}
+}
+
+void OnMouseWheel(int wheelNumber, int direction, int x, int y)
+{
+	g_inputRecorder.Record(MyInputTrace::EventType_MouseWheel, wheelNumber, direction, 0, x, y);
+	g_transformCache.InvalidateCamera();
+	if (direction > 0)
+	{
+		g_camera.Eye.z -= 1;
+		const float LimitDistance = 1;
+		if (g_camera.Eye.z <= LimitDistance)
+		{
+			g_camera.Eye.z = LimitDistance;
+		}
+	}
+	else if (direction < 0)
+	{
+		g_camera.Eye.z += 1;
+	}
+	RequestFrame(MyFrameScheduler::DirtyFlag_Camera);
+}
+
+int main(int argc, char** argv)
+{
+	glutInit(&argc, argv);
+	glutInitWindowPosition(100, 100);
+	glutInitWindowSize(720, 720);
+	glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH | GLUT_DOUBLE);
+	glutCreateWindow("OpenGL Ray Pickup Test");
+	glutDisplayFunc(Display);
+	glutReshapeFunc(Reshape);
+	// アイドル時には描画しない。描画は入力イベントのコールバックから RequestFrame() で要求する。
+	glutMouseFunc(Mouse);
+	glutMotionFunc(Motion);
+	glutPassiveMotionFunc(PassiveMotion);
+	glutKeyboardFunc(Keyboard);
+	glutSpecialFunc(Special);
+	glutMouseWheelFunc(OnMouseWheel);
+	// メイン ウィンドウにクローズ メッセージが投げられたときに、メイン ループを抜ける。
+	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
+
+	glutCloseFunc(FinalizeApp);
+
+	// コマンドライン引数で点群ファイル（PLY, XYZ, LAS）を指定できる。
+	// glutInit() は GLUT 用の引数を取り除くので、残った最初の引数をファイル パスとみなす。
+	// ファイル パスの代わりに "<分布名>:<点数>[:<シード>]" を指定すると、ランダムな点群を生成する（InitializeApp() を参照）。
+	// 2 番目の引数は、点群の常駐に使ってよいメモリ量[MB]。これを超える点群はページングして扱う。
+	// 3 番目の引数は、選択操作の取り消し履歴に使ってよいメモリ量[MB]。
+	const size_t pagedMemoryBudgetMB = (argc >= 3) ? size_t(strtoul(argv[2], nullptr, 10)) : 0;
+	const size_t selectionHistoryBudgetMB = (argc >= 4) ? size_t(strtoul(argv[3], nullptr, 10)) : 0;
+	InitializeApp(argc >= 2 ? argv[1] : nullptr, pagedMemoryBudgetMB, selectionHistoryBudgetMB);
+
+	glutMainLoop();
+
+	return 0;
+}
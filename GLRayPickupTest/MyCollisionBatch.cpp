@@ -0,0 +1,340 @@
+﻿#include "stdafx.h"
+#include "MyCollisionBatch.hpp"
+
+#include <immintrin.h>
+
+
+// 各カーネルは、スカラー版の CheckLineIntersectWithSphere() とまったく同じ順序で同じ演算（減算、乗算、加算、除算）を行なう。
+// 逆数近似や FMA を使うと結果がわずかに変わり、境界上の点の判定がスカラー版と一致しなくなるので使わない。
+
+namespace
+{
+	using MyCollision::LineSphereBatchQuery;
+
+	// 一度にビットマスクへ書き出す点数。スタック上のバッファで足りる程度にしておく。
+	const size_t MaskBlockSize = 4096;
+	const size_t MaskBlockWordsNum = MaskBlockSize / 64;
+
+	typedef void(*RangeKernel)(const LineSphereBatchQuery&, const float*, const float*, const float*, size_t, uint64_t*);
+	typedef void(*IndexedKernel)(const LineSphereBatchQuery&, const float*, const float*, const float*, const uint32_t*, size_t, uint64_t*);
+
+	inline bool TestPointScalar(const LineSphereBatchQuery& query, float posX, float posY, float posZ)
+	{
+		// vPQ1 = q1 - point, vQ2Q1 = q1 - q2, cross(vPQ1, vQ2Q1) の順。
+		const float ax = query.LinePos1.x - posX;
+		const float ay = query.LinePos1.y - posY;
+		const float az = query.LinePos1.z - posZ;
+		const float bx = query.LineVecQ2Q1.x;
+		const float by = query.LineVecQ2Q1.y;
+		const float bz = query.LineVecQ2Q1.z;
+		const float cx = ay * bz - by * az;
+		const float cy = az * bx - bz * ax;
+		const float cz = ax * by - bx * ay;
+		const float crossLengthSquared = cx * cx + cy * cy + cz * cz;
+		return query.SphereRadiusSquared >= crossLengthSquared / query.LineVecLengthSquared;
+	}
+
+	void TestRangeScalar(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, size_t count, uint64_t* pOutMaskWords)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (TestPointScalar(query, pPosX[i], pPosY[i], pPosZ[i]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+	void TestIndexedScalar(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, const uint32_t* pIndices, size_t count, uint64_t* pOutMaskWords)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			if (TestPointScalar(query, pPosX[index], pPosY[index], pPosZ[index]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+#pragma region // SSE2 //
+
+	inline int TestLanesSSE2(const LineSphereBatchQuery& query, __m128 posX, __m128 posY, __m128 posZ)
+	{
+		const __m128 ax = _mm_sub_ps(_mm_set1_ps(query.LinePos1.x), posX);
+		const __m128 ay = _mm_sub_ps(_mm_set1_ps(query.LinePos1.y), posY);
+		const __m128 az = _mm_sub_ps(_mm_set1_ps(query.LinePos1.z), posZ);
+		const __m128 bx = _mm_set1_ps(query.LineVecQ2Q1.x);
+		const __m128 by = _mm_set1_ps(query.LineVecQ2Q1.y);
+		const __m128 bz = _mm_set1_ps(query.LineVecQ2Q1.z);
+		const __m128 cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az));
+		const __m128 cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax));
+		const __m128 cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay));
+		const __m128 crossLengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+		const __m128 distanceSquared = _mm_div_ps(crossLengthSquared, _mm_set1_ps(query.LineVecLengthSquared));
+		return _mm_movemask_ps(_mm_cmpge_ps(_mm_set1_ps(query.SphereRadiusSquared), distanceSquared));
+	}
+
+	void TestRangeSSE2(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, size_t count, uint64_t* pOutMaskWords)
+	{
+		const size_t simdCount = count & ~size_t(3);
+		for (size_t i = 0; i < simdCount; i += 4)
+		{
+			const int bits = TestLanesSSE2(query, _mm_loadu_ps(pPosX + i), _mm_loadu_ps(pPosY + i), _mm_loadu_ps(pPosZ + i));
+			pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+		for (size_t i = simdCount; i < count; ++i)
+		{
+			if (TestPointScalar(query, pPosX[i], pPosY[i], pPosZ[i]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+	void TestIndexedSSE2(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, const uint32_t* pIndices, size_t count, uint64_t* pOutMaskWords)
+	{
+		// SSE2 にはギャザー命令がないので、スカラー ロードで組み立てる。
+		const size_t simdCount = count & ~size_t(3);
+		for (size_t i = 0; i < simdCount; i += 4)
+		{
+			const uint32_t* p = pIndices + i;
+			const int bits = TestLanesSSE2(query,
+				_mm_setr_ps(pPosX[p[0]], pPosX[p[1]], pPosX[p[2]], pPosX[p[3]]),
+				_mm_setr_ps(pPosY[p[0]], pPosY[p[1]], pPosY[p[2]], pPosY[p[3]]),
+				_mm_setr_ps(pPosZ[p[0]], pPosZ[p[1]], pPosZ[p[2]], pPosZ[p[3]]));
+			pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+		for (size_t i = simdCount; i < count; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			if (TestPointScalar(query, pPosX[index], pPosY[index], pPosZ[index]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+#pragma endregion
+
+#pragma region // AVX2 //
+
+	MY_SIMD_TARGET_AVX2 inline int TestLanesAVX2(const LineSphereBatchQuery& query, __m256 posX, __m256 posY, __m256 posZ)
+	{
+		const __m256 ax = _mm256_sub_ps(_mm256_set1_ps(query.LinePos1.x), posX);
+		const __m256 ay = _mm256_sub_ps(_mm256_set1_ps(query.LinePos1.y), posY);
+		const __m256 az = _mm256_sub_ps(_mm256_set1_ps(query.LinePos1.z), posZ);
+		const __m256 bx = _mm256_set1_ps(query.LineVecQ2Q1.x);
+		const __m256 by = _mm256_set1_ps(query.LineVecQ2Q1.y);
+		const __m256 bz = _mm256_set1_ps(query.LineVecQ2Q1.z);
+		const __m256 cx = _mm256_sub_ps(_mm256_mul_ps(ay, bz), _mm256_mul_ps(by, az));
+		const __m256 cy = _mm256_sub_ps(_mm256_mul_ps(az, bx), _mm256_mul_ps(bz, ax));
+		const __m256 cz = _mm256_sub_ps(_mm256_mul_ps(ax, by), _mm256_mul_ps(bx, ay));
+		const __m256 crossLengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+		const __m256 distanceSquared = _mm256_div_ps(crossLengthSquared, _mm256_set1_ps(query.LineVecLengthSquared));
+		return _mm256_movemask_ps(_mm256_cmp_ps(_mm256_set1_ps(query.SphereRadiusSquared), distanceSquared, _CMP_GE_OQ));
+	}
+
+	MY_SIMD_TARGET_AVX2 void TestRangeAVX2(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, size_t count, uint64_t* pOutMaskWords)
+	{
+		const size_t simdCount = count & ~size_t(7);
+		for (size_t i = 0; i < simdCount; i += 8)
+		{
+			const int bits = TestLanesAVX2(query, _mm256_loadu_ps(pPosX + i), _mm256_loadu_ps(pPosY + i), _mm256_loadu_ps(pPosZ + i));
+			pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+		_mm256_zeroupper();
+		for (size_t i = simdCount; i < count; ++i)
+		{
+			if (TestPointScalar(query, pPosX[i], pPosY[i], pPosZ[i]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+	MY_SIMD_TARGET_AVX2 void TestIndexedAVX2(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, const uint32_t* pIndices, size_t count, uint64_t* pOutMaskWords)
+	{
+		const size_t simdCount = count & ~size_t(7);
+		for (size_t i = 0; i < simdCount; i += 8)
+		{
+			const __m256i vIndices = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pIndices + i));
+			const int bits = TestLanesAVX2(query,
+				_mm256_i32gather_ps(pPosX, vIndices, 4),
+				_mm256_i32gather_ps(pPosY, vIndices, 4),
+				_mm256_i32gather_ps(pPosZ, vIndices, 4));
+			pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+		_mm256_zeroupper();
+		for (size_t i = simdCount; i < count; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			if (TestPointScalar(query, pPosX[index], pPosY[index], pPosZ[index]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+#pragma endregion
+
+#ifdef MY_SIMD_SUPPORTS_AVX512
+#pragma region // AVX-512 //
+
+	MY_SIMD_TARGET_AVX512 inline uint32_t TestLanesAVX512(const LineSphereBatchQuery& query, __m512 posX, __m512 posY, __m512 posZ)
+	{
+		const __m512 ax = _mm512_sub_ps(_mm512_set1_ps(query.LinePos1.x), posX);
+		const __m512 ay = _mm512_sub_ps(_mm512_set1_ps(query.LinePos1.y), posY);
+		const __m512 az = _mm512_sub_ps(_mm512_set1_ps(query.LinePos1.z), posZ);
+		const __m512 bx = _mm512_set1_ps(query.LineVecQ2Q1.x);
+		const __m512 by = _mm512_set1_ps(query.LineVecQ2Q1.y);
+		const __m512 bz = _mm512_set1_ps(query.LineVecQ2Q1.z);
+		const __m512 cx = _mm512_sub_ps(_mm512_mul_ps(ay, bz), _mm512_mul_ps(by, az));
+		const __m512 cy = _mm512_sub_ps(_mm512_mul_ps(az, bx), _mm512_mul_ps(bz, ax));
+		const __m512 cz = _mm512_sub_ps(_mm512_mul_ps(ax, by), _mm512_mul_ps(bx, ay));
+		const __m512 crossLengthSquared = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(cx, cx), _mm512_mul_ps(cy, cy)), _mm512_mul_ps(cz, cz));
+		const __m512 distanceSquared = _mm512_div_ps(crossLengthSquared, _mm512_set1_ps(query.LineVecLengthSquared));
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(query.SphereRadiusSquared), distanceSquared, _CMP_GE_OQ);
+	}
+
+	MY_SIMD_TARGET_AVX512 void TestRangeAVX512(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, size_t count, uint64_t* pOutMaskWords)
+	{
+		const size_t simdCount = count & ~size_t(15);
+		for (size_t i = 0; i < simdCount; i += 16)
+		{
+			const uint32_t bits = TestLanesAVX512(query, _mm512_loadu_ps(pPosX + i), _mm512_loadu_ps(pPosY + i), _mm512_loadu_ps(pPosZ + i));
+			pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+		_mm256_zeroupper();
+		for (size_t i = simdCount; i < count; ++i)
+		{
+			if (TestPointScalar(query, pPosX[i], pPosY[i], pPosZ[i]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+	MY_SIMD_TARGET_AVX512 void TestIndexedAVX512(const LineSphereBatchQuery& query, const float* pPosX, const float* pPosY, const float* pPosZ, const uint32_t* pIndices, size_t count, uint64_t* pOutMaskWords)
+	{
+		const size_t simdCount = count & ~size_t(15);
+		for (size_t i = 0; i < simdCount; i += 16)
+		{
+			const __m512i vIndices = _mm512_loadu_si512(pIndices + i);
+			const uint32_t bits = TestLanesAVX512(query,
+				_mm512_i32gather_ps(vIndices, pPosX, 4),
+				_mm512_i32gather_ps(vIndices, pPosY, 4),
+				_mm512_i32gather_ps(vIndices, pPosZ, 4));
+			pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+		}
+		_mm256_zeroupper();
+		for (size_t i = simdCount; i < count; ++i)
+		{
+			const uint32_t index = pIndices[i];
+			if (TestPointScalar(query, pPosX[index], pPosY[index], pPosZ[index]))
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+#pragma endregion
+#endif
+
+	RangeKernel GetRangeKernel()
+	{
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+#ifdef MY_SIMD_SUPPORTS_AVX512
+		case MyCpuFeatures::SimdLevel_AVX512:
+			return TestRangeAVX512;
+#endif
+		case MyCpuFeatures::SimdLevel_AVX2:
+			return TestRangeAVX2;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			return TestRangeSSE2;
+		default:
+			return TestRangeScalar;
+		}
+	}
+
+	IndexedKernel GetIndexedKernel()
+	{
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+#ifdef MY_SIMD_SUPPORTS_AVX512
+		case MyCpuFeatures::SimdLevel_AVX512:
+			return TestIndexedAVX512;
+#endif
+		case MyCpuFeatures::SimdLevel_AVX2:
+			return TestIndexedAVX2;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			return TestIndexedSSE2;
+		default:
+			return TestIndexedScalar;
+		}
+	}
+
+	// ビットマスクのセットされたビットに対応するインデックスを追記する。
+	template<typename TIndexMapper> void AppendMaskedIndices(const uint64_t* pMaskWords, size_t wordsNum, TIndexMapper mapIndex, std::vector<uint32_t>& outIndices)
+	{
+		for (size_t w = 0; w < wordsNum; ++w)
+		{
+			uint64_t bits = pMaskWords[w];
+			while (bits != 0)
+			{
+				const size_t i = w * 64 + MyMath::GetLowestSetBitIndex(bits);
+				outIndices.push_back(mapIndex(i));
+				bits &= bits - 1;
+			}
+		}
+	}
+} // end of namespace
+
+namespace MyCollision
+{
+	void CheckLineIntersectWithSphereBatch(
+		const LineSphereBatchQuery& query,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		uint64_t* pOutHitMaskWords)
+	{
+		std::fill(pOutHitMaskWords, pOutHitMaskWords + (count + 63) / 64, uint64_t(0));
+		GetRangeKernel()(query, pPosX, pPosY, pPosZ, count, pOutHitMaskWords);
+	}
+
+	void CheckLineIntersectWithSphereBatch(
+		const LineSphereBatchQuery& query,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t firstIndex, size_t count,
+		std::vector<uint32_t>& outIndices)
+	{
+		const RangeKernel kernel = GetRangeKernel();
+		uint64_t maskWords[MaskBlockWordsNum];
+		for (size_t blockStart = 0; blockStart < count; blockStart += MaskBlockSize)
+		{
+			const size_t blockIndex = firstIndex + blockStart;
+			const size_t blockSize = std::min(MaskBlockSize, count - blockStart);
+			const size_t wordsNum = (blockSize + 63) / 64;
+			std::fill(maskWords, maskWords + wordsNum, uint64_t(0));
+			kernel(query, pPosX + blockIndex, pPosY + blockIndex, pPosZ + blockIndex, blockSize, maskWords);
+			AppendMaskedIndices(maskWords, wordsNum, [blockIndex](size_t i) { return uint32_t(blockIndex + i); }, outIndices);
+		}
+	}
+
+	void CheckLineIntersectWithSphereBatchIndexed(
+		const LineSphereBatchQuery& query,
+		const float* pPosX, const float* pPosY, const float* pPosZ, const uint32_t* pIndices, size_t count,
+		std::vector<uint32_t>& outIndices)
+	{
+		const IndexedKernel kernel = GetIndexedKernel();
+		uint64_t maskWords[MaskBlockWordsNum];
+		for (size_t blockStart = 0; blockStart < count; blockStart += MaskBlockSize)
+		{
+			const uint32_t* pBlockIndices = pIndices + blockStart;
+			const size_t blockSize = std::min(MaskBlockSize, count - blockStart);
+			const size_t wordsNum = (blockSize + 63) / 64;
+			std::fill(maskWords, maskWords + wordsNum, uint64_t(0));
+			kernel(query, pPosX, pPosY, pPosZ, pBlockIndices, blockSize, maskWords);
+			AppendMaskedIndices(maskWords, wordsNum, [pBlockIndices](size_t i) { return pBlockIndices[i]; }, outIndices);
+		}
+	}
+}
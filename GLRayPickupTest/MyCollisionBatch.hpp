@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+#include "MyCpuFeatures.hpp"
+
+namespace MyCollision
+{
+	//! @brief  直線と多数の球（同一半径）との交差判定を一括で行なうための、前計算済みの直線パラメータ。<br>
+	//! GetLengthSquaredBetweenLineAndPoint() が点ごとに再計算している (q1 - q2) とその長さの平方を、ここで一度だけ計算しておく。<br>
+	struct LineSphereBatchQuery
+	{
+		MyVector3F LinePos1;
+		MyVector3F LineVecQ2Q1; //!< (q1 - q2)。<br>
+		float LineVecLengthSquared; //!< |q1 - q2|^2。<br>
+		float SphereRadiusSquared;
+	public:
+		LineSphereBatchQuery(const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius)
+			: LinePos1(linePos1)
+			, LineVecQ2Q1(linePos1 - linePos2)
+			, LineVecLengthSquared(MyMath::GetVectorLengthSquared(linePos1 - linePos2))
+			, SphereRadiusSquared(sphereRadius * sphereRadius)
+		{}
+	};
+
+	// 使用する SIMD 命令セットは MyCpuFeatures::GetActiveSimdLevel() による。
+
+	//! @brief  位置座標配列（SoA）の先頭 count 点について直線と球の交差判定を行ない、結果を 64 点単位のビットマスクに書き込む。<br>
+	//! pOutHitMaskWords には (count + 63) / 64 ワード分の領域が必要。<br>
+	//! 結果は CheckLineIntersectWithSphere() と完全に一致する（除算を含めて同じ順序で同じ演算を行なう）。<br>
+	void CheckLineIntersectWithSphereBatch(
+		const LineSphereBatchQuery& query,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		uint64_t* pOutHitMaskWords);
+
+	//! @brief  位置座標配列（SoA）の [firstIndex, firstIndex + count) について交差判定を行ない、交差した点のインデックスを outIndices に追記する。<br>
+	void CheckLineIntersectWithSphereBatch(
+		const LineSphereBatchQuery& query,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t firstIndex, size_t count,
+		std::vector<uint32_t>& outIndices);
+
+	//! @brief  インデックス リストで指定された点について交差判定を行ない、交差した点のインデックスを outIndices に追記する。<br>
+	//! 八分木の葉ノードのように、判定対象が連続していない場合に使う。<br>
+	//! ギャザー命令はインデックスを符号付き 32bit 整数として扱うので、点数は 2^31 未満であること。<br>
+	void CheckLineIntersectWithSphereBatchIndexed(
+		const LineSphereBatchQuery& query,
+		const float* pPosX, const float* pPosY, const float* pPosZ, const uint32_t* pIndices, size_t count,
+		std::vector<uint32_t>& outIndices);
+}
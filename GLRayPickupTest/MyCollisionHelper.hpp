@@ -1,29 +1,134 @@
-﻿#pragma once
-
-#include "MyMath.hpp"
-
-namespace MyCollision
-{
-	// 点と直線との距離の平方（3D）。
-	template<typename T> T GetLengthSquaredBetweenLineAndPoint(const glm::detail::tvec3<T>& q1, const glm::detail::tvec3<T>& q2, const glm::detail::tvec3<T>& point)
-	{
-		const glm::detail::tvec3<T> vPQ1 = q1 - point, vQ2Q1 = q1 - q2, vCrossPQ1toQ2Q1 = glm::cross(vPQ1, vQ2Q1);
-		return MyMath::GetVectorLengthSquared(vCrossPQ1toQ2Q1) / MyMath::GetVectorLengthSquared(vQ2Q1);
-	}
-
-	// 直線と球との交差判定。
-	template<typename T> bool CheckLineIntersectWithSphere(const glm::detail::tvec3<T>& linePos1, const glm::detail::tvec3<T>& linePos2, const glm::detail::tvec3<T>& sphereCenter, T sphereRadius)
-	{
-		return (sphereRadius * sphereRadius) >= GetLengthSquaredBetweenLineAndPoint(linePos1, linePos2, sphereCenter);
-	}
-
-	// 指定された点と、最大値・最小値を指定された軸平行境界ボックス（AABB）との交差判定を行なう（2D）。
-	template<typename T> bool CheckIntersectWithAABBparameterizedMinMax2D(T targetX, T targetY, T aabbMinX, T aabbMinY, T aabbMaxX, T aabbMaxY)
-	{
-		return
-			(targetX > aabbMinX) &&
-			(targetX < aabbMaxX) &&
-			(targetY > aabbMinY) &&
-			(targetY < aabbMaxY);
-	}
-}
+﻿#pragma once
+
+#include "MyMath.hpp"
+
+namespace MyCollision
+{
+	// 点と直線との距離の平方（3D）。
+	template<typename T> T GetLengthSquaredBetweenLineAndPoint(const glm::detail::tvec3<T>& q1, const glm::detail::tvec3<T>& q2, const glm::detail::tvec3<T>& point)
+	{
+		const glm::detail::tvec3<T> vPQ1 = q1 - point, vQ2Q1 = q1 - q2, vCrossPQ1toQ2Q1 = glm::cross(vPQ1, vQ2Q1);
+		return MyMath::GetVectorLengthSquared(vCrossPQ1toQ2Q1) / MyMath::GetVectorLengthSquared(vQ2Q1);
+	}
+
+	// 直線と球との交差判定。
+	template<typename T> bool CheckLineIntersectWithSphere(const glm::detail::tvec3<T>& linePos1, const glm::detail::tvec3<T>& linePos2, const glm::detail::tvec3<T>& sphereCenter, T sphereRadius)
+	{
+		return (sphereRadius * sphereRadius) >= GetLengthSquaredBetweenLineAndPoint(linePos1, linePos2, sphereCenter);
+	}
+
+	// 直線上で点に最も近い位置の媒介変数 t。直線は linePos1 + t * (linePos2 - linePos1) で表す。
+	template<typename T> T GetLineParameterOfClosestPoint(const glm::detail::tvec3<T>& linePos1, const glm::detail::tvec3<T>& linePos2, const glm::detail::tvec3<T>& point)
+	{
+		const glm::detail::tvec3<T> vDir = linePos2 - linePos1;
+		return glm::dot(point - linePos1, vDir) / MyMath::GetVectorLengthSquared(vDir);
+	}
+
+	// 直線と、最大値・最小値を指定された軸平行境界ボックス（AABB）との交差判定（3D）。
+	// スラブ法による。線分ではなく無限直線として扱うので、媒介変数 t の範囲は制限しない。
+	// 交差する場合は、AABB に入る位置と出る位置の媒介変数 t を outTMin, outTMax に返す。直線が軸に平行な場合は ±無限大になりうる。
+	template<typename T> bool CalcLineIntersectWithAABB(const glm::detail::tvec3<T>& linePos1, const glm::detail::tvec3<T>& linePos2, const glm::detail::tvec3<T>& aabbMin, const glm::detail::tvec3<T>& aabbMax,
+		T& outTMin, T& outTMax)
+	{
+		const glm::detail::tvec3<T> vDir = linePos2 - linePos1;
+		T tMin = -std::numeric_limits<T>::infinity();
+		T tMax = +std::numeric_limits<T>::infinity();
+		for (int i = 0; i < 3; ++i)
+		{
+			if (vDir[i] == 0)
+			{
+				// 直線が軸に平行な場合、スラブの外にあれば交差しない。
+				if (linePos1[i] < aabbMin[i] || linePos1[i] > aabbMax[i])
+				{
+					return false;
+				}
+			}
+			else
+			{
+				const T invDir = 1 / vDir[i];
+				T t1 = (aabbMin[i] - linePos1[i]) * invDir;
+				T t2 = (aabbMax[i] - linePos1[i]) * invDir;
+				if (t1 > t2)
+				{
+					std::swap(t1, t2);
+				}
+				tMin = std::max(tMin, t1);
+				tMax = std::min(tMax, t2);
+				if (tMin > tMax)
+				{
+					return false;
+				}
+			}
+		}
+		outTMin = tMin;
+		outTMax = tMax;
+		return true;
+	}
+
+	template<typename T> bool CheckLineIntersectWithAABB(const glm::detail::tvec3<T>& linePos1, const glm::detail::tvec3<T>& linePos2, const glm::detail::tvec3<T>& aabbMin, const glm::detail::tvec3<T>& aabbMax)
+	{
+		T tMin, tMax;
+		return CalcLineIntersectWithAABB(linePos1, linePos2, aabbMin, aabbMax, tMin, tMax);
+	}
+
+	// 凸領域と AABB との包含関係。
+	enum ContainmentType
+	{
+		ContainmentType_Disjoint, //!< AABB 全体が凸領域の外側にある。<br>
+		ContainmentType_Intersects, //!< AABB が凸領域の境界にかかっている（判定できない場合も含む）。<br>
+		ContainmentType_Contains, //!< AABB 全体が凸領域の内側にある。<br>
+	};
+
+	// 3 点を通る平面 (a, b, c, d) を作成する。a * x + b * y + c * z + d = 0 を満たす。
+	// 法線 (a, b, c) は正規化しない。向きは (p1 - p0) × (p2 - p0) の方向。
+	template<typename T> glm::detail::tvec4<T> CreatePlaneFromPoints(const glm::detail::tvec3<T>& p0, const glm::detail::tvec3<T>& p1, const glm::detail::tvec3<T>& p2)
+	{
+		const glm::detail::tvec3<T> vNormal = glm::cross(p1 - p0, p2 - p0);
+		return glm::detail::tvec4<T>(vNormal, -glm::dot(vNormal, p0));
+	}
+
+	// 平面 (a, b, c, d) と点との符号付き距離（法線を正規化していない場合はその長さ倍）。
+	template<typename T> T GetSignedDistanceBetweenPlaneAndPoint(const glm::detail::tvec4<T>& plane, const glm::detail::tvec3<T>& point)
+	{
+		return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+	}
+
+	// 各平面の正の側の共通部分を凸領域として、AABB との包含関係を調べる（3D）。
+	// 平面ごとに、法線方向に最も遠い頂点と最も近い頂点だけを調べる。
+	// いずれの平面に対しても完全に外側ではないが、実際には凸領域と交差しない AABB も Intersects となる（保守的な判定）。
+	template<typename T> ContainmentType ClassifyAABBWithPlanes(const glm::detail::tvec3<T>& aabbMin, const glm::detail::tvec3<T>& aabbMax, const glm::detail::tvec4<T>* pPlanes, int planesNum)
+	{
+		ContainmentType result = ContainmentType_Contains;
+		for (int i = 0; i < planesNum; ++i)
+		{
+			const glm::detail::tvec4<T>& plane = pPlanes[i];
+			const glm::detail::tvec3<T> vFarthest(
+				(plane.x >= 0) ? aabbMax.x : aabbMin.x,
+				(plane.y >= 0) ? aabbMax.y : aabbMin.y,
+				(plane.z >= 0) ? aabbMax.z : aabbMin.z);
+			if (GetSignedDistanceBetweenPlaneAndPoint(plane, vFarthest) <= 0)
+			{
+				return ContainmentType_Disjoint;
+			}
+			const glm::detail::tvec3<T> vNearest(
+				(plane.x >= 0) ? aabbMin.x : aabbMax.x,
+				(plane.y >= 0) ? aabbMin.y : aabbMax.y,
+				(plane.z >= 0) ? aabbMin.z : aabbMax.z);
+			if (GetSignedDistanceBetweenPlaneAndPoint(plane, vNearest) <= 0)
+			{
+				result = ContainmentType_Intersects;
+			}
+		}
+		return result;
+	}
+
+	// 指定された点と、最大値・最小値を指定された軸平行境界ボックス（AABB）との交差判定を行なう（2D）。
+	template<typename T> bool CheckIntersectWithAABBparameterizedMinMax2D(T targetX, T targetY, T aabbMinX, T aabbMinY, T aabbMaxX, T aabbMaxY)
+	{
+		return
+			(targetX > aabbMinX) &&
+			(targetX < aabbMaxX) &&
+			(targetY > aabbMinY) &&
+			(targetY < aabbMaxY);
+	}
+}
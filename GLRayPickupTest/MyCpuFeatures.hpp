@@ -0,0 +1,153 @@
+﻿#pragma once
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+
+// GCC/Clang では、/arch 指定なしで上位の命令セットの組み込み関数を使う関数に target 属性が必要。
+// MSVC では不要（どの関数でも組み込み関数を使える）。
+#if defined(_MSC_VER)
+#define MY_SIMD_TARGET_AVX2
+#define MY_SIMD_TARGET_AVX512
+#else
+#define MY_SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#define MY_SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+// AVX-512 の組み込み関数は Visual Studio 2017 15.3 以降で利用可能。
+#if (defined(_MSC_VER) && (_MSC_VER >= 1911)) || (!defined(_MSC_VER) && defined(__GNUC__))
+#define MY_SIMD_SUPPORTS_AVX512
+#endif
+
+
+namespace MyCpuFeatures
+{
+	//! @brief  実行時に利用可能な SIMD 命令セットの水準。<br>
+	enum SimdLevel
+	{
+		SimdLevel_Scalar,
+		SimdLevel_SSE2,
+		SimdLevel_AVX2,
+		SimdLevel_AVX512,
+	};
+
+	inline const char* GetSimdLevelName(SimdLevel level)
+	{
+		switch (level)
+		{
+		case SimdLevel_SSE2:
+			return "SSE2";
+		case SimdLevel_AVX2:
+			return "AVX2";
+		case SimdLevel_AVX512:
+			return "AVX-512";
+		default:
+			return "Scalar";
+		}
+	}
+
+	namespace Detail
+	{
+		inline void GetCpuId(int leaf, int subleaf, uint32_t outRegs[4])
+		{
+#if defined(_MSC_VER)
+			int regs[4] = {};
+			__cpuidex(regs, leaf, subleaf);
+			for (int i = 0; i < 4; ++i)
+			{
+				outRegs[i] = uint32_t(regs[i]);
+			}
+#else
+			__cpuid_count(leaf, subleaf, outRegs[0], outRegs[1], outRegs[2], outRegs[3]);
+#endif
+		}
+
+		inline uint64_t GetXCR0()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			uint32_t eax = 0, edx = 0;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return (uint64_t(edx) << 32) | eax;
+#endif
+		}
+
+		inline SimdLevel DetectSimdLevel()
+		{
+			uint32_t regs[4] = {};
+			GetCpuId(0, 0, regs);
+			const uint32_t maxLeaf = regs[0];
+			if (maxLeaf < 1)
+			{
+				return SimdLevel_Scalar;
+			}
+
+			GetCpuId(1, 0, regs);
+			const bool hasSSE2 = (regs[3] & (1u << 26)) != 0;
+			const bool hasOSXSAVE = (regs[2] & (1u << 27)) != 0;
+			const bool hasAVX = (regs[2] & (1u << 28)) != 0;
+			if (!hasSSE2)
+			{
+				return SimdLevel_Scalar;
+			}
+			// YMM/ZMM レジスタの退避を OS がサポートしているかどうかも確認する必要がある。
+			if (!hasOSXSAVE || !hasAVX || maxLeaf < 7)
+			{
+				return SimdLevel_SSE2;
+			}
+			const uint64_t xcr0 = GetXCR0();
+			if ((xcr0 & 0x06) != 0x06)
+			{
+				return SimdLevel_SSE2;
+			}
+
+			GetCpuId(7, 0, regs);
+			const bool hasAVX2 = (regs[1] & (1u << 5)) != 0;
+			const bool hasAVX512F = (regs[1] & (1u << 16)) != 0;
+			if (!hasAVX2)
+			{
+				return SimdLevel_SSE2;
+			}
+#ifdef MY_SIMD_SUPPORTS_AVX512
+			if (hasAVX512F && (xcr0 & 0xE6) == 0xE6)
+			{
+				return SimdLevel_AVX512;
+			}
+#endif
+			return SimdLevel_AVX2;
+		}
+	}
+
+	//! @brief  実行中の CPU と OS で利用可能な最上位の SIMD 命令セットを取得する。<br>
+	inline SimdLevel GetSupportedSimdLevel()
+	{
+		static const SimdLevel level = Detail::DetectSimdLevel();
+		return level;
+	}
+
+	namespace Detail
+	{
+		inline SimdLevel& GetActiveSimdLevelRef()
+		{
+			static SimdLevel level = GetSupportedSimdLevel();
+			return level;
+		}
+	}
+
+	//! @brief  一括処理のカーネルが実際に使う SIMD 命令セットを取得する。既定ではサポートされる最上位の水準。<br>
+	inline SimdLevel GetActiveSimdLevel()
+	{
+		return Detail::GetActiveSimdLevelRef();
+	}
+
+	//! @brief  一括処理のカーネルが使う SIMD 命令セットを変更する。<br>
+	//! 検証や計測のためのもの。CPU がサポートする水準より上を指定した場合は、サポートされる最上位の水準になる。<br>
+	inline void SetActiveSimdLevel(SimdLevel level)
+	{
+		Detail::GetActiveSimdLevelRef() = std::min(level, GetSupportedSimdLevel());
+	}
+}
@@ -0,0 +1,313 @@
+﻿#include "stdafx.h"
+#include "MyFrameProfiler.hpp"
+#include "MyMath.hpp"
+
+
+namespace
+{
+	std::atomic<uint64_t> g_nextProfilerId(1);
+
+	// スレッドが最後に使ったプロファイラーとそのリング バッファ。
+	struct ThreadRingCache
+	{
+		uint64_t ProfilerId;
+		void* pRing;
+	};
+	thread_local ThreadRingCache t_ringCache = { 0, nullptr };
+}
+
+
+#pragma region // MyLatencyHistogram //
+
+void MyLatencyHistogram::Clear()
+{
+	std::fill(m_counts.begin(), m_counts.end(), 0);
+	m_totalCount = 0;
+	m_minValue = UINT64_MAX;
+	m_maxValue = 0;
+	m_sum = 0;
+}
+
+size_t MyLatencyHistogram::GetBucketIndex(uint64_t value)
+{
+	if (value < 2 * SubBucketsNum)
+	{
+		return size_t(value);
+	}
+	// 最上位ビットから SubBucketBits + 1 ビットを残す。残した値は [SubBucketsNum, 2 * SubBucketsNum) に入る。
+	const int shift = MyMath::GetHighestSetBitIndex(value) - SubBucketBits;
+	return size_t(2 * SubBucketsNum + (shift - 1) * SubBucketsNum + ((value >> shift) - SubBucketsNum));
+}
+
+uint64_t MyLatencyHistogram::GetBucketLowerBound(size_t bucketIndex)
+{
+	if (bucketIndex < 2 * SubBucketsNum)
+	{
+		return bucketIndex;
+	}
+	const size_t offset = bucketIndex - 2 * SubBucketsNum;
+	const int shift = int(offset / SubBucketsNum) + 1;
+	return (SubBucketsNum + offset % SubBucketsNum) << shift;
+}
+
+uint64_t MyLatencyHistogram::GetBucketUpperBound(size_t bucketIndex)
+{
+	return (bucketIndex + 1 < BucketsNum) ? GetBucketLowerBound(bucketIndex + 1) - 1 : UINT64_MAX;
+}
+
+void MyLatencyHistogram::Record(uint64_t value)
+{
+	++m_counts[GetBucketIndex(value)];
+	++m_totalCount;
+	m_minValue = std::min(m_minValue, value);
+	m_maxValue = std::max(m_maxValue, value);
+	m_sum += double(value);
+}
+
+uint64_t MyLatencyHistogram::GetValueAtPercentile(double percentile) const
+{
+	if (m_totalCount == 0)
+	{
+		return 0;
+	}
+	const double clampedPercentile = std::min(std::max(percentile, 0.0), 100.0);
+	const uint64_t targetCount = std::max<uint64_t>(1, uint64_t(std::ceil(clampedPercentile * 0.01 * m_totalCount)));
+	uint64_t cumulativeCount = 0;
+	for (size_t i = 0; i < BucketsNum; ++i)
+	{
+		cumulativeCount += m_counts[i];
+		if (cumulativeCount >= targetCount)
+		{
+			return std::min(GetBucketUpperBound(i), m_maxValue);
+		}
+	}
+	return m_maxValue;
+}
+
+#pragma endregion
+
+
+#pragma region // MyFrameProfiler //
+
+MyFrameProfiler::MyFrameProfiler()
+	: m_id(g_nextProfilerId++)
+	, m_droppedNum()
+{
+}
+
+uint32_t MyFrameProfiler::AddPhase(const char* pName)
+{
+	m_phaseNames.push_back(pName);
+	m_histograms.push_back(MyLatencyHistogram());
+	return uint32_t(m_phaseNames.size() - 1);
+}
+
+MyFrameProfiler::ThreadRing& MyFrameProfiler::GetThreadRing()
+{
+	if (t_ringCache.ProfilerId != m_id)
+	{
+		// スレッドごとに初回だけリング バッファを確保して登録する。
+		std::lock_guard<std::mutex> lock(m_ringsMutex);
+		m_rings.push_back(std::unique_ptr<ThreadRing>(new ThreadRing()));
+		t_ringCache.ProfilerId = m_id;
+		t_ringCache.pRing = m_rings.back().get();
+	}
+	return *static_cast<ThreadRing*>(t_ringCache.pRing);
+}
+
+void MyFrameProfiler::Record(uint32_t phase, uint64_t nanoseconds)
+{
+	ThreadRing& ring = this->GetThreadRing();
+	const Sample sample = { phase, nanoseconds };
+	if (ring.Ring.TryPush(&sample, 1) == 0)
+	{
+		ring.DroppedNum.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void MyFrameProfiler::Collect()
+{
+	std::lock_guard<std::mutex> lock(m_ringsMutex);
+	m_scratchSamples.resize(RingCapacityPerThread);
+	for (const auto& pRing : m_rings)
+	{
+		size_t poppedNum = 0;
+		while ((poppedNum = pRing->Ring.TryPop(m_scratchSamples.data(), m_scratchSamples.size())) > 0)
+		{
+			for (size_t i = 0; i < poppedNum; ++i)
+			{
+				const Sample& sample = m_scratchSamples[i];
+				if (sample.Phase < m_histograms.size())
+				{
+					m_histograms[sample.Phase].Record(sample.Nanoseconds);
+				}
+			}
+		}
+		m_droppedNum += pRing->DroppedNum.exchange(0, std::memory_order_relaxed);
+	}
+}
+
+void MyFrameProfiler::Reset()
+{
+	this->Collect();
+	for (auto& histogram : m_histograms)
+	{
+		histogram.Clear();
+	}
+	m_droppedNum = 0;
+}
+
+bool MyFrameProfiler::WriteCsvFile(const char* pFilePath) const
+{
+	FILE* pFile = nullptr;
+	if (fopen_s(&pFile, pFilePath, "w") != 0 || !pFile)
+	{
+		return false;
+	}
+	fprintf(pFile, "phase,lower_ns,upper_ns,count,cumulative_percentile\n");
+	for (size_t p = 0; p < m_histograms.size(); ++p)
+	{
+		const MyLatencyHistogram& histogram = m_histograms[p];
+		uint64_t cumulativeCount = 0;
+		for (size_t i = 0; i < MyLatencyHistogram::BucketsNum; ++i)
+		{
+			const uint64_t count = histogram.GetBucketCount(i);
+			if (count == 0)
+			{
+				continue;
+			}
+			cumulativeCount += count;
+			fprintf(pFile, "%s,%llu,%llu,%llu,%.6f\n", m_phaseNames[p],
+				static_cast<unsigned long long>(MyLatencyHistogram::GetBucketLowerBound(i)),
+				static_cast<unsigned long long>(MyLatencyHistogram::GetBucketUpperBound(i)),
+				static_cast<unsigned long long>(count), 100.0 * cumulativeCount / histogram.GetTotalCount());
+		}
+	}
+	fclose(pFile);
+	return true;
+}
+
+bool MyFrameProfiler::WriteJsonFile(const char* pFilePath) const
+{
+	FILE* pFile = nullptr;
+	if (fopen_s(&pFile, pFilePath, "w") != 0 || !pFile)
+	{
+		return false;
+	}
+	static const double Percentiles[] = { 50, 90, 99, 99.9 };
+	fprintf(pFile, "{\n");
+	fprintf(pFile, "  \"unit\": \"ns\",\n");
+	fprintf(pFile, "  \"sub_buckets\": %llu,\n", static_cast<unsigned long long>(MyLatencyHistogram::SubBucketsNum));
+	fprintf(pFile, "  \"dropped\": %llu,\n", static_cast<unsigned long long>(m_droppedNum));
+	fprintf(pFile, "  \"phases\": [");
+	for (size_t p = 0; p < m_histograms.size(); ++p)
+	{
+		const MyLatencyHistogram& histogram = m_histograms[p];
+		fprintf(pFile, "%s\n    {\n", (p > 0) ? "," : "");
+		fprintf(pFile, "      \"name\": \"%s\",\n", m_phaseNames[p]);
+		fprintf(pFile, "      \"count\": %llu,\n", static_cast<unsigned long long>(histogram.GetTotalCount()));
+		fprintf(pFile, "      \"min\": %llu,\n", static_cast<unsigned long long>(histogram.GetMinValue()));
+		fprintf(pFile, "      \"mean\": %.6g,\n", histogram.GetMeanValue());
+		fprintf(pFile, "      \"max\": %llu,\n", static_cast<unsigned long long>(histogram.GetMaxValue()));
+		fprintf(pFile, "      \"percentiles\": {");
+		for (size_t k = 0; k < sizeof(Percentiles) / sizeof(Percentiles[0]); ++k)
+		{
+			fprintf(pFile, "%s \"p%g\": %llu", (k > 0) ? "," : "", Percentiles[k],
+				static_cast<unsigned long long>(histogram.GetValueAtPercentile(Percentiles[k])));
+		}
+		fprintf(pFile, " },\n");
+		// 非空のバケットを [下限, 上限, 個数] で列挙する。
+		fprintf(pFile, "      \"buckets\": [");
+		bool isFirstBucket = true;
+		for (size_t i = 0; i < MyLatencyHistogram::BucketsNum; ++i)
+		{
+			const uint64_t count = histogram.GetBucketCount(i);
+			if (count == 0)
+			{
+				continue;
+			}
+			fprintf(pFile, "%s[%llu, %llu, %llu]", isFirstBucket ? "" : ", ",
+				static_cast<unsigned long long>(MyLatencyHistogram::GetBucketLowerBound(i)),
+				static_cast<unsigned long long>(MyLatencyHistogram::GetBucketUpperBound(i)),
+				static_cast<unsigned long long>(count));
+			isFirstBucket = false;
+		}
+		fprintf(pFile, "]\n    }");
+	}
+	fprintf(pFile, "\n  ]\n}\n");
+	fclose(pFile);
+	return true;
+}
+
+#pragma endregion
+
+
+#pragma region // MyInputLatencyTracker //
+
+MyInputLatencyTracker::MyInputLatencyTracker(MyFrameProfiler& profiler, uint32_t phase, double budgetSeconds)
+	: m_profiler(profiler)
+	, m_phase(phase)
+	, m_budgetSeconds(budgetSeconds)
+	, m_framesNum()
+	, m_overBudgetFramesNum()
+	, m_droppedEventsNum()
+	, m_lastFrameLatencySeconds()
+	, m_worstFrameLatencySeconds()
+	, m_isLastFrameOverBudget()
+{
+	m_pendingEventTimes.reserve(MaxEventsPerFrame);
+	m_frameEventTimes.reserve(MaxEventsPerFrame);
+}
+
+void MyInputLatencyTracker::OnInput(Clock::time_point eventTime)
+{
+	if (m_pendingEventTimes.size() < MaxEventsPerFrame)
+	{
+		m_pendingEventTimes.push_back(eventTime);
+	}
+	else
+	{
+		++m_droppedEventsNum;
+	}
+}
+
+void MyInputLatencyTracker::BeginFrame()
+{
+	// 容量を確保済みのバッファを入れ替えるだけなので、フレームごとのメモリ確保はない。
+	m_frameEventTimes.swap(m_pendingEventTimes);
+	m_pendingEventTimes.clear();
+}
+
+bool MyInputLatencyTracker::EndFrame(Clock::time_point presentTime)
+{
+	if (m_frameEventTimes.empty())
+	{
+		return false;
+	}
+	for (const auto& eventTime : m_frameEventTimes)
+	{
+		m_profiler.Record(m_phase, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(presentTime - eventTime).count()));
+	}
+	m_lastFrameLatencySeconds = std::chrono::duration<double>(presentTime - m_frameEventTimes.front()).count();
+	m_worstFrameLatencySeconds = std::max(m_worstFrameLatencySeconds, m_lastFrameLatencySeconds);
+	m_isLastFrameOverBudget = (m_lastFrameLatencySeconds > m_budgetSeconds);
+	++m_framesNum;
+	if (m_isLastFrameOverBudget)
+	{
+		++m_overBudgetFramesNum;
+	}
+	m_frameEventTimes.clear();
+	return m_isLastFrameOverBudget;
+}
+
+void MyInputLatencyTracker::Reset()
+{
+	m_framesNum = 0;
+	m_overBudgetFramesNum = 0;
+	m_droppedEventsNum = 0;
+	m_lastFrameLatencySeconds = 0;
+	m_worstFrameLatencySeconds = 0;
+	m_isLastFrameOverBudget = false;
+}
+
+#pragma endregion
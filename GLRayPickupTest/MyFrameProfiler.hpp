@@ -0,0 +1,194 @@
+﻿#pragma once
+
+#include "MySpscRingBuffer.hpp"
+
+
+//! @brief  処理時間[ns]の分布を、相対誤差一定のバケットで数えるヒストグラム（HdrHistogram と同様の対数・線形バケット）。<br>
+//! 2 のべき乗の範囲ごとに SubBucketsNum 個の等幅バケットに分けるので、どの値でも分解能は 1/SubBucketsNum（約 3%）以内になる。<br>
+//! 2 * SubBucketsNum ns 未満の値は 1ns 単位で数える。<br>
+class MyLatencyHistogram
+{
+public:
+	static const int SubBucketBits = 5;
+	static const uint64_t SubBucketsNum = uint64_t(1) << SubBucketBits;
+	//! @brief  バケット数。64bit のすべての値を表せる。<br>
+	static const size_t BucketsNum = size_t(2 * SubBucketsNum + (64 - SubBucketBits - 1) * SubBucketsNum);
+
+private:
+	std::vector<uint64_t> m_counts;
+	uint64_t m_totalCount;
+	uint64_t m_minValue;
+	uint64_t m_maxValue;
+	double m_sum;
+
+public:
+	MyLatencyHistogram()
+		: m_counts(BucketsNum)
+		, m_totalCount()
+		, m_minValue(UINT64_MAX)
+		, m_maxValue()
+		, m_sum()
+	{}
+
+public:
+	void Clear();
+	void Record(uint64_t value);
+
+	uint64_t GetTotalCount() const { return m_totalCount; }
+	uint64_t GetMinValue() const { return m_totalCount ? m_minValue : 0; }
+	uint64_t GetMaxValue() const { return m_maxValue; }
+	double GetMeanValue() const { return m_totalCount ? m_sum / m_totalCount : 0; }
+
+	//! @brief  percentile[%] 以下の値が含まれるバケットの上限値。最大値を超える場合は最大値。<br>
+	uint64_t GetValueAtPercentile(double percentile) const;
+
+	uint64_t GetBucketCount(size_t bucketIndex) const { return m_counts[bucketIndex]; }
+	static size_t GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketLowerBound(size_t bucketIndex);
+	static uint64_t GetBucketUpperBound(size_t bucketIndex);
+};
+
+
+//! @brief  フレーム内の処理ごとの CPU 時間を計測するプロファイラー。<br>
+//! 計測値はスレッドごとのロックフリーの SPSC リング バッファに積むだけなので、計測側はロックを取らず、メモリも確保しない（各スレッドの初回を除く）。<br>
+//! メイン スレッドが Collect() でリング バッファを空にして、処理ごとの MyLatencyHistogram に集計する。<br>
+//! リング バッファが満杯になった場合は計測値を捨てて数える。<br>
+class MyFrameProfiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Sample
+	{
+		uint32_t Phase;
+		uint64_t Nanoseconds;
+	};
+
+	static const size_t RingCapacityPerThread = 4096;
+
+private:
+	struct ThreadRing
+	{
+		MySpscRingBuffer<Sample> Ring;
+		std::atomic<uint64_t> DroppedNum;
+		ThreadRing() : Ring(RingCapacityPerThread), DroppedNum() {}
+	};
+
+private:
+	const uint64_t m_id; //!< スレッドごとのリング バッファのキャッシュを、プロファイラーのインスタンスごとに区別するための通し番号。<br>
+	std::mutex m_ringsMutex;
+	std::vector<std::unique_ptr<ThreadRing>> m_rings;
+	std::vector<const char*> m_phaseNames;
+	std::vector<MyLatencyHistogram> m_histograms;
+	std::vector<Sample> m_scratchSamples;
+	uint64_t m_droppedNum;
+
+public:
+	MyFrameProfiler();
+
+public:
+	//! @brief  計測する処理を追加して、その番号を返す。計測を始める前に、メイン スレッドで呼ぶこと。pName は静的な文字列であること。<br>
+	uint32_t AddPhase(const char* pName);
+
+	size_t GetPhasesNum() const { return m_phaseNames.size(); }
+	const char* GetPhaseName(uint32_t phase) const { return m_phaseNames[phase]; }
+	const MyLatencyHistogram& GetHistogram(uint32_t phase) const { return m_histograms[phase]; }
+	uint64_t GetDroppedNum() const { return m_droppedNum; }
+
+	//! @brief  計測値を積む。どのスレッドから呼んでもよい。<br>
+	void Record(uint32_t phase, uint64_t nanoseconds);
+
+	//! @brief  全スレッドのリング バッファの計測値をヒストグラムに集計する。メイン スレッドから呼ぶこと。<br>
+	void Collect();
+
+	//! @brief  集計済みのヒストグラムをクリアする。<br>
+	void Reset();
+
+	//! @brief  処理ごとの非空のバケットを CSV で書き出す。<br>
+	bool WriteCsvFile(const char* pFilePath) const;
+
+	//! @brief  処理ごとの統計値とパーセンタイル、非空のバケットを JSON で書き出す。<br>
+	bool WriteJsonFile(const char* pFilePath) const;
+
+private:
+	ThreadRing& GetThreadRing();
+
+	MyFrameProfiler(const MyFrameProfiler&) = delete;
+	MyFrameProfiler& operator=(const MyFrameProfiler&) = delete;
+};
+
+
+//! @brief  スコープの開始から終了までの時間を MyFrameProfiler に記録する。<br>
+class MyProfileScope
+{
+	MyFrameProfiler& m_profiler;
+	const uint32_t m_phase;
+	const MyFrameProfiler::Clock::time_point m_beginTime;
+
+public:
+	MyProfileScope(MyFrameProfiler& profiler, uint32_t phase)
+		: m_profiler(profiler)
+		, m_phase(phase)
+		, m_beginTime(MyFrameProfiler::Clock::now())
+	{}
+
+	~MyProfileScope()
+	{
+		const auto elapsed = MyFrameProfiler::Clock::now() - m_beginTime;
+		m_profiler.Record(m_phase, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+	}
+
+private:
+	MyProfileScope(const MyProfileScope&) = delete;
+	MyProfileScope& operator=(const MyProfileScope&) = delete;
+};
+
+
+//! @brief  入力イベントから、その結果を表示したフレームの glutSwapBuffers() までの時間（入力遅延）を計測する。<br>
+//! イベントが届いたら OnInput() で時刻を控えておき、フレームの開始時に BeginFrame() でそのフレームに反映するイベントとして引き取る。<br>
+//! バッファの交換後に EndFrame() を呼ぶと、イベントごとの遅延を MyFrameProfiler の処理 phase として記録し、<br>
+//! 最も古いイベントの遅延が予算を超えたフレームを数える。<br>
+//! glutSwapBuffers() から戻った時刻までを測るので、ディスプレイに表示されるまでの時間（垂直同期やコンポジターの待ち）は含まない。<br>
+class MyInputLatencyTracker
+{
+public:
+	typedef MyFrameProfiler::Clock Clock;
+
+	//! @brief  1 フレームで引き取るイベント数の上限。超えた分は新しい順に捨てて数える（最も古いイベントの遅延は失われない）。<br>
+	static const size_t MaxEventsPerFrame = 1024;
+
+private:
+	MyFrameProfiler& m_profiler;
+	const uint32_t m_phase;
+	std::vector<Clock::time_point> m_pendingEventTimes; //!< まだどのフレームにも引き取られていないイベント。<br>
+	std::vector<Clock::time_point> m_frameEventTimes; //!< 描画中のフレームに反映するイベント。<br>
+	double m_budgetSeconds;
+	uint64_t m_framesNum; //!< イベントを反映したフレーム数。<br>
+	uint64_t m_overBudgetFramesNum;
+	uint64_t m_droppedEventsNum;
+	double m_lastFrameLatencySeconds; //!< 直近のフレームの、最も古いイベントの遅延。<br>
+	double m_worstFrameLatencySeconds;
+	bool m_isLastFrameOverBudget;
+
+public:
+	MyInputLatencyTracker(MyFrameProfiler& profiler, uint32_t phase, double budgetSeconds);
+
+public:
+	void OnInput(Clock::time_point eventTime);
+	void BeginFrame();
+	//! @brief  フレームの遅延が予算を超えた場合は true を返す。<br>
+	bool EndFrame(Clock::time_point presentTime);
+	void Reset();
+
+	double GetBudgetSeconds() const { return m_budgetSeconds; }
+	uint64_t GetFramesNum() const { return m_framesNum; }
+	uint64_t GetOverBudgetFramesNum() const { return m_overBudgetFramesNum; }
+	uint64_t GetDroppedEventsNum() const { return m_droppedEventsNum; }
+	double GetLastFrameLatencySeconds() const { return m_lastFrameLatencySeconds; }
+	double GetWorstFrameLatencySeconds() const { return m_worstFrameLatencySeconds; }
+	bool IsLastFrameOverBudget() const { return m_isLastFrameOverBudget; }
+
+private:
+	MyInputLatencyTracker(const MyInputLatencyTracker&) = delete;
+	MyInputLatencyTracker& operator=(const MyInputLatencyTracker&) = delete;
+};
@@ -0,0 +1,57 @@
+﻿#include "stdafx.h"
+#include "MyFrameScheduler.hpp"
+
+
+const double MyFrameScheduler::AdaptiveBusyRatio = 0.5;
+const double MyFrameScheduler::FrameSecondsSmoothing = 0.125;
+
+
+double MyFrameScheduler::GetMinFrameIntervalSeconds() const
+{
+	if (m_maxFramesPerSecond <= 0)
+	{
+		return 0;
+	}
+	const double capSeconds = 1.0 / m_maxFramesPerSecond;
+	return m_isAdaptive ? std::max(capSeconds, m_averageFrameSeconds / AdaptiveBusyRatio) : capSeconds;
+}
+
+MyFrameScheduler::FrameRequest MyFrameScheduler::Invalidate(uint32_t flags, Clock::time_point now, double& outDelaySeconds)
+{
+	outDelaySeconds = 0;
+	m_dirtyFlags |= flags;
+	++m_stats.InvalidationsNum;
+	if (m_isFramePending)
+	{
+		++m_stats.CoalescedNum;
+		return FrameRequest_None;
+	}
+	m_isFramePending = true;
+	const double elapsedSeconds = std::chrono::duration<double>(now - m_lastFrameBeginTime).count();
+	const double delaySeconds = this->GetMinFrameIntervalSeconds() - elapsedSeconds;
+	if (delaySeconds <= 0)
+	{
+		return FrameRequest_PostNow;
+	}
+	++m_stats.DeferredNum;
+	outDelaySeconds = delaySeconds;
+	return FrameRequest_PostLater;
+}
+
+uint32_t MyFrameScheduler::BeginFrame(Clock::time_point now)
+{
+	const uint32_t flags = m_dirtyFlags;
+	m_dirtyFlags = 0;
+	m_isFramePending = false;
+	m_lastFrameBeginTime = now;
+	++m_stats.FramesNum;
+	return flags;
+}
+
+void MyFrameScheduler::EndFrame(Clock::time_point now)
+{
+	const double frameSeconds = std::chrono::duration<double>(now - m_lastFrameBeginTime).count();
+	// 最初のフレームの処理時間で移動平均を初期化する。
+	m_averageFrameSeconds = (m_averageFrameSeconds <= 0) ? frameSeconds :
+		m_averageFrameSeconds + (frameSeconds - m_averageFrameSeconds) * FrameSecondsSmoothing;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+
+
+//! @brief  入力イベントなどで立てたダーティ フラグに基づいて、必要なときだけフレームを描画するためのスケジューラー。<br>
+//! 描画の要求は次のフレームの開始まで 1 つにまとめるので、連続して届くマウス移動などのイベントは 1 フレームの描画で済む。<br>
+//! 最大フレーム レートを指定すると、前のフレームの開始から最小間隔が経つまで描画を遅らせる。<br>
+//! 適応モードでは、直近のフレームの処理時間の移動平均が間隔の AdaptiveBusyRatio を超えないように間隔を広げる。<br>
+//! ウィンドウ システムには依存しないので、描画の要求とタイマーの設定は Invalidate() の戻り値に従って呼び出し側で行なう。<br>
+class MyFrameScheduler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	//! @brief  フレームを描画し直す理由。描画側は BeginFrame() の戻り値を見て、不要な処理を省略できる。<br>
+	enum DirtyFlag
+	{
+		DirtyFlag_Hover = 1 << 0, //!< マウス位置が変わった。ホバー判定をやり直す。<br>
+		DirtyFlag_Camera = 1 << 1, //!< カメラやトラックボールの回転が変わった。<br>
+		DirtyFlag_Viewport = 1 << 2, //!< ウィンドウのサイズが変わった。<br>
+		DirtyFlag_Selection = 1 << 3, //!< 選択状態や選択矩形が変わった。<br>
+		DirtyFlag_Scene = 1 << 4, //!< 点群や表示の設定が変わった。<br>
+		DirtyFlag_Streaming = 1 << 5, //!< ストリーミング入力やページングなど、フレームごとに進む処理が続いている。<br>
+		DirtyFlag_All = (1 << 6) - 1,
+	};
+
+	//! @brief  Invalidate() の結果として、呼び出し側が行なうこと。<br>
+	enum FrameRequest
+	{
+		FrameRequest_None, //!< 既に描画を要求済み。何もしなくてよい。<br>
+		FrameRequest_PostNow, //!< 直ちに描画を要求する（glutPostRedisplay()）。<br>
+		FrameRequest_PostLater, //!< outDelaySeconds 後に描画を要求する（glutTimerFunc()）。<br>
+	};
+
+	//! @brief  適応モードでの、フレームの処理時間がフレーム間隔に占める割合の上限。<br>
+	static const double AdaptiveBusyRatio;
+	//! @brief  処理時間の移動平均の重み。<br>
+	static const double FrameSecondsSmoothing;
+
+	struct Stats
+	{
+		uint64_t FramesNum; //!< BeginFrame() の回数。<br>
+		uint64_t InvalidationsNum; //!< Invalidate() の回数。<br>
+		uint64_t CoalescedNum; //!< 描画要求済みのフレームにまとめた Invalidate() の回数。<br>
+		uint64_t DeferredNum; //!< フレーム レートの上限のために遅らせた描画要求の回数。<br>
+	};
+
+private:
+	uint32_t m_dirtyFlags;
+	bool m_isFramePending; //!< 描画を要求済み（またはタイマーで予約済み）で、まだフレームが始まっていない。<br>
+	Clock::time_point m_lastFrameBeginTime;
+	double m_maxFramesPerSecond; //!< 0 なら上限なし。<br>
+	bool m_isAdaptive;
+	double m_averageFrameSeconds;
+	Stats m_stats;
+
+public:
+	MyFrameScheduler()
+		: m_dirtyFlags(DirtyFlag_All)
+		, m_isFramePending()
+		, m_lastFrameBeginTime()
+		, m_maxFramesPerSecond()
+		, m_isAdaptive()
+		, m_averageFrameSeconds()
+		, m_stats()
+	{}
+
+public:
+	//! @brief  フレーム レートの上限を設定する。maxFramesPerSecond が 0 なら上限なし。<br>
+	//! isAdaptive が true なら、フレームの処理時間に応じてさらに間隔を広げる。<br>
+	void SetFrameRateCap(double maxFramesPerSecond, bool isAdaptive)
+	{
+		m_maxFramesPerSecond = std::max(maxFramesPerSecond, 0.0);
+		m_isAdaptive = isAdaptive;
+	}
+	double GetMaxFramesPerSecond() const { return m_maxFramesPerSecond; }
+	bool IsAdaptive() const { return m_isAdaptive; }
+
+	//! @brief  現在のフレームの最小間隔[秒]。<br>
+	double GetMinFrameIntervalSeconds() const;
+
+	double GetAverageFrameSeconds() const { return m_averageFrameSeconds; }
+	const Stats& GetStats() const { return m_stats; }
+	bool IsFramePending() const { return m_isFramePending; }
+
+	//! @brief  ダーティ フラグを立てて、描画の要求方法を返す。<br>
+	//! FrameRequest_PostLater の場合は、outDelaySeconds 後に描画を要求すること。<br>
+	FrameRequest Invalidate(uint32_t flags, Clock::time_point now, double& outDelaySeconds);
+
+	//! @brief  フレームの開始時に呼ぶ。前のフレーム以降に立ったダーティ フラグを返して、クリアする。<br>
+	//! ウィンドウの再表示などで要求なしに描画される場合は 0 を返すことがある。<br>
+	uint32_t BeginFrame(Clock::time_point now);
+
+	//! @brief  フレームの終了時に呼ぶ。処理時間の移動平均を更新する。<br>
+	void EndFrame(Clock::time_point now);
+};
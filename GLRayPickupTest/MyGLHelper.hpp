@@ -1,146 +1,260 @@
-﻿#pragma once
-
-#include "MyMath.hpp"
-
-// 古い GLM の角度単位は昔の OpenGL 固定機能を踏襲しているらしく、既定で Degrees だが、GLM_FORCE_RADIANS を定義すると Radians になるらしい。
-// GLM_FORCE_RADIANS は 0.9.6.0 で削除された模様。既定で Radians になったらしい。
-// また、古い GLM では glm::mat4 のデフォルト コンストラクタで単位行列になっていたが、
-// 新しい GLM のデフォルト コンストラクタは未初期化となるように仕様変更されたらしい。
-
-namespace MyGLHelper
-{
-	//! @brief  Direct3D ライクのビューポート構造体。<br>
-	struct Viewport
-	{
-		int X, Y, Width, Height;
-		float MinZ, MaxZ; //!< 通常、0 と 1 を指定する。<br>
-	};
-
-	struct PerspectiveParam
-	{
-		float Fov; //!< 視野角[Degrees]。<br>
-		float Near, Far;
-	};
-
-	class CameraParam
-	{
-	public:
-		MyVector3F Eye;
-		MyVector3F At;
-		MyVector3F Up;
-
-	public:
-		CameraParam(MyVector3F vEye, MyVector3F vAt, MyVector3F vUp)
-			: Eye(vEye)
-			, At(vAt)
-			, Up(vUp)
-		{}
-	};
-
-
-	inline MyMatrix4x4F CreateMatrixLookAt(const CameraParam& camera)
-	{
-		return glm::lookAt(camera.Eye, camera.At, camera.Up);
-	}
-
-	inline MyMatrix4x4F CreateMatrixPerspectiveFov(const Viewport& vp, const PerspectiveParam& pers)
-	{
-		return glm::perspectiveFov(glm::radians(pers.Fov), float(vp.Width), float(vp.Height), pers.Near, pers.Far);
-	}
-
-	inline MyMatrix4x4F CreateMatrixOrotho2D(float left, float right, float bottom, float top)
-	{
-		return glm::ortho(left, right, bottom, top);
-	}
-
-	inline MyMatrix4x4F CreateMatrixOrotho(float left, float right, float bottom, float top, float zNear, float zFar)
-	{
-		return glm::ortho(left, right, bottom, top, zNear, zFar);
-	}
-
-
-	//! @brief  指定された行列により 3D ベクトルをトランスフォームし、その結果を w = 1 に射影する。<br>
-	//! Direct3D の D3DXVec3TransformCoord() 類似。<br>
-	inline MyVector3F TransformVector3Coord(const MyMatrix4x4F& mat, MyVector3F vec)
-	{
-		MyVector4F vOut(vec.x, vec.y, vec.z, 1);
-
-		vOut = mat * vOut;
-		vOut /= vOut.w; // w = 1 に射影。
-
-		return MyVector3F(vOut);
-	}
-
-
-	//! @brief  ビューポート行列を作成。<br>
-	//! 
-	//! なお、OpenGL や Direct3D では固定機能でもプログラマブル シェーダーでも、<br>
-	//! この行列の詳細だけは隠ぺいされ、通常は計算で求めることはなく、ビューポートのパラメータを API で指定する方式になっている。<br>
-	inline MyMatrix4x4F CreateViewportMatrix(
-		const Viewport& vp)
-	{
-		MyMatrix4x4F matVP(1); // 単位行列。
-
-		matVP[0][0] = +vp.Width * 0.5f;
-		matVP[1][1] = -vp.Height * 0.5f;
-		matVP[2][2] = vp.MaxZ - vp.MinZ;
-		matVP[3][0] = float(vp.X) + vp.Width * 0.5f; // D3D では [0][3] 要素。
-		matVP[3][1] = float(vp.Y) + vp.Height * 0.5f; // D3D では [1][3] 要素。
-		matVP[3][2] = vp.MinZ; // D3D では [2][3] 要素。
-
-		return matVP;
-	}
-
-	//! @brief  ワールド座標をスクリーン位置へ変換する行列を作成する。<br>
-	inline MyMatrix4x4F CreateMatrixTransformWorldCoordToScreenCoord(
-		const MyMatrix4x4F& matView,
-		const MyMatrix4x4F& matProj,
-		const Viewport& vp)
-	{
-		return CreateViewportMatrix(vp) * matProj * matView;
-	}
-
-	//! @brief  スクリーン位置をワールド座標へ変換する行列を作成する。<br>
-	inline void CreateMatrixUnProjectionScreenCoordToWorldCoord(
-		MyMatrix4x4F& outMatrix,
-		const MyMatrix4x4F& matView,
-		const MyMatrix4x4F& matProj,
-		const Viewport& vp)
-	{
-
-		// 逆行列の計算は負荷が高いので、(Mview^-1 * Mproj^-1 * Mviewport^-1) を求めるよりも、
-		// (Mviewport * Mproj * Mview)^-1 を求めたほうがよい。
-#if 0
-		MyMatrix4x4F matVP = CreateViewportMatrix(vp);
-
-		const MyMatrix4x4F invVP = glm::inverse(matVP);
-
-		const MyMatrix4x4F invProjView = glm::inverse(matProj * matView);
-
-		outMatrix = invProjView * invVP;
-#else
-		outMatrix = glm::inverse(CreateMatrixTransformWorldCoordToScreenCoord(matView, matProj, vp));
-#endif
-	}
-
-	//! @brief  スクリーン位置をワールド座標へ直接変換。<br>
-	//! 何度も同様の変換を繰り返し行なう場合は、一度 CreateMatrixUnProjectionScreenCoordToWorldCoord() で変換行列を計算したほうが効率的。<br>
-	inline MyVector3F UnProjectScreenCoordToWorldCoord(
-		int screenX,
-		int screenY,
-		float screenZ,
-		const MyMatrix4x4F& matView,
-		const MyMatrix4x4F& matProj,
-		const Viewport& vp)
-	{
-		const MyVector3F vScreenCoord(float(screenX), float(screenY), screenZ);
-#if 1
-		return glm::unProject(vScreenCoord, matView, matProj, MyVector4I(vp.X, vp.Y, vp.Width, vp.Height));
-#else
-		MyMatrix4x4F matUnproj;
-		CreateMatrixUnProjectionScreenCoordToWorldCoord(matUnproj, matView, matProj, vp);
-
-		return TransformVector3Coord(matUnproj, vScreenCoord);
-#endif
-	}
-}
+﻿#pragma once
+
+#include "MyMath.hpp"
+#include "MyCollisionHelper.hpp"
+
+// 古い GLM の角度単位は昔の OpenGL 固定機能を踏襲しているらしく、既定で Degrees だが、GLM_FORCE_RADIANS を定義すると Radians になるらしい。
+// GLM_FORCE_RADIANS は 0.9.6.0 で削除された模様。既定で Radians になったらしい。
+// また、古い GLM では glm::mat4 のデフォルト コンストラクタで単位行列になっていたが、
+// 新しい GLM のデフォルト コンストラクタは未初期化となるように仕様変更されたらしい。
+
+namespace MyGLHelper
+{
+	//! @brief  Direct3D ライクのビューポート構造体。<br>
+	struct Viewport
+	{
+		int X, Y, Width, Height;
+		float MinZ, MaxZ; //!< 通常、0 と 1 を指定する。<br>
+	};
+
+	struct PerspectiveParam
+	{
+		float Fov; //!< 視野角[Degrees]。<br>
+		float Near, Far;
+	};
+
+	class CameraParam
+	{
+	public:
+		MyVector3F Eye;
+		MyVector3F At;
+		MyVector3F Up;
+
+	public:
+		CameraParam(MyVector3F vEye, MyVector3F vAt, MyVector3F vUp)
+			: Eye(vEye)
+			, At(vAt)
+			, Up(vUp)
+		{}
+	};
+
+
+	inline MyMatrix4x4F CreateMatrixLookAt(const CameraParam& camera)
+	{
+		return glm::lookAt(camera.Eye, camera.At, camera.Up);
+	}
+
+	inline MyMatrix4x4F CreateMatrixPerspectiveFov(const Viewport& vp, const PerspectiveParam& pers)
+	{
+		return glm::perspectiveFov(glm::radians(pers.Fov), float(vp.Width), float(vp.Height), pers.Near, pers.Far);
+	}
+
+	inline MyMatrix4x4F CreateMatrixOrotho2D(float left, float right, float bottom, float top)
+	{
+		return glm::ortho(left, right, bottom, top);
+	}
+
+	inline MyMatrix4x4F CreateMatrixOrotho(float left, float right, float bottom, float top, float zNear, float zFar)
+	{
+		return glm::ortho(left, right, bottom, top, zNear, zFar);
+	}
+
+
+	//! @brief  指定された行列により 3D ベクトルをトランスフォームし、その結果を w = 1 に射影する。<br>
+	//! Direct3D の D3DXVec3TransformCoord() 類似。<br>
+	inline MyVector3F TransformVector3Coord(const MyMatrix4x4F& mat, MyVector3F vec)
+	{
+		MyVector4F vOut(vec.x, vec.y, vec.z, 1);
+
+		vOut = mat * vOut;
+		vOut /= vOut.w; // w = 1 に射影。
+
+		return MyVector3F(vOut);
+	}
+
+
+	//! @brief  アフィン変換行列（最下行が (0, 0, 0, 1)）か否か。<br>
+	//! ビュー行列、ビューポート行列、平行投影行列はアフィン変換行列。<br>
+	inline bool IsAffineMatrix(const MyMatrix4x4F& mat)
+	{
+		return mat[0][3] == 0 && mat[1][3] == 0 && mat[2][3] == 0 && mat[3][3] == 1;
+	}
+
+	//! @brief  アフィン変換行列の逆行列を計算する。<br>
+	//! 左上 3x3 部分の逆行列（余因子による）と、平行移動成分の逆変換だけで済む。<br>
+	inline MyMatrix4x4F InverseAffineMatrix(const MyMatrix4x4F& mat)
+	{
+		assert(IsAffineMatrix(mat));
+		// 3x3 部分の列ベクトルを c0, c1, c2 とすると、逆行列の各行は (c1 × c2, c2 × c0, c0 × c1) / det となる。
+		const MyVector3F c0(mat[0]);
+		const MyVector3F c1(mat[1]);
+		const MyVector3F c2(mat[2]);
+		const MyVector3F r0 = glm::cross(c1, c2);
+		const MyVector3F r1 = glm::cross(c2, c0);
+		const MyVector3F r2 = glm::cross(c0, c1);
+		const float invDet = 1 / glm::dot(c0, r0);
+		MyMatrix4x4F outMatrix(1);
+		for (int col = 0; col < 3; ++col)
+		{
+			outMatrix[col][0] = r0[col] * invDet;
+			outMatrix[col][1] = r1[col] * invDet;
+			outMatrix[col][2] = r2[col] * invDet;
+		}
+		// 平行移動成分 t は -R^-1 * t に変換する。
+		const MyVector3F vTrans(mat[3]);
+		for (int row = 0; row < 3; ++row)
+		{
+			outMatrix[3][row] = -(outMatrix[0][row] * vTrans.x + outMatrix[1][row] * vTrans.y + outMatrix[2][row] * vTrans.z);
+		}
+		return outMatrix;
+	}
+
+	//! @brief  透視投影行列（glm::perspectiveFov() や glm::frustum() の形式）か否か。<br>
+	//! x' = a * x + c * z, y' = b * y + d * z, z' = e * z + f * w, w' = s * z の形であること。<br>
+	inline bool IsPerspectiveMatrix(const MyMatrix4x4F& mat)
+	{
+		return
+			mat[0][1] == 0 && mat[0][2] == 0 && mat[0][3] == 0 &&
+			mat[1][0] == 0 && mat[1][2] == 0 && mat[1][3] == 0 &&
+			mat[3][0] == 0 && mat[3][1] == 0 && mat[3][3] == 0 &&
+			mat[0][0] != 0 && mat[1][1] != 0 && mat[2][3] != 0 && mat[3][2] != 0;
+	}
+
+	//! @brief  透視投影行列の逆行列を閉じた式で計算する。<br>
+	inline MyMatrix4x4F InversePerspectiveMatrix(const MyMatrix4x4F& mat)
+	{
+		assert(IsPerspectiveMatrix(mat));
+		const float a = mat[0][0], b = mat[1][1], c = mat[2][0], d = mat[2][1];
+		const float e = mat[2][2], f = mat[3][2], s = mat[2][3];
+		// z = w' / s, x = (x' - c * z) / a, y = (y' - d * z) / b, w = (z' - e * z) / f。
+		MyMatrix4x4F outMatrix(0);
+		outMatrix[0][0] = 1 / a;
+		outMatrix[3][0] = -c / (a * s);
+		outMatrix[1][1] = 1 / b;
+		outMatrix[3][1] = -d / (b * s);
+		outMatrix[3][2] = 1 / s;
+		outMatrix[2][3] = 1 / f;
+		outMatrix[3][3] = -e / (f * s);
+		return outMatrix;
+	}
+
+	//! @brief  行列の構造（アフィン変換、透視投影）に応じて、一般の 4x4 逆行列より軽い方法で逆行列を計算する。<br>
+	//! いずれの構造でもない場合は glm::inverse() を使う。<br>
+	inline MyMatrix4x4F InverseMatrixByStructure(const MyMatrix4x4F& mat)
+	{
+		if (IsAffineMatrix(mat))
+		{
+			return InverseAffineMatrix(mat);
+		}
+		if (IsPerspectiveMatrix(mat))
+		{
+			return InversePerspectiveMatrix(mat);
+		}
+		return glm::inverse(mat);
+	}
+
+
+	//! @brief  ビューポート行列を作成。<br>
+	//! 
+	//! なお、OpenGL や Direct3D では固定機能でもプログラマブル シェーダーでも、<br>
+	//! この行列の詳細だけは隠ぺいされ、通常は計算で求めることはなく、ビューポートのパラメータを API で指定する方式になっている。<br>
+	inline MyMatrix4x4F CreateViewportMatrix(
+		const Viewport& vp)
+	{
+		MyMatrix4x4F matVP(1); // 単位行列。
+
+		matVP[0][0] = +vp.Width * 0.5f;
+		matVP[1][1] = -vp.Height * 0.5f;
+		matVP[2][2] = vp.MaxZ - vp.MinZ;
+		matVP[3][0] = float(vp.X) + vp.Width * 0.5f; // D3D では [0][3] 要素。
+		matVP[3][1] = float(vp.Y) + vp.Height * 0.5f; // D3D では [1][3] 要素。
+		matVP[3][2] = vp.MinZ; // D3D では [2][3] 要素。
+
+		return matVP;
+	}
+
+	//! @brief  ワールド座標をスクリーン位置へ変換する行列を作成する。<br>
+	inline MyMatrix4x4F CreateMatrixTransformWorldCoordToScreenCoord(
+		const MyMatrix4x4F& matView,
+		const MyMatrix4x4F& matProj,
+		const Viewport& vp)
+	{
+		return CreateViewportMatrix(vp) * matProj * matView;
+	}
+
+	//! @brief  スクリーン位置をワールド座標へ変換する行列を作成する。<br>
+	inline void CreateMatrixUnProjectionScreenCoordToWorldCoord(
+		MyMatrix4x4F& outMatrix,
+		const MyMatrix4x4F& matView,
+		const MyMatrix4x4F& matProj,
+		const Viewport& vp)
+	{
+
+		// 一般の 4x4 逆行列の計算は負荷が高いので、3 回計算して (Mview^-1 * Mproj^-1 * Mviewport^-1) を求めるよりも、
+		// 1 回だけ計算して (Mviewport * Mproj * Mview)^-1 を求めたほうがよい。
+		// ただし、ビュー行列とビューポート行列はアフィン変換、プロジェクション行列は透視投影もしくは平行投影という構造を持つので、
+		// 構造を利用すればそれぞれの逆行列は一般の逆行列よりずっと少ない計算量で求まり、桁落ちも少ない。
+#if 0
+		outMatrix = glm::inverse(CreateMatrixTransformWorldCoordToScreenCoord(matView, matProj, vp));
+#else
+		outMatrix =
+			InverseMatrixByStructure(matView) *
+			InverseMatrixByStructure(matProj) *
+			InverseMatrixByStructure(CreateViewportMatrix(vp));
+#endif
+	}
+
+	//! @brief  スクリーン矩形を通る視錐台の側面 4 平面を、ワールド座標系で作成する。<br>
+	//! matUnproj は CreateMatrixUnProjectionScreenCoordToWorldCoord() で作成した逆プロジェクション行列。<br>
+	//! 各平面の法線は視錐台の内側を向く。Near/Far 平面は含まないので、視点から無限遠までの四角錐となる。<br>
+	//! 矩形の幅または高さが 0 の場合、平面は退化する。<br>
+	inline void CreateFrustumPlanesFromScreenRect(
+		MyVector4F outPlanes[4],
+		const MyMatrix4x4F& matUnproj,
+		float rectL, float rectT, float rectR, float rectB)
+	{
+		// Near 側の 4 点は互いに近接していて平面の向きの精度が悪くなるので、
+		// 各平面は Near 側の 1 点と、間隔の広い Far 側の 2 点から作る。
+		const MyVector3F vNearLT = TransformVector3Coord(matUnproj, MyVector3F(rectL, rectT, 0));
+		const MyVector3F vNearRB = TransformVector3Coord(matUnproj, MyVector3F(rectR, rectB, 0));
+		const MyVector3F vFarLT = TransformVector3Coord(matUnproj, MyVector3F(rectL, rectT, 1));
+		const MyVector3F vFarRT = TransformVector3Coord(matUnproj, MyVector3F(rectR, rectT, 1));
+		const MyVector3F vFarRB = TransformVector3Coord(matUnproj, MyVector3F(rectR, rectB, 1));
+		const MyVector3F vFarLB = TransformVector3Coord(matUnproj, MyVector3F(rectL, rectB, 1));
+		// 左・上・右・下の順。
+		outPlanes[0] = MyCollision::CreatePlaneFromPoints(vNearLT, vFarLT, vFarLB);
+		outPlanes[1] = MyCollision::CreatePlaneFromPoints(vNearLT, vFarRT, vFarLT);
+		outPlanes[2] = MyCollision::CreatePlaneFromPoints(vNearRB, vFarRB, vFarRT);
+		outPlanes[3] = MyCollision::CreatePlaneFromPoints(vNearRB, vFarLB, vFarRB);
+		// 座標系の左右手系やビューポートの Y 軸の向きに依存しないように、矩形中心を通る点が内側になるよう向きを揃える。
+		const MyVector3F vInside = TransformVector3Coord(matUnproj, MyVector3F((rectL + rectR) * 0.5f, (rectT + rectB) * 0.5f, 0.5f));
+		for (int i = 0; i < 4; ++i)
+		{
+			if (MyCollision::GetSignedDistanceBetweenPlaneAndPoint(outPlanes[i], vInside) < 0)
+			{
+				outPlanes[i] = -outPlanes[i];
+			}
+		}
+	}
+
+	//! @brief  スクリーン位置をワールド座標へ直接変換。<br>
+	//! 何度も同様の変換を繰り返し行なう場合は、一度 CreateMatrixUnProjectionScreenCoordToWorldCoord() で変換行列を計算したほうが効率的。<br>
+	inline MyVector3F UnProjectScreenCoordToWorldCoord(
+		int screenX,
+		int screenY,
+		float screenZ,
+		const MyMatrix4x4F& matView,
+		const MyMatrix4x4F& matProj,
+		const Viewport& vp)
+	{
+		const MyVector3F vScreenCoord(float(screenX), float(screenY), screenZ);
+#if 1
+		return glm::unProject(vScreenCoord, matView, matProj, MyVector4I(vp.X, vp.Y, vp.Width, vp.Height));
+#else
+		MyMatrix4x4F matUnproj;
+		CreateMatrixUnProjectionScreenCoordToWorldCoord(matUnproj, matView, matProj, vp);
+
+		return TransformVector3Coord(matUnproj, vScreenCoord);
+#endif
+	}
+}
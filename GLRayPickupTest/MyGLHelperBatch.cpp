@@ -0,0 +1,461 @@
+﻿#include "stdafx.h"
+#include "MyGLHelperBatch.hpp"
+#include "MyGLHelper.hpp"
+#include "MyCollisionHelper.hpp"
+
+#include <immintrin.h>
+
+
+// 各カーネルは SIMD 幅ぶんの点をまとめて処理する。
+// 端数は、ゼロ埋めした一時バッファにコピーして同じカーネルで処理し、範囲外のレーンの結果を捨てる。
+// こうすることで、端数の点についても SIMD 版と同じ計算結果になる。
+
+namespace
+{
+	enum BatchOperation
+	{
+		BatchOperation_Transform,
+		BatchOperation_CheckPoint,
+		BatchOperation_CheckRect,
+	};
+
+	// 各カーネルに渡す引数一式。
+	struct BatchParam
+	{
+		const MyMatrix4x4F* pMatrix;
+		float TargetX, TargetY, Tolerance;
+		int RectL, RectT, RectR, RectB;
+	};
+
+	inline uint64_t GetLowBitsMask(size_t bitsNum)
+	{
+		return (bitsNum >= 64) ? ~uint64_t(0) : ((uint64_t(1) << bitsNum) - 1);
+	}
+
+#pragma region // Scalar //
+
+	void ProcessScalar(BatchOperation op, const BatchParam& param,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ, uint64_t* pOutMaskWords)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			const MyVector3F vScreen = MyGLHelper::TransformVector3Coord(*param.pMatrix, MyVector3F(pPosX[i], pPosY[i], pPosZ[i]));
+			bool intersects = false;
+			switch (op)
+			{
+			case BatchOperation_Transform:
+				pOutX[i] = vScreen.x;
+				pOutY[i] = vScreen.y;
+				pOutZ[i] = vScreen.z;
+				break;
+			case BatchOperation_CheckPoint:
+				intersects = MyCollision::CheckIntersectWithAABBparameterizedMinMax2D(
+					param.TargetX, param.TargetY,
+					vScreen.x - param.Tolerance, vScreen.y - param.Tolerance,
+					vScreen.x + param.Tolerance, vScreen.y + param.Tolerance);
+				break;
+			case BatchOperation_CheckRect:
+				// 視点の後方（w <= 0）の点は、射影すると上下左右が反転するので交差しない。
+				intersects = ((*param.pMatrix) * MyVector4F(pPosX[i], pPosY[i], pPosZ[i], 1)).w > 0 &&
+					MyCollision::CheckIntersectWithAABBparameterizedMinMax2D(
+						int(vScreen.x), int(vScreen.y), param.RectL, param.RectT, param.RectR, param.RectB);
+				break;
+			}
+			if (intersects)
+			{
+				pOutMaskWords[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+	}
+
+#pragma endregion
+
+#pragma region // SSE2 //
+
+	// glm の mat4 * vec4 と同じく、(m[0] * x + m[1] * y) + (m[2] * z + m[3] * 1) の順で計算する。
+	inline __m128 TransformRowSSE2(const __m128 (&m)[4][4], int row, __m128 x, __m128 y, __m128 z)
+	{
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(m[0][row], x), _mm_mul_ps(m[1][row], y)),
+			_mm_add_ps(_mm_mul_ps(m[2][row], z), m[3][row]));
+	}
+
+	// 逆数近似 + ニュートン・ラフソン法 1 回で、除算の代わりに w の逆数を求める。
+	inline __m128 ReciprocalSSE2(__m128 w)
+	{
+		const __m128 r = _mm_rcp_ps(w);
+		return _mm_mul_ps(r, _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(w, r)));
+	}
+
+	inline int ProcessLanesSSE2(BatchOperation op, const BatchParam& param, const __m128 (&m)[4][4],
+		__m128 x, __m128 y, __m128 z, float* pOutX, float* pOutY, float* pOutZ)
+	{
+		const __m128 w = TransformRowSSE2(m, 3, x, y, z);
+		const __m128 invW = ReciprocalSSE2(w);
+		const __m128 sx = _mm_mul_ps(TransformRowSSE2(m, 0, x, y, z), invW);
+		const __m128 sy = _mm_mul_ps(TransformRowSSE2(m, 1, x, y, z), invW);
+		switch (op)
+		{
+		case BatchOperation_Transform:
+			_mm_storeu_ps(pOutX, sx);
+			_mm_storeu_ps(pOutY, sy);
+			_mm_storeu_ps(pOutZ, _mm_mul_ps(TransformRowSSE2(m, 2, x, y, z), invW));
+			return 0;
+		case BatchOperation_CheckPoint:
+		{
+			const __m128 tolerance = _mm_set1_ps(param.Tolerance);
+			const __m128 targetX = _mm_set1_ps(param.TargetX);
+			const __m128 targetY = _mm_set1_ps(param.TargetY);
+			const __m128 insideX = _mm_and_ps(_mm_cmpgt_ps(targetX, _mm_sub_ps(sx, tolerance)), _mm_cmplt_ps(targetX, _mm_add_ps(sx, tolerance)));
+			const __m128 insideY = _mm_and_ps(_mm_cmpgt_ps(targetY, _mm_sub_ps(sy, tolerance)), _mm_cmplt_ps(targetY, _mm_add_ps(sy, tolerance)));
+			return _mm_movemask_ps(_mm_and_ps(insideX, insideY));
+		}
+		case BatchOperation_CheckRect:
+		{
+			const __m128i ix = _mm_cvttps_epi32(sx);
+			const __m128i iy = _mm_cvttps_epi32(sy);
+			const __m128i insideX = _mm_and_si128(_mm_cmpgt_epi32(ix, _mm_set1_epi32(param.RectL)), _mm_cmplt_epi32(ix, _mm_set1_epi32(param.RectR)));
+			const __m128i insideY = _mm_and_si128(_mm_cmpgt_epi32(iy, _mm_set1_epi32(param.RectT)), _mm_cmplt_epi32(iy, _mm_set1_epi32(param.RectB)));
+			const __m128 inFront = _mm_cmpgt_ps(w, _mm_setzero_ps());
+			return _mm_movemask_ps(_mm_and_ps(_mm_castsi128_ps(_mm_and_si128(insideX, insideY)), inFront));
+		}
+		}
+		return 0;
+	}
+
+	void ProcessSSE2(BatchOperation op, const BatchParam& param,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ, uint64_t* pOutMaskWords)
+	{
+		const size_t LanesNum = 4;
+		__m128 m[4][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				m[c][r] = _mm_set1_ps((*param.pMatrix)[c][r]);
+			}
+		}
+
+		for (size_t i = 0; i < count; i += LanesNum)
+		{
+			int bits = 0;
+			if (i + LanesNum <= count)
+			{
+				bits = ProcessLanesSSE2(op, param, m,
+					_mm_loadu_ps(pPosX + i), _mm_loadu_ps(pPosY + i), _mm_loadu_ps(pPosZ + i),
+					pOutX + i, pOutY + i, pOutZ + i);
+			}
+			else
+			{
+				const size_t restNum = count - i;
+				float inX[LanesNum] = {}, inY[LanesNum] = {}, inZ[LanesNum] = {};
+				float outX[LanesNum], outY[LanesNum], outZ[LanesNum];
+				std::copy(pPosX + i, pPosX + count, inX);
+				std::copy(pPosY + i, pPosY + count, inY);
+				std::copy(pPosZ + i, pPosZ + count, inZ);
+				bits = ProcessLanesSSE2(op, param, m, _mm_loadu_ps(inX), _mm_loadu_ps(inY), _mm_loadu_ps(inZ), outX, outY, outZ);
+				bits &= int(GetLowBitsMask(restNum));
+				if (op == BatchOperation_Transform)
+				{
+					std::copy(outX, outX + restNum, pOutX + i);
+					std::copy(outY, outY + restNum, pOutY + i);
+					std::copy(outZ, outZ + restNum, pOutZ + i);
+				}
+			}
+			if (pOutMaskWords)
+			{
+				pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+			}
+		}
+	}
+
+#pragma endregion
+
+#pragma region // AVX2 //
+
+	MY_SIMD_TARGET_AVX2 inline __m256 TransformRowAVX2(const __m256 (&m)[4][4], int row, __m256 x, __m256 y, __m256 z)
+	{
+		return _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(m[0][row], x), _mm256_mul_ps(m[1][row], y)),
+			_mm256_add_ps(_mm256_mul_ps(m[2][row], z), m[3][row]));
+	}
+
+	MY_SIMD_TARGET_AVX2 inline __m256 ReciprocalAVX2(__m256 w)
+	{
+		const __m256 r = _mm256_rcp_ps(w);
+		return _mm256_mul_ps(r, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(w, r)));
+	}
+
+	MY_SIMD_TARGET_AVX2 inline int ProcessLanesAVX2(BatchOperation op, const BatchParam& param, const __m256 (&m)[4][4],
+		__m256 x, __m256 y, __m256 z, float* pOutX, float* pOutY, float* pOutZ)
+	{
+		const __m256 w = TransformRowAVX2(m, 3, x, y, z);
+		const __m256 invW = ReciprocalAVX2(w);
+		const __m256 sx = _mm256_mul_ps(TransformRowAVX2(m, 0, x, y, z), invW);
+		const __m256 sy = _mm256_mul_ps(TransformRowAVX2(m, 1, x, y, z), invW);
+		switch (op)
+		{
+		case BatchOperation_Transform:
+			_mm256_storeu_ps(pOutX, sx);
+			_mm256_storeu_ps(pOutY, sy);
+			_mm256_storeu_ps(pOutZ, _mm256_mul_ps(TransformRowAVX2(m, 2, x, y, z), invW));
+			return 0;
+		case BatchOperation_CheckPoint:
+		{
+			const __m256 tolerance = _mm256_set1_ps(param.Tolerance);
+			const __m256 targetX = _mm256_set1_ps(param.TargetX);
+			const __m256 targetY = _mm256_set1_ps(param.TargetY);
+			const __m256 insideX = _mm256_and_ps(
+				_mm256_cmp_ps(targetX, _mm256_sub_ps(sx, tolerance), _CMP_GT_OQ),
+				_mm256_cmp_ps(targetX, _mm256_add_ps(sx, tolerance), _CMP_LT_OQ));
+			const __m256 insideY = _mm256_and_ps(
+				_mm256_cmp_ps(targetY, _mm256_sub_ps(sy, tolerance), _CMP_GT_OQ),
+				_mm256_cmp_ps(targetY, _mm256_add_ps(sy, tolerance), _CMP_LT_OQ));
+			return _mm256_movemask_ps(_mm256_and_ps(insideX, insideY));
+		}
+		case BatchOperation_CheckRect:
+		{
+			const __m256i ix = _mm256_cvttps_epi32(sx);
+			const __m256i iy = _mm256_cvttps_epi32(sy);
+			const __m256i insideX = _mm256_and_si256(
+				_mm256_cmpgt_epi32(ix, _mm256_set1_epi32(param.RectL)),
+				_mm256_cmpgt_epi32(_mm256_set1_epi32(param.RectR), ix));
+			const __m256i insideY = _mm256_and_si256(
+				_mm256_cmpgt_epi32(iy, _mm256_set1_epi32(param.RectT)),
+				_mm256_cmpgt_epi32(_mm256_set1_epi32(param.RectB), iy));
+			const __m256 inFront = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_GT_OQ);
+			return _mm256_movemask_ps(_mm256_and_ps(_mm256_castsi256_ps(_mm256_and_si256(insideX, insideY)), inFront));
+		}
+		}
+		return 0;
+	}
+
+	MY_SIMD_TARGET_AVX2 void ProcessAVX2(BatchOperation op, const BatchParam& param,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ, uint64_t* pOutMaskWords)
+	{
+		const size_t LanesNum = 8;
+		__m256 m[4][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				m[c][r] = _mm256_set1_ps((*param.pMatrix)[c][r]);
+			}
+		}
+
+		for (size_t i = 0; i < count; i += LanesNum)
+		{
+			int bits = 0;
+			if (i + LanesNum <= count)
+			{
+				bits = ProcessLanesAVX2(op, param, m,
+					_mm256_loadu_ps(pPosX + i), _mm256_loadu_ps(pPosY + i), _mm256_loadu_ps(pPosZ + i),
+					pOutX + i, pOutY + i, pOutZ + i);
+			}
+			else
+			{
+				const size_t restNum = count - i;
+				float inX[LanesNum] = {}, inY[LanesNum] = {}, inZ[LanesNum] = {};
+				float outX[LanesNum], outY[LanesNum], outZ[LanesNum];
+				std::copy(pPosX + i, pPosX + count, inX);
+				std::copy(pPosY + i, pPosY + count, inY);
+				std::copy(pPosZ + i, pPosZ + count, inZ);
+				bits = ProcessLanesAVX2(op, param, m, _mm256_loadu_ps(inX), _mm256_loadu_ps(inY), _mm256_loadu_ps(inZ), outX, outY, outZ);
+				bits &= int(GetLowBitsMask(restNum));
+				if (op == BatchOperation_Transform)
+				{
+					std::copy(outX, outX + restNum, pOutX + i);
+					std::copy(outY, outY + restNum, pOutY + i);
+					std::copy(outZ, outZ + restNum, pOutZ + i);
+				}
+			}
+			if (pOutMaskWords)
+			{
+				pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+			}
+		}
+		_mm256_zeroupper();
+	}
+
+#pragma endregion
+
+#ifdef MY_SIMD_SUPPORTS_AVX512
+#pragma region // AVX-512 //
+
+	MY_SIMD_TARGET_AVX512 inline __m512 TransformRowAVX512(const __m512 (&m)[4][4], int row, __m512 x, __m512 y, __m512 z)
+	{
+		return _mm512_add_ps(
+			_mm512_add_ps(_mm512_mul_ps(m[0][row], x), _mm512_mul_ps(m[1][row], y)),
+			_mm512_add_ps(_mm512_mul_ps(m[2][row], z), m[3][row]));
+	}
+
+	MY_SIMD_TARGET_AVX512 inline __m512 ReciprocalAVX512(__m512 w)
+	{
+		// AVX-512F の逆数近似は相対誤差 2^-14 なので、やはりニュートン・ラフソン法を 1 回適用する。
+		const __m512 r = _mm512_rcp14_ps(w);
+		return _mm512_mul_ps(r, _mm512_sub_ps(_mm512_set1_ps(2.0f), _mm512_mul_ps(w, r)));
+	}
+
+	MY_SIMD_TARGET_AVX512 inline uint32_t ProcessLanesAVX512(BatchOperation op, const BatchParam& param, const __m512 (&m)[4][4],
+		__m512 x, __m512 y, __m512 z, float* pOutX, float* pOutY, float* pOutZ)
+	{
+		const __m512 w = TransformRowAVX512(m, 3, x, y, z);
+		const __m512 invW = ReciprocalAVX512(w);
+		const __m512 sx = _mm512_mul_ps(TransformRowAVX512(m, 0, x, y, z), invW);
+		const __m512 sy = _mm512_mul_ps(TransformRowAVX512(m, 1, x, y, z), invW);
+		switch (op)
+		{
+		case BatchOperation_Transform:
+			_mm512_storeu_ps(pOutX, sx);
+			_mm512_storeu_ps(pOutY, sy);
+			_mm512_storeu_ps(pOutZ, _mm512_mul_ps(TransformRowAVX512(m, 2, x, y, z), invW));
+			return 0;
+		case BatchOperation_CheckPoint:
+		{
+			const __m512 tolerance = _mm512_set1_ps(param.Tolerance);
+			const __m512 targetX = _mm512_set1_ps(param.TargetX);
+			const __m512 targetY = _mm512_set1_ps(param.TargetY);
+			__mmask16 inside = _mm512_cmp_ps_mask(targetX, _mm512_sub_ps(sx, tolerance), _CMP_GT_OQ);
+			inside = _mm512_mask_cmp_ps_mask(inside, targetX, _mm512_add_ps(sx, tolerance), _CMP_LT_OQ);
+			inside = _mm512_mask_cmp_ps_mask(inside, targetY, _mm512_sub_ps(sy, tolerance), _CMP_GT_OQ);
+			inside = _mm512_mask_cmp_ps_mask(inside, targetY, _mm512_add_ps(sy, tolerance), _CMP_LT_OQ);
+			return inside;
+		}
+		case BatchOperation_CheckRect:
+		{
+			const __m512i ix = _mm512_cvttps_epi32(sx);
+			const __m512i iy = _mm512_cvttps_epi32(sy);
+			__mmask16 inside = _mm512_cmpgt_epi32_mask(ix, _mm512_set1_epi32(param.RectL));
+			inside = _mm512_mask_cmpgt_epi32_mask(inside, _mm512_set1_epi32(param.RectR), ix);
+			inside = _mm512_mask_cmpgt_epi32_mask(inside, iy, _mm512_set1_epi32(param.RectT));
+			inside = _mm512_mask_cmpgt_epi32_mask(inside, _mm512_set1_epi32(param.RectB), iy);
+			inside = _mm512_mask_cmp_ps_mask(inside, w, _mm512_setzero_ps(), _CMP_GT_OQ);
+			return inside;
+		}
+		}
+		return 0;
+	}
+
+	MY_SIMD_TARGET_AVX512 void ProcessAVX512(BatchOperation op, const BatchParam& param,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ, uint64_t* pOutMaskWords)
+	{
+		const size_t LanesNum = 16;
+		__m512 m[4][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			for (int r = 0; r < 4; ++r)
+			{
+				m[c][r] = _mm512_set1_ps((*param.pMatrix)[c][r]);
+			}
+		}
+
+		for (size_t i = 0; i < count; i += LanesNum)
+		{
+			uint32_t bits = 0;
+			if (i + LanesNum <= count)
+			{
+				bits = ProcessLanesAVX512(op, param, m,
+					_mm512_loadu_ps(pPosX + i), _mm512_loadu_ps(pPosY + i), _mm512_loadu_ps(pPosZ + i),
+					pOutX + i, pOutY + i, pOutZ + i);
+			}
+			else
+			{
+				const size_t restNum = count - i;
+				float inX[LanesNum] = {}, inY[LanesNum] = {}, inZ[LanesNum] = {};
+				float outX[LanesNum], outY[LanesNum], outZ[LanesNum];
+				std::copy(pPosX + i, pPosX + count, inX);
+				std::copy(pPosY + i, pPosY + count, inY);
+				std::copy(pPosZ + i, pPosZ + count, inZ);
+				bits = ProcessLanesAVX512(op, param, m, _mm512_loadu_ps(inX), _mm512_loadu_ps(inY), _mm512_loadu_ps(inZ), outX, outY, outZ);
+				bits &= uint32_t(GetLowBitsMask(restNum));
+				if (op == BatchOperation_Transform)
+				{
+					std::copy(outX, outX + restNum, pOutX + i);
+					std::copy(outY, outY + restNum, pOutY + i);
+					std::copy(outZ, outZ + restNum, pOutZ + i);
+				}
+			}
+			if (pOutMaskWords)
+			{
+				pOutMaskWords[i / 64] |= uint64_t(bits) << (i % 64);
+			}
+		}
+		_mm256_zeroupper();
+	}
+
+#pragma endregion
+#endif
+
+	void Process(BatchOperation op, const BatchParam& param,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ, uint64_t* pOutMaskWords)
+	{
+		if (pOutMaskWords)
+		{
+			std::fill(pOutMaskWords, pOutMaskWords + (count + 63) / 64, uint64_t(0));
+		}
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+#ifdef MY_SIMD_SUPPORTS_AVX512
+		case MyCpuFeatures::SimdLevel_AVX512:
+			ProcessAVX512(op, param, pPosX, pPosY, pPosZ, count, pOutX, pOutY, pOutZ, pOutMaskWords);
+			break;
+#endif
+		case MyCpuFeatures::SimdLevel_AVX2:
+			ProcessAVX2(op, param, pPosX, pPosY, pPosZ, count, pOutX, pOutY, pOutZ, pOutMaskWords);
+			break;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			ProcessSSE2(op, param, pPosX, pPosY, pPosZ, count, pOutX, pOutY, pOutZ, pOutMaskWords);
+			break;
+		default:
+			ProcessScalar(op, param, pPosX, pPosY, pPosZ, count, pOutX, pOutY, pOutZ, pOutMaskWords);
+			break;
+		}
+	}
+} // end of namespace
+
+namespace MyGLHelper
+{
+	void TransformVector3CoordBatch(
+		const MyMatrix4x4F& mat,
+		const float* pInX, const float* pInY, const float* pInZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ)
+	{
+		BatchParam param = {};
+		param.pMatrix = &mat;
+		Process(BatchOperation_Transform, param, pInX, pInY, pInZ, count, pOutX, pOutY, pOutZ, nullptr);
+	}
+
+	void TransformVector3CoordAndCheckIntersectWithPointBatch(
+		const MyMatrix4x4F& matToScreen,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float targetX, float targetY, float tolerance,
+		uint64_t* pOutHitMaskWords)
+	{
+		BatchParam param = {};
+		param.pMatrix = &matToScreen;
+		param.TargetX = targetX;
+		param.TargetY = targetY;
+		param.Tolerance = tolerance;
+		Process(BatchOperation_CheckPoint, param, pPosX, pPosY, pPosZ, count, nullptr, nullptr, nullptr, pOutHitMaskWords);
+	}
+
+	void TransformVector3CoordAndCheckIntersectWithRectBatch(
+		const MyMatrix4x4F& matToScreen,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		int rectL, int rectT, int rectR, int rectB,
+		uint64_t* pOutHitMaskWords)
+	{
+		BatchParam param = {};
+		param.pMatrix = &matToScreen;
+		param.RectL = rectL;
+		param.RectT = rectT;
+		param.RectR = rectR;
+		param.RectB = rectB;
+		Process(BatchOperation_CheckRect, param, pPosX, pPosY, pPosZ, count, nullptr, nullptr, nullptr, pOutHitMaskWords);
+	}
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+#include "MyCpuFeatures.hpp"
+
+namespace MyGLHelper
+{
+	// TransformVector3Coord() を多数の点に対して一括で適用する SIMD 版。
+	// 使用する SIMD 命令セットは MyCpuFeatures::GetActiveSimdLevel() による。
+	// w による除算は、逆数近似にニュートン・ラフソン法を 1 回適用したもので代用するので、
+	// TransformVector3Coord() の結果とは最下位ビット程度の誤差が生じることがある。
+	// スクリーン座標系での交差判定はピクセル単位のマージンを持つので、この程度の誤差は問題にならない。
+
+	//! @brief  位置座標配列（SoA）の先頭 count 点を指定された行列によりトランスフォームし、その結果を w = 1 に射影する。<br>
+	void TransformVector3CoordBatch(
+		const MyMatrix4x4F& mat,
+		const float* pInX, const float* pInY, const float* pInZ, size_t count,
+		float* pOutX, float* pOutY, float* pOutZ);
+
+	//! @brief  スクリーン座標へ変換した点と、指定スクリーン位置との交差判定を一括で行ない、結果を 64 点単位のビットマスクに書き込む。<br>
+	//! 各点のスクリーン位置を中心とし、tolerance を半径とする正方形の内側（境界を含まない）に (targetX, targetY) があれば交差とみなす。<br>
+	//! pOutHitMaskWords には (count + 63) / 64 ワード分の領域が必要。<br>
+	void TransformVector3CoordAndCheckIntersectWithPointBatch(
+		const MyMatrix4x4F& matToScreen,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		float targetX, float targetY, float tolerance,
+		uint64_t* pOutHitMaskWords);
+
+	//! @brief  スクリーン座標へ変換した点と、スクリーン矩形との交差判定を一括で行ない、結果を 64 点単位のビットマスクに書き込む。<br>
+	//! スクリーン座標を整数に切り捨てた上で、矩形の内側（境界を含まない）にあれば交差とみなす。視点の後方（w <= 0）にある点は交差しない。<br>
+	//! pOutHitMaskWords には (count + 63) / 64 ワード分の領域が必要。<br>
+	void TransformVector3CoordAndCheckIntersectWithRectBatch(
+		const MyMatrix4x4F& matToScreen,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t count,
+		int rectL, int rectT, int rectR, int rectB,
+		uint64_t* pOutHitMaskWords);
+}
@@ -0,0 +1,307 @@
+﻿#include "stdafx.h"
+#include "MyInputReplayer.hpp"
+
+
+namespace
+{
+	// 修飾キーから選択操作の集合演算を決める。GLRayPickupTest の GetSelectionOperationFromModifiers() と同じ規則。
+	MyBitsetOps::SetOperation GetSelectionOperation(uint8_t modifiers, MyBitsetOps::SetOperation defaultOp)
+	{
+		const bool isShiftDown = (modifiers & MyInputTrace::Modifier_Shift) != 0;
+		const bool isCtrlDown = (modifiers & MyInputTrace::Modifier_Ctrl) != 0;
+		if (isShiftDown && isCtrlDown)
+		{
+			return MyBitsetOps::SetOperation_Intersection;
+		}
+		else if (isShiftDown)
+		{
+			return MyBitsetOps::SetOperation_Union;
+		}
+		else if (isCtrlDown)
+		{
+			return MyBitsetOps::SetOperation_Difference;
+		}
+		return defaultOp;
+	}
+}
+
+MyInputReplayer::MyInputReplayer(MyJobSystem& jobSystem, float intersectMarginInWorld, float intersectMarginInScreen)
+	: m_viewport()
+	, m_persParam()
+	, m_camera(MyVector3F(0, 0, 1), MyVector3F(0, 0, 0), MyVector3F(0, 1, 0))
+	, m_transformCache(m_camera, m_viewport, m_persParam, m_trackball, MyTransformCache::ProjectionType_Perspective)
+	, m_picker(jobSystem)
+	, m_mouse()
+	, m_usesWorldUnitAsIntersectMargin()
+	, m_intersectMarginInWorld(intersectMarginInWorld)
+	, m_intersectMarginInScreen(intersectMarginInScreen)
+{
+}
+
+bool MyInputReplayer::Restore(const MyInputTrace& trace, MyPointCloudStore& store, std::string& outErrorMessage)
+{
+	// 範囲外の選択を切り詰めて再生すると、記録時とは異なる選択状態から始まってしまう。
+	for (const auto& run : trace.GetInitialSelection())
+	{
+		if (uint64_t(run.First) + run.Count > store.GetPointsNum())
+		{
+			outErrorMessage = "The initial selection is out of the point cloud.";
+			return false;
+		}
+	}
+
+	const MyInputTrace::InitialState& state = trace.GetInitialState();
+	m_viewport.Width = std::max(state.ViewportWidth, 1);
+	m_viewport.Height = std::max(state.ViewportHeight, 1);
+	m_viewport.MaxZ = 1.0f;
+	m_persParam.Fov = state.Fov;
+	m_persParam.Near = state.Near;
+	m_persParam.Far = state.Far;
+	m_camera.Eye = MyVector3F(state.CameraEye[0], state.CameraEye[1], state.CameraEye[2]);
+	m_camera.At = MyVector3F(state.CameraAt[0], state.CameraAt[1], state.CameraAt[2]);
+	m_camera.Up = MyVector3F(state.CameraUp[0], state.CameraUp[1], state.CameraUp[2]);
+	m_trackball.OnResize(m_viewport.Width, m_viewport.Height);
+	m_trackball.SetRotation(MyQuaternion4F(state.TrackballRotation[0], state.TrackballRotation[1], state.TrackballRotation[2], state.TrackballRotation[3]));
+	m_transformCache.InvalidateCamera();
+	m_transformCache.InvalidateViewport();
+	m_transformCache.InvalidateProjection();
+	m_picker.SetPickMode(MyPointPicker::PickMode(state.PickMode % MyPointPicker::PickMode_Count));
+	m_usesWorldUnitAsIntersectMargin = (state.UsesWorldUnitAsIntersectMargin != 0);
+	m_mouse = MouseState();
+	m_history.Clear();
+
+	store.ClearSelection();
+	for (const auto& run : trace.GetInitialSelection())
+	{
+		for (uint32_t i = 0; i < run.Count; ++i)
+		{
+			store.SetSelected(run.First + i, true);
+		}
+	}
+	return true;
+}
+
+bool MyInputReplayer::Replay(const MyInputTrace& trace, MyPointCloudStore& store, const MyPointOctree& octree, Result& outResult, std::string& outErrorMessage)
+{
+	typedef std::chrono::steady_clock Clock;
+	const MyInputTrace::InitialState& state = trace.GetInitialState();
+	if (store.GetPointsNum() != state.PointsNum || MyInputTrace::CalcPositionsHash(store) != state.PositionsHash)
+	{
+		outErrorMessage = "The point cloud differs from the recorded one.";
+		return false;
+	}
+	if (!this->Restore(trace, store, outErrorMessage))
+	{
+		return false;
+	}
+
+	const std::vector<MyInputTrace::Event>& events = trace.GetEvents();
+	outResult.EventsNum = events.size();
+	outResult.TraceSeconds = events.empty() ? 0 : (events.back().TimeMicroseconds - events.front().TimeMicroseconds) * 1e-6;
+	for (auto& histogram : outResult.EventLatencies)
+	{
+		histogram.Clear();
+	}
+	outResult.AllLatencies.Clear();
+	outResult.HoverQueriesNum = 0;
+	outResult.HoverHitsNum = 0;
+	outResult.HoverHash = 0;
+	const Clock::time_point replayStartTime = Clock::now();
+	for (const auto& event : events)
+	{
+		const Clock::time_point startTime = Clock::now();
+		if (this->HandleEvent(event, store, octree))
+		{
+			this->QueryHover(store, octree, outResult);
+		}
+		const uint64_t nanoseconds = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - startTime).count());
+		if (event.Type < MyInputTrace::EventType_Count)
+		{
+			outResult.EventLatencies[event.Type].Record(nanoseconds);
+		}
+		outResult.AllLatencies.Record(nanoseconds);
+	}
+	outResult.ReplaySeconds = std::chrono::duration<double>(Clock::now() - replayStartTime).count();
+	outResult.SelectedNum = store.CountSelected();
+	outResult.SelectionHash = MyInputTrace::CalcSelectionHash(store);
+	outResult.UndoableNum = m_history.GetUndoableNum();
+	return true;
+}
+
+bool MyInputReplayer::HandleEvent(const MyInputTrace::Event& event, MyPointCloudStore& store, const MyPointOctree& octree)
+{
+	switch (event.Type)
+	{
+	case MyInputTrace::EventType_MouseButton:
+		return this->HandleMouseButton(event, store, octree);
+	case MyInputTrace::EventType_Motion:
+		m_mouse.CurrentPos = MyVector2I(event.X, event.Y);
+		if (m_mouse.IsRightButtonPressed)
+		{
+			m_trackball.OnMouseDragging(event.X, event.Y);
+		}
+		return true;
+	case MyInputTrace::EventType_PassiveMotion:
+		m_mouse.CurrentPos = MyVector2I(event.X, event.Y);
+		return true;
+	case MyInputTrace::EventType_MouseWheel:
+		m_transformCache.InvalidateCamera();
+		if (event.State > 0)
+		{
+			const float LimitDistance = 1;
+			m_camera.Eye.z = std::max(m_camera.Eye.z - 1, LimitDistance);
+		}
+		else if (event.State < 0)
+		{
+			m_camera.Eye.z += 1;
+		}
+		return true;
+	case MyInputTrace::EventType_Keyboard:
+		this->HandleKeyboard(event, store);
+		return true;
+	case MyInputTrace::EventType_Reshape:
+		m_viewport.Width = std::max(int(event.X), 1);
+		m_viewport.Height = std::max(int(event.Y), 1);
+		m_transformCache.InvalidateViewport();
+		m_trackball.OnResize(m_viewport.Width, m_viewport.Height);
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool MyInputReplayer::HandleMouseButton(const MyInputTrace::Event& event, MyPointCloudStore& store, const MyPointOctree& octree)
+{
+	const bool isDown = (event.State == MyInputTrace::ButtonState_Down);
+	if (event.Code == MyInputTrace::Button_Right)
+	{
+		m_mouse.IsRightButtonPressed = isDown;
+		if (isDown)
+		{
+			m_trackball.OnMouseDragStart(event.X, event.Y);
+		}
+		else
+		{
+			m_trackball.OnMouseDragStop(event.X, event.Y);
+		}
+		// アプリケーションはトラックボールの開始・停止をカメラの変化として扱い、描画時にホバー判定をやり直す。
+		return true;
+	}
+	// 左ボタンでは選択状態が変わるだけなので、ホバー判定はやり直さない。
+	if (event.Code != MyInputTrace::Button_Left)
+	{
+		return false;
+	}
+	m_mouse.IsLeftButtonPressed = isDown;
+	if (isDown)
+	{
+		m_mouse.DragStartPosL = MyVector2I(event.X, event.Y);
+		return false;
+	}
+	const MyVector2I vDiff = m_mouse.DragStartPosL - MyVector2I(event.X, event.Y);
+	const char* pSelectionLabel = nullptr;
+	if (MyMath::GetVectorLength(vDiff) < 2)
+	{
+		const MyBitsetOps::SetOperation op = GetSelectionOperation(event.Modifiers, MyBitsetOps::SetOperation_SymmetricDifference);
+		pSelectionLabel = "Click";
+		MyVector3F vWCoord0, vWCoord1;
+		this->CalcUnProjectedRayPositions(vWCoord0, vWCoord1);
+		if (m_usesWorldUnitAsIntersectMargin)
+		{
+			m_picker.QueryPointsInWorld(store, octree, vWCoord0, vWCoord1, m_intersectMarginInWorld, m_hitIndices);
+			m_picker.SelectPoints(store, m_hitIndices, op);
+		}
+		else if (m_picker.GetPickMode() == MyPointPicker::PickMode_All)
+		{
+			m_picker.SelectPointsIntersectWithScreenPosParallel(store, m_transformCache.GetWorldToScreenMatrix(),
+				float(m_mouse.CurrentPos.x), float(m_mouse.CurrentPos.y), m_intersectMarginInScreen, op);
+		}
+		else
+		{
+			m_picker.QueryPointsInScreen(store, m_transformCache.GetWorldToScreenMatrix(), m_viewport.Width, m_viewport.Height,
+				float(m_mouse.CurrentPos.x), float(m_mouse.CurrentPos.y), m_intersectMarginInScreen,
+				vWCoord0, vWCoord1, m_hitIndices);
+			m_picker.SelectPoints(store, m_hitIndices, op);
+		}
+	}
+	else
+	{
+		const int rectL = std::min(m_mouse.CurrentPos.x, m_mouse.DragStartPosL.x);
+		const int rectR = std::max(m_mouse.CurrentPos.x, m_mouse.DragStartPosL.x);
+		const int rectT = std::min(m_mouse.CurrentPos.y, m_mouse.DragStartPosL.y);
+		const int rectB = std::max(m_mouse.CurrentPos.y, m_mouse.DragStartPosL.y);
+		m_picker.SelectPointsIntersectWithScreenRectByFrustum(store, octree,
+			m_transformCache.GetWorldToScreenMatrix(), m_transformCache.GetScreenToWorldMatrix(), rectL, rectT, rectR, rectB,
+			GetSelectionOperation(event.Modifiers, MyBitsetOps::SetOperation_Replace));
+		pSelectionLabel = "Rect";
+	}
+	m_history.Record(m_picker.GetLastChangedSet(), pSelectionLabel);
+	return false;
+}
+
+void MyInputReplayer::HandleKeyboard(const MyInputTrace::Event& event, MyPointCloudStore& store)
+{
+	// 計測やストリーミング入力など、選択結果に関わらないキーは無視する。
+	switch (event.Code)
+	{
+	case 's':
+		m_usesWorldUnitAsIntersectMargin = false;
+		break;
+	case 'w':
+		m_usesWorldUnitAsIntersectMargin = true;
+		break;
+	case 'k':
+		m_picker.SetPickMode(MyPointPicker::PickMode((m_picker.GetPickMode() + 1) % MyPointPicker::PickMode_Count));
+		break;
+	case 'v':
+		store.InvertSelection();
+		m_history.RecordInvertAll(store.GetPointsNum(), "Invert");
+		break;
+	case 'c':
+		{
+			MySelectionSet changes;
+			store.ApplySelection(MyBitsetOps::SetOperation_Replace, MySelectionSet(), &changes);
+			m_history.Record(changes, "Clear");
+		}
+		break;
+	case 'z':
+	case 'Z' - '@':
+		m_history.Undo(store);
+		break;
+	case 'y':
+	case 'Y' - '@':
+		m_history.Redo(store);
+		break;
+	default:
+		break;
+	}
+}
+
+void MyInputReplayer::CalcUnProjectedRayPositions(MyVector3F& vWCoord0, MyVector3F& vWCoord1)
+{
+	MyPointPicker::CalcUnProjectedRayPositions(m_transformCache.GetScreenToWorldMatrix(),
+		float(m_mouse.CurrentPos.x), float(m_mouse.CurrentPos.y), vWCoord0, vWCoord1);
+}
+
+void MyInputReplayer::QueryHover(const MyPointCloudStore& store, const MyPointOctree& octree, Result& result)
+{
+	MyVector3F vWCoord0, vWCoord1;
+	this->CalcUnProjectedRayPositions(vWCoord0, vWCoord1);
+	if (m_usesWorldUnitAsIntersectMargin)
+	{
+		m_picker.QueryPointsInWorld(store, octree, vWCoord0, vWCoord1, m_intersectMarginInWorld, m_hitIndices);
+	}
+	else
+	{
+		m_picker.QueryPointsInScreen(store, m_transformCache.GetWorldToScreenMatrix(), m_viewport.Width, m_viewport.Height,
+			float(m_mouse.CurrentPos.x), float(m_mouse.CurrentPos.y), m_intersectMarginInScreen,
+			vWCoord0, vWCoord1, m_hitIndices);
+	}
+	++result.HoverQueriesNum;
+	result.HoverHitsNum += m_hitIndices.size();
+	// PickMode_All の列挙順は並列化の分割に依存しうるので、順序によらない和で混ぜる。
+	for (auto index : m_hitIndices)
+	{
+		result.HoverHash += (uint64_t(index) + 1) * 0x9E3779B97F4A7C15ull;
+	}
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include "MyInputTrace.hpp"
+#include "MyPointPicker.hpp"
+#include "MySelectionHistory.hpp"
+#include "MyTransformCache.hpp"
+#include "MyFrameProfiler.hpp"
+
+
+//! @brief  MyInputTrace に記録した入力イベントを、ウィンドウなしで再生する。<br>
+//! GLRayPickupTest の GLUT コールバックと同じ手順で、MyPointPicker によるホバー判定・クリック選択・矩形選択、<br>
+//! MySelectionHistory による取り消し・やり直し、MyTrackball による回転、ホイールによるズームを行なう。<br>
+//! ホバー判定は、GLRayPickupTest でフレームの描画時にやり直す条件を満たすイベントごとに 1 回行なう。<br>
+//! イベントは記録時の間隔を待たずに続けて処理し、1 イベントあたりの処理時間の分布と、最終的な選択状態のハッシュ値を求める。<br>
+class MyInputReplayer
+{
+public:
+	struct Result
+	{
+		size_t EventsNum;
+		double TraceSeconds; //!< 記録された最初から最後のイベントまでの時間。<br>
+		double ReplaySeconds; //!< 再生にかかった時間。<br>
+		MyLatencyHistogram EventLatencies[MyInputTrace::EventType_Count]; //!< イベントの種類ごとの処理時間[ns]。<br>
+		MyLatencyHistogram AllLatencies;
+		uint64_t HoverQueriesNum;
+		uint64_t HoverHitsNum; //!< ホバー判定で列挙した点数の合計。<br>
+		uint64_t HoverHash; //!< ホバー判定の結果（列挙した点のインデックス）のハッシュ値。<br>
+		size_t SelectedNum;
+		uint64_t SelectionHash; //!< 再生後の選択状態の MyInputTrace::CalcSelectionHash()。<br>
+		size_t UndoableNum;
+	};
+
+private:
+	struct MouseState
+	{
+		bool IsLeftButtonPressed;
+		bool IsRightButtonPressed;
+		MyVector2I DragStartPosL;
+		MyVector2I CurrentPos;
+	};
+
+private:
+	MyGLHelper::Viewport m_viewport;
+	MyGLHelper::PerspectiveParam m_persParam;
+	MyGLHelper::CameraParam m_camera;
+	MyTrackball m_trackball;
+	MyTransformCache m_transformCache;
+	MyPointPicker m_picker;
+	MySelectionHistory m_history;
+	MouseState m_mouse;
+	bool m_usesWorldUnitAsIntersectMargin;
+	float m_intersectMarginInWorld;
+	float m_intersectMarginInScreen;
+	std::vector<uint32_t> m_hitIndices;
+
+public:
+	//! @brief  交差マージンは GLRayPickupTest と同じ値を指定すること。<br>
+	MyInputReplayer(MyJobSystem& jobSystem, float intersectMarginInWorld, float intersectMarginInScreen);
+
+public:
+	//! @brief  trace を再生する。store と octree は trace の初期状態の点群（MyInputTrace::InitialState）から作成しておくこと。<br>
+	//! 点群の位置座標のハッシュ値が記録時と異なる場合や、記録開始時の選択範囲が点群の外にある場合は false を返す。<br>
+	//! store の選択状態は記録開始時の状態に置き換えられる。<br>
+	bool Replay(const MyInputTrace& trace, MyPointCloudStore& store, const MyPointOctree& octree, Result& outResult, std::string& outErrorMessage);
+
+private:
+	//! @brief  記録開始時の状態に戻す。初期の選択範囲が点群の外にある場合は、何も変更せずに false を返す。<br>
+	bool Restore(const MyInputTrace& trace, MyPointCloudStore& store, std::string& outErrorMessage);
+	//! @brief  イベントを処理する。描画時にホバー判定をやり直すイベントなら true を返す。<br>
+	bool HandleEvent(const MyInputTrace::Event& event, MyPointCloudStore& store, const MyPointOctree& octree);
+	//! @brief  マウス ボタンのイベントを処理する。描画時にホバー判定をやり直すイベントなら true を返す。<br>
+	bool HandleMouseButton(const MyInputTrace::Event& event, MyPointCloudStore& store, const MyPointOctree& octree);
+	void HandleKeyboard(const MyInputTrace::Event& event, MyPointCloudStore& store);
+	void QueryHover(const MyPointCloudStore& store, const MyPointOctree& octree, Result& result);
+	void CalcUnProjectedRayPositions(MyVector3F& vWCoord0, MyVector3F& vWCoord1);
+
+	MyInputReplayer(const MyInputReplayer&) = delete;
+	MyInputReplayer& operator=(const MyInputReplayer&) = delete;
+};
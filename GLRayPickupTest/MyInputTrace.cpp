@@ -0,0 +1,183 @@
+﻿#include "stdafx.h"
+#include "MyInputTrace.hpp"
+
+#include <fstream>
+
+
+namespace
+{
+	const char FileMagic[4] = { 'M', 'Y', 'I', 'T' };
+	const uint32_t FileVersion = 1;
+
+	struct FileHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint32_t InitialStateBytes; //!< 構造体の大きさが変わっていないかどうかの確認用。<br>
+		uint32_t EventBytes;
+		uint64_t SelectionRunsNum;
+		uint64_t EventsNum;
+	};
+
+	// FNV-1a を 32bit 単位で適用する。
+	const uint64_t HashOffsetBasis = 0xCBF29CE484222325ull;
+	const uint64_t HashPrime = 0x100000001B3ull;
+
+	template<typename T> uint64_t CombineHash(uint64_t hash, const T* pValues, size_t count)
+	{
+		static_assert(sizeof(T) % sizeof(uint32_t) == 0, "T must be a multiple of 32 bits.");
+		const size_t wordsNum = count * sizeof(T) / sizeof(uint32_t);
+		const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pValues);
+		for (size_t i = 0; i < wordsNum; ++i)
+		{
+			uint32_t word;
+			memcpy(&word, pBytes + i * sizeof(uint32_t), sizeof(word));
+			hash = (hash ^ word) * HashPrime;
+		}
+		return hash;
+	}
+}
+
+const char* const MyInputTrace::FileExtension = ".mytrace";
+
+MyInputTrace::MyInputTrace()
+	: m_initialState()
+{
+}
+
+void MyInputTrace::Reset(const InitialState& initialState, const MyPointCloudStore& store)
+{
+	m_initialState = initialState;
+	m_events.clear();
+	m_initialSelection.clear();
+	const size_t pointsNum = store.GetPointsNum();
+	for (size_t i = 0; i < pointsNum; )
+	{
+		if (!store.IsSelected(i))
+		{
+			++i;
+			continue;
+		}
+		SelectionRun run = { uint32_t(i), 0 };
+		while (i < pointsNum && store.IsSelected(i))
+		{
+			++run.Count;
+			++i;
+		}
+		m_initialSelection.push_back(run);
+	}
+}
+
+bool MyInputTrace::WriteFile(const char* pFilePath, std::string& outErrorMessage) const
+{
+	std::ofstream stream(pFilePath, std::ios::binary | std::ios::trunc);
+	if (!stream)
+	{
+		outErrorMessage = std::string("Failed to create the trace file: ") + pFilePath;
+		return false;
+	}
+	FileHeader header = {};
+	memcpy(header.Magic, FileMagic, sizeof(FileMagic));
+	header.Version = FileVersion;
+	header.InitialStateBytes = sizeof(InitialState);
+	header.EventBytes = sizeof(Event);
+	header.SelectionRunsNum = m_initialSelection.size();
+	header.EventsNum = m_events.size();
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(reinterpret_cast<const char*>(&m_initialState), sizeof(m_initialState));
+	stream.write(reinterpret_cast<const char*>(m_initialSelection.data()), std::streamsize(sizeof(SelectionRun) * m_initialSelection.size()));
+	stream.write(reinterpret_cast<const char*>(m_events.data()), std::streamsize(sizeof(Event) * m_events.size()));
+	stream.close();
+	if (!stream)
+	{
+		outErrorMessage = std::string("Failed to write the trace file: ") + pFilePath;
+		return false;
+	}
+	return true;
+}
+
+bool MyInputTrace::ReadFile(const char* pFilePath, std::string& outErrorMessage)
+{
+	std::ifstream stream(pFilePath, std::ios::binary);
+	if (!stream)
+	{
+		outErrorMessage = std::string("Failed to open the trace file: ") + pFilePath;
+		return false;
+	}
+	FileHeader header = {};
+	stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!stream || memcmp(header.Magic, FileMagic, sizeof(FileMagic)) != 0 || header.Version != FileVersion ||
+		header.InitialStateBytes != sizeof(InitialState) || header.EventBytes != sizeof(Event))
+	{
+		outErrorMessage = std::string("Not a supported trace file: ") + pFilePath;
+		return false;
+	}
+	stream.read(reinterpret_cast<char*>(&m_initialState), sizeof(m_initialState));
+	// 壊れたファイルで巨大な確保をしないように、残りのファイル サイズと照合してから読む。
+	// 個数とバイト数の積が桁あふれしないように、それぞれの個数を先に残りのサイズで抑える。
+	const std::streamoff headerEnd = stream.tellg();
+	stream.seekg(0, std::ios::end);
+	const uint64_t remainingBytes = uint64_t(stream.tellg() - headerEnd);
+	stream.seekg(headerEnd);
+	if (!stream ||
+		header.SelectionRunsNum > remainingBytes / sizeof(SelectionRun) ||
+		header.EventsNum > remainingBytes / sizeof(Event) ||
+		header.SelectionRunsNum * sizeof(SelectionRun) + header.EventsNum * sizeof(Event) != remainingBytes)
+	{
+		outErrorMessage = std::string("The trace file is truncated: ") + pFilePath;
+		return false;
+	}
+	m_initialSelection.resize(size_t(header.SelectionRunsNum));
+	m_events.resize(size_t(header.EventsNum));
+	stream.read(reinterpret_cast<char*>(m_initialSelection.data()), std::streamsize(sizeof(SelectionRun) * m_initialSelection.size()));
+	stream.read(reinterpret_cast<char*>(m_events.data()), std::streamsize(sizeof(Event) * m_events.size()));
+	if (!stream)
+	{
+		outErrorMessage = std::string("Failed to read the trace file: ") + pFilePath;
+		return false;
+	}
+	return true;
+}
+
+uint64_t MyInputTrace::CalcPositionsHash(const MyPointCloudStore& store)
+{
+	uint64_t hash = HashOffsetBasis;
+	hash = CombineHash(hash, store.GetPositionsX(), store.GetPointsNum());
+	hash = CombineHash(hash, store.GetPositionsY(), store.GetPointsNum());
+	hash = CombineHash(hash, store.GetPositionsZ(), store.GetPointsNum());
+	return hash;
+}
+
+uint64_t MyInputTrace::CalcSelectionHash(const MyPointCloudStore& store)
+{
+	return CombineHash(HashOffsetBasis, store.GetSelectionWords(), store.GetSelectionWordsNum());
+}
+
+
+void MyInputRecorder::Start(const MyInputTrace::InitialState& initialState, const MyPointCloudStore& store)
+{
+	m_trace.Reset(initialState, store);
+	m_startTime = Clock::now();
+	m_isRecording = true;
+}
+
+bool MyInputRecorder::Stop(const char* pFilePath, std::string& outErrorMessage)
+{
+	m_isRecording = false;
+	return m_trace.WriteFile(pFilePath, outErrorMessage);
+}
+
+void MyInputRecorder::Record(MyInputTrace::EventType type, int code, int state, int modifiers, int x, int y)
+{
+	if (!m_isRecording)
+	{
+		return;
+	}
+	const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_startTime);
+	const MyInputTrace::Event event =
+	{
+		uint32_t(elapsed.count()), uint8_t(type), uint8_t(code), int8_t(state), uint8_t(modifiers),
+		int16_t(std::min(std::max(x, INT16_MIN), INT16_MAX)), int16_t(std::min(std::max(y, INT16_MIN), INT16_MAX)),
+	};
+	m_trace.AddEvent(event);
+}
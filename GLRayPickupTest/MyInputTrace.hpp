@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+
+
+//! @brief  入力イベントのトレース ファイル。GLUT のコールバックに届いたマウス・キーボードなどのイベントを、時刻付きで記録する。<br>
+//! 記録開始時の点群の生成条件、ビューポート、カメラ、トラックボールの回転、ピッキングの設定、選択状態も保持するので、<br>
+//! ウィンドウなしで同じ操作を再生し（MyInputReplayer）、ビルド間で遅延や選択結果を比べられる。<br>
+//! イベントは 1 個 12 バイト。選択状態は選択された点の連続区間の列で持つ。<br>
+class MyInputTrace
+{
+public:
+	static const char* const FileExtension;
+
+	enum EventType
+	{
+		EventType_MouseButton, //!< Code = GLUT のボタン、State = GLUT_DOWN/GLUT_UP。<br>
+		EventType_Motion, //!< ボタンを押したままの移動。<br>
+		EventType_PassiveMotion, //!< ボタンを押していない移動。<br>
+		EventType_MouseWheel, //!< State = 回転方向（+1 または -1）。<br>
+		EventType_Keyboard, //!< Code = キーの文字。<br>
+		EventType_Reshape, //!< X, Y = ウィンドウの幅と高さ。<br>
+		EventType_Count,
+	};
+
+	//! @brief  マウス ボタン。GLUT_LEFT_BUTTON などと同じ値。<br>
+	enum Button
+	{
+		Button_Left = 0,
+		Button_Middle = 1,
+		Button_Right = 2,
+	};
+
+	//! @brief  マウス ボタンの状態。GLUT_DOWN, GLUT_UP と同じ値。<br>
+	enum ButtonState
+	{
+		ButtonState_Down = 0,
+		ButtonState_Up = 1,
+	};
+
+	//! @brief  修飾キー。GLUT_ACTIVE_SHIFT などと同じ値。<br>
+	enum Modifier
+	{
+		Modifier_Shift = 1,
+		Modifier_Ctrl = 2,
+		Modifier_Alt = 4,
+	};
+
+	struct Event
+	{
+		uint32_t TimeMicroseconds; //!< 記録開始からの時刻。<br>
+		uint8_t Type;
+		uint8_t Code;
+		int8_t State;
+		uint8_t Modifiers;
+		int16_t X;
+		int16_t Y;
+	};
+
+	//! @brief  記録開始時の状態。点群は GLRayPickupTest と同じく MyPointGenerator で生成し、Morton 順に並べ替えたもの。<br>
+	struct InitialState
+	{
+		uint64_t PointsNum;
+		uint64_t Seed;
+		uint64_t PositionsHash; //!< CalcPositionsHash() の値。再生時に同じ点群かどうかを確かめる。<br>
+		uint32_t Distribution; //!< MyPointGenerator::Distribution。<br>
+		float CloudRadius;
+		int32_t ViewportWidth;
+		int32_t ViewportHeight;
+		float Fov, Near, Far;
+		float CameraEye[3];
+		float CameraAt[3];
+		float CameraUp[3];
+		float TrackballRotation[4]; //!< w, x, y, z。<br>
+		uint32_t PickMode; //!< MyPointPicker::PickMode。<br>
+		uint32_t UsesWorldUnitAsIntersectMargin;
+	};
+
+	//! @brief  選択された点の連続区間。<br>
+	struct SelectionRun
+	{
+		uint32_t First;
+		uint32_t Count;
+	};
+
+private:
+	InitialState m_initialState;
+	std::vector<SelectionRun> m_initialSelection;
+	std::vector<Event> m_events;
+
+public:
+	MyInputTrace();
+
+public:
+	const InitialState& GetInitialState() const { return m_initialState; }
+	const std::vector<SelectionRun>& GetInitialSelection() const { return m_initialSelection; }
+	const std::vector<Event>& GetEvents() const { return m_events; }
+
+	//! @brief  記録を始める。イベントと選択状態はクリアされる。<br>
+	void Reset(const InitialState& initialState, const MyPointCloudStore& store);
+	void AddEvent(const Event& event) { m_events.push_back(event); }
+
+	bool WriteFile(const char* pFilePath, std::string& outErrorMessage) const;
+	bool ReadFile(const char* pFilePath, std::string& outErrorMessage);
+
+	//! @brief  点群の位置座標のハッシュ値。<br>
+	static uint64_t CalcPositionsHash(const MyPointCloudStore& store);
+
+	//! @brief  点群の選択状態のハッシュ値。ビルド間で選択結果が一致するかどうかの比較に使う。<br>
+	static uint64_t CalcSelectionHash(const MyPointCloudStore& store);
+};
+
+
+//! @brief  GLUT のコールバックから呼んで、入力イベントを MyInputTrace に記録する。<br>
+class MyInputRecorder
+{
+	typedef std::chrono::steady_clock Clock;
+
+	MyInputTrace m_trace;
+	Clock::time_point m_startTime;
+	bool m_isRecording;
+
+public:
+	MyInputRecorder() : m_isRecording() {}
+
+public:
+	bool IsRecording() const { return m_isRecording; }
+	size_t GetEventsNum() const { return m_trace.GetEvents().size(); }
+
+	void Start(const MyInputTrace::InitialState& initialState, const MyPointCloudStore& store);
+
+	//! @brief  記録を止めてファイルに書き出す。<br>
+	bool Stop(const char* pFilePath, std::string& outErrorMessage);
+
+	void Record(MyInputTrace::EventType type, int code, int state, int modifiers, int x, int y);
+};
@@ -0,0 +1,187 @@
+﻿#include "stdafx.h"
+#include "MyJobSystem.hpp"
+
+
+MyJobSystem::MyJobSystem(unsigned threadsNum)
+	: m_activeThreadsNum()
+	, m_jobGeneration()
+	, m_jobThreadsNum()
+	, m_runningWorkersNum()
+	, m_isQuitting()
+	, m_pJobFunc()
+	, m_jobCount()
+	, m_jobChunkSize()
+{
+	if (threadsNum == 0)
+	{
+		threadsNum = std::max(1u, std::thread::hardware_concurrency());
+	}
+	m_workRanges.reset(new WorkRange[threadsNum]);
+	m_activeThreadsNum = threadsNum;
+	m_workerThreads.reserve(threadsNum - 1);
+	for (unsigned i = 1; i < threadsNum; ++i)
+	{
+		m_workerThreads.emplace_back(&MyJobSystem::WorkerThreadMain, this, i);
+	}
+}
+
+MyJobSystem::~MyJobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_isQuitting = true;
+	}
+	m_jobStartCondition.notify_all();
+	for (auto& thread : m_workerThreads)
+	{
+		thread.join();
+	}
+}
+
+void MyJobSystem::SetActiveThreadsNum(unsigned threadsNum)
+{
+	m_activeThreadsNum = std::min(std::max(1u, threadsNum), this->GetMaxThreadsNum());
+}
+
+void MyJobSystem::ParallelFor(size_t count, size_t chunkSize, const ChunkFunc& func)
+{
+	assert(chunkSize > 0);
+	if (count == 0)
+	{
+		return;
+	}
+	const size_t chunksNum = (count + chunkSize - 1) / chunkSize;
+	const unsigned threadsNum = unsigned(std::min<size_t>(m_activeThreadsNum, chunksNum));
+	if (threadsNum <= 1)
+	{
+		// 並列化の意味がないので、呼び出し元スレッドで直接処理する。
+		for (size_t begin = 0; begin < count; begin += chunkSize)
+		{
+			func(begin, std::min(begin + chunkSize, count));
+		}
+		return;
+	}
+
+	// 最初はチャンクを連続した区間で均等に配分する。偏りはスティールで解消される。
+	for (unsigned t = 0; t < threadsNum; ++t)
+	{
+		std::lock_guard<std::mutex> lock(m_workRanges[t].Mutex);
+		m_workRanges[t].BeginChunk = chunksNum * t / threadsNum;
+		m_workRanges[t].EndChunk = chunksNum * (t + 1) / threadsNum;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_pJobFunc = &func;
+		m_jobCount = count;
+		m_jobChunkSize = chunkSize;
+		m_jobThreadsNum = threadsNum;
+		m_runningWorkersNum = threadsNum - 1;
+		++m_jobGeneration;
+	}
+	m_jobStartCondition.notify_all();
+
+	this->ProcessChunks(0);
+
+	// すべてのワーカーが抜けるまで待つ。ワーカーは残りチャンクがなくなった時点で抜けるので、
+	// この時点で全チャンクの処理が完了している。
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	m_jobEndCondition.wait(lock, [this]() { return m_runningWorkersNum == 0; });
+	m_pJobFunc = nullptr;
+}
+
+void MyJobSystem::WorkerThreadMain(unsigned threadIndex)
+{
+	uint64_t lastGeneration = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobStartCondition.wait(lock, [&]() { return m_isQuitting || m_jobGeneration != lastGeneration; });
+			if (m_isQuitting)
+			{
+				return;
+			}
+			lastGeneration = m_jobGeneration;
+			// 今回のジョブに参加しないワーカーは、次のジョブまで待つ。
+			if (threadIndex >= m_jobThreadsNum)
+			{
+				continue;
+			}
+		}
+
+		this->ProcessChunks(threadIndex);
+
+		bool isLast = false;
+		{
+			std::lock_guard<std::mutex> lock(m_jobMutex);
+			isLast = (--m_runningWorkersNum == 0);
+		}
+		if (isLast)
+		{
+			m_jobEndCondition.notify_one();
+		}
+	}
+}
+
+void MyJobSystem::ProcessChunks(unsigned threadIndex)
+{
+	const ChunkFunc& func = *m_pJobFunc;
+	for (;;)
+	{
+		size_t chunk = 0;
+		while (this->PopOwnChunk(threadIndex, chunk))
+		{
+			const size_t begin = chunk * m_jobChunkSize;
+			func(begin, std::min(begin + m_jobChunkSize, m_jobCount));
+		}
+		if (!this->StealChunks(threadIndex))
+		{
+			// どのスレッドにも未着手のチャンクが残っていない。
+			return;
+		}
+	}
+}
+
+bool MyJobSystem::PopOwnChunk(unsigned threadIndex, size_t& outChunk)
+{
+	WorkRange& range = m_workRanges[threadIndex];
+	std::lock_guard<std::mutex> lock(range.Mutex);
+	if (range.BeginChunk >= range.EndChunk)
+	{
+		return false;
+	}
+	outChunk = range.BeginChunk++;
+	return true;
+}
+
+bool MyJobSystem::StealChunks(unsigned threadIndex)
+{
+	// 参加していないスレッドの担当範囲は空なので、参加スレッドの範囲だけ見ればよい。
+	const unsigned threadsNum = m_jobThreadsNum;
+	for (unsigned i = 1; i < threadsNum; ++i)
+	{
+		const unsigned victimIndex = (threadIndex + i) % threadsNum;
+		WorkRange& victim = m_workRanges[victimIndex];
+		size_t stolenBegin = 0;
+		size_t stolenEnd = 0;
+		{
+			std::lock_guard<std::mutex> lock(victim.Mutex);
+			if (victim.BeginChunk >= victim.EndChunk)
+			{
+				continue;
+			}
+			const size_t restNum = victim.EndChunk - victim.BeginChunk;
+			// 後半（残りが 1 つならその 1 つ）を奪う。
+			stolenBegin = victim.EndChunk - (restNum + 1) / 2;
+			stolenEnd = victim.EndChunk;
+			victim.EndChunk = stolenBegin;
+		}
+		WorkRange& own = m_workRanges[threadIndex];
+		std::lock_guard<std::mutex> lock(own.Mutex);
+		own.BeginChunk = stolenBegin;
+		own.EndChunk = stolenEnd;
+		return true;
+	}
+	return false;
+}
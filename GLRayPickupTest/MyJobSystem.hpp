@@ -0,0 +1,71 @@
+﻿#pragma once
+
+
+//! @brief  ワークスティーリングによる簡易ジョブ システム。<br>
+//! ParallelFor() で範囲をチャンクに分割し、呼び出し元スレッドとワーカー スレッドで分担して処理する。<br>
+//! 各スレッドは自分の担当範囲を先頭から消化し、空になったら他スレッドの担当範囲の後半を奪って続ける。<br>
+//! どのチャンクをどのスレッドが処理するかは実行ごとに変わるので、チャンク間で書き込み先が重ならないようにすること。<br>
+//! ParallelFor() を複数のスレッドから同時に呼び出したり、入れ子にしたりすることはできない。<br>
+class MyJobSystem
+{
+public:
+	//! @brief  チャンクを処理する関数。引数は [beginIndex, endIndex) の範囲。<br>
+	typedef std::function<void(size_t beginIndex, size_t endIndex)> ChunkFunc;
+
+private:
+	// 1 スレッドぶんの担当範囲（チャンク番号の半開区間）。所有者と盗む側の双方からロックしてアクセスする。
+	// 隣り合う要素が同じキャッシュラインに載らないようにパディングする（C++14 ではアライメント指定付きの new が使えない）。
+	struct WorkRange
+	{
+		std::mutex Mutex;
+		size_t BeginChunk;
+		size_t EndChunk;
+		char Padding[64];
+		WorkRange() : BeginChunk(), EndChunk() {}
+	};
+
+private:
+	std::vector<std::thread> m_workerThreads;
+	std::unique_ptr<WorkRange[]> m_workRanges; //!< [0] は呼び出し元スレッド、[1..] はワーカー スレッドの担当範囲。<br>
+	unsigned m_activeThreadsNum; //!< ParallelFor() で使うスレッド数（呼び出し元を含む）。<br>
+
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobStartCondition;
+	std::condition_variable m_jobEndCondition;
+	uint64_t m_jobGeneration; //!< ジョブを投入するたびに増える。ワーカーはこの変化で新しいジョブを検知する。<br>
+	unsigned m_jobThreadsNum; //!< 現在のジョブに参加するスレッド数（呼び出し元を含む）。<br>
+	unsigned m_runningWorkersNum; //!< 現在のジョブを処理中のワーカー数。<br>
+	bool m_isQuitting;
+
+	const ChunkFunc* m_pJobFunc;
+	size_t m_jobCount;
+	size_t m_jobChunkSize;
+
+public:
+	//! @brief  threadsNum は呼び出し元スレッドを含むスレッド数。0 の場合はハードウェア スレッド数。<br>
+	explicit MyJobSystem(unsigned threadsNum = 0);
+	~MyJobSystem();
+
+	//! @brief  呼び出し元スレッドを含む、利用可能な最大スレッド数を取得する。<br>
+	unsigned GetMaxThreadsNum() const
+	{ return unsigned(m_workerThreads.size()) + 1; }
+
+	unsigned GetActiveThreadsNum() const
+	{ return m_activeThreadsNum; }
+
+	//! @brief  ParallelFor() で使うスレッド数を 1 以上 GetMaxThreadsNum() 以下に制限する。スケーリングの計測用。<br>
+	void SetActiveThreadsNum(unsigned threadsNum);
+
+	//! @brief  [0, count) を chunkSize 個ずつのチャンクに分割し、func を並列に呼び出す。全チャンクの処理が終わるまで戻らない。<br>
+	//! 各チャンクの先頭インデックスは chunkSize の倍数になる。<br>
+	void ParallelFor(size_t count, size_t chunkSize, const ChunkFunc& func);
+
+private:
+	MyJobSystem(const MyJobSystem&) = delete;
+	MyJobSystem& operator=(const MyJobSystem&) = delete;
+
+	void WorkerThreadMain(unsigned threadIndex);
+	void ProcessChunks(unsigned threadIndex);
+	bool PopOwnChunk(unsigned threadIndex, size_t& outChunk);
+	bool StealChunks(unsigned threadIndex);
+};
@@ -0,0 +1,172 @@
+﻿#include "stdafx.h"
+#include "MyMappedFile.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#if defined(_WIN32)
+
+MyMappedFile::MyMappedFile()
+	: m_hFile(INVALID_HANDLE_VALUE)
+	, m_hMapping()
+	, m_pData()
+	, m_size()
+{
+}
+
+bool MyMappedFile::Open(const char* pFilePath)
+{
+	this->Close();
+
+	m_hFile = ::CreateFileA(pFilePath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize = {};
+	if (!::GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart <= 0 ||
+		uint64_t(fileSize.QuadPart) > uint64_t(SIZE_MAX))
+	{
+		this->Close();
+		return false;
+	}
+	m_hMapping = ::CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_hMapping)
+	{
+		this->Close();
+		return false;
+	}
+	m_pData = static_cast<const uint8_t*>(::MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		this->Close();
+		return false;
+	}
+	m_size = uint64_t(fileSize.QuadPart);
+	return true;
+}
+
+void MyMappedFile::Close()
+{
+	if (m_pData)
+	{
+		::UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+	}
+	if (m_hMapping)
+	{
+		::CloseHandle(m_hMapping);
+		m_hMapping = nullptr;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+
+void MyMappedFile::AdviseSequentialAccess()
+{
+	// Windows ではファイルを開く際に FILE_FLAG_SEQUENTIAL_SCAN を指定済み。
+}
+
+bool MyMappedFile::GetFileStamp(const char* pFilePath, uint64_t& outSize, int64_t& outWriteTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes = {};
+	if (!::GetFileAttributesExA(pFilePath, GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+	outSize = (uint64_t(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	outWriteTime = int64_t((uint64_t(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime);
+	return true;
+}
+
+#else
+
+MyMappedFile::MyMappedFile()
+	: m_fileDescriptor(-1)
+	, m_pData()
+	, m_size()
+{
+}
+
+bool MyMappedFile::Open(const char* pFilePath)
+{
+	this->Close();
+
+	m_fileDescriptor = ::open(pFilePath, O_RDONLY);
+	if (m_fileDescriptor < 0)
+	{
+		return false;
+	}
+	struct stat fileStat = {};
+	if (::fstat(m_fileDescriptor, &fileStat) != 0 || fileStat.st_size <= 0 ||
+		uint64_t(fileStat.st_size) > uint64_t(SIZE_MAX))
+	{
+		this->Close();
+		return false;
+	}
+	void* pMapped = ::mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	if (pMapped == MAP_FAILED)
+	{
+		this->Close();
+		return false;
+	}
+	m_pData = static_cast<const uint8_t*>(pMapped);
+	m_size = uint64_t(fileStat.st_size);
+	return true;
+}
+
+void MyMappedFile::Close()
+{
+	if (m_pData)
+	{
+		::munmap(const_cast<uint8_t*>(m_pData), size_t(m_size));
+		m_pData = nullptr;
+	}
+	if (m_fileDescriptor >= 0)
+	{
+		::close(m_fileDescriptor);
+		m_fileDescriptor = -1;
+	}
+	m_size = 0;
+}
+
+void MyMappedFile::AdviseSequentialAccess()
+{
+	if (m_pData)
+	{
+		::madvise(const_cast<uint8_t*>(m_pData), size_t(m_size), MADV_SEQUENTIAL);
+	}
+}
+
+bool MyMappedFile::GetFileStamp(const char* pFilePath, uint64_t& outSize, int64_t& outWriteTime)
+{
+	struct stat fileStat = {};
+	if (::stat(pFilePath, &fileStat) != 0)
+	{
+		return false;
+	}
+	outSize = uint64_t(fileStat.st_size);
+	outWriteTime = int64_t(fileStat.st_mtime);
+	return true;
+}
+
+#endif
+
+MyMappedFile::~MyMappedFile()
+{
+	this->Close();
+}
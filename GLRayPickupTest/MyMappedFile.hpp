@@ -0,0 +1,44 @@
+﻿#pragma once
+
+
+//! @brief  読み取り専用のメモリ マップト ファイル。<br>
+//! ファイル全体を 1 つのビューとしてマップするので、巨大なファイルを扱うには 64 ビット プロセスであること。<br>
+//! ファイルの内容はアクセスした時点で OS がページ単位で読み込むので、バッファへのコピーは発生しない。<br>
+class MyMappedFile
+{
+private:
+#if defined(_WIN32)
+	void* m_hFile;
+	void* m_hMapping;
+#else
+	int m_fileDescriptor;
+#endif
+	const uint8_t* m_pData;
+	uint64_t m_size;
+
+public:
+	MyMappedFile();
+	~MyMappedFile();
+
+public:
+	//! @brief  ファイルを開いてマップする。失敗した場合（空のファイルを含む）は false を返す。<br>
+	//! すでに開いているファイルは閉じられる。<br>
+	bool Open(const char* pFilePath);
+
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	const uint8_t* GetData() const { return m_pData; }
+	uint64_t GetSize() const { return m_size; }
+
+	//! @brief  先頭から順に一度だけ読むことを OS に伝え、先読みを促す。<br>
+	void AdviseSequentialAccess();
+
+	//! @brief  ファイルを開かずに、サイズと最終更新時刻（OS 依存の単位）を取得する。キャッシュの鮮度の判定に使う。<br>
+	static bool GetFileStamp(const char* pFilePath, uint64_t& outSize, int64_t& outWriteTime);
+
+private:
+	MyMappedFile(const MyMappedFile&) = delete;
+	MyMappedFile& operator=(const MyMappedFile&) = delete;
+};
@@ -0,0 +1,173 @@
+﻿#include "stdafx.h"
+#include "MyMortonOrder.hpp"
+#include "MyJobSystem.hpp"
+
+
+namespace
+{
+	// 基数ソートの 1 パスで扱うビット数。30 ビットのコードを 3 パスでソートする。
+	const int RadixBits = 10;
+	const size_t RadixBucketsNum = size_t(1) << RadixBits;
+	const int RadixPassesNum = 3;
+	// 並列化の単位となるブロックの点数。ブロックごとにヒストグラムを持つので、小さすぎるとヒストグラムの走査が重くなる。
+	// ブロックの分け方はスレッド数によらないので、ソート結果もスレッド数によらない。
+	const size_t RadixBlockPointsNum = 64 * 1024;
+
+	void CalcBoundsParallel(MyJobSystem& jobSystem, const float* pPosX, const float* pPosY, const float* pPosZ, size_t pointsNum,
+		MyVector3F& outBoundsMin, MyVector3F& outBoundsMax)
+	{
+		const size_t blocksNum = (pointsNum + RadixBlockPointsNum - 1) / RadixBlockPointsNum;
+		std::vector<MyVector3F> blockMins(blocksNum, MyVector3F(+std::numeric_limits<float>::infinity()));
+		std::vector<MyVector3F> blockMaxs(blocksNum, MyVector3F(-std::numeric_limits<float>::infinity()));
+		jobSystem.ParallelFor(pointsNum, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			const size_t block = beginIndex / RadixBlockPointsNum;
+			MyVector3F boundsMin = blockMins[block];
+			MyVector3F boundsMax = blockMaxs[block];
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				const MyVector3F pos(pPosX[i], pPosY[i], pPosZ[i]);
+				boundsMin = glm::min(boundsMin, pos);
+				boundsMax = glm::max(boundsMax, pos);
+			}
+			blockMins[block] = boundsMin;
+			blockMaxs[block] = boundsMax;
+		});
+		outBoundsMin = MyVector3F(+std::numeric_limits<float>::infinity());
+		outBoundsMax = MyVector3F(-std::numeric_limits<float>::infinity());
+		for (size_t b = 0; b < blocksNum; ++b)
+		{
+			outBoundsMin = glm::min(outBoundsMin, blockMins[b]);
+			outBoundsMax = glm::max(outBoundsMax, blockMaxs[b]);
+		}
+	}
+
+	template<typename T> void PermuteArrayParallel(MyJobSystem& jobSystem, T* pValues, const std::vector<uint32_t>& order, std::vector<T>& scratch)
+	{
+		const size_t count = order.size();
+		scratch.resize(count);
+		jobSystem.ParallelFor(count, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				scratch[i] = pValues[order[i]];
+			}
+		});
+		std::copy(scratch.begin(), scratch.end(), pValues);
+	}
+} // end of namespace
+
+namespace MyMortonOrder
+{
+	void SortByMortonCodeParallel(MyJobSystem& jobSystem, const float* pPosX, const float* pPosY, const float* pPosZ, size_t pointsNum,
+		std::vector<uint32_t>& outOrder)
+	{
+		assert(pointsNum <= size_t(UINT32_MAX));
+		MyVector3F boundsMin, boundsMax;
+		CalcBoundsParallel(jobSystem, pPosX, pPosY, pPosZ, pointsNum, boundsMin, boundsMax);
+		MyVector3F gridMin, invCellSize;
+		CalcCubicGrid(boundsMin, boundsMax, gridMin, invCellSize);
+
+		std::vector<uint32_t> codes(pointsNum);
+		outOrder.resize(pointsNum);
+		jobSystem.ParallelFor(pointsNum, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				codes[i] = CalcMortonCode(MyVector3F(pPosX[i], pPosY[i], pPosZ[i]), gridMin, invCellSize);
+				outOrder[i] = uint32_t(i);
+			}
+		});
+
+		// LSD 基数ソート。各パスで、ブロックごとのヒストグラム → (バケット, ブロック) の順の累積和 → ブロックごとの分配、を行なう。
+		// 同じバケットの中ではブロック順、ブロック内では元の順に書き込むので、安定ソートになる。
+		const size_t blocksNum = (pointsNum + RadixBlockPointsNum - 1) / RadixBlockPointsNum;
+		std::vector<uint32_t> histograms(blocksNum * RadixBucketsNum);
+		std::vector<uint32_t> sortedCodes(pointsNum);
+		std::vector<uint32_t> sortedOrder(pointsNum);
+		for (int pass = 0; pass < RadixPassesNum; ++pass)
+		{
+			const int shift = pass * RadixBits;
+			jobSystem.ParallelFor(pointsNum, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+			{
+				uint32_t* pHistogram = &histograms[beginIndex / RadixBlockPointsNum * RadixBucketsNum];
+				std::fill(pHistogram, pHistogram + RadixBucketsNum, 0);
+				for (size_t i = beginIndex; i < endIndex; ++i)
+				{
+					++pHistogram[(codes[i] >> shift) & (RadixBucketsNum - 1)];
+				}
+			});
+			uint32_t offset = 0;
+			for (size_t bucket = 0; bucket < RadixBucketsNum; ++bucket)
+			{
+				for (size_t block = 0; block < blocksNum; ++block)
+				{
+					uint32_t& entry = histograms[block * RadixBucketsNum + bucket];
+					const uint32_t count = entry;
+					entry = offset;
+					offset += count;
+				}
+			}
+			jobSystem.ParallelFor(pointsNum, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+			{
+				uint32_t* pOffsets = &histograms[beginIndex / RadixBlockPointsNum * RadixBucketsNum];
+				for (size_t i = beginIndex; i < endIndex; ++i)
+				{
+					const uint32_t destIndex = pOffsets[(codes[i] >> shift) & (RadixBucketsNum - 1)]++;
+					sortedCodes[destIndex] = codes[i];
+					sortedOrder[destIndex] = outOrder[i];
+				}
+			});
+			codes.swap(sortedCodes);
+			outOrder.swap(sortedOrder);
+		}
+	}
+
+	void ReorderStoreParallel(MyJobSystem& jobSystem, MyPointCloudStore& store, const std::vector<uint32_t>& order)
+	{
+		const size_t pointsNum = store.GetPointsNum();
+		assert(order.size() == pointsNum);
+		std::vector<float> scratchPositions;
+		PermuteArrayParallel(jobSystem, store.GetPositionsX(), order, scratchPositions);
+		PermuteArrayParallel(jobSystem, store.GetPositionsY(), order, scratchPositions);
+		PermuteArrayParallel(jobSystem, store.GetPositionsZ(), order, scratchPositions);
+		// パレットを使っている場合は、1 バイトのインデックスのまま並べ替える。
+		if (store.UsesPalette())
+		{
+			std::vector<uint8_t> scratchIndices;
+			PermuteArrayParallel(jobSystem, store.GetPaletteIndices(), order, scratchIndices);
+		}
+		else
+		{
+			std::vector<uint32_t> scratchWords;
+			PermuteArrayParallel(jobSystem, store.GetPackedColors(), order, scratchWords);
+		}
+
+		// 選択状態のビットは 64 点単位のワードに書き込むので、ブロックの境界をワード境界に揃えて並列化する。
+		const uint64_t* pSelectionWords = store.GetSelectionWords();
+		std::vector<uint64_t> selectionWords(store.GetSelectionWordsNum());
+		jobSystem.ParallelFor(pointsNum, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				const uint32_t source = order[i];
+				const uint64_t bit = (pSelectionWords[source / MyPointCloudStore::BitsPerSelectionWord] >> (source % MyPointCloudStore::BitsPerSelectionWord)) & 1;
+				selectionWords[i / MyPointCloudStore::BitsPerSelectionWord] |= bit << (i % MyPointCloudStore::BitsPerSelectionWord);
+			}
+		});
+		std::copy(selectionWords.begin(), selectionWords.end(), store.GetSelectionWords());
+
+		// 元のインデックスの表は、既に並べ替えられていれば合成する。
+		std::vector<uint32_t> originalIndices(pointsNum);
+		jobSystem.ParallelFor(pointsNum, RadixBlockPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				originalIndices[i] = store.GetOriginalIndex(order[i]);
+			}
+		});
+		store.SetOriginalIndices(std::move(originalIndices));
+		store.NotifyPositionsModified();
+		store.NotifyColorsModified();
+	}
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+
+class MyJobSystem;
+
+
+//! @brief  点群を Morton 順（Z 順序曲線）に並べ替える。<br>
+//! 生成順やファイル順のままだと、空間的に近い点がメモリ上で散らばるので、八分木の葉やスクリーン タイルの点を読むたびに<br>
+//! キャッシュ ミスと TLB ミスが起きる。Morton 順に並べると、空間的に近い点がメモリ上でも連続する。<br>
+//! 並べ替えの前後で点のインデックスが変わるので、点群には元のインデックスの表を持たせる（MyPointCloudStore::GetOriginalIndex()）。<br>
+namespace MyMortonOrder
+{
+	//! @brief  Morton コードの各軸の分割数。3 軸で 30 ビットのコードになる。<br>
+	const uint32_t CellsPerAxis = 1024;
+	const int BitsPerAxis = 10;
+
+	//! @brief  10 ビットの値のビットを 2 ビットおきに広げる。<br>
+	inline uint32_t SpreadBits10(uint32_t val)
+	{
+		val &= 0x3FF;
+		val = (val | (val << 16)) & 0x030000FF;
+		val = (val | (val << 8)) & 0x0300F00F;
+		val = (val | (val << 4)) & 0x030C30C3;
+		val = (val | (val << 2)) & 0x09249249;
+		return val;
+	}
+
+	//! @brief  点群の AABB から、Morton コードの格子の最小点 outGridMin と、セルの大きさの逆数 outInvCellSize（各軸共通）を求める。<br>
+	//! 格子は AABB の中心を中心とし、最も長い辺を一辺とする立方体で、MyPointOctree::Build() のルートのセルと一致する。<br>
+	//! したがって八分木の各ノードのセルは Morton コードの上位ビットが共通の範囲になり、ノードの点は並べ替え後のインデックスで連番になる。<br>
+	inline void CalcCubicGrid(const MyVector3F& boundsMin, const MyVector3F& boundsMax, MyVector3F& outGridMin, MyVector3F& outInvCellSize)
+	{
+		const MyVector3F vExtent = (boundsMax - boundsMin) * 0.5f;
+		const float halfSize = std::max(std::max(vExtent.x, vExtent.y), vExtent.z);
+		outGridMin = (boundsMin + boundsMax) * 0.5f - MyVector3F(halfSize);
+		outInvCellSize = MyVector3F((halfSize > 0) ? float(CellsPerAxis) / (halfSize * 2) : 0.0f);
+	}
+
+	//! @brief  格子の最小点 gridMin と、各軸のセルの大きさの逆数 invCellSize から、30 ビットの Morton コードを求める。<br>
+	inline uint32_t CalcMortonCode(const MyVector3F& pos, const MyVector3F& gridMin, const MyVector3F& invCellSize)
+	{
+		const auto toCell = [](float val) { return uint32_t(std::min(std::max(val, 0.0f), float(CellsPerAxis - 1))); };
+		return
+			SpreadBits10(toCell((pos.x - gridMin.x) * invCellSize.x)) |
+			(SpreadBits10(toCell((pos.y - gridMin.y) * invCellSize.y)) << 1) |
+			(SpreadBits10(toCell((pos.z - gridMin.z) * invCellSize.z)) << 2);
+	}
+
+	//! @brief  点群全体の AABB から CalcCubicGrid() で求めた格子で各点の Morton コードを求め、コードの昇順に並べたときの点の順序を並列の基数ソートで求める。<br>
+	//! outOrder[i] は、並べ替え後に i 番目に来る点の（並べ替え前の）インデックス。<br>
+	//! 同じコードの点は元の順序を保つ（安定ソート）ので、結果はスレッド数によらず、(コード, インデックス) の組で比較ソートした結果と一致する。<br>
+	void SortByMortonCodeParallel(MyJobSystem& jobSystem, const float* pPosX, const float* pPosY, const float* pPosZ, size_t pointsNum,
+		std::vector<uint32_t>& outOrder);
+
+	//! @brief  点群の位置座標、色、選択状態を order の順序に並べ替え、元のインデックスの表を更新する。<br>
+	//! order は SortByMortonCodeParallel() の結果のような、[0, 点数) の順列であること。<br>
+	void ReorderStoreParallel(MyJobSystem& jobSystem, MyPointCloudStore& store, const std::vector<uint32_t>& order);
+}
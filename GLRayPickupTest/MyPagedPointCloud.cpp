@@ -0,0 +1,302 @@
+﻿#include "stdafx.h"
+#include "MyPagedPointCloud.hpp"
+#include "MyCollisionHelper.hpp"
+#include "MyCollisionBatch.hpp"
+
+
+// std::vector::assign() などに参照で渡すので、定義が必要。
+const uint32_t MyPagedPointCloud::InvalidIndex;
+
+MyPagedPointCloud::MyPagedPointCloud()
+	: m_slotsNum()
+	, m_lruHead(InvalidIndex)
+	, m_lruTail(InvalidIndex)
+	, m_pendingLoadsNum()
+	, m_frameIndex()
+	, m_stats()
+	, m_isQuitting()
+{
+}
+
+MyPagedPointCloud::~MyPagedPointCloud()
+{
+	this->Close();
+}
+
+bool MyPagedPointCloud::Open(const char* pCacheFilePath, size_t memoryBudgetBytes)
+{
+	this->Close();
+	if (!m_cache.Open(pCacheFilePath))
+	{
+		return false;
+	}
+	// 予算が 1 スロットに満たなくても、最低 1 チャンクは常駐できるようにする。
+	const size_t slotsNum = std::min<size_t>(std::max<size_t>(memoryBudgetBytes / SlotBytes, 1), m_cache.GetChunksNum());
+	m_slotsNum = uint32_t(slotsNum);
+	m_slotPositionsX.resize(slotsNum * ChunkPointsNum);
+	m_slotPositionsY.resize(slotsNum * ChunkPointsNum);
+	m_slotPositionsZ.resize(slotsNum * ChunkPointsNum);
+	m_slotColors.resize(slotsNum * ChunkPointsNum);
+	const Slot freeSlot = { SlotState_Free, InvalidIndex, 0, InvalidIndex, InvalidIndex };
+	m_slots.assign(slotsNum, freeSlot);
+	m_chunkSlots.assign(m_cache.GetChunksNum(), InvalidIndex);
+	m_chunkRequestedFrames.assign(m_cache.GetChunksNum(), 0);
+	// 末尾から取り出すので、若い番号のスロットから使われるように逆順に積む。
+	m_freeSlots.resize(slotsNum);
+	for (size_t i = 0; i < slotsNum; ++i)
+	{
+		m_freeSlots[i] = uint32_t(slotsNum - 1 - i);
+	}
+	m_lruHead = m_lruTail = InvalidIndex;
+	m_pendingLoadsNum = 0;
+	// 0 は「一度も要求されていない」を表すので、フレーム番号は 1 から始める。
+	m_frameIndex = 1;
+	m_stats = Stats();
+	m_newlyResidentSlots.clear();
+	m_requestQueue.clear();
+	m_completedLoads.clear();
+	m_isQuitting = false;
+	m_ioThread = std::thread([this]() { this->IoThreadMain(); });
+	return true;
+}
+
+void MyPagedPointCloud::Close()
+{
+	if (m_ioThread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_ioMutex);
+			m_isQuitting = true;
+		}
+		m_ioCondition.notify_all();
+		m_ioThread.join();
+	}
+	m_cache.Close();
+	m_slotsNum = 0;
+	std::vector<float>().swap(m_slotPositionsX);
+	std::vector<float>().swap(m_slotPositionsY);
+	std::vector<float>().swap(m_slotPositionsZ);
+	std::vector<uint32_t>().swap(m_slotColors);
+	m_slots.clear();
+	m_chunkSlots.clear();
+	m_chunkRequestedFrames.clear();
+	m_freeSlots.clear();
+	m_lruHead = m_lruTail = InvalidIndex;
+	m_pendingLoadsNum = 0;
+	m_newlyResidentSlots.clear();
+	m_requestQueue.clear();
+	m_completedLoads.clear();
+}
+
+uint32_t MyPagedPointCloud::GetResidentChunksNum() const
+{
+	return m_slotsNum - uint32_t(m_freeSlots.size()) - m_pendingLoadsNum;
+}
+
+void MyPagedPointCloud::IoThreadMain()
+{
+	for (;;)
+	{
+		LoadRequest request;
+		{
+			std::unique_lock<std::mutex> lock(m_ioMutex);
+			m_ioCondition.wait(lock, [this]() { return m_isQuitting || !m_requestQueue.empty(); });
+			if (m_isQuitting)
+			{
+				return;
+			}
+			request = m_requestQueue.front();
+			m_requestQueue.pop_front();
+		}
+		// マップされたファイルのページに初めて触れるのはここなので、ディスクからの読み込みはこのスレッドで発生する。
+		// スロットはメイン スレッドが読み込み中として確保したものなので、ロックなしで書き込んでよい。
+		const size_t base = size_t(request.SlotIndex) * ChunkPointsNum;
+		const MyPointCache::ChunkInfo& chunk = m_cache.GetChunk(request.ChunkIndex);
+		m_cache.DecodeChunkPositions(request.ChunkIndex, &m_slotPositionsX[base], &m_slotPositionsY[base], &m_slotPositionsZ[base]);
+		memcpy(&m_slotColors[base], m_cache.GetPackedColors() + chunk.FirstPoint, chunk.PointsNum * sizeof(uint32_t));
+		{
+			std::lock_guard<std::mutex> lock(m_ioMutex);
+			m_completedLoads.push_back(request);
+		}
+	}
+}
+
+void MyPagedPointCloud::BeginFrame()
+{
+	++m_frameIndex;
+	m_newlyResidentSlots.clear();
+	{
+		std::lock_guard<std::mutex> lock(m_ioMutex);
+		for (const auto& load : m_completedLoads)
+		{
+			m_newlyResidentSlots.push_back(load.SlotIndex);
+		}
+		m_completedLoads.clear();
+	}
+	for (auto slotIndex : m_newlyResidentSlots)
+	{
+		Slot& slot = m_slots[slotIndex];
+		assert(slot.State == SlotState_Loading);
+		slot.State = SlotState_Resident;
+		this->LinkLruFront(slotIndex);
+		--m_pendingLoadsNum;
+		++m_stats.LoadsNum;
+	}
+}
+
+void MyPagedPointCloud::LinkLruFront(uint32_t slotIndex)
+{
+	Slot& slot = m_slots[slotIndex];
+	slot.Prev = InvalidIndex;
+	slot.Next = m_lruHead;
+	if (m_lruHead != InvalidIndex)
+	{
+		m_slots[m_lruHead].Prev = slotIndex;
+	}
+	m_lruHead = slotIndex;
+	if (m_lruTail == InvalidIndex)
+	{
+		m_lruTail = slotIndex;
+	}
+}
+
+void MyPagedPointCloud::UnlinkLru(uint32_t slotIndex)
+{
+	Slot& slot = m_slots[slotIndex];
+	if (slot.Prev != InvalidIndex)
+	{
+		m_slots[slot.Prev].Next = slot.Next;
+	}
+	else
+	{
+		m_lruHead = slot.Next;
+	}
+	if (slot.Next != InvalidIndex)
+	{
+		m_slots[slot.Next].Prev = slot.Prev;
+	}
+	else
+	{
+		m_lruTail = slot.Prev;
+	}
+	slot.Prev = slot.Next = InvalidIndex;
+}
+
+uint32_t MyPagedPointCloud::AcquireSlot()
+{
+	if (!m_freeSlots.empty())
+	{
+		const uint32_t slotIndex = m_freeSlots.back();
+		m_freeSlots.pop_back();
+		return slotIndex;
+	}
+	// LRU リストの末尾が最も長く使われていないチャンク。それすら今のフレームで使われているなら、追い出せるものはない。
+	// 追い出すと、同じフレームですでに返したスロットの内容が変わってしまう。
+	const uint32_t slotIndex = m_lruTail;
+	if (slotIndex == InvalidIndex || m_slots[slotIndex].LastUsedFrame == m_frameIndex)
+	{
+		return InvalidIndex;
+	}
+	this->UnlinkLru(slotIndex);
+	m_chunkSlots[m_slots[slotIndex].ChunkIndex] = InvalidIndex;
+	++m_stats.EvictionsNum;
+	return slotIndex;
+}
+
+bool MyPagedPointCloud::RequestChunk(uint32_t chunkIndex)
+{
+	// 交差判定と描画の両方から要求されることがあるので、同じフレームでの 2 回目以降の要求は統計に数えない。
+	const bool isFirstRequestInFrame = (m_chunkRequestedFrames[chunkIndex] != m_frameIndex);
+	m_chunkRequestedFrames[chunkIndex] = m_frameIndex;
+	const uint32_t currentSlot = m_chunkSlots[chunkIndex];
+	if (currentSlot != InvalidIndex && m_slots[currentSlot].State == SlotState_Resident)
+	{
+		if (isFirstRequestInFrame)
+		{
+			++m_stats.HitsNum;
+			m_slots[currentSlot].LastUsedFrame = m_frameIndex;
+			this->UnlinkLru(currentSlot);
+			this->LinkLruFront(currentSlot);
+		}
+		return true;
+	}
+	if (isFirstRequestInFrame)
+	{
+		++m_stats.MissesNum;
+	}
+	if (currentSlot != InvalidIndex)
+	{
+		// 読み込み中。
+		return false;
+	}
+	if (m_pendingLoadsNum >= MaxPendingLoadsNum)
+	{
+		return false;
+	}
+	const uint32_t slotIndex = this->AcquireSlot();
+	if (slotIndex == InvalidIndex)
+	{
+		return false;
+	}
+	Slot& slot = m_slots[slotIndex];
+	slot.State = SlotState_Loading;
+	slot.ChunkIndex = chunkIndex;
+	slot.LastUsedFrame = m_frameIndex;
+	m_chunkSlots[chunkIndex] = slotIndex;
+	++m_pendingLoadsNum;
+	{
+		std::lock_guard<std::mutex> lock(m_ioMutex);
+		const LoadRequest request = { chunkIndex, slotIndex };
+		m_requestQueue.push_back(request);
+	}
+	m_ioCondition.notify_one();
+	return false;
+}
+
+uint32_t MyPagedPointCloud::GetResidentSlot(uint32_t chunkIndex) const
+{
+	const uint32_t slotIndex = m_chunkSlots[chunkIndex];
+	return (slotIndex != InvalidIndex && m_slots[slotIndex].State == SlotState_Resident) ? slotIndex : InvalidIndex;
+}
+
+void MyPagedPointCloud::QueryLineIntersectWithSphere(const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius,
+	std::vector<uint32_t>& outIndices)
+{
+	outIndices.clear();
+	// MyPointCache::QueryLineIntersectWithSphere() と同様に、チャンクの AABB を交差マージン分だけ膨らませて判定する。
+	const float margin = sphereRadius * 1.001f;
+	const MyVector3F vMargin(margin, margin, margin);
+	const MyCollision::LineSphereBatchQuery query(linePos1, linePos2, sphereRadius);
+	for (uint32_t c = 0; c < this->GetChunksNum(); ++c)
+	{
+		const MyPointCache::ChunkInfo& chunk = m_cache.GetChunk(c);
+		const MyVector3F boundsMin(chunk.BoundsMin[0], chunk.BoundsMin[1], chunk.BoundsMin[2]);
+		const MyVector3F boundsMax(chunk.BoundsMax[0], chunk.BoundsMax[1], chunk.BoundsMax[2]);
+		if (!MyCollision::CheckLineIntersectWithAABB(linePos1, linePos2, boundsMin - vMargin, boundsMax + vMargin))
+		{
+			continue;
+		}
+		if (!this->RequestChunk(c))
+		{
+			continue;
+		}
+		const uint32_t slotIndex = m_chunkSlots[c];
+		m_scratchIndices.clear();
+		MyCollision::CheckLineIntersectWithSphereBatch(query,
+			this->GetSlotPositionsX(slotIndex), this->GetSlotPositionsY(slotIndex), this->GetSlotPositionsZ(slotIndex),
+			0, chunk.PointsNum, m_scratchIndices);
+		for (auto index : m_scratchIndices)
+		{
+			outIndices.push_back(chunk.FirstPoint + index);
+		}
+	}
+}
+
+MyVector3F MyPagedPointCloud::GetResidentPosition(uint32_t pointIndex) const
+{
+	const uint32_t chunkIndex = pointIndex / ChunkPointsNum;
+	const uint32_t slotIndex = this->GetResidentSlot(chunkIndex);
+	assert(slotIndex != InvalidIndex);
+	const size_t index = size_t(slotIndex) * ChunkPointsNum + (pointIndex - m_cache.GetChunk(chunkIndex).FirstPoint);
+	return MyVector3F(m_slotPositionsX[index], m_slotPositionsY[index], m_slotPositionsZ[index]);
+}
@@ -0,0 +1,135 @@
+﻿#pragma once
+
+#include "MyPointCache.hpp"
+
+
+//! @brief  点群全体をメモリに載せずに扱うための、ページングされた点群。<br>
+//! 量子化キャッシュ ファイル（MyPointCache）の空間チャンクを単位として、必要になったチャンクだけをバックグラウンドの I/O スレッドでデコードし、<br>
+//! メモリ予算から決まる数のスロットに保持する。スロットが足りなくなったら、最も長く使われていないチャンクを追い出す（LRU）。<br>
+//! 交差判定や描画は常駐しているチャンクだけを対象とし、常駐していないチャンクは読み込みを要求して次のフレーム以降に回す。<br>
+//! I/O スレッドは割り当てられたスロットにしか書き込まず、常駐状態の管理はすべて呼び出し元スレッド（メイン スレッド）で行なう。<br>
+class MyPagedPointCloud
+{
+public:
+	static const uint32_t ChunkPointsNum = MyPointCache::ChunkPointsNum;
+	static const uint32_t InvalidIndex = UINT32_MAX;
+	//! 1 スロット（1 チャンクぶんの位置座標と色）のバイト数。<br>
+	static const size_t SlotBytes = ChunkPointsNum * (sizeof(float) * 3 + sizeof(uint32_t));
+	//! 同時に I/O スレッドへ依頼する読み込みの最大数。カメラの移動中に古い要求が溜まらないようにする。<br>
+	static const uint32_t MaxPendingLoadsNum = 64;
+
+	//! @brief  チャンク キャッシュの統計。<br>
+	struct Stats
+	{
+		uint64_t HitsNum; //!< 要求したチャンクが常駐していた回数。同じフレーム内の同じチャンクへの要求は 1 回と数える。<br>
+		uint64_t MissesNum; //!< 要求したチャンクが常駐していなかった（読み込み中を含む）回数。数え方は HitsNum と同じ。<br>
+		uint64_t LoadsNum; //!< 読み込みが完了したチャンク数。<br>
+		uint64_t EvictionsNum; //!< 追い出したチャンク数。<br>
+	};
+
+private:
+	enum SlotState
+	{
+		SlotState_Free,
+		SlotState_Loading,
+		SlotState_Resident,
+	};
+
+	struct Slot
+	{
+		SlotState State;
+		uint32_t ChunkIndex;
+		uint64_t LastUsedFrame;
+		uint32_t Prev, Next; //!< LRU リスト（常駐スロットのみ。先頭が最近使われたもの）。<br>
+	};
+
+	struct LoadRequest
+	{
+		uint32_t ChunkIndex;
+		uint32_t SlotIndex;
+	};
+
+private:
+	MyPointCache m_cache;
+	uint32_t m_slotsNum;
+	std::vector<float> m_slotPositionsX, m_slotPositionsY, m_slotPositionsZ; //!< スロット s のデータは [s * ChunkPointsNum, (s + 1) * ChunkPointsNum)。<br>
+	std::vector<uint32_t> m_slotColors;
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_chunkSlots; //!< チャンクごとの、読み込み中または常駐しているスロット。なければ InvalidIndex。<br>
+	std::vector<uint64_t> m_chunkRequestedFrames; //!< チャンクごとの、最後に要求されたフレーム。<br>
+	std::vector<uint32_t> m_freeSlots;
+	uint32_t m_lruHead, m_lruTail;
+	uint32_t m_pendingLoadsNum;
+	uint64_t m_frameIndex;
+	Stats m_stats;
+	std::vector<uint32_t> m_newlyResidentSlots;
+
+	// I/O スレッドとの受け渡し。m_ioMutex で保護する。
+	std::thread m_ioThread;
+	std::mutex m_ioMutex;
+	std::condition_variable m_ioCondition;
+	std::deque<LoadRequest> m_requestQueue; //!< 要求された順に読み込む。<br>
+	std::vector<LoadRequest> m_completedLoads;
+	bool m_isQuitting;
+
+	mutable std::vector<uint32_t> m_scratchIndices;
+
+public:
+	MyPagedPointCloud();
+	~MyPagedPointCloud();
+
+public:
+	//! @brief  キャッシュ ファイルを開き、memoryBudgetBytes から決まる数のスロットを確保して I/O スレッドを開始する。<br>
+	bool Open(const char* pCacheFilePath, size_t memoryBudgetBytes);
+	void Close();
+	bool IsOpen() const { return m_cache.IsOpen(); }
+
+	size_t GetPointsNum() const { return m_cache.GetPointsNum(); }
+	uint32_t GetChunksNum() const { return m_cache.GetChunksNum(); }
+	const MyPointCache::ChunkInfo& GetChunk(uint32_t chunkIndex) const { return m_cache.GetChunk(chunkIndex); }
+	MyVector3D GetOffset() const { return m_cache.GetOffset(); }
+	uint32_t GetSlotsNum() const { return m_slotsNum; }
+	size_t GetMemoryBudgetBytes() const { return size_t(m_slotsNum) * SlotBytes; }
+	uint32_t GetResidentChunksNum() const;
+	uint32_t GetPendingLoadsNum() const { return m_pendingLoadsNum; }
+	const Stats& GetStats() const { return m_stats; }
+
+	//! @brief  フレームの開始時に呼ぶ。I/O スレッドで読み込みが完了したチャンクを常駐状態にする。<br>
+	void BeginFrame();
+
+	//! @brief  チャンクを今のフレームで使うことを通知する。常駐していれば true を返す。<br>
+	//! 常駐していなければ、スロットを確保して（必要なら今のフレームで使われていないチャンクを追い出して）読み込みを要求し、false を返す。<br>
+	bool RequestChunk(uint32_t chunkIndex);
+
+	//! @brief  常駐しているチャンクのスロット。常駐していなければ InvalidIndex。<br>
+	uint32_t GetResidentSlot(uint32_t chunkIndex) const;
+
+	//! @brief  スロットに常駐しているチャンク。常駐していなければ InvalidIndex。描画で常駐スロットを列挙するのに使う。<br>
+	uint32_t GetSlotChunk(uint32_t slotIndex) const
+	{ return m_slots[slotIndex].State == SlotState_Resident ? m_slots[slotIndex].ChunkIndex : InvalidIndex; }
+
+	const float* GetSlotPositionsX(uint32_t slotIndex) const { return &m_slotPositionsX[size_t(slotIndex) * ChunkPointsNum]; }
+	const float* GetSlotPositionsY(uint32_t slotIndex) const { return &m_slotPositionsY[size_t(slotIndex) * ChunkPointsNum]; }
+	const float* GetSlotPositionsZ(uint32_t slotIndex) const { return &m_slotPositionsZ[size_t(slotIndex) * ChunkPointsNum]; }
+	const uint32_t* GetSlotColors(uint32_t slotIndex) const { return &m_slotColors[size_t(slotIndex) * ChunkPointsNum]; }
+
+	//! @brief  直前の BeginFrame() で常駐状態になったスロット。描画用バッファの部分更新に使う。<br>
+	const std::vector<uint32_t>& GetNewlyResidentSlots() const { return m_newlyResidentSlots; }
+
+	//! @brief  直線と点群の各点（同一半径の球）の交差判定を、常駐しているチャンクだけを対象に行なう。<br>
+	//! 直線が通るのに常駐していないチャンクは読み込みを要求する。outIndices はクリアされ、キャッシュ ファイル内の点のインデックスが入る。<br>
+	void QueryLineIntersectWithSphere(const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius,
+		std::vector<uint32_t>& outIndices);
+
+	//! @brief  キャッシュ ファイル内の点のインデックスから位置座標を取得する。点のチャンクが常駐していること。<br>
+	MyVector3F GetResidentPosition(uint32_t pointIndex) const;
+
+private:
+	MyPagedPointCloud(const MyPagedPointCloud&) = delete;
+	MyPagedPointCloud& operator=(const MyPagedPointCloud&) = delete;
+
+	void IoThreadMain();
+	uint32_t AcquireSlot();
+	void LinkLruFront(uint32_t slotIndex);
+	void UnlinkLru(uint32_t slotIndex);
+};
@@ -0,0 +1,177 @@
+﻿#include "stdafx.h"
+#include "MyPagedPointCloudRenderer.hpp"
+
+
+MyPagedPointCloudRenderer::MyPagedPointCloudRenderer(uint32_t packedColorHovered)
+	: m_positionBuffer()
+	, m_colorBuffer()
+	, m_slotsNum()
+	, m_packedColorHovered(packedColorHovered)
+	, m_lastUploadedChunksNum()
+{
+}
+
+MyPagedPointCloudRenderer::~MyPagedPointCloudRenderer()
+{
+	// OpenGL コンテキストが破棄された後の可能性があるので、ここでは GL 関数を呼ばない。
+	assert(m_positionBuffer == 0 && m_colorBuffer == 0);
+}
+
+void MyPagedPointCloudRenderer::Release()
+{
+	if (m_positionBuffer)
+	{
+		glDeleteBuffers(1, &m_positionBuffer);
+		m_positionBuffer = 0;
+	}
+	if (m_colorBuffer)
+	{
+		glDeleteBuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	m_slotsNum = 0;
+}
+
+void MyPagedPointCloudRenderer::RecreateBuffers(uint32_t slotsNum)
+{
+	this->Release();
+
+	const size_t pointsNum = size_t(slotsNum) * MyPagedPointCloud::ChunkPointsNum;
+	glGenBuffers(1, &m_positionBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(pointsNum * 3 * sizeof(float)), nullptr, GL_DYNAMIC_DRAW);
+	glGenBuffers(1, &m_colorBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+	glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(pointsNum * sizeof(uint32_t)), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_slotsNum = slotsNum;
+}
+
+void MyPagedPointCloudRenderer::Update(const MyPagedPointCloud& cloud, const std::vector<uint32_t>& hitPointIndices)
+{
+	m_lastUploadedChunksNum = 0;
+	m_hoveredPositions.clear();
+	if (!cloud.IsOpen())
+	{
+		return;
+	}
+	bool uploadsAll = false;
+	if (m_positionBuffer == 0 || cloud.GetSlotsNum() != m_slotsNum)
+	{
+		this->RecreateBuffers(cloud.GetSlotsNum());
+		uploadsAll = true;
+	}
+
+	const size_t chunkPointsNum = MyPagedPointCloud::ChunkPointsNum;
+	m_scratchPositions.resize(chunkPointsNum * 3);
+	const auto uploadSlot = [&](uint32_t slotIndex)
+	{
+		const uint32_t chunkIndex = cloud.GetSlotChunk(slotIndex);
+		if (chunkIndex == MyPagedPointCloud::InvalidIndex)
+		{
+			return;
+		}
+		// 固定機能パイプラインの頂点配列は (x, y, z) が並んだ形式しか受け付けないので、SoA からインターリーブする。
+		const uint32_t pointsNum = cloud.GetChunk(chunkIndex).PointsNum;
+		const float* pPosX = cloud.GetSlotPositionsX(slotIndex);
+		const float* pPosY = cloud.GetSlotPositionsY(slotIndex);
+		const float* pPosZ = cloud.GetSlotPositionsZ(slotIndex);
+		for (uint32_t i = 0; i < pointsNum; ++i)
+		{
+			m_scratchPositions[i * 3 + 0] = pPosX[i];
+			m_scratchPositions[i * 3 + 1] = pPosY[i];
+			m_scratchPositions[i * 3 + 2] = pPosZ[i];
+		}
+		const size_t firstPoint = size_t(slotIndex) * chunkPointsNum;
+		glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(firstPoint * 3 * sizeof(float)), GLsizeiptr(pointsNum * 3 * sizeof(float)), m_scratchPositions.data());
+		glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(firstPoint * sizeof(uint32_t)), GLsizeiptr(pointsNum * sizeof(uint32_t)), cloud.GetSlotColors(slotIndex));
+		++m_lastUploadedChunksNum;
+	};
+	if (uploadsAll)
+	{
+		// バッファを作り直した場合は、以前から常駐しているチャンクも含めて全スロットを書き直す。
+		for (uint32_t s = 0; s < m_slotsNum; ++s)
+		{
+			uploadSlot(s);
+		}
+	}
+	else
+	{
+		for (auto slotIndex : cloud.GetNewlyResidentSlots())
+		{
+			uploadSlot(slotIndex);
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_hoveredPositions.reserve(hitPointIndices.size() * 3);
+	for (auto pointIndex : hitPointIndices)
+	{
+		const MyVector3F pos = cloud.GetResidentPosition(pointIndex);
+		m_hoveredPositions.push_back(pos.x);
+		m_hoveredPositions.push_back(pos.y);
+		m_hoveredPositions.push_back(pos.z);
+	}
+}
+
+void MyPagedPointCloudRenderer::Draw(const MyPagedPointCloud& cloud)
+{
+	if (m_slotsNum == 0)
+	{
+		return;
+	}
+
+	// 連続するスロットの範囲はまとめて 1 つの範囲にする。
+	m_drawFirsts.clear();
+	m_drawCounts.clear();
+	for (uint32_t s = 0; s < m_slotsNum; ++s)
+	{
+		const uint32_t chunkIndex = cloud.GetSlotChunk(s);
+		if (chunkIndex == MyPagedPointCloud::InvalidIndex)
+		{
+			continue;
+		}
+		const GLint first = GLint(size_t(s) * MyPagedPointCloud::ChunkPointsNum);
+		const GLsizei count = GLsizei(cloud.GetChunk(chunkIndex).PointsNum);
+		if (!m_drawFirsts.empty() && m_drawFirsts.back() + m_drawCounts.back() == first)
+		{
+			m_drawCounts.back() += count;
+		}
+		else
+		{
+			m_drawFirsts.push_back(first);
+			m_drawCounts.push_back(count);
+		}
+	}
+
+	if (!m_drawFirsts.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, nullptr);
+		// パックされた色はメモリ上で R, G, B, A の順に並んでいる。
+		glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, nullptr);
+
+		glMultiDrawArrays(GL_POINTS, m_drawFirsts.data(), m_drawCounts.data(), GLsizei(m_drawFirsts.size()));
+
+		glDisableClientState(GL_COLOR_ARRAY);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDisableClientState(GL_VERTEX_ARRAY);
+	}
+
+	if (!m_hoveredPositions.empty())
+	{
+		// 同じ位置に描画済みの点より手前に出るように、深度が等しい場合も通す。
+		glDepthFunc(GL_LEQUAL);
+		glColor4ubv(reinterpret_cast<const GLubyte*>(&m_packedColorHovered));
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, m_hoveredPositions.data());
+		glDrawArrays(GL_POINTS, 0, GLsizei(m_hoveredPositions.size() / 3));
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDepthFunc(GL_LESS);
+	}
+}
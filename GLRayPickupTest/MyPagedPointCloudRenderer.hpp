@@ -0,0 +1,46 @@
+﻿#pragma once
+
+#include "MyPagedPointCloud.hpp"
+
+
+//! @brief  ページングされた点群（MyPagedPointCloud）を描画するクラス。<br>
+//! スロット数ぶんの頂点バッファを確保しておき、新たに常駐したチャンクのスロットの範囲だけをアップロードする。<br>
+//! 描画は常駐しているスロットの範囲を集めて glMultiDrawArrays() 1 回で行なう。読み込み中や空きのスロットは描画しない。<br>
+//! ホバー中の点は、常駐しているチャンクから位置を集めて上から重ね描きする。<br>
+//! OpenGL コンテキストの作成後に使用し、コンテキストの破棄前に Release() を呼ぶこと。<br>
+class MyPagedPointCloudRenderer
+{
+private:
+	GLuint m_positionBuffer;
+	GLuint m_colorBuffer;
+	uint32_t m_slotsNum;
+	uint32_t m_packedColorHovered;
+	std::vector<float> m_scratchPositions;
+	std::vector<GLint> m_drawFirsts;
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<float> m_hoveredPositions;
+	uint32_t m_lastUploadedChunksNum; //!< 直前の Update() でアップロードしたチャンク数。<br>
+
+public:
+	explicit MyPagedPointCloudRenderer(uint32_t packedColorHovered);
+	~MyPagedPointCloudRenderer();
+
+public:
+	//! @brief  バッファ オブジェクトを破棄する。OpenGL コンテキストが有効なうちに呼ぶこと。<br>
+	void Release();
+
+	//! @brief  直前の MyPagedPointCloud::BeginFrame() で常駐したチャンクと、ホバー中の点をバッファに反映する。<br>
+	//! hitPointIndices は MyPagedPointCloud::QueryLineIntersectWithSphere() の結果。<br>
+	void Update(const MyPagedPointCloud& cloud, const std::vector<uint32_t>& hitPointIndices);
+
+	//! @brief  常駐しているチャンクの点を GL_POINTS で描画する。<br>
+	void Draw(const MyPagedPointCloud& cloud);
+
+	uint32_t GetLastUploadedChunksNum() const { return m_lastUploadedChunksNum; }
+
+private:
+	MyPagedPointCloudRenderer(const MyPagedPointCloudRenderer&) = delete;
+	MyPagedPointCloudRenderer& operator=(const MyPagedPointCloudRenderer&) = delete;
+
+	void RecreateBuffers(uint32_t slotsNum);
+};
@@ -0,0 +1,309 @@
+﻿#include "stdafx.h"
+#include "MyPointCache.hpp"
+#include "MyJobSystem.hpp"
+#include "MyCollisionHelper.hpp"
+#include "MyCollisionBatch.hpp"
+#include "MyMortonOrder.hpp"
+
+#include <fstream>
+
+
+namespace
+{
+	const char FileMagic[4] = { 'M', 'Y', 'P', 'C' };
+	// バージョン 2 で元のインデックスの配列を追加した。古いキャッシュは開けないので、元のファイルから作り直される。
+	const uint32_t FileVersion = 2;
+	// 各セクションの先頭を揃える境界。色配列を uint32_t としてそのまま参照できるようにする。
+	const uint64_t SectionAlignment = 64;
+	const float QuantizedMax = 65535.0f;
+
+	uint64_t AlignUp(uint64_t val)
+	{ return (val + SectionAlignment - 1) / SectionAlignment * SectionAlignment; }
+
+	// セクションの先頭が境界に揃っていて、[offset, offset + size) がファイルに収まるか否か。
+	// 壊れたファイルでは offset + size が桁あふれしうるので、加算する前に比べる。
+	bool IsValidSection(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{ return offset % SectionAlignment == 0 && offset <= fileSize && size <= fileSize - offset; }
+
+	float DecodeQuantized(float origin, float scale, uint16_t q)
+	{ return origin + float(q) * scale; }
+}
+
+const char* const MyPointCache::FileExtension = ".mypc";
+
+MyPointCache::MyPointCache()
+	: m_pHeader()
+	, m_pChunks()
+{
+	static_assert(sizeof(FileHeader) == 112, "The cache file header must not contain padding.");
+	static_assert(sizeof(ChunkInfo) == 56, "The cache chunk info must not contain padding.");
+}
+
+bool MyPointCache::WriteFile(const char* pFilePath, const MyPointCloudStore& store, const MyVector3D& offset,
+	uint64_t sourceFileSize, int64_t sourceWriteTime, MyJobSystem& jobSystem, std::string& outErrorMessage)
+{
+	const size_t pointsNum = store.GetPointsNum();
+	if (pointsNum == 0 || pointsNum > size_t(UINT32_MAX))
+	{
+		outErrorMessage = "The number of points is zero or too large.";
+		return false;
+	}
+	const float* pPosX = store.GetPositionsX();
+	const float* pPosY = store.GetPositionsY();
+	const float* pPosZ = store.GetPositionsZ();
+
+	// 点群全体の AABB で Morton コードを求めて並べ替え、連続する ChunkPointsNum 点を 1 チャンクとする。
+	// Morton 順で連続する点は空間的にまとまっているので、チャンクの AABB が小さくなり、量子化の精度も上がる。
+	std::vector<uint32_t> order;
+	MyMortonOrder::SortByMortonCodeParallel(jobSystem, pPosX, pPosY, pPosZ, pointsNum, order);
+
+	const uint32_t chunksNum = uint32_t((pointsNum + ChunkPointsNum - 1) / ChunkPointsNum);
+	std::vector<ChunkInfo> chunks(chunksNum);
+	std::vector<uint16_t> quantizedPositions(pointsNum * 3);
+	std::vector<uint32_t> colors(pointsNum);
+	std::vector<uint32_t> originalIndices(pointsNum);
+	jobSystem.ParallelFor(chunksNum, 1, [&](size_t beginIndex, size_t endIndex)
+	{
+		for (size_t c = beginIndex; c < endIndex; ++c)
+		{
+			ChunkInfo& chunk = chunks[c];
+			chunk.FirstPoint = uint32_t(c * ChunkPointsNum);
+			chunk.PointsNum = uint32_t(std::min<size_t>(ChunkPointsNum, pointsNum - chunk.FirstPoint));
+			const uint32_t* pOrder = &order[chunk.FirstPoint];
+			const float* const pSourceAxes[3] = { pPosX, pPosY, pPosZ };
+			// チャンクのデコード結果の格納位置は、X, Y, Z の各配列が連続する。
+			uint16_t* pQuantized = &quantizedPositions[size_t(chunk.FirstPoint) * 3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float* pSource = pSourceAxes[axis];
+				float axisMin = +std::numeric_limits<float>::infinity();
+				float axisMax = -std::numeric_limits<float>::infinity();
+				for (uint32_t k = 0; k < chunk.PointsNum; ++k)
+				{
+					const float val = pSource[pOrder[k]];
+					axisMin = std::min(axisMin, val);
+					axisMax = std::max(axisMax, val);
+				}
+				const float axisExtent = axisMax - axisMin;
+				chunk.Origin[axis] = axisMin;
+				chunk.Scale[axis] = axisExtent / QuantizedMax;
+				const float invScale = (axisExtent > 0) ? QuantizedMax / axisExtent : 0.0f;
+				uint16_t* pAxisQuantized = pQuantized + axis * chunk.PointsNum;
+				// AABB はデコード後の値で求めておく（量子化誤差で元の AABB からはみ出す可能性があるため）。
+				chunk.BoundsMin[axis] = +std::numeric_limits<float>::infinity();
+				chunk.BoundsMax[axis] = -std::numeric_limits<float>::infinity();
+				for (uint32_t k = 0; k < chunk.PointsNum; ++k)
+				{
+					const float normalized = (pSource[pOrder[k]] - axisMin) * invScale;
+					const uint16_t q = uint16_t(std::min(std::max(normalized + 0.5f, 0.0f), QuantizedMax));
+					pAxisQuantized[k] = q;
+					const float decoded = DecodeQuantized(chunk.Origin[axis], chunk.Scale[axis], q);
+					chunk.BoundsMin[axis] = std::min(chunk.BoundsMin[axis], decoded);
+					chunk.BoundsMax[axis] = std::max(chunk.BoundsMax[axis], decoded);
+				}
+			}
+			for (uint32_t k = 0; k < chunk.PointsNum; ++k)
+			{
+				colors[chunk.FirstPoint + k] = store.GetPackedColor(pOrder[k]);
+				// 点群がすでに並べ替えられている場合も、読み込み・生成時のインデックスを格納する。
+				originalIndices[chunk.FirstPoint + k] = store.GetOriginalIndex(pOrder[k]);
+			}
+		}
+	});
+
+	FileHeader header = {};
+	memcpy(header.Magic, FileMagic, sizeof(FileMagic));
+	header.Version = FileVersion;
+	header.PointsNum = pointsNum;
+	header.ChunksNum = chunksNum;
+	header.ChunkPointsNum = ChunkPointsNum;
+	header.Offset[0] = offset.x;
+	header.Offset[1] = offset.y;
+	header.Offset[2] = offset.z;
+	header.SourceFileSize = sourceFileSize;
+	header.SourceWriteTime = sourceWriteTime;
+	header.ChunkTableOffset = AlignUp(sizeof(FileHeader));
+	header.PositionsOffset = AlignUp(header.ChunkTableOffset + sizeof(ChunkInfo) * chunksNum);
+	header.ColorsOffset = AlignUp(header.PositionsOffset + sizeof(uint16_t) * quantizedPositions.size());
+	header.OriginalIndicesOffset = AlignUp(header.ColorsOffset + sizeof(uint32_t) * colors.size());
+
+	std::ofstream stream(pFilePath, std::ios::binary | std::ios::trunc);
+	if (!stream)
+	{
+		outErrorMessage = std::string("Failed to create the cache file: ") + pFilePath;
+		return false;
+	}
+	const auto writeAt = [&](uint64_t fileOffset, const void* pData, size_t size)
+	{
+		// 境界揃えのための隙間は 0 で埋める。
+		static const char zeros[SectionAlignment] = {};
+		const uint64_t currentOffset = uint64_t(stream.tellp());
+		assert(currentOffset <= fileOffset && fileOffset - currentOffset < SectionAlignment);
+		stream.write(zeros, std::streamsize(fileOffset - currentOffset));
+		stream.write(static_cast<const char*>(pData), std::streamsize(size));
+	};
+	writeAt(0, &header, sizeof(header));
+	writeAt(header.ChunkTableOffset, chunks.data(), sizeof(ChunkInfo) * chunks.size());
+	writeAt(header.PositionsOffset, quantizedPositions.data(), sizeof(uint16_t) * quantizedPositions.size());
+	writeAt(header.ColorsOffset, colors.data(), sizeof(uint32_t) * colors.size());
+	writeAt(header.OriginalIndicesOffset, originalIndices.data(), sizeof(uint32_t) * originalIndices.size());
+	stream.close();
+	if (!stream)
+	{
+		outErrorMessage = std::string("Failed to write the cache file: ") + pFilePath;
+		return false;
+	}
+	return true;
+}
+
+bool MyPointCache::Open(const char* pFilePath)
+{
+	this->Close();
+	if (!m_file.Open(pFilePath) || m_file.GetSize() < sizeof(FileHeader))
+	{
+		this->Close();
+		return false;
+	}
+	const uint8_t* pData = m_file.GetData();
+	const uint64_t fileSize = m_file.GetSize();
+	const FileHeader* pHeader = reinterpret_cast<const FileHeader*>(pData);
+	const uint64_t pointsNum = pHeader->PointsNum;
+	// 点数の上限を先に確かめるので、以降のセクションの大きさの計算は桁あふれしない。
+	// 各セクションがファイルに収まることを確かめてから、セクションどうしが重ならないことを確かめる。
+	const uint64_t chunkTableSize = sizeof(ChunkInfo) * uint64_t(pHeader->ChunksNum);
+	const uint64_t positionsSize = sizeof(uint16_t) * 3 * pointsNum;
+	const uint64_t colorsSize = sizeof(uint32_t) * pointsNum;
+	const uint64_t originalIndicesSize = sizeof(uint32_t) * pointsNum;
+	const bool isValid =
+		memcmp(pHeader->Magic, FileMagic, sizeof(FileMagic)) == 0 &&
+		pHeader->Version == FileVersion &&
+		pHeader->ChunkPointsNum == ChunkPointsNum &&
+		pointsNum > 0 && pointsNum <= UINT32_MAX &&
+		pHeader->ChunksNum == (pointsNum + ChunkPointsNum - 1) / ChunkPointsNum &&
+		IsValidSection(pHeader->ChunkTableOffset, chunkTableSize, fileSize) &&
+		IsValidSection(pHeader->PositionsOffset, positionsSize, fileSize) &&
+		IsValidSection(pHeader->ColorsOffset, colorsSize, fileSize) &&
+		IsValidSection(pHeader->OriginalIndicesOffset, originalIndicesSize, fileSize) &&
+		sizeof(FileHeader) <= pHeader->ChunkTableOffset &&
+		pHeader->ChunkTableOffset + chunkTableSize <= pHeader->PositionsOffset &&
+		pHeader->PositionsOffset + positionsSize <= pHeader->ColorsOffset &&
+		pHeader->ColorsOffset + colorsSize <= pHeader->OriginalIndicesOffset;
+	if (!isValid)
+	{
+		this->Close();
+		return false;
+	}
+
+	// チャンクの点の範囲は WriteFile() の分け方と一致しなければならない。
+	// 一致しないと、位置座標のデコードや色のコピーがセクションや呼び出し側の領域（ChunkPointsNum 点ぶん）をはみ出す。
+	const ChunkInfo* pChunks = reinterpret_cast<const ChunkInfo*>(pData + pHeader->ChunkTableOffset);
+	for (uint32_t c = 0; c < pHeader->ChunksNum; ++c)
+	{
+		const uint64_t firstPoint = uint64_t(c) * ChunkPointsNum;
+		if (pChunks[c].FirstPoint != firstPoint || pChunks[c].PointsNum != std::min<uint64_t>(ChunkPointsNum, pointsNum - firstPoint))
+		{
+			this->Close();
+			return false;
+		}
+	}
+	m_pHeader = pHeader;
+	m_pChunks = pChunks;
+	return true;
+}
+
+void MyPointCache::Close()
+{
+	m_file.Close();
+	m_pHeader = nullptr;
+	m_pChunks = nullptr;
+}
+
+bool MyPointCache::IsCreatedFrom(uint64_t sourceFileSize, int64_t sourceWriteTime) const
+{
+	return m_pHeader->SourceFileSize == sourceFileSize && m_pHeader->SourceWriteTime == sourceWriteTime;
+}
+
+const uint32_t* MyPointCache::GetPackedColors() const
+{
+	return reinterpret_cast<const uint32_t*>(m_file.GetData() + m_pHeader->ColorsOffset);
+}
+
+const uint32_t* MyPointCache::GetOriginalIndices() const
+{
+	return reinterpret_cast<const uint32_t*>(m_file.GetData() + m_pHeader->OriginalIndicesOffset);
+}
+
+void MyPointCache::DecodeChunkPositions(uint32_t chunkIndex, float* pOutX, float* pOutY, float* pOutZ) const
+{
+	const ChunkInfo& chunk = m_pChunks[chunkIndex];
+	const uint16_t* pQuantized = reinterpret_cast<const uint16_t*>(m_file.GetData() + m_pHeader->PositionsOffset) + size_t(chunk.FirstPoint) * 3;
+	float* const pOutAxes[3] = { pOutX, pOutY, pOutZ };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const uint16_t* pAxisQuantized = pQuantized + axis * chunk.PointsNum;
+		float* pOut = pOutAxes[axis];
+		const float origin = chunk.Origin[axis];
+		const float scale = chunk.Scale[axis];
+		for (uint32_t k = 0; k < chunk.PointsNum; ++k)
+		{
+			pOut[k] = DecodeQuantized(origin, scale, pAxisQuantized[k]);
+		}
+	}
+}
+
+void MyPointCache::DecodeToStore(MyPointCloudStore& store, MyJobSystem& jobSystem) const
+{
+	const size_t pointsNum = this->GetPointsNum();
+	store.Resize(pointsNum);
+	float* pPosX = store.GetPositionsX();
+	float* pPosY = store.GetPositionsY();
+	float* pPosZ = store.GetPositionsZ();
+	const uint32_t* pColors = this->GetPackedColors();
+	uint32_t* pOutColors = store.GetPackedColors();
+	const uint32_t* pOriginalIndices = this->GetOriginalIndices();
+	std::vector<uint32_t> originalIndices(pointsNum);
+	jobSystem.ParallelFor(this->GetChunksNum(), 16, [&](size_t beginIndex, size_t endIndex)
+	{
+		for (size_t c = beginIndex; c < endIndex; ++c)
+		{
+			const ChunkInfo& chunk = m_pChunks[c];
+			this->DecodeChunkPositions(uint32_t(c), pPosX + chunk.FirstPoint, pPosY + chunk.FirstPoint, pPosZ + chunk.FirstPoint);
+			memcpy(pOutColors + chunk.FirstPoint, pColors + chunk.FirstPoint, sizeof(uint32_t) * chunk.PointsNum);
+			memcpy(&originalIndices[chunk.FirstPoint], pOriginalIndices + chunk.FirstPoint, sizeof(uint32_t) * chunk.PointsNum);
+		}
+	});
+	store.SetOriginalIndices(std::move(originalIndices));
+	store.ClearSelection();
+	store.NotifyPositionsModified();
+	store.NotifyColorsModified();
+}
+
+void MyPointCache::QueryLineIntersectWithSphere(const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius,
+	std::vector<uint32_t>& outIndices) const
+{
+	outIndices.clear();
+	// 八分木と同様に、チャンクの AABB を交差マージン分だけ（わずかに余裕を持たせて）膨らませて判定する。
+	const float margin = sphereRadius * 1.001f;
+	const MyVector3F vMargin(margin, margin, margin);
+	const MyCollision::LineSphereBatchQuery query(linePos1, linePos2, sphereRadius);
+	m_scratchX.resize(ChunkPointsNum);
+	m_scratchY.resize(ChunkPointsNum);
+	m_scratchZ.resize(ChunkPointsNum);
+	for (uint32_t c = 0; c < this->GetChunksNum(); ++c)
+	{
+		const ChunkInfo& chunk = m_pChunks[c];
+		const MyVector3F boundsMin(chunk.BoundsMin[0], chunk.BoundsMin[1], chunk.BoundsMin[2]);
+		const MyVector3F boundsMax(chunk.BoundsMax[0], chunk.BoundsMax[1], chunk.BoundsMax[2]);
+		if (!MyCollision::CheckLineIntersectWithAABB(linePos1, linePos2, boundsMin - vMargin, boundsMax + vMargin))
+		{
+			continue;
+		}
+		this->DecodeChunkPositions(c, m_scratchX.data(), m_scratchY.data(), m_scratchZ.data());
+		m_scratchIndices.clear();
+		MyCollision::CheckLineIntersectWithSphereBatch(query, m_scratchX.data(), m_scratchY.data(), m_scratchZ.data(), 0, chunk.PointsNum, m_scratchIndices);
+		for (auto index : m_scratchIndices)
+		{
+			outIndices.push_back(chunk.FirstPoint + index);
+		}
+	}
+}
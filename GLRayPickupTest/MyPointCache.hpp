@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+#include "MyMappedFile.hpp"
+
+class MyJobSystem;
+
+
+//! @brief  量子化した点群のキャッシュ ファイル。一度読み込んだ点群を、次回以降はパースなしで即座に読み込むために使う。<br>
+//! 点群を空間的にまとまったチャンク（Morton 順で ChunkPointsNum 点ずつ）に分け、チャンクごとに原点とスケールを持たせて、<br>
+//! 位置座標を各軸 16 ビットに量子化して格納する。色は RGBA8 のまま格納する。1 点あたり 14 バイト強。<br>
+//! ファイルはメモリ マップして使い、位置座標はチャンク単位で必要になったときにデコードする。<br>
+//! チャンクの AABB を先頭のテーブルに持つので、交差判定ではレイが通るチャンクだけをデコードすればよい。<br>
+//! 点の順序は元の点群とは異なる（Morton 順に並べ替えられる）。元の点群での各点のインデックスも 1 点あたり 4 バイトで格納し、<br>
+//! DecodeToStore() で MyPointCloudStore::GetOriginalIndex() として復元する。<br>
+class MyPointCache
+{
+public:
+	static const uint32_t ChunkPointsNum = 4096;
+	static const char* const FileExtension; //!< 元のファイル名に付加する拡張子。<br>
+
+	//! @brief  チャンクの情報。位置座標は Origin + q * Scale（q は 0～65535 の量子化値）。<br>
+	//! Bounds はデコード後の位置座標の AABB。<br>
+	struct ChunkInfo
+	{
+		float Origin[3];
+		float Scale[3];
+		float BoundsMin[3];
+		float BoundsMax[3];
+		uint32_t FirstPoint;
+		uint32_t PointsNum;
+	};
+
+private:
+	struct FileHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+		uint64_t PointsNum;
+		uint32_t ChunksNum;
+		uint32_t ChunkPointsNum;
+		double Offset[3]; //!< 元の座標 = 格納された位置座標 + Offset。<br>
+		uint64_t SourceFileSize;
+		int64_t SourceWriteTime;
+		uint64_t ChunkTableOffset;
+		uint64_t PositionsOffset; //!< チャンクごとに X, Y, Z の順で uint16_t の配列が並ぶ。<br>
+		uint64_t ColorsOffset; //!< 全点の RGBA8 の配列。<br>
+		uint64_t OriginalIndicesOffset; //!< 全点の、キャッシュの作成元の点群でのインデックス（uint32_t）の配列。<br>
+		uint64_t Reserved[2];
+	};
+
+private:
+	MyMappedFile m_file;
+	const FileHeader* m_pHeader;
+	const ChunkInfo* m_pChunks;
+	mutable std::vector<float> m_scratchX, m_scratchY, m_scratchZ;
+	mutable std::vector<uint32_t> m_scratchIndices;
+
+public:
+	MyPointCache();
+
+public:
+	//! @brief  点群をキャッシュ ファイルに書き出す。offset は点群の位置座標に加えると元の座標になる値。<br>
+	//! sourceFileSize, sourceWriteTime は元のファイルのスタンプで、IsCreatedFrom() での照合に使う。<br>
+	static bool WriteFile(const char* pFilePath, const MyPointCloudStore& store, const MyVector3D& offset,
+		uint64_t sourceFileSize, int64_t sourceWriteTime, MyJobSystem& jobSystem, std::string& outErrorMessage);
+
+	//! @brief  キャッシュ ファイルをマップする。形式が正しくない場合は false を返す。<br>
+	bool Open(const char* pFilePath);
+	void Close();
+	bool IsOpen() const { return m_pHeader != nullptr; }
+
+	//! @brief  指定されたスタンプの元ファイルから作成されたキャッシュか否か。<br>
+	bool IsCreatedFrom(uint64_t sourceFileSize, int64_t sourceWriteTime) const;
+
+	size_t GetPointsNum() const { return size_t(m_pHeader->PointsNum); }
+	uint32_t GetChunksNum() const { return m_pHeader->ChunksNum; }
+	const ChunkInfo& GetChunk(uint32_t chunkIndex) const { return m_pChunks[chunkIndex]; }
+	MyVector3D GetOffset() const { return MyVector3D(m_pHeader->Offset[0], m_pHeader->Offset[1], m_pHeader->Offset[2]); }
+	uint64_t GetFileSize() const { return m_file.GetSize(); }
+
+	//! @brief  マップされた RGBA8 の色配列。MyPointCloudStore::GetPackedColors() と同じ形式。<br>
+	const uint32_t* GetPackedColors() const;
+
+	//! @brief  マップされた、各点の元の点群でのインデックスの配列。<br>
+	const uint32_t* GetOriginalIndices() const;
+
+	//! @brief  1 チャンクぶんの位置座標をデコードする。出力先には GetChunk(chunkIndex).PointsNum 点ぶんの領域が必要。<br>
+	void DecodeChunkPositions(uint32_t chunkIndex, float* pOutX, float* pOutY, float* pOutZ) const;
+
+	//! @brief  全点をデコードして store を置き換える。選択状態はクリアされる。元のインデックスの表も設定する。<br>
+	void DecodeToStore(MyPointCloudStore& store, MyJobSystem& jobSystem) const;
+
+	//! @brief  直線と点群の各点（同一半径の球）の交差判定を、直線が通るチャンクだけをデコードして行なう。<br>
+	//! outIndices はクリアされる。DecodeToStore() した点群のインデックスと一致する。作業領域を共有するので、同時に複数のスレッドから呼ばないこと。<br>
+	void QueryLineIntersectWithSphere(const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius,
+		std::vector<uint32_t>& outIndices) const;
+
+private:
+	MyPointCache(const MyPointCache&) = delete;
+	MyPointCache& operator=(const MyPointCache&) = delete;
+};
@@ -0,0 +1,774 @@
+﻿#include "stdafx.h"
+#include "MyPointCloudLoader.hpp"
+#include "MyMappedFile.hpp"
+#include "MyJobSystem.hpp"
+
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// ASCII の並列デコードで 1 ジョブが受け持つバイト数の目安。
+	const size_t AsciiChunkBytes = 4 * 1024 * 1024;
+	// バイナリの並列デコードで 1 ジョブが受け持つ点数。
+	const size_t BinaryChunkPointsNum = 64 * 1024;
+
+	double GetSecondsSince(const Clock::time_point& startTime)
+	{ return std::chrono::duration<double>(Clock::now() - startTime).count(); }
+
+	// アラインメントされていない位置からリトル エンディアンの値を読む。
+	template<typename T> T ReadUnaligned(const uint8_t* pData)
+	{
+		T val;
+		memcpy(&val, pData, sizeof(T));
+		return val;
+	}
+
+	uint32_t PackColorFromBytes(uint32_t r, uint32_t g, uint32_t b)
+	{ return r | (g << 8) | (b << 16) | (0xFFu << 24); }
+
+	// チャンクごとに求めた AABB。最後にまとめて全体の AABB にする。
+	struct ChunkBounds
+	{
+		MyVector3F Min, Max;
+		ChunkBounds()
+			: Min(+std::numeric_limits<float>::infinity())
+			, Max(-std::numeric_limits<float>::infinity())
+		{}
+		void Add(float x, float y, float z)
+		{
+			Min.x = std::min(Min.x, x); Min.y = std::min(Min.y, y); Min.z = std::min(Min.z, z);
+			Max.x = std::max(Max.x, x); Max.y = std::max(Max.y, y); Max.z = std::max(Max.z, z);
+		}
+	};
+
+
+#pragma region // ASCII XYZ //
+
+	bool IsAsciiSeparator(char c)
+	{ return c == ' ' || c == '\t' || c == ',' || c == ';'; }
+
+	bool IsAsciiLineEnd(char c)
+	{ return c == '\n' || c == '\r'; }
+
+	bool IsAsciiNumberStart(char c)
+	{ return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.'; }
+
+	// 10 進の実数を読む。strtod() はロケールに依存するうえ、終端を指定できないので使わない。
+	// 有効数字は 19 桁までを整数として蓄積し、最後に 10 のべき乗を掛ける。単精度で格納するには十分な精度がある。
+	bool ParseAsciiDouble(const char*& p, const char* pEnd, double& outVal)
+	{
+		static const double Pow10Table[] =
+		{
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+			1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+		};
+		const char* pCur = p;
+		bool isNegative = false;
+		if (pCur < pEnd && (*pCur == '-' || *pCur == '+'))
+		{
+			isNegative = (*pCur == '-');
+			++pCur;
+		}
+		uint64_t mantissa = 0;
+		int digitsNum = 0;
+		int exponent = 0;
+		bool hasDigits = false;
+		for (; pCur < pEnd && *pCur >= '0' && *pCur <= '9'; ++pCur)
+		{
+			hasDigits = true;
+			if (digitsNum < 19)
+			{
+				mantissa = mantissa * 10 + uint64_t(*pCur - '0');
+				digitsNum += (mantissa != 0);
+			}
+			else
+			{
+				++exponent;
+			}
+		}
+		if (pCur < pEnd && *pCur == '.')
+		{
+			for (++pCur; pCur < pEnd && *pCur >= '0' && *pCur <= '9'; ++pCur)
+			{
+				hasDigits = true;
+				if (digitsNum < 19)
+				{
+					mantissa = mantissa * 10 + uint64_t(*pCur - '0');
+					digitsNum += (mantissa != 0);
+					--exponent;
+				}
+			}
+		}
+		if (!hasDigits)
+		{
+			return false;
+		}
+		if (pCur < pEnd && (*pCur == 'e' || *pCur == 'E'))
+		{
+			const char* pExp = pCur + 1;
+			bool isExpNegative = false;
+			if (pExp < pEnd && (*pExp == '-' || *pExp == '+'))
+			{
+				isExpNegative = (*pExp == '-');
+				++pExp;
+			}
+			if (pExp < pEnd && *pExp >= '0' && *pExp <= '9')
+			{
+				int expVal = 0;
+				for (; pExp < pEnd && *pExp >= '0' && *pExp <= '9'; ++pExp)
+				{
+					expVal = std::min(expVal * 10 + (*pExp - '0'), 9999);
+				}
+				exponent += isExpNegative ? -expVal : expVal;
+				pCur = pExp;
+			}
+		}
+		double val = double(mantissa);
+		if (exponent < 0)
+		{
+			val = (-exponent <= 22) ? val / Pow10Table[-exponent] : val * std::pow(10.0, exponent);
+		}
+		else if (exponent > 0)
+		{
+			val = (exponent <= 22) ? val * Pow10Table[exponent] : val * std::pow(10.0, exponent);
+		}
+		outVal = isNegative ? -val : val;
+		p = pCur;
+		return true;
+	}
+
+	// 1 行ぶんの数値を最大 maxValuesNum 個読み、読めた個数を返す。p は次の行の先頭に進める。
+	int ParseAsciiLine(const char*& p, const char* pEnd, double outValues[], int maxValuesNum)
+	{
+		int valuesNum = 0;
+		while (p < pEnd && !IsAsciiLineEnd(*p))
+		{
+			if (IsAsciiSeparator(*p))
+			{
+				++p;
+				continue;
+			}
+			double val = 0;
+			if (valuesNum < maxValuesNum && ParseAsciiDouble(p, pEnd, val))
+			{
+				outValues[valuesNum++] = val;
+			}
+			else
+			{
+				// 数値でない列や余分な列は読み飛ばす。
+				while (p < pEnd && !IsAsciiSeparator(*p) && !IsAsciiLineEnd(*p))
+				{
+					++p;
+				}
+			}
+		}
+		while (p < pEnd && IsAsciiLineEnd(*p))
+		{
+			++p;
+		}
+		return valuesNum;
+	}
+
+	// 点を表す行（先頭の空白を除いた最初の文字が数値の開始文字の行）か否かを判定し、p を次の行の先頭に進める。
+	// ヘッダーやコメントの行は点として数えない。計数とデコードで同じ判定を使うこと。
+	bool SkipAsciiLine(const char*& p, const char* pEnd)
+	{
+		while (p < pEnd && IsAsciiSeparator(*p))
+		{
+			++p;
+		}
+		const bool isPointLine = (p < pEnd && IsAsciiNumberStart(*p));
+		while (p < pEnd && !IsAsciiLineEnd(*p))
+		{
+			++p;
+		}
+		while (p < pEnd && IsAsciiLineEnd(*p))
+		{
+			++p;
+		}
+		return isPointLine;
+	}
+
+	bool IsAsciiPointLineStart(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && IsAsciiSeparator(*p))
+		{
+			++p;
+		}
+		return p < pEnd && IsAsciiNumberStart(*p);
+	}
+
+	bool LoadAsciiXyz(const uint8_t* pData, uint64_t dataSize, uint32_t defaultPackedColor, MyJobSystem& jobSystem,
+		MyPointCloudStore& outStore, MyPointCloudLoader::LoadResult& outResult, std::vector<ChunkBounds>& outBounds, std::string& outErrorMessage)
+	{
+		const char* pText = reinterpret_cast<const char*>(pData);
+		const char* pTextEnd = pText + dataSize;
+
+		// チャンクの境界を行頭にそろえる。境界の調整は高々 1 行ぶんの走査で済む。
+		const size_t chunksNum = size_t((dataSize + AsciiChunkBytes - 1) / AsciiChunkBytes);
+		std::vector<const char*> chunkBegins(chunksNum + 1, pTextEnd);
+		chunkBegins[0] = pText;
+		for (size_t c = 1; c < chunksNum; ++c)
+		{
+			const char* p = std::max(pText + c * AsciiChunkBytes, chunkBegins[c - 1]);
+			while (p < pTextEnd && !IsAsciiLineEnd(p[-1]))
+			{
+				++p;
+			}
+			chunkBegins[c] = p;
+		}
+
+		// 1 パス目：チャンクごとに点の行数を数える。
+		std::vector<size_t> chunkPointOffsets(chunksNum + 1, 0);
+		jobSystem.ParallelFor(chunksNum, 1, [&](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t c = beginIndex; c < endIndex; ++c)
+			{
+				size_t linesNum = 0;
+				for (const char* p = chunkBegins[c]; p < chunkBegins[c + 1];)
+				{
+					linesNum += SkipAsciiLine(p, chunkBegins[c + 1]);
+				}
+				chunkPointOffsets[c + 1] = linesNum;
+			}
+		});
+		for (size_t c = 0; c < chunksNum; ++c)
+		{
+			chunkPointOffsets[c + 1] += chunkPointOffsets[c];
+		}
+		const size_t pointsNum = chunkPointOffsets[chunksNum];
+		if (pointsNum == 0 || pointsNum > size_t(UINT32_MAX))
+		{
+			outErrorMessage = "The number of point lines is zero or too large: " + std::to_string(pointsNum);
+			return false;
+		}
+
+		// 最初の点の行で、列数（色の有無）と、精度を保つための原点を決める。
+		const char* pFirstLine = pText;
+		while (!IsAsciiPointLineStart(pFirstLine, pTextEnd))
+		{
+			SkipAsciiLine(pFirstLine, pTextEnd);
+		}
+		double firstValues[6] = {};
+		const int firstValuesNum = ParseAsciiLine(pFirstLine, pTextEnd, firstValues, 6);
+		if (firstValuesNum < 3)
+		{
+			outErrorMessage = "The first point line has fewer than 3 values.";
+			return false;
+		}
+		outResult.HasColors = (firstValuesNum >= 6);
+		outResult.Offset = MyVector3D(firstValues[0], firstValues[1], firstValues[2]);
+
+		outStore.Resize(pointsNum);
+		float* pPosX = outStore.GetPositionsX();
+		float* pPosY = outStore.GetPositionsY();
+		float* pPosZ = outStore.GetPositionsZ();
+		uint32_t* pColors = outStore.GetPackedColors();
+		const MyVector3D origin = outResult.Offset;
+
+		// 2 パス目：チャンクごとに、1 パス目で求めた書き込み位置から位置と色をデコードする。
+		outBounds.assign(chunksNum, ChunkBounds());
+		std::atomic<size_t> malformedPointIndex(SIZE_MAX);
+		jobSystem.ParallelFor(chunksNum, 1, [&](size_t beginIndex, size_t endIndex)
+		{
+			for (size_t c = beginIndex; c < endIndex; ++c)
+			{
+				ChunkBounds& bounds = outBounds[c];
+				size_t pointIndex = chunkPointOffsets[c];
+				const char* pChunkEnd = chunkBegins[c + 1];
+				for (const char* p = chunkBegins[c]; p < pChunkEnd;)
+				{
+					if (!IsAsciiPointLineStart(p, pChunkEnd))
+					{
+						SkipAsciiLine(p, pChunkEnd);
+						continue;
+					}
+					double values[6];
+					const int valuesNum = ParseAsciiLine(p, pChunkEnd, values, 6);
+					if (valuesNum < 3)
+					{
+						size_t expected = SIZE_MAX;
+						malformedPointIndex.compare_exchange_strong(expected, pointIndex);
+						values[0] = values[1] = values[2] = 0;
+					}
+					const float x = float(values[0] - origin.x);
+					const float y = float(values[1] - origin.y);
+					const float z = float(values[2] - origin.z);
+					pPosX[pointIndex] = x;
+					pPosY[pointIndex] = y;
+					pPosZ[pointIndex] = z;
+					bounds.Add(x, y, z);
+					pColors[pointIndex] = (valuesNum >= 6) ?
+						PackColorFromBytes(
+							uint32_t(std::min(std::max(values[3], 0.0), 255.0)),
+							uint32_t(std::min(std::max(values[4], 0.0), 255.0)),
+							uint32_t(std::min(std::max(values[5], 0.0), 255.0))) :
+						defaultPackedColor;
+					++pointIndex;
+				}
+				assert(pointIndex == chunkPointOffsets[c + 1]);
+			}
+		});
+		if (malformedPointIndex != SIZE_MAX)
+		{
+			outErrorMessage = "Point #" + std::to_string(malformedPointIndex.load()) + " has fewer than 3 values.";
+			return false;
+		}
+		return true;
+	}
+
+#pragma endregion
+
+
+#pragma region // Binary PLY //
+
+	// PLY のスカラー プロパティの型。
+	enum PlyScalarType
+	{
+		PlyScalarType_Unknown,
+		PlyScalarType_Int8,
+		PlyScalarType_UInt8,
+		PlyScalarType_Int16,
+		PlyScalarType_UInt16,
+		PlyScalarType_Int32,
+		PlyScalarType_UInt32,
+		PlyScalarType_Float32,
+		PlyScalarType_Float64,
+	};
+
+	PlyScalarType GetPlyScalarType(const std::string& typeName)
+	{
+		if (typeName == "char" || typeName == "int8") { return PlyScalarType_Int8; }
+		if (typeName == "uchar" || typeName == "uint8") { return PlyScalarType_UInt8; }
+		if (typeName == "short" || typeName == "int16") { return PlyScalarType_Int16; }
+		if (typeName == "ushort" || typeName == "uint16") { return PlyScalarType_UInt16; }
+		if (typeName == "int" || typeName == "int32") { return PlyScalarType_Int32; }
+		if (typeName == "uint" || typeName == "uint32") { return PlyScalarType_UInt32; }
+		if (typeName == "float" || typeName == "float32") { return PlyScalarType_Float32; }
+		if (typeName == "double" || typeName == "float64") { return PlyScalarType_Float64; }
+		return PlyScalarType_Unknown;
+	}
+
+	// PLY のプロパティ型のバイト数。未知の型は 0。
+	size_t GetPlyScalarTypeSize(PlyScalarType type)
+	{
+		switch (type)
+		{
+		case PlyScalarType_Int8:
+		case PlyScalarType_UInt8:
+			return 1;
+		case PlyScalarType_Int16:
+		case PlyScalarType_UInt16:
+			return 2;
+		case PlyScalarType_Int32:
+		case PlyScalarType_UInt32:
+		case PlyScalarType_Float32:
+			return 4;
+		case PlyScalarType_Float64:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	// 任意のスカラー型の値を倍精度に変換して読む。整数型の座標は、そのままの値を座標とみなす。
+	double ReadPlyScalar(const uint8_t* pData, PlyScalarType type)
+	{
+		switch (type)
+		{
+		case PlyScalarType_Int8: return double(ReadUnaligned<int8_t>(pData));
+		case PlyScalarType_UInt8: return double(ReadUnaligned<uint8_t>(pData));
+		case PlyScalarType_Int16: return double(ReadUnaligned<int16_t>(pData));
+		case PlyScalarType_UInt16: return double(ReadUnaligned<uint16_t>(pData));
+		case PlyScalarType_Int32: return double(ReadUnaligned<int32_t>(pData));
+		case PlyScalarType_UInt32: return double(ReadUnaligned<uint32_t>(pData));
+		case PlyScalarType_Float32: return double(ReadUnaligned<float>(pData));
+		case PlyScalarType_Float64: return ReadUnaligned<double>(pData);
+		default: assert(false); return 0;
+		}
+	}
+
+	struct PlyElement
+	{
+		std::string Name;
+		uint64_t Count;
+		size_t Stride; //!< 1 要素のバイト数。<br>
+		bool IsVariableLength; //!< リスト プロパティを含むか否か。含む場合 Stride は意味を持たない。<br>
+		// 頂点要素のプロパティのオフセット。存在しない場合は SIZE_MAX。
+		size_t OffsetX, OffsetY, OffsetZ, OffsetR, OffsetG, OffsetB;
+		// 位置座標の軸ごとの型。軸ごとに異なっていてもよい。
+		PlyScalarType TypeX, TypeY, TypeZ;
+		PlyElement()
+			: Count(), Stride(), IsVariableLength()
+			, OffsetX(SIZE_MAX), OffsetY(SIZE_MAX), OffsetZ(SIZE_MAX), OffsetR(SIZE_MAX), OffsetG(SIZE_MAX), OffsetB(SIZE_MAX)
+			, TypeX(), TypeY(), TypeZ()
+		{}
+	};
+
+	bool LoadBinaryPly(const uint8_t* pData, uint64_t dataSize, uint32_t defaultPackedColor, MyJobSystem& jobSystem,
+		MyPointCloudStore& outStore, MyPointCloudLoader::LoadResult& outResult, std::vector<ChunkBounds>& outBounds, std::string& outErrorMessage)
+	{
+		// ヘッダーは "end_header" の行までのテキスト。巨大なファイル全体を走査しないよう、先頭の一定範囲だけ調べる。
+		const size_t maxHeaderBytes = size_t(std::min<uint64_t>(dataSize, 64 * 1024));
+		const std::string headerText(reinterpret_cast<const char*>(pData), maxHeaderBytes);
+		const char* const endHeaderMark = "end_header";
+		const size_t endHeaderPos = headerText.find(endHeaderMark);
+		const size_t endHeaderLineEnd = (endHeaderPos != std::string::npos) ? headerText.find('\n', endHeaderPos) : std::string::npos;
+		if (endHeaderLineEnd == std::string::npos)
+		{
+			outErrorMessage = "The PLY header is not terminated by end_header.";
+			return false;
+		}
+		const size_t bodyOffset = endHeaderLineEnd + 1;
+
+		std::vector<PlyElement> elements;
+		bool isBinaryLittleEndian = false;
+		size_t lineBegin = 0;
+		while (lineBegin < endHeaderPos)
+		{
+			size_t lineEnd = headerText.find('\n', lineBegin);
+			std::string line = headerText.substr(lineBegin, lineEnd - lineBegin);
+			lineBegin = lineEnd + 1;
+			if (!line.empty() && line.back() == '\r')
+			{
+				line.pop_back();
+			}
+			std::vector<std::string> tokens;
+			for (size_t pos = 0; pos < line.size();)
+			{
+				const size_t tokenBegin = line.find_first_not_of(" \t", pos);
+				if (tokenBegin == std::string::npos)
+				{
+					break;
+				}
+				const size_t tokenEnd = std::min(line.find_first_of(" \t", tokenBegin), line.size());
+				tokens.push_back(line.substr(tokenBegin, tokenEnd - tokenBegin));
+				pos = tokenEnd;
+			}
+			if (tokens.empty())
+			{
+				continue;
+			}
+			if (tokens[0] == "format" && tokens.size() >= 2)
+			{
+				isBinaryLittleEndian = (tokens[1] == "binary_little_endian");
+			}
+			else if (tokens[0] == "element" && tokens.size() >= 3)
+			{
+				PlyElement element;
+				element.Name = tokens[1];
+				element.Count = std::strtoull(tokens[2].c_str(), nullptr, 10);
+				elements.push_back(element);
+			}
+			else if (tokens[0] == "property" && tokens.size() >= 3 && !elements.empty())
+			{
+				PlyElement& element = elements.back();
+				if (tokens[1] == "list")
+				{
+					element.IsVariableLength = true;
+					continue;
+				}
+				const PlyScalarType type = GetPlyScalarType(tokens[1]);
+				const size_t typeSize = GetPlyScalarTypeSize(type);
+				if (typeSize == 0)
+				{
+					outErrorMessage = "Unknown PLY property type: " + tokens[1];
+					return false;
+				}
+				const std::string& propName = tokens[2];
+				const size_t offset = element.Stride;
+				if (propName == "x") { element.OffsetX = offset; element.TypeX = type; }
+				else if (propName == "y") { element.OffsetY = offset; element.TypeY = type; }
+				else if (propName == "z") { element.OffsetZ = offset; element.TypeZ = type; }
+				else if (typeSize == 1 && (propName == "red" || propName == "diffuse_red")) { element.OffsetR = offset; }
+				else if (typeSize == 1 && (propName == "green" || propName == "diffuse_green")) { element.OffsetG = offset; }
+				else if (typeSize == 1 && (propName == "blue" || propName == "diffuse_blue")) { element.OffsetB = offset; }
+				element.Stride += typeSize;
+			}
+		}
+		if (!isBinaryLittleEndian)
+		{
+			outErrorMessage = "Only binary_little_endian PLY files are supported.";
+			return false;
+		}
+
+		// 頂点要素より前の要素は、固定長でなければ読み飛ばせない。
+		// 要素数はヘッダーに書かれた任意の値なので、バイト数の乗算と加算が桁あふれしないよう、ファイルの残りのサイズと除算で比べる。
+		uint64_t vertexOffset = bodyOffset;
+		const PlyElement* pVertex = nullptr;
+		for (const auto& element : elements)
+		{
+			if (element.Name == "vertex")
+			{
+				pVertex = &element;
+				break;
+			}
+			if (element.IsVariableLength)
+			{
+				outErrorMessage = "Variable-length PLY elements before the vertex element are not supported.";
+				return false;
+			}
+			if (element.Stride != 0 && element.Count > (dataSize - vertexOffset) / element.Stride)
+			{
+				outErrorMessage = "The PLY element " + element.Name + " extends beyond the end of the file.";
+				return false;
+			}
+			vertexOffset += element.Count * element.Stride;
+		}
+		if (!pVertex || pVertex->IsVariableLength || pVertex->OffsetX == SIZE_MAX || pVertex->OffsetY == SIZE_MAX || pVertex->OffsetZ == SIZE_MAX)
+		{
+			outErrorMessage = "The PLY file has no fixed-length vertex element with x, y, z properties.";
+			return false;
+		}
+		const PlyElement vertex = *pVertex;
+		if (vertex.Count == 0 || vertex.Count > uint64_t(UINT32_MAX) ||
+			vertex.Count > (dataSize - vertexOffset) / vertex.Stride)
+		{
+			outErrorMessage = "The PLY vertex count does not match the file size.";
+			return false;
+		}
+
+		const size_t pointsNum = size_t(vertex.Count);
+		const uint8_t* pVertexData = pData + vertexOffset;
+		const auto readPosition = [&](const uint8_t* pRecord)
+		{
+			return MyVector3D(
+				ReadPlyScalar(pRecord + vertex.OffsetX, vertex.TypeX),
+				ReadPlyScalar(pRecord + vertex.OffsetY, vertex.TypeY),
+				ReadPlyScalar(pRecord + vertex.OffsetZ, vertex.TypeZ));
+		};
+		outResult.HasColors = (vertex.OffsetR != SIZE_MAX && vertex.OffsetG != SIZE_MAX && vertex.OffsetB != SIZE_MAX);
+		outResult.Offset = readPosition(pVertexData);
+
+		outStore.Resize(pointsNum);
+		float* pPosX = outStore.GetPositionsX();
+		float* pPosY = outStore.GetPositionsY();
+		float* pPosZ = outStore.GetPositionsZ();
+		uint32_t* pColors = outStore.GetPackedColors();
+		const MyVector3D origin = outResult.Offset;
+		const bool hasColors = outResult.HasColors;
+
+		outBounds.assign((pointsNum + BinaryChunkPointsNum - 1) / BinaryChunkPointsNum, ChunkBounds());
+		jobSystem.ParallelFor(pointsNum, BinaryChunkPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			ChunkBounds& bounds = outBounds[beginIndex / BinaryChunkPointsNum];
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				const uint8_t* pRecord = pVertexData + i * vertex.Stride;
+				const MyVector3D pos = readPosition(pRecord);
+				const float x = float(pos.x - origin.x);
+				const float y = float(pos.y - origin.y);
+				const float z = float(pos.z - origin.z);
+				pPosX[i] = x;
+				pPosY[i] = y;
+				pPosZ[i] = z;
+				bounds.Add(x, y, z);
+				pColors[i] = hasColors ?
+					PackColorFromBytes(pRecord[vertex.OffsetR], pRecord[vertex.OffsetG], pRecord[vertex.OffsetB]) :
+					defaultPackedColor;
+			}
+		});
+		return true;
+	}
+
+#pragma endregion
+
+
+#pragma region // LAS //
+
+	// 点データ レコード形式ごとの最小レコード長と、RGB のオフセット（RGB を持たない形式は 0）。
+	bool GetLasPointFormatLayout(uint8_t formatId, size_t& outMinRecordLength, size_t& outColorOffset)
+	{
+		static const uint8_t MinRecordLengths[] = { 20, 28, 26, 34, 57, 63, 30, 36, 38, 59, 67 };
+		static const uint8_t ColorOffsets[] = { 0, 0, 20, 28, 0, 28, 0, 30, 30, 0, 30 };
+		if (formatId >= sizeof(MinRecordLengths))
+		{
+			return false;
+		}
+		outMinRecordLength = MinRecordLengths[formatId];
+		outColorOffset = ColorOffsets[formatId];
+		return true;
+	}
+
+	bool LoadLas(const uint8_t* pData, uint64_t dataSize, uint32_t defaultPackedColor, MyJobSystem& jobSystem,
+		MyPointCloudStore& outStore, MyPointCloudLoader::LoadResult& outResult, std::vector<ChunkBounds>& outBounds, std::string& outErrorMessage)
+	{
+		// 公開ヘッダーのうち、LAS 1.0 から共通の部分は 227 バイト。
+		if (dataSize < 227)
+		{
+			outErrorMessage = "The LAS header is truncated.";
+			return false;
+		}
+		const uint8_t versionMinor = pData[25];
+		const uint16_t headerSize = ReadUnaligned<uint16_t>(pData + 94);
+		const uint32_t pointDataOffset = ReadUnaligned<uint32_t>(pData + 96);
+		const uint8_t rawFormatId = pData[104];
+		const uint16_t recordLength = ReadUnaligned<uint16_t>(pData + 105);
+		uint64_t pointsNum64 = ReadUnaligned<uint32_t>(pData + 107);
+		const MyVector3D scale(ReadUnaligned<double>(pData + 131), ReadUnaligned<double>(pData + 139), ReadUnaligned<double>(pData + 147));
+		const MyVector3D offset(ReadUnaligned<double>(pData + 155), ReadUnaligned<double>(pData + 163), ReadUnaligned<double>(pData + 171));
+		const MyVector3D boundsMax(ReadUnaligned<double>(pData + 179), ReadUnaligned<double>(pData + 195), ReadUnaligned<double>(pData + 211));
+		const MyVector3D boundsMin(ReadUnaligned<double>(pData + 187), ReadUnaligned<double>(pData + 203), ReadUnaligned<double>(pData + 219));
+		if (versionMinor >= 4 && headerSize >= 255 && dataSize >= 255)
+		{
+			// LAS 1.4 では 64 ビットの点数が別にあり、32 ビットの点数は 0 のことがある。
+			const uint64_t pointsNum14 = ReadUnaligned<uint64_t>(pData + 247);
+			pointsNum64 = std::max(pointsNum64, pointsNum14);
+		}
+		if (rawFormatId & 0x80)
+		{
+			outErrorMessage = "Compressed LAS (LAZ) files are not supported.";
+			return false;
+		}
+		const uint8_t formatId = rawFormatId & 0x3F;
+		size_t minRecordLength = 0;
+		size_t colorOffset = 0;
+		if (!GetLasPointFormatLayout(formatId, minRecordLength, colorOffset) || recordLength < minRecordLength)
+		{
+			outErrorMessage = "Unsupported LAS point data format: " + std::to_string(formatId);
+			return false;
+		}
+		if (pointsNum64 == 0 || pointsNum64 > uint64_t(UINT32_MAX) ||
+			pointDataOffset + pointsNum64 * recordLength > dataSize)
+		{
+			outErrorMessage = "The LAS point count does not match the file size.";
+			return false;
+		}
+
+		// LAS の座標は地理座標系の大きな値のことが多いので、ヘッダーの AABB の中心を原点として単精度にする。
+		const size_t pointsNum = size_t(pointsNum64);
+		outResult.HasColors = (colorOffset != 0);
+		outResult.Offset = (boundsMin + boundsMax) * 0.5;
+
+		outStore.Resize(pointsNum);
+		float* pPosX = outStore.GetPositionsX();
+		float* pPosY = outStore.GetPositionsY();
+		float* pPosZ = outStore.GetPositionsZ();
+		uint32_t* pColors = outStore.GetPackedColors();
+		// 整数座標 X に対して、X * scale + offset - origin を計算する。
+		const MyVector3D bias = offset - outResult.Offset;
+		const uint8_t* pPointData = pData + pointDataOffset;
+
+		outBounds.assign((pointsNum + BinaryChunkPointsNum - 1) / BinaryChunkPointsNum, ChunkBounds());
+		jobSystem.ParallelFor(pointsNum, BinaryChunkPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			ChunkBounds& bounds = outBounds[beginIndex / BinaryChunkPointsNum];
+			for (size_t i = beginIndex; i < endIndex; ++i)
+			{
+				const uint8_t* pRecord = pPointData + i * recordLength;
+				const float x = float(ReadUnaligned<int32_t>(pRecord + 0) * scale.x + bias.x);
+				const float y = float(ReadUnaligned<int32_t>(pRecord + 4) * scale.y + bias.y);
+				const float z = float(ReadUnaligned<int32_t>(pRecord + 8) * scale.z + bias.z);
+				pPosX[i] = x;
+				pPosY[i] = y;
+				pPosZ[i] = z;
+				bounds.Add(x, y, z);
+				// RGB は 16 ビットなので、上位 8 ビットを使う。
+				pColors[i] = colorOffset ?
+					PackColorFromBytes(
+						ReadUnaligned<uint16_t>(pRecord + colorOffset + 0) >> 8,
+						ReadUnaligned<uint16_t>(pRecord + colorOffset + 2) >> 8,
+						ReadUnaligned<uint16_t>(pRecord + colorOffset + 4) >> 8) :
+					defaultPackedColor;
+			}
+		});
+		return true;
+	}
+
+#pragma endregion
+} // end of namespace
+
+
+namespace MyPointCloudLoader
+{
+	const char* GetFileFormatName(FileFormat format)
+	{
+		switch (format)
+		{
+		case FileFormat_BinaryPly: return "Binary PLY";
+		case FileFormat_AsciiXyz: return "ASCII XYZ";
+		case FileFormat_Las: return "LAS";
+		default: return "Unknown";
+		}
+	}
+
+	bool LoadPointCloudFile(const char* pFilePath, uint32_t defaultPackedColor, MyJobSystem& jobSystem,
+		MyPointCloudStore& outStore, LoadResult& outResult, std::string& outErrorMessage)
+	{
+		const auto startTime = Clock::now();
+		outResult = LoadResult();
+
+		MyMappedFile file;
+		if (!file.Open(pFilePath))
+		{
+			outErrorMessage = std::string("Failed to open or map the file: ") + pFilePath;
+			return false;
+		}
+		file.AdviseSequentialAccess();
+		const uint8_t* pData = file.GetData();
+		const uint64_t dataSize = file.GetSize();
+		outResult.FileBytes = dataSize;
+		outResult.OpenSeconds = GetSecondsSince(startTime);
+
+		const auto decodeStartTime = Clock::now();
+		std::vector<ChunkBounds> chunkBounds;
+		bool isSucceeded = false;
+		if (dataSize >= 4 && memcmp(pData, "ply", 3) == 0 && (pData[3] == '\n' || pData[3] == '\r'))
+		{
+			outResult.Format = FileFormat_BinaryPly;
+			isSucceeded = LoadBinaryPly(pData, dataSize, defaultPackedColor, jobSystem, outStore, outResult, chunkBounds, outErrorMessage);
+		}
+		else if (dataSize >= 4 && memcmp(pData, "LASF", 4) == 0)
+		{
+			outResult.Format = FileFormat_Las;
+			isSucceeded = LoadLas(pData, dataSize, defaultPackedColor, jobSystem, outStore, outResult, chunkBounds, outErrorMessage);
+		}
+		else
+		{
+			outResult.Format = FileFormat_AsciiXyz;
+			isSucceeded = LoadAsciiXyz(pData, dataSize, defaultPackedColor, jobSystem, outStore, outResult, chunkBounds, outErrorMessage);
+		}
+		if (!isSucceeded)
+		{
+			return false;
+		}
+		outResult.DecodeSeconds = GetSecondsSince(decodeStartTime);
+
+		// デコード時に求めた AABB の中心が原点に来るように平行移動する。
+		// デコード時の原点（最初の点やヘッダーの AABB の中心）で大きな値はすでに除いてあるので、単精度の減算で十分。
+		const auto recenterStartTime = Clock::now();
+		ChunkBounds bounds;
+		for (const auto& chunk : chunkBounds)
+		{
+			bounds.Add(chunk.Min.x, chunk.Min.y, chunk.Min.z);
+			bounds.Add(chunk.Max.x, chunk.Max.y, chunk.Max.z);
+		}
+		const size_t pointsNum = outStore.GetPointsNum();
+		const MyVector3F center = (bounds.Min + bounds.Max) * 0.5f;
+		if (center != MyVector3F(0) && std::isfinite(center.x) && std::isfinite(center.y) && std::isfinite(center.z))
+		{
+			float* pPosX = outStore.GetPositionsX();
+			float* pPosY = outStore.GetPositionsY();
+			float* pPosZ = outStore.GetPositionsZ();
+			jobSystem.ParallelFor(pointsNum, BinaryChunkPointsNum, [&](size_t beginIndex, size_t endIndex)
+			{
+				for (size_t i = beginIndex; i < endIndex; ++i)
+				{
+					pPosX[i] -= center.x;
+					pPosY[i] -= center.y;
+					pPosZ[i] -= center.z;
+				}
+			});
+			outResult.Offset += MyVector3D(center);
+		}
+		outResult.RecenterSeconds = GetSecondsSince(recenterStartTime);
+
+		outStore.ClearSelection();
+		outStore.NotifyPositionsModified();
+		outStore.NotifyColorsModified();
+		outResult.PointsNum = pointsNum;
+		outResult.TotalSeconds = GetSecondsSince(startTime);
+		return true;
+	}
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+
+class MyJobSystem;
+
+
+//! @brief  点群ファイルの読み込み。<br>
+//! ファイルはメモリ マップして、MyPointCloudStore の配列へ直接デコードする（中間バッファを経由しない）。<br>
+//! 対応形式は binary_little_endian の PLY、ASCII の XYZ（1 行に "x y z [r g b]"）、非圧縮の LAS 1.0～1.4。<br>
+//! ASCII は行境界で区切ったチャンクに分割し、点数の計数とデコードをそれぞれジョブ システムで並列に行なう。<br>
+namespace MyPointCloudLoader
+{
+	enum FileFormat
+	{
+		FileFormat_Unknown,
+		FileFormat_BinaryPly,
+		FileFormat_AsciiXyz,
+		FileFormat_Las,
+	};
+
+	//! @brief  読み込み結果と、所要時間の内訳。<br>
+	struct LoadResult
+	{
+		FileFormat Format;
+		uint64_t FileBytes;
+		size_t PointsNum;
+		bool HasColors;
+		//! 単精度でも精度が落ちないように、点群の AABB の中心が原点に来るように平行移動して格納する。<br>
+		//! 元の座標は、格納された位置座標に Offset を加えたもの。<br>
+		MyVector3D Offset;
+		double OpenSeconds; //!< ファイルを開いてマップするまで。<br>
+		double DecodeSeconds; //!< ヘッダーの解析、点数の計数、位置と色のデコード。<br>
+		double RecenterSeconds; //!< AABB の中心への平行移動。<br>
+		double TotalSeconds;
+
+		LoadResult()
+			: Format(), FileBytes(), PointsNum(), HasColors(), Offset()
+			, OpenSeconds(), DecodeSeconds(), RecenterSeconds(), TotalSeconds()
+		{}
+
+		//! @brief  ファイル サイズを全体の所要時間で割った読み込み速度[MB/s]。<br>
+		double GetThroughputMBPerSec() const
+		{ return TotalSeconds > 0 ? (FileBytes / (1024.0 * 1024.0)) / TotalSeconds : 0; }
+	};
+
+	const char* GetFileFormatName(FileFormat format);
+
+	//! @brief  点群ファイルを読み込んで outStore を置き換える。選択状態はクリアされる。<br>
+	//! 形式はファイル先頭のマジック ナンバーで判定し、"ply" でも "LASF" でもなければ ASCII XYZ とみなす。<br>
+	//! 色を持たないファイルの点は defaultPackedColor になる。<br>
+	//! 失敗した場合は false を返し、outErrorMessage に理由を設定する。outStore の内容は不定になる。<br>
+	bool LoadPointCloudFile(const char* pFilePath, uint32_t defaultPackedColor, MyJobSystem& jobSystem,
+		MyPointCloudStore& outStore, LoadResult& outResult, std::string& outErrorMessage);
+}
@@ -0,0 +1,300 @@
+﻿#include "stdafx.h"
+#include "MyPointCloudRenderer.hpp"
+
+
+namespace
+{
+	// バッファがまだ内容を持っていないことを表すバージョン番号。
+	const uint64_t InvalidVersion = UINT64_MAX;
+}
+
+MyPointCloudRenderer::MyPointCloudRenderer(uint32_t packedColorHovered, uint32_t packedColorSelected)
+	: m_positionBuffer()
+	, m_colorBuffer()
+	, m_pMappedColors()
+	, m_usesPersistentMapping()
+	, m_pointsNum()
+	, m_capacityPointsNum()
+	, m_uploadedPositionsVersion(InvalidVersion)
+	, m_packedColorHovered(packedColorHovered)
+	, m_packedColorSelected(packedColorSelected)
+	, m_currentColorRegion()
+	, m_lastUpdatedRangesNum()
+	, m_lastUpdatedPointsNum()
+{
+}
+
+MyPointCloudRenderer::~MyPointCloudRenderer()
+{
+	// OpenGL コンテキストが破棄された後の可能性があるので、ここでは GL 関数を呼ばない。
+	assert(m_positionBuffer == 0 && m_colorBuffer == 0);
+}
+
+void MyPointCloudRenderer::Initialize(bool allowsPersistentMapping)
+{
+	assert(m_positionBuffer == 0 && m_colorBuffer == 0);
+	// 永続マップには GL_ARB_buffer_storage が、書き込み前の同期にはフェンス（GL_ARB_sync）が必要。
+	m_usesPersistentMapping = allowsPersistentMapping && GLEW_ARB_buffer_storage && GLEW_ARB_sync;
+}
+
+void MyPointCloudRenderer::Release()
+{
+	for (auto& region : m_colorRegions)
+	{
+		WaitForDrawFence(region);
+	}
+	m_colorRegions.clear();
+	m_currentColorRegion = 0;
+	if (m_pMappedColors)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		m_pMappedColors = nullptr;
+	}
+	if (m_positionBuffer)
+	{
+		glDeleteBuffers(1, &m_positionBuffer);
+		m_positionBuffer = 0;
+	}
+	if (m_colorBuffer)
+	{
+		glDeleteBuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	m_pointsNum = 0;
+	m_capacityPointsNum = 0;
+	m_uploadedPositionsVersion = InvalidVersion;
+}
+
+void MyPointCloudRenderer::RecreateBuffers(size_t pointsNum, size_t capacityPointsNum)
+{
+	this->Release();
+
+	// サイズ 0 のバッファ ストレージは作成できないので、最低 1 点ぶん確保する。
+	const size_t allocPointsNum = std::max<size_t>(capacityPointsNum, 1);
+	const GLsizeiptr positionsSize = GLsizeiptr(allocPointsNum * 3 * sizeof(float));
+	const GLsizeiptr colorsSize = GLsizeiptr(allocPointsNum * sizeof(uint32_t));
+	const GLsizeiptr mappedColorsSize = colorsSize * GLsizeiptr(ColorRegionsNum);
+
+	glGenBuffers(1, &m_positionBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, positionsSize, nullptr, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_colorBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+	if (m_usesPersistentMapping)
+	{
+		// コヒーレントな永続マップなので、書き込んだ内容は明示的なフラッシュなしで次の描画コマンドから見える。
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, mappedColorsSize, nullptr, flags);
+		m_pMappedColors = static_cast<uint32_t*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, mappedColorsSize, flags));
+		if (!m_pMappedColors)
+		{
+			// マップに失敗した場合は、以降 glBufferSubData() で更新する。
+			puts("Warning : Failed to map the point color buffer persistently. Falling back to glBufferSubData().");
+			m_usesPersistentMapping = false;
+			glDeleteBuffers(1, &m_colorBuffer);
+			glGenBuffers(1, &m_colorBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+		}
+	}
+	if (!m_usesPersistentMapping)
+	{
+		glBufferData(GL_ARRAY_BUFFER, colorsSize, nullptr, GL_DYNAMIC_DRAW);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_pointsNum = pointsNum;
+	m_capacityPointsNum = allocPointsNum;
+	// どの領域もまだ何も書き込んでいないので、最初の書き込みで全点を書く。
+	const ColorRegion emptyRegion = { nullptr, 0, InvalidVersion, std::vector<uint64_t>(), std::vector<uint64_t>() };
+	m_colorRegions.assign(m_usesPersistentMapping ? ColorRegionsNum : 1, emptyRegion);
+	m_currentColorRegion = 0;
+}
+
+void MyPointCloudRenderer::UploadPositions(const MyPointCloudStore& store, size_t beginPoint, size_t endPoint)
+{
+	// 固定機能パイプラインの頂点配列は (x, y, z) が並んだ形式しか受け付けないので、SoA からインターリーブする。
+	const float* pPosX = store.GetPositionsX();
+	const float* pPosY = store.GetPositionsY();
+	const float* pPosZ = store.GetPositionsZ();
+	m_scratchPositions.resize((endPoint - beginPoint) * 3);
+	for (size_t i = beginPoint; i < endPoint; ++i)
+	{
+		m_scratchPositions[(i - beginPoint) * 3 + 0] = pPosX[i];
+		m_scratchPositions[(i - beginPoint) * 3 + 1] = pPosY[i];
+		m_scratchPositions[(i - beginPoint) * 3 + 2] = pPosZ[i];
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, GLintptr(beginPoint * 3 * sizeof(float)), GLsizeiptr(m_scratchPositions.size() * sizeof(float)), m_scratchPositions.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_uploadedPositionsVersion = store.GetPositionsVersion();
+}
+
+void MyPointCloudRenderer::UpdateColors(ColorRegion& region, size_t regionIndex, const MyPointCloudStore& store, const uint64_t* pHitWords, size_t beginWord, size_t endWord)
+{
+	const size_t beginPoint = beginWord * PointsPerWord;
+	const size_t endPoint = std::min(endWord * PointsPerWord, m_pointsNum);
+	const uint64_t* pSelectionWords = store.GetSelectionWords();
+	const uint32_t* pPackedColors = store.GetPackedColors();
+	// パレットを使っている場合は、ここで RGBA8 に展開する。
+	const uint8_t* pPaletteIndices = store.GetPaletteIndices();
+	const uint32_t* pPalette = store.GetPalette().data();
+
+	// 永続マップの場合はバッファに直接書き込む。
+	uint32_t* pDest = nullptr;
+	if (m_pMappedColors)
+	{
+		pDest = m_pMappedColors + regionIndex * m_capacityPointsNum + beginPoint;
+	}
+	else
+	{
+		m_scratchColors.resize(endPoint - beginPoint);
+		pDest = m_scratchColors.data();
+	}
+	for (size_t i = beginPoint; i < endPoint; ++i)
+	{
+		const size_t word = i / PointsPerWord;
+		const uint64_t bit = uint64_t(1) << (i % PointsPerWord);
+		pDest[i - beginPoint] =
+			(pHitWords[word] & bit) ? m_packedColorHovered :
+			((pSelectionWords[word] & bit) ? m_packedColorSelected :
+			(pPaletteIndices ? pPalette[pPaletteIndices[i]] : pPackedColors[i]));
+	}
+	if (!m_pMappedColors)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, GLintptr(beginPoint * sizeof(uint32_t)), GLsizeiptr((endPoint - beginPoint) * sizeof(uint32_t)), pDest);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	std::copy(pSelectionWords + beginWord, pSelectionWords + endWord, region.UploadedSelectionWords.begin() + beginWord);
+	std::copy(pHitWords + beginWord, pHitWords + endWord, region.UploadedHitWords.begin() + beginWord);
+	++m_lastUpdatedRangesNum;
+	m_lastUpdatedPointsNum += endPoint - beginPoint;
+}
+
+void MyPointCloudRenderer::Update(const MyPointCloudStore& store, const uint64_t* pHitWords)
+{
+	m_lastUpdatedRangesNum = 0;
+	m_lastUpdatedPointsNum = 0;
+
+	const size_t pointsNum = store.GetPointsNum();
+	size_t appendedFirstPoint = pointsNum;
+	if (m_positionBuffer == 0 || pointsNum < m_pointsNum || pointsNum > m_capacityPointsNum)
+	{
+		this->RecreateBuffers(pointsNum, std::max(pointsNum, store.GetCapacity()));
+	}
+	else if (pointsNum > m_pointsNum)
+	{
+		// 容量の範囲内で点が追加された。
+		appendedFirstPoint = m_pointsNum;
+		m_pointsNum = pointsNum;
+	}
+	if (m_uploadedPositionsVersion != store.GetPositionsVersion())
+	{
+		this->UploadPositions(store, 0, m_pointsNum);
+	}
+	else if (appendedFirstPoint < pointsNum)
+	{
+		this->UploadPositions(store, appendedFirstPoint, pointsNum);
+	}
+
+	// 前回の Draw() の後に GPU が読むかもしれない領域を避けて、次の領域に書き込む。
+	// 次の領域の内容は ColorRegionsNum - 1 フレーム前のものなので、そのときからの変化を書き直す。
+	m_currentColorRegion = (m_currentColorRegion + 1) % m_colorRegions.size();
+	ColorRegion& region = m_colorRegions[m_currentColorRegion];
+
+	// 色そのものが変わった場合は全点を書き直す。さもなくば、選択状態かホバー状態が変化したワードの連続範囲だけを書き直す。
+	// この領域に書き込んだ後に追加された点を含むワードは、状態の変化に関わらず書き込む。
+	const bool updatesAll = (region.UploadedColorsVersion != store.GetColorsVersion());
+	const size_t appendedFirstWord = region.PointsNum / PointsPerWord;
+	const size_t wordsNum = MyPointCloudStore::GetSelectionWordsNum(m_pointsNum);
+	region.UploadedSelectionWords.resize(wordsNum, 0);
+	region.UploadedHitWords.resize(wordsNum, 0);
+	region.PointsNum = m_pointsNum;
+	const uint64_t* pSelectionWords = store.GetSelectionWords();
+	bool hasWaitedForDraw = false;
+	size_t w = 0;
+	while (w < wordsNum)
+	{
+		const auto isDirty = [&](size_t word)
+		{
+			return updatesAll || word >= appendedFirstWord ||
+				pSelectionWords[word] != region.UploadedSelectionWords[word] ||
+				pHitWords[word] != region.UploadedHitWords[word];
+		};
+		if (!isDirty(w))
+		{
+			++w;
+			continue;
+		}
+		const size_t beginWord = w;
+		while (w < wordsNum && isDirty(w))
+		{
+			++w;
+		}
+		if (!hasWaitedForDraw)
+		{
+			// 永続マップした領域は、GPU がこの領域を参照した描画を終えるまで書き換えられない。
+			// 通常は ColorRegionsNum - 1 フレーム前の描画なので、すでに終わっていて待たずに済む。
+			WaitForDrawFence(region);
+			hasWaitedForDraw = true;
+		}
+		this->UpdateColors(region, m_currentColorRegion, store, pHitWords, beginWord, w);
+	}
+	region.UploadedColorsVersion = store.GetColorsVersion();
+}
+
+void MyPointCloudRenderer::Draw()
+{
+	if (m_pointsNum == 0)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_positionBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, nullptr);
+	// パックされた色はメモリ上で R, G, B, A の順に並んでいる。直前の Update() で書き込んだ領域を参照する。
+	glBindBuffer(GL_ARRAY_BUFFER, m_colorBuffer);
+	glEnableClientState(GL_COLOR_ARRAY);
+	const size_t colorOffset = m_currentColorRegion * m_capacityPointsNum * sizeof(uint32_t);
+	glColorPointer(4, GL_UNSIGNED_BYTE, 0, reinterpret_cast<const void*>(colorOffset));
+
+	glDrawArrays(GL_POINTS, 0, GLsizei(m_pointsNum));
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (m_pMappedColors)
+	{
+		ColorRegion& region = m_colorRegions[m_currentColorRegion];
+		if (region.DrawFence)
+		{
+			glDeleteSync(region.DrawFence);
+		}
+		region.DrawFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+void MyPointCloudRenderer::WaitForDrawFence(ColorRegion& region)
+{
+	if (!region.DrawFence)
+	{
+		return;
+	}
+	for (;;)
+	{
+		// 初回はコマンドをフラッシュしないと、フェンスがいつまでもシグナルされない可能性がある。
+		const GLenum result = glClientWaitSync(region.DrawFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000 * 1000 * 1000);
+		if (result != GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+	}
+	glDeleteSync(region.DrawFence);
+	region.DrawFence = nullptr;
+}
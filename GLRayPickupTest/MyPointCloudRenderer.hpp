@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+
+
+//! @brief  点群をバッファ オブジェクト（VBO）に載せて、glDrawArrays() 1 回で描画するクラス。<br>
+//! 位置座標は点群の位置が変わったときだけアップロードする。点群の末尾に点が追加された場合は、追加された範囲だけをアップロードする。<br>
+//! バッファは点群の容量（MyPointCloudStore::Reserve()）ぶん確保するので、容量の範囲内の追加ではバッファを作り直さない。<br>
+//! 表示色（ホバー・選択状態を反映した色）は別の小さなバッファに持ち、前回のアップロード時から状態が変化した範囲だけを更新する。<br>
+//! GL_ARB_buffer_storage が使える環境では表示色バッファを永続マップして直接書き込み、使えない環境では glBufferSubData() で更新する。<br>
+//! 永続マップの場合は、表示色バッファを ColorRegionsNum 個の領域に分けてフレームごとに順に使い、領域ごとのフェンスで GPU が読み終えたことを確かめる。<br>
+//! GPU が前のフレームの領域を読んでいる間に CPU は次の領域に書き込めるので、CPU と GPU が互いを待たずに済む。<br>
+//! 各領域は最後に書き込んだときの状態を覚えておき、それ以降に変化した範囲（直近の数フレームぶんの変化）を書き直す。<br>
+//! 固定機能パイプラインの頂点配列（glVertexPointer(), glColorPointer()）で描画するので、現在の行列スタックがそのまま使われる。<br>
+//! OpenGL コンテキストの作成後に使用し、コンテキストの破棄前に Release() を呼ぶこと。<br>
+class MyPointCloudRenderer
+{
+public:
+	static const size_t PointsPerWord = MyPointCloudStore::BitsPerSelectionWord;
+	//! @brief  永続マップの場合に順に使う表示色バッファの領域の数（トリプル バッファリング）。<br>
+	static const size_t ColorRegionsNum = 3;
+
+private:
+	//! @brief  表示色バッファの 1 領域の状態。<br>
+	struct ColorRegion
+	{
+		GLsync DrawFence; //!< この領域を参照する直前の描画の完了を待つためのフェンス。<br>
+		size_t PointsNum; //!< この領域に書き込んだ点数。<br>
+		uint64_t UploadedColorsVersion;
+		// この領域に反映済みの選択状態とホバー状態。64 点単位のワードで比較して、変化した範囲を見つける。
+		std::vector<uint64_t> UploadedSelectionWords;
+		std::vector<uint64_t> UploadedHitWords;
+	};
+
+private:
+	GLuint m_positionBuffer;
+	GLuint m_colorBuffer;
+	uint32_t* m_pMappedColors; //!< 永続マップされた表示色バッファの先頭。永続マップを使わない場合は nullptr。<br>
+	bool m_usesPersistentMapping;
+	size_t m_pointsNum;
+	size_t m_capacityPointsNum; //!< バッファの 1 領域に確保した点数。<br>
+	uint64_t m_uploadedPositionsVersion;
+	uint32_t m_packedColorHovered;
+	uint32_t m_packedColorSelected;
+
+	//! @brief  永続マップの場合は ColorRegionsNum 個、glBufferSubData() の場合は 1 個。<br>
+	std::vector<ColorRegion> m_colorRegions;
+	size_t m_currentColorRegion; //!< 直前の Update() で書き込み、Draw() で参照する領域。<br>
+	std::vector<uint32_t> m_scratchColors;
+	std::vector<float> m_scratchPositions;
+
+	uint32_t m_lastUpdatedRangesNum; //!< 直前の Update() で書き換えた連続範囲の数。<br>
+	size_t m_lastUpdatedPointsNum; //!< 直前の Update() で書き換えた点数。<br>
+
+public:
+	MyPointCloudRenderer(uint32_t packedColorHovered, uint32_t packedColorSelected);
+	~MyPointCloudRenderer();
+
+public:
+	//! @brief  使用する更新方式を決める。GLEW の初期化後に呼ぶこと。<br>
+	//! allowsPersistentMapping が false の場合は、拡張機能の有無に関わらず glBufferSubData() を使う。<br>
+	void Initialize(bool allowsPersistentMapping);
+
+	//! @brief  バッファ オブジェクトを破棄する。OpenGL コンテキストが有効なうちに呼ぶこと。<br>
+	void Release();
+
+	//! @brief  点群の位置・色・選択状態と、ホバー状態のビットマスクをバッファに反映する。<br>
+	//! pHitWords は点群の選択状態と同じ形式（64 点単位のワード）のビットセット。<br>
+	void Update(const MyPointCloudStore& store, const uint64_t* pHitWords);
+
+	//! @brief  GL_POINTS で全点を描画する。<br>
+	void Draw();
+
+	bool UsesPersistentMapping() const { return m_usesPersistentMapping; }
+	uint32_t GetLastUpdatedRangesNum() const { return m_lastUpdatedRangesNum; }
+	size_t GetLastUpdatedPointsNum() const { return m_lastUpdatedPointsNum; }
+
+private:
+	MyPointCloudRenderer(const MyPointCloudRenderer&) = delete;
+	MyPointCloudRenderer& operator=(const MyPointCloudRenderer&) = delete;
+
+	void RecreateBuffers(size_t pointsNum, size_t capacityPointsNum);
+	void UploadPositions(const MyPointCloudStore& store, size_t beginPoint, size_t endPoint);
+	void UpdateColors(ColorRegion& region, size_t regionIndex, const MyPointCloudStore& store, const uint64_t* pHitWords, size_t beginWord, size_t endWord);
+	static void WaitForDrawFence(ColorRegion& region);
+};
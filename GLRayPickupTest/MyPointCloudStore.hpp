@@ -0,0 +1,370 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+#include "MySelectionSet.hpp"
+
+
+//! @brief  点群データの格納クラス（SoA: Structure of Arrays）。<br>
+//! 位置座標の X, Y, Z 成分、パックされた色、選択状態のビットセットをそれぞれ別の連続配列に持つ。<br>
+//! 交差判定のループは位置座標しか読まないので、AoS 構造体の配列に比べてメモリ帯域の無駄が少なくなる。<br>
+//! 色は点ごとの RGBA8 か、256 色までのパレットとそのインデックス（1 点 1 バイト）で持つ。<br>
+//! 生成した点群や色を持たないファイルのように色の種類が少ない場合はパレットにして、色のメモリを 1/4 にする。<br>
+//! パレットの色を RGBA8 に戻すのは、描画用の色を作るときと GetPackedColor() で 1 点ずつ読むときだけ。<br>
+class MyPointCloudStore
+{
+public:
+	static const size_t BitsPerSelectionWord = 64;
+	static const size_t MaxPaletteColorsNum = 256;
+
+	enum ColorEncoding
+	{
+		ColorEncoding_RGBA8, //!< 点ごとの RGBA8（4 バイト/点）。<br>
+		ColorEncoding_Palette8, //!< パレットのインデックス（1 バイト/点）。<br>
+	};
+
+private:
+	std::vector<float> m_positionsX;
+	std::vector<float> m_positionsY;
+	std::vector<float> m_positionsZ;
+	std::vector<uint32_t> m_packedColors; //!< RGBA8。パレットを使う場合は空。<br>
+	std::vector<uint8_t> m_paletteIndices; //!< パレットを使う場合の、点ごとのパレットのインデックス。<br>
+	std::vector<uint32_t> m_palette; //!< RGBA8 のパレット。空ならパレットを使わない。<br>
+	std::vector<uint64_t> m_selectionWords; //!< 選択状態のビットセット。<br>
+	//! 並べ替え後のインデックスから、読み込み・生成時のインデックスへの表。並べ替えていなければ空（恒等写像）。<br>
+	std::vector<uint32_t> m_originalIndices;
+	//! 位置座標が変更されるか、点数が Resize() で変更されるたびに増える。派生データのキャッシュの無効化判定に使う。<br>
+	//! AppendPoint() による末尾への追加では増えないので、派生データは点数の増加を見て、増えた点だけを追加で反映できる。<br>
+	uint64_t m_positionsVersion;
+	uint64_t m_colorsVersion; //!< 色が変更されるか、点数が Resize() で変更されるたびに増える。<br>
+
+public:
+	MyPointCloudStore()
+		: m_positionsVersion()
+		, m_colorsVersion()
+	{}
+
+public:
+	void Resize(size_t pointsNum)
+	{
+		m_positionsX.resize(pointsNum);
+		m_positionsY.resize(pointsNum);
+		m_positionsZ.resize(pointsNum);
+		if (this->UsesPalette())
+		{
+			m_paletteIndices.resize(pointsNum);
+		}
+		else
+		{
+			m_packedColors.resize(pointsNum);
+		}
+		m_selectionWords.resize(GetSelectionWordsNum(pointsNum));
+		std::vector<uint32_t>().swap(m_originalIndices);
+		++m_positionsVersion;
+		++m_colorsVersion;
+	}
+
+	//! @brief  全点を削除して、確保しているメモリも解放する。<br>
+	void Clear()
+	{
+		std::vector<float>().swap(m_positionsX);
+		std::vector<float>().swap(m_positionsY);
+		std::vector<float>().swap(m_positionsZ);
+		std::vector<uint32_t>().swap(m_packedColors);
+		std::vector<uint8_t>().swap(m_paletteIndices);
+		m_palette.clear();
+		std::vector<uint64_t>().swap(m_selectionWords);
+		std::vector<uint32_t>().swap(m_originalIndices);
+		++m_positionsVersion;
+		++m_colorsVersion;
+	}
+
+	//! @brief  AppendPoint() で再確保が起きないように、あらかじめ容量を確保する。<br>
+	void Reserve(size_t capacity)
+	{
+		m_positionsX.reserve(capacity);
+		m_positionsY.reserve(capacity);
+		m_positionsZ.reserve(capacity);
+		if (this->UsesPalette())
+		{
+			m_paletteIndices.reserve(capacity);
+		}
+		else
+		{
+			m_packedColors.reserve(capacity);
+		}
+		m_selectionWords.reserve(GetSelectionWordsNum(capacity));
+		if (!m_originalIndices.empty())
+		{
+			m_originalIndices.reserve(capacity);
+		}
+	}
+
+	//! @brief  末尾に未選択の点を追加する。既存の点は変化しないので、バージョン番号は変えない。<br>
+	//! 追加した点の元のインデックスは、追加時の点数になる。<br>
+	//! パレットを使っている場合、パレットにない色を 257 色目として追加しようとすると RGBA8 に展開する。<br>
+	void AppendPoint(const MyVector3F& pos, uint32_t packedColor)
+	{
+		if (this->UsesPalette())
+		{
+			const size_t paletteIndex = this->FindOrAddPaletteColor(packedColor);
+			if (paletteIndex < MaxPaletteColorsNum)
+			{
+				m_paletteIndices.push_back(uint8_t(paletteIndex));
+			}
+			else
+			{
+				this->ExpandColors();
+			}
+		}
+		if (!this->UsesPalette())
+		{
+			m_packedColors.push_back(packedColor);
+		}
+		if (!m_originalIndices.empty())
+		{
+			m_originalIndices.push_back(uint32_t(m_positionsX.size()));
+		}
+		m_positionsX.push_back(pos.x);
+		m_positionsY.push_back(pos.y);
+		m_positionsZ.push_back(pos.z);
+		if (m_selectionWords.size() < GetSelectionWordsNum(m_positionsX.size()))
+		{
+			m_selectionWords.push_back(0);
+		}
+	}
+
+	size_t GetPointsNum() const { return m_positionsX.size(); }
+	size_t GetCapacity() const { return m_positionsX.capacity(); }
+
+	//! @brief  確保しているメモリ量[Bytes]。<br>
+	size_t GetMemoryBytes() const
+	{
+		return
+			(m_positionsX.capacity() + m_positionsY.capacity() + m_positionsZ.capacity()) * sizeof(float) +
+			m_packedColors.capacity() * sizeof(uint32_t) +
+			m_paletteIndices.capacity() * sizeof(uint8_t) + m_palette.capacity() * sizeof(uint32_t) +
+			m_selectionWords.capacity() * sizeof(uint64_t) +
+			m_originalIndices.capacity() * sizeof(uint32_t);
+	}
+
+	//! @brief  1 点あたりの使用メモリ量[Bytes]。色を RGBA8 で持つ場合（最大）の値。<br>
+	static double GetBytesPerPoint()
+	{ return sizeof(float) * 3 + sizeof(uint32_t) + 1.0 / 8.0; }
+
+	uint64_t GetPositionsVersion() const { return m_positionsVersion; }
+	uint64_t GetColorsVersion() const { return m_colorsVersion; }
+
+	const float* GetPositionsX() const { return m_positionsX.data(); }
+	const float* GetPositionsY() const { return m_positionsY.data(); }
+	const float* GetPositionsZ() const { return m_positionsZ.data(); }
+
+	//! @brief  位置座標の配列に直接書き込む。ファイルからの読み込みなどで、1 点ずつの設定を避けるために使う。<br>
+	//! 書き込み後は NotifyPositionsModified() を呼ぶこと。<br>
+	float* GetPositionsX() { return m_positionsX.data(); }
+	float* GetPositionsY() { return m_positionsY.data(); }
+	float* GetPositionsZ() { return m_positionsZ.data(); }
+
+	void NotifyPositionsModified() { ++m_positionsVersion; }
+
+	MyVector3F GetPosition(size_t index) const
+	{ return MyVector3F(m_positionsX[index], m_positionsY[index], m_positionsZ[index]); }
+
+	void SetPosition(size_t index, const MyVector3F& pos)
+	{
+		m_positionsX[index] = pos.x;
+		m_positionsY[index] = pos.y;
+		m_positionsZ[index] = pos.z;
+		++m_positionsVersion;
+	}
+
+	ColorEncoding GetColorEncoding() const { return this->UsesPalette() ? ColorEncoding_Palette8 : ColorEncoding_RGBA8; }
+	bool UsesPalette() const { return !m_palette.empty(); }
+
+	//! @brief  RGBA8 の色配列。パレットを使っている場合は nullptr。<br>
+	const uint32_t* GetPackedColors() const { return this->UsesPalette() ? nullptr : m_packedColors.data(); }
+
+	//! @brief  パックされた色の配列に直接書き込む。書き込み後は NotifyColorsModified() を呼ぶこと。<br>
+	//! パレットを使っている場合は RGBA8 に展開してから返す。<br>
+	uint32_t* GetPackedColors()
+	{
+		this->ExpandColors();
+		return m_packedColors.data();
+	}
+
+	void NotifyColorsModified() { ++m_colorsVersion; }
+
+	uint32_t GetPackedColor(size_t index) const
+	{ return this->UsesPalette() ? m_palette[m_paletteIndices[index]] : m_packedColors[index]; }
+
+	void SetColor(size_t index, const MyVector4F& color)
+	{
+		const uint32_t packedColor = MyMath::PackColorToRGBA8(color);
+		const size_t paletteIndex = this->UsesPalette() ? this->FindOrAddPaletteColor(packedColor) : MaxPaletteColorsNum;
+		if (paletteIndex < MaxPaletteColorsNum)
+		{
+			m_paletteIndices[index] = uint8_t(paletteIndex);
+		}
+		else
+		{
+			this->GetPackedColors()[index] = packedColor;
+		}
+		++m_colorsVersion;
+	}
+
+	//! @brief  パレットの色（RGBA8）。パレットを使わない場合は空。<br>
+	const std::vector<uint32_t>& GetPalette() const { return m_palette; }
+
+	//! @brief  点ごとのパレットのインデックス。パレットを使わない場合は nullptr。<br>
+	//! 書き込み後は NotifyColorsModified() を呼ぶこと。<br>
+	const uint8_t* GetPaletteIndices() const { return this->UsesPalette() ? m_paletteIndices.data() : nullptr; }
+	uint8_t* GetPaletteIndices() { return this->UsesPalette() ? m_paletteIndices.data() : nullptr; }
+
+	//! @brief  パレットを設定して、色をパレットのインデックスで持つようにする。全点のインデックスは 0 になる。<br>
+	//! 色の種類が既知の場合（生成した点群など）に、RGBA8 の配列を経由せずにインデックスを書き込むために使う。<br>
+	void SetPalette(const uint32_t* pColors, size_t colorsNum)
+	{
+		assert(colorsNum > 0 && colorsNum <= MaxPaletteColorsNum);
+		m_palette.assign(pColors, pColors + colorsNum);
+		m_paletteIndices.assign(m_positionsX.size(), 0);
+		std::vector<uint32_t>().swap(m_packedColors);
+		++m_colorsVersion;
+	}
+
+	//! @brief  RGBA8 の色が MaxPaletteColorsNum 色以下ならパレットに変換する。パレットを使うようになれば true を返す。<br>
+	//! 色の見た目は変わらないので、バージョン番号は変えない。<br>
+	bool CompactColors()
+	{
+		if (this->UsesPalette() || m_packedColors.empty())
+		{
+			return this->UsesPalette();
+		}
+		// 空間的に近い点は同じ色のことが多いので、直前の色と同じかどうかを先に調べる。
+		std::vector<uint32_t> palette;
+		std::vector<uint8_t> paletteIndices(m_packedColors.size());
+		uint32_t lastColor = m_packedColors[0];
+		uint8_t lastIndex = 0;
+		palette.push_back(lastColor);
+		for (size_t i = 0; i < m_packedColors.size(); ++i)
+		{
+			const uint32_t color = m_packedColors[i];
+			if (color != lastColor)
+			{
+				const auto it = std::find(palette.begin(), palette.end(), color);
+				if (it == palette.end() && palette.size() == MaxPaletteColorsNum)
+				{
+					return false;
+				}
+				lastIndex = uint8_t(it - palette.begin());
+				lastColor = color;
+				if (it == palette.end())
+				{
+					palette.push_back(color);
+				}
+			}
+			paletteIndices[i] = lastIndex;
+		}
+		m_palette.swap(palette);
+		m_paletteIndices.swap(paletteIndices);
+		std::vector<uint32_t>().swap(m_packedColors);
+		return true;
+	}
+
+	//! @brief  パレットを使っていれば、色を点ごとの RGBA8 に展開する。<br>
+	void ExpandColors()
+	{
+		if (!this->UsesPalette())
+		{
+			return;
+		}
+		m_packedColors.resize(m_paletteIndices.size());
+		for (size_t i = 0; i < m_paletteIndices.size(); ++i)
+		{
+			m_packedColors[i] = m_palette[m_paletteIndices[i]];
+		}
+		std::vector<uint8_t>().swap(m_paletteIndices);
+		m_palette.clear();
+	}
+
+	static size_t GetSelectionWordsNum(size_t pointsNum)
+	{ return (pointsNum + BitsPerSelectionWord - 1) / BitsPerSelectionWord; }
+
+	//! @brief  選択状態のビットセットを 64 点単位のワードとして直接読み書きする。<br>
+	//! 範囲外のビット（最終ワードの余り）は常に 0 にしておくこと。<br>
+	uint64_t* GetSelectionWords() { return m_selectionWords.data(); }
+	const uint64_t* GetSelectionWords() const { return m_selectionWords.data(); }
+	size_t GetSelectionWordsNum() const { return m_selectionWords.size(); }
+
+	bool IsSelected(size_t index) const
+	{ return ((m_selectionWords[index / BitsPerSelectionWord] >> (index % BitsPerSelectionWord)) & 1) != 0; }
+
+	void SetSelected(size_t index, bool isSelected)
+	{
+		const uint64_t mask = uint64_t(1) << (index % BitsPerSelectionWord);
+		uint64_t& word = m_selectionWords[index / BitsPerSelectionWord];
+		word = isSelected ? (word | mask) : (word & ~mask);
+	}
+
+	void ToggleSelected(size_t index)
+	{ m_selectionWords[index / BitsPerSelectionWord] ^= uint64_t(1) << (index % BitsPerSelectionWord); }
+
+	void ClearSelection()
+	{ std::fill(m_selectionWords.begin(), m_selectionWords.end(), uint64_t(0)); }
+
+	//! @brief  全点の選択状態を反転する。<br>
+	void InvertSelection()
+	{ this->InvertSelection(m_positionsX.size()); }
+
+	//! @brief  先頭の pointsNum 点（点数を超える分は無視）の選択状態を反転する。<br>
+	//! 反転した後に点が追加された場合でも、反転の取り消しが追加された点に及ばないようにするために使う。<br>
+	void InvertSelection(size_t pointsNum)
+	{
+		pointsNum = std::min(pointsNum, m_positionsX.size());
+		const size_t fullWordsNum = pointsNum / BitsPerSelectionWord;
+		MyBitsetOps::InvertWords(m_selectionWords.data(), fullWordsNum);
+		const size_t tailBitsNum = pointsNum % BitsPerSelectionWord;
+		if (tailBitsNum != 0)
+		{
+			m_selectionWords[fullWordsNum] ^= (uint64_t(1) << tailBitsNum) - 1;
+		}
+	}
+
+	//! @brief  選択されている点の数。<br>
+	size_t CountSelected() const
+	{ return MyBitsetOps::CountBits(m_selectionWords.data(), m_selectionWords.size()); }
+
+	//! @brief  選択状態を selection との集合演算の結果にする。selection の要素は点数未満であること。<br>
+	//! pOutChanges を指定すると、選択状態が変わった点の集合を書き出す（MySelectionHistory に記録する差分）。<br>
+	void ApplySelection(MyBitsetOps::SetOperation op, const MySelectionSet& selection, MySelectionSet* pOutChanges = nullptr)
+	{ selection.ApplyTo(op, m_selectionWords.data(), m_positionsX.size(), pOutChanges); }
+
+	//! @brief  点の、読み込み・生成時のインデックスを取得する。点群の外部に見せるインデックスには、これを使う。<br>
+	uint32_t GetOriginalIndex(size_t index) const
+	{ return m_originalIndices.empty() ? uint32_t(index) : m_originalIndices[index]; }
+
+	bool IsReordered() const { return !m_originalIndices.empty(); }
+
+private:
+	//! @brief  パレットの色のインデックスを探し、なければ追加する。パレットが一杯なら MaxPaletteColorsNum を返す。<br>
+	size_t FindOrAddPaletteColor(uint32_t packedColor)
+	{
+		const auto it = std::find(m_palette.begin(), m_palette.end(), packedColor);
+		if (it != m_palette.end())
+		{
+			return size_t(it - m_palette.begin());
+		}
+		if (m_palette.size() == MaxPaletteColorsNum)
+		{
+			return MaxPaletteColorsNum;
+		}
+		m_palette.push_back(packedColor);
+		return m_palette.size() - 1;
+	}
+
+public:
+	//! @brief  点の並べ替えに合わせて、元のインデックスの表を設定する。MyMortonOrder::ReorderStoreParallel() から使う。<br>
+	void SetOriginalIndices(std::vector<uint32_t>&& originalIndices)
+	{
+		assert(originalIndices.size() == m_positionsX.size());
+		m_originalIndices = std::move(originalIndices);
+	}
+};
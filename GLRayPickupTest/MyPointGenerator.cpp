@@ -0,0 +1,182 @@
+﻿#include "stdafx.h"
+#include "MyPointGenerator.hpp"
+#include "MyRandom.hpp"
+
+
+namespace
+{
+	using MyRandom::Philox4x32Counter;
+
+	// 乱数の用途ごとのストリーム番号。同じ点のインデックスでも、用途が違えば独立な乱数になる。
+	enum RandomStream
+	{
+		RandomStream_Position,
+		RandomStream_ClusterChoice,
+		RandomStream_ClusterShape,
+	};
+
+	// 一度に乱数を生成する点数。スタック上のバッファで足りる程度にしておく。
+	const size_t RandomBlockPointsNum = 1024;
+
+	struct RandomBlockBuffer
+	{
+		uint32_t Words[4][RandomBlockPointsNum];
+		uint32_t* const pWords[4];
+		RandomBlockBuffer() : pWords{ Words[0], Words[1], Words[2], Words[3] } {}
+	};
+
+	struct Cluster
+	{
+		MyVector3F Center;
+		float Sigma;
+	};
+
+	// Marsaglia (1972) の方法で、[-1, 1)^2 の一様乱数 (u, v) から球面上の一様分布の点を作る。
+	// u^2 + v^2 < 1 の場合だけ採用できる（確率 π/4）。1 ブロックに 2 組入っているので、両方とも棄却されるのは約 4.6% 。
+	bool TryMapToUnitSphere(uint32_t bitsU, uint32_t bitsV, MyVector3F& outPos)
+	{
+		const float u = MyRandom::ConvertToSignedUnitFloat(bitsU);
+		const float v = MyRandom::ConvertToSignedUnitFloat(bitsV);
+		const float s = u * u + v * v;
+		if (s >= 1.0f || s == 0.0f)
+		{
+			return false;
+		}
+		const float scale = 2.0f * std::sqrt(1.0f - s);
+		outPos = MyVector3F(u * scale, v * scale, 1.0f - 2.0f * s);
+		return true;
+	}
+
+	MyVector3F GenerateSpherePosition(uint64_t seed, uint64_t index, const uint32_t words[4])
+	{
+		MyVector3F pos;
+		if (TryMapToUnitSphere(words[0], words[1], pos) || TryMapToUnitSphere(words[2], words[3], pos))
+		{
+			return pos;
+		}
+		// 両方とも棄却された場合は、同じ点のインデックスの次のサブストリームでやり直す。
+		for (Philox4x32Counter counter = { index, RandomStream_Position, 1 }; ; ++counter.Substream)
+		{
+			uint32_t retryWords[4];
+			MyRandom::GeneratePhilox4x32(seed, counter, retryWords);
+			if (TryMapToUnitSphere(retryWords[0], retryWords[1], pos) || TryMapToUnitSphere(retryWords[2], retryWords[3], pos))
+			{
+				return pos;
+			}
+		}
+	}
+
+	// Box-Muller 法で、一様乱数 2 個から標準正規分布の乱数 2 個を作る。
+	void MapToNormalPair(uint32_t bitsR, uint32_t bitsTheta, float& outValue0, float& outValue1)
+	{
+		const float r = std::sqrt(-2.0f * std::log(MyRandom::ConvertToPositiveUnitFloat(bitsR)));
+		const float theta = MyMath::F_2PI * MyRandom::ConvertToUnitFloat(bitsTheta);
+		outValue0 = r * std::cos(theta);
+		outValue1 = r * std::sin(theta);
+	}
+
+	void GenerateClusters(uint64_t seed, float radius, Cluster outClusters[])
+	{
+		for (size_t c = 0; c < MyPointGenerator::ClustersNum; ++c)
+		{
+			const Philox4x32Counter counter = { c, RandomStream_ClusterShape, 0 };
+			uint32_t words[4];
+			MyRandom::GeneratePhilox4x32(seed, counter, words);
+			outClusters[c].Center = MyVector3F(
+				MyRandom::ConvertToSignedUnitFloat(words[0]),
+				MyRandom::ConvertToSignedUnitFloat(words[1]),
+				MyRandom::ConvertToSignedUnitFloat(words[2])) * radius;
+			outClusters[c].Sigma = radius * (0.02f + 0.16f * MyRandom::ConvertToUnitFloat(words[3]));
+		}
+	}
+} // end of namespace
+
+namespace MyPointGenerator
+{
+	const char* GetDistributionName(Distribution distribution)
+	{
+		switch (distribution)
+		{
+		case Distribution_SphereShell:
+			return "sphere_shell";
+		case Distribution_UniformBox:
+			return "uniform_box";
+		case Distribution_GaussianClusters:
+			return "clustered";
+		default:
+			return "";
+		}
+	}
+
+	bool FindDistributionByName(const char* pName, Distribution& outDistribution)
+	{
+		for (int d = 0; d < Distribution_Count; ++d)
+		{
+			if (strcmp(pName, GetDistributionName(Distribution(d))) == 0)
+			{
+				outDistribution = Distribution(d);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void GeneratePointsParallel(MyJobSystem& jobSystem, MyPointCloudStore& store, size_t pointsNum,
+		Distribution distribution, float radius, uint64_t seed)
+	{
+		store.Resize(pointsNum);
+		float* pPosX = store.GetPositionsX();
+		float* pPosY = store.GetPositionsY();
+		float* pPosZ = store.GetPositionsZ();
+		Cluster clusters[ClustersNum];
+		GenerateClusters(seed, radius, clusters);
+
+		jobSystem.ParallelFor(pointsNum, ChunkPointsNum, [&](size_t beginIndex, size_t endIndex)
+		{
+			RandomBlockBuffer positionRandom;
+			RandomBlockBuffer clusterRandom;
+			for (size_t blockBegin = beginIndex; blockBegin < endIndex; blockBegin += RandomBlockPointsNum)
+			{
+				const size_t blockSize = std::min(RandomBlockPointsNum, endIndex - blockBegin);
+				const Philox4x32Counter positionCounter = { blockBegin, RandomStream_Position, 0 };
+				MyRandom::GeneratePhilox4x32Batch(seed, positionCounter, blockSize, positionRandom.pWords);
+				if (distribution == Distribution_GaussianClusters)
+				{
+					const Philox4x32Counter clusterCounter = { blockBegin, RandomStream_ClusterChoice, 0 };
+					MyRandom::GeneratePhilox4x32Batch(seed, clusterCounter, blockSize, clusterRandom.pWords);
+				}
+				for (size_t i = 0; i < blockSize; ++i)
+				{
+					const uint32_t words[4] = { positionRandom.Words[0][i], positionRandom.Words[1][i], positionRandom.Words[2][i], positionRandom.Words[3][i] };
+					MyVector3F pos;
+					switch (distribution)
+					{
+					case Distribution_SphereShell:
+						pos = GenerateSpherePosition(seed, blockBegin + i, words) * radius;
+						break;
+					case Distribution_UniformBox:
+						pos = MyVector3F(
+							MyRandom::ConvertToSignedUnitFloat(words[0]),
+							MyRandom::ConvertToSignedUnitFloat(words[1]),
+							MyRandom::ConvertToSignedUnitFloat(words[2])) * radius;
+						break;
+					default:
+					{
+						// 乗算とシフトで [0, ClustersNum) に写像する。
+						const Cluster& cluster = clusters[(uint64_t(clusterRandom.Words[0][i]) * ClustersNum) >> 32];
+						float n0, n1, n2, n3;
+						MapToNormalPair(words[0], words[1], n0, n1);
+						MapToNormalPair(words[2], words[3], n2, n3);
+						pos = cluster.Center + MyVector3F(n0, n1, n2) * cluster.Sigma;
+						break;
+					}
+					}
+					pPosX[blockBegin + i] = pos.x;
+					pPosY[blockBegin + i] = pos.y;
+					pPosZ[blockBegin + i] = pos.z;
+				}
+			}
+		});
+		store.NotifyPositionsModified();
+	}
+}
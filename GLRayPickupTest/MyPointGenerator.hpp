@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+#include "MyJobSystem.hpp"
+
+
+//! @brief  検証・計測用のランダムな点群を、カウンター ベースの乱数 (MyRandom) で並列に生成する。<br>
+//! 各点の位置は (シード, 点のインデックス) だけから決まるので、スレッド数や処理順によらずビット単位で同じ点群になる。<br>
+namespace MyPointGenerator
+{
+	enum Distribution
+	{
+		Distribution_SphereShell, //!< 半径 radius の球面上の一様分布。<br>
+		Distribution_UniformBox, //!< 一辺 2 * radius の立方体内の一様分布。<br>
+		Distribution_GaussianClusters, //!< 立方体内のランダムな位置を中心とする、大きさの異なる正規分布の集まり。<br>
+		Distribution_Count,
+	};
+
+	const char* GetDistributionName(Distribution distribution);
+
+	//! @brief  GetDistributionName() の名前から分布を求める。見つからなければ false を返す。<br>
+	bool FindDistributionByName(const char* pName, Distribution& outDistribution);
+
+	//! @brief  ParallelFor() の 1 チャンクあたりの点数。<br>
+	const size_t ChunkPointsNum = 64 * 1024;
+
+	//! @brief  Distribution_GaussianClusters のクラスター数。<br>
+	const size_t ClustersNum = 32;
+
+	//! @brief  store の点数を pointsNum にして、原点を中心とする分布で位置座標を生成する。色と選択状態は変更しない。<br>
+	//! 球面分布は乗算・加算・平方根（いずれも IEEE 754 で正しく丸められる演算）だけで計算するので、プラットフォームによらず同じ点群になる。<br>
+	//! 正規分布は Box-Muller 法で対数と三角関数を使うので、標準ライブラリの実装が異なると最下位ビットが変わりうる。<br>
+	void GeneratePointsParallel(MyJobSystem& jobSystem, MyPointCloudStore& store, size_t pointsNum,
+		Distribution distribution, float radius, uint64_t seed);
+}
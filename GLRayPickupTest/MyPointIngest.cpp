@@ -0,0 +1,89 @@
+﻿#include "stdafx.h"
+#include "MyPointIngest.hpp"
+
+
+MyPointIngest::MyPointIngest(size_t ringCapacity)
+	: m_ring(ringCapacity)
+	, m_isRunning(false)
+	, m_producedNum(0)
+	, m_droppedNum(0)
+	, m_consumedNum()
+{
+}
+
+MyPointIngest::~MyPointIngest()
+{
+	this->Stop();
+}
+
+void MyPointIngest::Start(const Generator& generator, double pointsPerSecond)
+{
+	this->Stop();
+	// 前回の停止時に取り出されずに残った点を、新しい入力に混ぜないように捨てる。
+	m_ring.DiscardAll();
+	m_producedNum = 0;
+	m_droppedNum = 0;
+	m_consumedNum = 0;
+	m_startTime = Clock::now();
+	m_isRunning = true;
+	m_producerThread = std::thread([this, generator, pointsPerSecond]() { this->ProducerThreadMain(generator, pointsPerSecond); });
+}
+
+void MyPointIngest::Stop()
+{
+	if (m_producerThread.joinable())
+	{
+		m_isRunning = false;
+		m_producerThread.join();
+		m_stopTime = Clock::now();
+	}
+}
+
+void MyPointIngest::ProducerThreadMain(Generator generator, double pointsPerSecond)
+{
+	std::vector<Point> batch(BatchPointsNum);
+	uint64_t producedNum = 0;
+	while (m_isRunning.load(std::memory_order_relaxed))
+	{
+		if (pointsPerSecond > 0)
+		{
+			// 開始時刻からの経過時間で目標の点数に追いつくまで待つ。待ち時間の誤差が累積しないように、毎回開始時刻から計算する。
+			const auto dueTime = m_startTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(producedNum / pointsPerSecond));
+			std::this_thread::sleep_until(dueTime);
+		}
+		const size_t generatedNum = generator(batch.data(), BatchPointsNum);
+		size_t pushedNum = m_ring.TryPush(batch.data(), generatedNum);
+		if (pointsPerSecond > 0)
+		{
+			m_droppedNum.fetch_add(generatedNum - pushedNum, std::memory_order_relaxed);
+		}
+		else
+		{
+			while (pushedNum < generatedNum && m_isRunning.load(std::memory_order_relaxed))
+			{
+				std::this_thread::yield();
+				pushedNum += m_ring.TryPush(batch.data() + pushedNum, generatedNum - pushedNum);
+			}
+		}
+		producedNum += generatedNum;
+		m_producedNum.store(producedNum, std::memory_order_relaxed);
+	}
+}
+
+size_t MyPointIngest::Pop(Point* pOutPoints, size_t maxCount)
+{
+	const size_t poppedNum = m_ring.TryPop(pOutPoints, maxCount);
+	m_consumedNum += poppedNum;
+	return poppedNum;
+}
+
+MyPointIngest::Stats MyPointIngest::GetStats() const
+{
+	Stats stats = {};
+	stats.ProducedNum = m_producedNum.load(std::memory_order_relaxed);
+	stats.DroppedNum = m_droppedNum.load(std::memory_order_relaxed);
+	stats.ConsumedNum = m_consumedNum;
+	const Clock::time_point endTime = this->IsRunning() ? Clock::now() : m_stopTime;
+	stats.ElapsedSeconds = std::chrono::duration<double>(endTime - m_startTime).count();
+	return stats;
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include "MySpscRingBuffer.hpp"
+
+
+//! @brief  センサーなどから連続して届く点を、描画スレッドを止めずに受け取るためのストリーミング入力。<br>
+//! 生産者スレッドが生成関数（受信処理）を呼んで点を作り、ロックフリーの SPSC リング バッファに積む。<br>
+//! 消費者（メイン スレッド）は毎フレーム Pop() で取り出して、点群と空間インデックスに追加する。<br>
+//! 生産レートを指定した場合、リング バッファが満杯なら実際のセンサーと同様に点を捨てて数える。<br>
+//! 生産レートに 0 を指定した場合は、空きができるまで生産者が待つので、消費側の最大スループットを計測できる。<br>
+class MyPointIngest
+{
+public:
+	struct Point
+	{
+		float X, Y, Z;
+		uint32_t PackedColor;
+	};
+
+	//! 生成関数。最大 maxCount 点を書き込み、書き込んだ点数を返す。生産者スレッドから呼ばれる。<br>
+	typedef std::function<size_t(Point* pOutPoints, size_t maxCount)> Generator;
+
+	//! 生産者が 1 回に生成・追加する点数。<br>
+	static const size_t BatchPointsNum = 4096;
+
+	struct Stats
+	{
+		uint64_t ProducedNum; //!< 生成した点数（捨てた点を含む）。<br>
+		uint64_t DroppedNum; //!< リング バッファが満杯で捨てた点数。<br>
+		uint64_t ConsumedNum; //!< Pop() で取り出した点数。<br>
+		double ElapsedSeconds; //!< Start() からの経過時間。停止後は停止までの時間。<br>
+
+		double GetConsumedPointsPerSec() const { return ElapsedSeconds > 0 ? ConsumedNum / ElapsedSeconds : 0; }
+		double GetProducedPointsPerSec() const { return ElapsedSeconds > 0 ? ProducedNum / ElapsedSeconds : 0; }
+	};
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	MySpscRingBuffer<Point> m_ring;
+	std::thread m_producerThread;
+	std::atomic<bool> m_isRunning;
+	std::atomic<uint64_t> m_producedNum;
+	std::atomic<uint64_t> m_droppedNum;
+	uint64_t m_consumedNum;
+	Clock::time_point m_startTime;
+	Clock::time_point m_stopTime;
+
+public:
+	//! @brief  ringCapacity 点以上を保持できるリング バッファを確保する。<br>
+	explicit MyPointIngest(size_t ringCapacity);
+	~MyPointIngest();
+
+public:
+	//! @brief  生産者スレッドを開始する。pointsPerSecond が 0 の場合はレートを制限しない。統計はリセットされる。<br>
+	//! 前回の停止後にリング バッファに残っていた点は捨てる。<br>
+	void Start(const Generator& generator, double pointsPerSecond);
+
+	//! @brief  生産者スレッドを停止する。リング バッファに残った点は、次の Start() までは Pop() で取り出せる。<br>
+	void Stop();
+
+	bool IsRunning() const { return m_producerThread.joinable(); }
+
+	//! @brief  消費者スレッドから、最大 maxCount 点を取り出す。待機はしない。<br>
+	size_t Pop(Point* pOutPoints, size_t maxCount);
+
+	//! @brief  リング バッファに溜まっている点数の概算。<br>
+	size_t GetQueuedPointsNumApprox() const { return m_ring.GetSizeApprox(); }
+
+	size_t GetRingCapacity() const { return m_ring.GetCapacity(); }
+
+	//! @brief  統計を取得する。消費者スレッドから呼ぶこと。<br>
+	Stats GetStats() const;
+
+private:
+	MyPointIngest(const MyPointIngest&) = delete;
+	MyPointIngest& operator=(const MyPointIngest&) = delete;
+
+	void ProducerThreadMain(Generator generator, double pointsPerSecond);
+};
@@ -0,0 +1,515 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+#include "MyCollisionHelper.hpp"
+#include "MyCollisionBatch.hpp"
+
+
+//! @brief  点群の空間インデックス（八分木）。<br>
+//! 点群の全点を総当たりで交差判定すると計算量は O(n) となるが、<br>
+//! ノードの境界ボックスで枝刈りすることで、レイ近傍の点だけを判定すれば済むようになる。<br>
+//! 位置座標そのものは保持せず、点のインデックスだけを保持する。<br>
+//! 構築時の位置座標は関数オブジェクト経由で取得し、問い合わせ時は位置座標配列（SoA）を直接参照する。<br>
+class MyPointOctree
+{
+public:
+	static const uint32_t InvalidIndex = UINT32_MAX;
+	static const uint32_t LeafCapacity = 64; //!< 葉ノードあたりの点数の目安。<br>
+	static const uint32_t MaxDepth = 20; //!< 同一座標の点が大量にある場合でも無限に分割しないための上限。<br>
+
+	struct Node
+	{
+		MyVector3F CellCenter; //!< 分割セル（立方体）の中心。<br>
+		float CellHalfSize; //!< 分割セル（立方体）の一辺の半分。<br>
+		MyVector3F BoundsMin, BoundsMax; //!< 子孫の点を包含するタイトな AABB。空のノードでは Min > Max となる。<br>
+		uint32_t FirstChild; //!< 8 個の子ノードの先頭インデックス。葉ノードの場合は InvalidIndex。<br>
+		uint32_t Depth;
+		uint32_t PointsNum; //!< 子孫の点の数。<br>
+		uint32_t MinPointIndex, MaxPointIndex; //!< 子孫の点のインデックスの最小値と最大値。空のノードでは Min > Max となる。<br>
+		std::vector<uint32_t> PointIndices; //!< 葉ノードに属する点のインデックス。<br>
+	public:
+		Node(const MyVector3F& center, float halfSize, uint32_t depth)
+			: CellCenter(center)
+			, CellHalfSize(halfSize)
+			, BoundsMin(+std::numeric_limits<float>::max())
+			, BoundsMax(-std::numeric_limits<float>::max())
+			, FirstChild(InvalidIndex)
+			, Depth(depth)
+			, PointsNum()
+			, MinPointIndex(InvalidIndex)
+			, MaxPointIndex()
+		{}
+		bool IsLeaf() const { return this->FirstChild == InvalidIndex; }
+		bool IsEmpty() const { return this->BoundsMin.x > this->BoundsMax.x; }
+		//! @brief  子孫の点のインデックスが [MinPointIndex, MaxPointIndex] の連番になっているか否か。<br>
+		//! 点群を Morton 順に並べ替えてから構築した場合、大半のノードで成り立つ。<br>
+		bool HasContiguousPointIndices() const { return this->PointsNum != 0 && this->MaxPointIndex - this->MinPointIndex == this->PointsNum - 1; }
+	};
+
+	//! @brief  レイとの交差結果。<br>
+	struct RayHit
+	{
+		uint32_t PointIndex;
+		float RayParam; //!< レイ上で点に最も近い位置の媒介変数 t（MyCollision::GetLineParameterOfClosestPoint()）。小さいほど手前。<br>
+	public:
+		//! @brief  手前の順の比較。t が等しい場合はインデックスの順とするので、結果は走査順に依存しない。<br>
+		static bool IsNearer(const RayHit& a, const RayHit& b)
+		{ return (a.RayParam < b.RayParam) || (a.RayParam == b.RayParam && a.PointIndex < b.PointIndex); }
+	};
+
+private:
+	std::vector<Node> m_nodes; //!< [0] がルート。<br>
+	uint32_t m_pointsNum;
+	uint32_t m_depth; //!< 最も深いノードの深さ。<br>
+	std::vector<uint32_t> m_splitScratch;
+
+public:
+	MyPointOctree()
+		: m_pointsNum()
+		, m_depth()
+	{}
+
+public:
+	const std::vector<Node>& GetNodes() const { return m_nodes; }
+	uint32_t GetPointsNum() const { return m_pointsNum; }
+
+	//! @brief  ノードと点インデックスが確保しているメモリ量[Bytes]。<br>
+	size_t GetMemoryBytes() const
+	{
+		size_t bytes = m_nodes.capacity() * sizeof(Node) + m_splitScratch.capacity() * sizeof(uint32_t);
+		for (const auto& node : m_nodes)
+		{
+			bytes += node.PointIndices.capacity() * sizeof(uint32_t);
+		}
+		return bytes;
+	}
+
+	//! @brief  点群全体から八分木を構築する。<br>
+	//! getPosition(uint32_t index) は MyVector3F を返す関数オブジェクト。<br>
+	template<typename TPositionGetter> void Build(uint32_t pointsNum, TPositionGetter getPosition)
+	{
+		m_nodes.clear();
+		m_pointsNum = pointsNum;
+		m_depth = 0;
+		if (pointsNum == 0)
+		{
+			return;
+		}
+
+		MyVector3F vMin = getPosition(0);
+		MyVector3F vMax = vMin;
+		for (uint32_t i = 1; i < pointsNum; ++i)
+		{
+			const MyVector3F pos = getPosition(i);
+			vMin = glm::min(vMin, pos);
+			vMax = glm::max(vMax, pos);
+		}
+		// 分割セルは立方体とする。
+		const MyVector3F vExtent = (vMax - vMin) * 0.5f;
+		const float halfSize = std::max(std::max(vExtent.x, vExtent.y), std::max(vExtent.z, std::numeric_limits<float>::min()));
+
+		std::vector<uint32_t> indices(pointsNum);
+		std::vector<uint32_t> scratch(pointsNum);
+		for (uint32_t i = 0; i < pointsNum; ++i)
+		{
+			indices[i] = i;
+		}
+
+		m_nodes.push_back(Node((vMin + vMax) * 0.5f, halfSize, 0));
+		this->BuildNode(0, &indices[0], &scratch[0], pointsNum, getPosition);
+	}
+
+	//! @brief  点を 1 つ追加する。点群の末尾に追加された点を、全体を再構築せずに反映するために使う。<br>
+	//! 経路上のノードの AABB を広げて葉ノードに追加し、葉ノードの点数が LeafCapacity を超えたら、その葉だけを Build() と同じ方法で分割する。<br>
+	//! ルートのセルの外側の点は、ルートのセルを 2 倍に広げて（元のルートを子ノードにして）から追加する。<br>
+	//! 深さが MaxDepth に達している場合はそれ以上広げず、セルの外側の点もそのまま最寄りの子ノードに振り分ける（AABB は正しく保たれる）。<br>
+	template<typename TPositionGetter> void Insert(uint32_t index, TPositionGetter getPosition)
+	{
+		const MyVector3F pos = getPosition(index);
+		if (m_nodes.empty())
+		{
+			// 空の八分木の場合は、点を中心とする大きさ 1 のセルから始める。セルは外側の点が来れば広がる。
+			m_nodes.push_back(Node(pos, 0.5f, 0));
+		}
+		while (m_depth < MaxDepth && !IsInsideCell(m_nodes[0], pos))
+		{
+			this->GrowRoot(pos);
+		}
+
+		uint32_t nodeIndex = 0;
+		for (;;)
+		{
+			Node& node = m_nodes[nodeIndex];
+			node.BoundsMin = glm::min(node.BoundsMin, pos);
+			node.BoundsMax = glm::max(node.BoundsMax, pos);
+			++node.PointsNum;
+			node.MinPointIndex = std::min(node.MinPointIndex, index);
+			node.MaxPointIndex = std::max(node.MaxPointIndex, index);
+			if (node.IsLeaf())
+			{
+				break;
+			}
+			nodeIndex = node.FirstChild + GetOctant(node.CellCenter, pos);
+		}
+		++m_pointsNum;
+		Node& leaf = m_nodes[nodeIndex];
+		leaf.PointIndices.push_back(index);
+		if (leaf.PointIndices.size() > LeafCapacity && leaf.Depth < MaxDepth)
+		{
+			// 葉ノードを内部ノードにする。BuildNode() は子ノードの AABB を統合するが、この葉の AABB はすでに全点を包含している。
+			std::vector<uint32_t> indices;
+			indices.swap(leaf.PointIndices);
+			m_splitScratch.resize(indices.size());
+			this->BuildNode(nodeIndex, indices.data(), m_splitScratch.data(), uint32_t(indices.size()), getPosition);
+		}
+	}
+
+	//! @brief  直線との距離が sphereRadius 以下となる点のインデックスをすべて列挙する。<br>
+	//! 葉ノードの判定には MyCollision::CheckLineIntersectWithSphereBatchIndexed() を使う。<br>
+	//! これは MyCollision::CheckLineIntersectWithSphere() と結果が一致するので、総当たりの結果とも一致する。<br>
+	//! 出力の順序は不定。outIndices はクリアされる。<br>
+	void QueryLineIntersectWithSphere(
+		const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius,
+		const float* pPosX, const float* pPosY, const float* pPosZ, std::vector<uint32_t>& outIndices) const
+	{
+		outIndices.clear();
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		// ノードの AABB を交差マージン分だけ膨らませて、直線との交差判定を行なう。
+		// 浮動小数点の丸め誤差で境界上の点を取りこぼさないように、わずかに余裕を持たせておく。
+		const float margin = sphereRadius * 1.001f;
+		const MyVector3F vMargin(margin, margin, margin);
+		const MyCollision::LineSphereBatchQuery query(linePos1, linePos2, sphereRadius);
+
+		uint32_t stack[MaxDepth * 8 + 1];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const Node& node = m_nodes[stack[--stackSize]];
+			if (node.IsEmpty() ||
+				!MyCollision::CheckLineIntersectWithAABB(linePos1, linePos2, node.BoundsMin - vMargin, node.BoundsMax + vMargin))
+			{
+				continue;
+			}
+			if (node.IsLeaf())
+			{
+				MyCollision::CheckLineIntersectWithSphereBatchIndexed(
+					query, pPosX, pPosY, pPosZ, node.PointIndices.data(), node.PointIndices.size(), outIndices);
+			}
+			else
+			{
+				for (uint32_t c = 0; c < 8; ++c)
+				{
+					stack[stackSize++] = node.FirstChild + c;
+				}
+			}
+		}
+	}
+
+	//! @brief  linePos1 から linePos2 の方向へのレイとの距離が sphereRadius 以下となる点のうち、手前から最大 maxHitsNum 個を列挙する。<br>
+	//! 判定は QueryLineIntersectWithSphere() と同じで、レイの始点より後ろ（t < 0）の点は除く。outHits は手前の順に並ぶ。<br>
+	//! ノードを AABB に入る位置の t が小さい順に走査し、見つかった maxHitsNum 個目の t より奥のノードに達した時点で打ち切る。<br>
+	//! 交差マージンで膨らませた AABB に入る位置の t は、そのノードの点の t の下限になるので、結果は総当たりを t の順に並べたものと一致する。<br>
+	void QueryRayNearestHits(
+		const MyVector3F& linePos1, const MyVector3F& linePos2, float sphereRadius,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t maxHitsNum, std::vector<RayHit>& outHits) const
+	{
+		outHits.clear();
+		if (m_nodes.empty() || maxHitsNum == 0)
+		{
+			return;
+		}
+
+		const float margin = sphereRadius * 1.001f;
+		const MyVector3F vMargin(margin, margin, margin);
+		const MyCollision::LineSphereBatchQuery query(linePos1, linePos2, sphereRadius);
+
+		// (AABB に入る位置の t, ノード) の最小ヒープ。outHits は見つかった中で最も奥の点を先頭とする最大ヒープとして使う。
+		typedef std::pair<float, uint32_t> NodeEntry;
+		std::vector<NodeEntry> nodeHeap;
+		std::vector<uint32_t> leafHitIndices;
+		const auto pushNode = [&](uint32_t nodeIndex)
+		{
+			const Node& node = m_nodes[nodeIndex];
+			float tMin, tMax;
+			if (!node.IsEmpty() &&
+				MyCollision::CalcLineIntersectWithAABB(linePos1, linePos2, node.BoundsMin - vMargin, node.BoundsMax + vMargin, tMin, tMax) &&
+				tMax >= 0)
+			{
+				nodeHeap.push_back(NodeEntry(std::max(tMin, 0.0f), nodeIndex));
+				std::push_heap(nodeHeap.begin(), nodeHeap.end(), std::greater<NodeEntry>());
+			}
+		};
+		pushNode(0);
+		while (!nodeHeap.empty())
+		{
+			std::pop_heap(nodeHeap.begin(), nodeHeap.end(), std::greater<NodeEntry>());
+			const NodeEntry entry = nodeHeap.back();
+			nodeHeap.pop_back();
+			if (outHits.size() == maxHitsNum && entry.first > outHits.front().RayParam)
+			{
+				// 残りのノードはすべてこれより奥にある。
+				break;
+			}
+			const Node& node = m_nodes[entry.second];
+			if (!node.IsLeaf())
+			{
+				for (uint32_t c = 0; c < 8; ++c)
+				{
+					pushNode(node.FirstChild + c);
+				}
+				continue;
+			}
+			leafHitIndices.clear();
+			MyCollision::CheckLineIntersectWithSphereBatchIndexed(
+				query, pPosX, pPosY, pPosZ, node.PointIndices.data(), node.PointIndices.size(), leafHitIndices);
+			for (auto index : leafHitIndices)
+			{
+				const RayHit hit = { index, MyCollision::GetLineParameterOfClosestPoint(linePos1, linePos2, MyVector3F(pPosX[index], pPosY[index], pPosZ[index])) };
+				if (hit.RayParam < 0)
+				{
+					continue;
+				}
+				if (outHits.size() < maxHitsNum)
+				{
+					outHits.push_back(hit);
+					std::push_heap(outHits.begin(), outHits.end(), RayHit::IsNearer);
+				}
+				else if (RayHit::IsNearer(hit, outHits.front()))
+				{
+					std::pop_heap(outHits.begin(), outHits.end(), RayHit::IsNearer);
+					outHits.back() = hit;
+					std::push_heap(outHits.begin(), outHits.end(), RayHit::IsNearer);
+				}
+			}
+		}
+		std::sort_heap(outHits.begin(), outHits.end(), RayHit::IsNearer);
+	}
+
+	//! @brief  凸領域に対してノードを分類する。<br>
+	//! classifyAABB(const MyVector3F& aabbMin, const MyVector3F& aabbMax) は MyCollision::ContainmentType を返す関数オブジェクト。<br>
+	//! 凸領域に完全に含まれるノードは outInsideNodes に追加する。その点は位置座標を参照することなく EnumerateSubtreePointRanges() で列挙できる。<br>
+	//! 凸領域の境界にかかる葉ノードは outBoundaryLeaves に追加するので、呼び出し側でその点を個別に判定すること。<br>
+	//! 凸領域の外側にあるノードは点ごと棄却する。出力はノードのインデックスで、順序は不定。<br>
+	template<typename TClassifier> void QueryConvexRegion(
+		TClassifier classifyAABB, std::vector<uint32_t>& outInsideNodes, std::vector<uint32_t>& outBoundaryLeaves) const
+	{
+		outInsideNodes.clear();
+		outBoundaryLeaves.clear();
+		if (m_nodes.empty())
+		{
+			return;
+		}
+
+		uint32_t stack[MaxDepth * 8 + 1];
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const uint32_t nodeIndex = stack[--stackSize];
+			const Node& node = m_nodes[nodeIndex];
+			if (node.IsEmpty())
+			{
+				continue;
+			}
+			const MyCollision::ContainmentType containment = classifyAABB(node.BoundsMin, node.BoundsMax);
+			if (containment == MyCollision::ContainmentType_Disjoint)
+			{
+				continue;
+			}
+			if (containment == MyCollision::ContainmentType_Contains)
+			{
+				outInsideNodes.push_back(nodeIndex);
+			}
+			else if (node.IsLeaf())
+			{
+				outBoundaryLeaves.push_back(nodeIndex);
+			}
+			else
+			{
+				for (uint32_t c = 0; c < 8; ++c)
+				{
+					stack[stackSize++] = node.FirstChild + c;
+				}
+			}
+		}
+	}
+
+	//! @brief  指定ノードの子孫の点のインデックスを、連番の範囲ごとに列挙する。<br>
+	//! onRange(uint32_t beginIndex, uint32_t endIndex) は [beginIndex, endIndex) の範囲を受け取る関数オブジェクト。<br>
+	//! インデックスが連番になっている部分木は、その先を辿らずに 1 つの範囲として渡す。<br>
+	//! それ以外の葉ノードでは、点のインデックスの並びのうち連続する部分ごとに渡す。範囲の順序は不定。<br>
+	template<typename TRangeFunc> void EnumerateSubtreePointRanges(uint32_t nodeIndex, TRangeFunc onRange) const
+	{
+		uint32_t stack[MaxDepth * 8 + 1];
+		int stackSize = 0;
+		stack[stackSize++] = nodeIndex;
+		while (stackSize > 0)
+		{
+			const Node& node = m_nodes[stack[--stackSize]];
+			if (node.HasContiguousPointIndices())
+			{
+				onRange(node.MinPointIndex, node.MaxPointIndex + 1);
+			}
+			else if (node.IsLeaf())
+			{
+				for (size_t i = 0; i < node.PointIndices.size(); )
+				{
+					const uint32_t beginIndex = node.PointIndices[i];
+					uint32_t endIndex = beginIndex + 1;
+					for (++i; i < node.PointIndices.size() && node.PointIndices[i] == endIndex; ++i)
+					{
+						++endIndex;
+					}
+					onRange(beginIndex, endIndex);
+				}
+			}
+			else
+			{
+				for (uint32_t c = 0; c < 8; ++c)
+				{
+					stack[stackSize++] = node.FirstChild + c;
+				}
+			}
+		}
+	}
+
+private:
+	static bool IsInsideCell(const Node& node, const MyVector3F& pos)
+	{
+		// NaN は比較が常に偽になるので、セルの外側として扱われる（MaxDepth で止まる）。
+		return
+			std::abs(pos.x - node.CellCenter.x) <= node.CellHalfSize &&
+			std::abs(pos.y - node.CellCenter.y) <= node.CellHalfSize &&
+			std::abs(pos.z - node.CellCenter.z) <= node.CellHalfSize;
+	}
+
+	// ルートのセルを pos の方向に 2 倍に広げる。元のルートは新しいルートの子ノードになり、木全体が 1 段深くなる。
+	void GrowRoot(const MyVector3F& pos)
+	{
+		for (auto& node : m_nodes)
+		{
+			++node.Depth;
+		}
+		++m_depth;
+
+		const MyVector3F vOldCenter = m_nodes[0].CellCenter;
+		const float halfSize = m_nodes[0].CellHalfSize;
+		const MyVector3F vNewCenter(
+			vOldCenter.x + ((pos.x >= vOldCenter.x) ? +halfSize : -halfSize),
+			vOldCenter.y + ((pos.y >= vOldCenter.y) ? +halfSize : -halfSize),
+			vOldCenter.z + ((pos.z >= vOldCenter.z) ? +halfSize : -halfSize));
+		const uint32_t firstChild = uint32_t(m_nodes.size());
+		for (uint32_t c = 0; c < 8; ++c)
+		{
+			const MyVector3F vChildCenter(
+				vNewCenter.x + ((c & 1) ? +halfSize : -halfSize),
+				vNewCenter.y + ((c & 2) ? +halfSize : -halfSize),
+				vNewCenter.z + ((c & 4) ? +halfSize : -halfSize));
+			m_nodes.push_back(Node(vChildCenter, halfSize, 1));
+		}
+		// 新しいルートの子ノードのうち、元のルートのセルと一致するものを元のルートで置き換える。
+		Node& oldRootSlot = m_nodes[firstChild + GetOctant(vNewCenter, vOldCenter)];
+		oldRootSlot = std::move(m_nodes[0]);
+		Node newRoot(vNewCenter, halfSize * 2, 0);
+		newRoot.BoundsMin = oldRootSlot.BoundsMin;
+		newRoot.BoundsMax = oldRootSlot.BoundsMax;
+		newRoot.PointsNum = oldRootSlot.PointsNum;
+		newRoot.MinPointIndex = oldRootSlot.MinPointIndex;
+		newRoot.MaxPointIndex = oldRootSlot.MaxPointIndex;
+		newRoot.FirstChild = firstChild;
+		m_nodes[0] = std::move(newRoot);
+	}
+
+	static uint32_t GetOctant(const MyVector3F& center, const MyVector3F& pos)
+	{
+		return
+			((pos.x >= center.x) ? 1 : 0) |
+			((pos.y >= center.y) ? 2 : 0) |
+			((pos.z >= center.z) ? 4 : 0);
+	}
+
+	template<typename TPositionGetter> void BuildNode(uint32_t nodeIndex, uint32_t* pIndices, uint32_t* pScratch, uint32_t count, TPositionGetter& getPosition)
+	{
+		// m_nodes の再確保で参照が無効になるので、ノードはインデックスで扱う。
+		if (count <= LeafCapacity || m_nodes[nodeIndex].Depth >= MaxDepth)
+		{
+			Node& leaf = m_nodes[nodeIndex];
+			m_depth = std::max(m_depth, leaf.Depth);
+			leaf.PointIndices.assign(pIndices, pIndices + count);
+			leaf.PointsNum = count;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const MyVector3F pos = getPosition(pIndices[i]);
+				leaf.BoundsMin = glm::min(leaf.BoundsMin, pos);
+				leaf.BoundsMax = glm::max(leaf.BoundsMax, pos);
+				leaf.MinPointIndex = std::min(leaf.MinPointIndex, pIndices[i]);
+				leaf.MaxPointIndex = std::max(leaf.MaxPointIndex, pIndices[i]);
+			}
+			return;
+		}
+
+		const MyVector3F vCenter = m_nodes[nodeIndex].CellCenter;
+		const float childHalfSize = m_nodes[nodeIndex].CellHalfSize * 0.5f;
+		const uint32_t childDepth = m_nodes[nodeIndex].Depth + 1;
+
+		// 八分割のバケット ソート。
+		uint32_t counts[8] = {};
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			++counts[GetOctant(vCenter, getPosition(pIndices[i]))];
+		}
+		uint32_t offsets[8] = {};
+		for (uint32_t c = 1; c < 8; ++c)
+		{
+			offsets[c] = offsets[c - 1] + counts[c - 1];
+		}
+		{
+			uint32_t cursors[8];
+			std::copy(offsets, offsets + 8, cursors);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint32_t index = pIndices[i];
+				pScratch[cursors[GetOctant(vCenter, getPosition(index))]++] = index;
+			}
+			std::copy(pScratch, pScratch + count, pIndices);
+		}
+
+		const uint32_t firstChild = uint32_t(m_nodes.size());
+		m_nodes[nodeIndex].FirstChild = firstChild;
+		for (uint32_t c = 0; c < 8; ++c)
+		{
+			const MyVector3F vChildCenter(
+				vCenter.x + ((c & 1) ? +childHalfSize : -childHalfSize),
+				vCenter.y + ((c & 2) ? +childHalfSize : -childHalfSize),
+				vCenter.z + ((c & 4) ? +childHalfSize : -childHalfSize));
+			m_nodes.push_back(Node(vChildCenter, childHalfSize, childDepth));
+		}
+		for (uint32_t c = 0; c < 8; ++c)
+		{
+			this->BuildNode(firstChild + c, pIndices + offsets[c], pScratch + offsets[c], counts[c], getPosition);
+		}
+
+		// 子ノードの AABB とインデックスの範囲を統合する。
+		Node& node = m_nodes[nodeIndex];
+		node.PointsNum = count;
+		for (uint32_t c = 0; c < 8; ++c)
+		{
+			const Node& child = m_nodes[firstChild + c];
+			if (!child.IsEmpty())
+			{
+				node.BoundsMin = glm::min(node.BoundsMin, child.BoundsMin);
+				node.BoundsMax = glm::max(node.BoundsMax, child.BoundsMax);
+			}
+			if (child.PointsNum != 0)
+			{
+				node.MinPointIndex = std::min(node.MinPointIndex, child.MinPointIndex);
+				node.MaxPointIndex = std::max(node.MaxPointIndex, child.MaxPointIndex);
+			}
+		}
+	}
+};
@@ -0,0 +1,295 @@
+﻿#include "stdafx.h"
+#include "MyPointPicker.hpp"
+#include "MyGLHelper.hpp"
+#include "MyGLHelperBatch.hpp"
+#include "MyCollisionHelper.hpp"
+
+
+namespace
+{
+	// 密なビットセットの [beginIndex, endIndex) のビットを立てる。両端のワードはマスクで、間のワードは全ビットで埋める。
+	void SetBitRange(uint64_t* pWords, uint32_t beginIndex, uint32_t endIndex)
+	{
+		const uint32_t bitsPerWord = MyPointCloudStore::BitsPerSelectionWord;
+		if (beginIndex >= endIndex)
+		{
+			return;
+		}
+		const uint32_t beginWord = beginIndex / bitsPerWord;
+		const uint32_t lastWord = (endIndex - 1) / bitsPerWord;
+		const uint64_t beginMask = ~uint64_t(0) << (beginIndex % bitsPerWord);
+		const uint64_t lastMask = ~uint64_t(0) >> (bitsPerWord - 1 - (endIndex - 1) % bitsPerWord);
+		if (beginWord == lastWord)
+		{
+			pWords[beginWord] |= beginMask & lastMask;
+			return;
+		}
+		pWords[beginWord] |= beginMask;
+		std::fill(pWords + beginWord + 1, pWords + lastWord, ~uint64_t(0));
+		pWords[lastWord] |= lastMask;
+	}
+}
+
+
+// 参照で渡すことがあるので、定義が必要。
+const size_t MyPointPicker::DefaultTopKHitsNum;
+const size_t MyPointPicker::ParallelChunkPointsNum;
+
+MyPointPicker::MyPointPicker(MyJobSystem& jobSystem)
+	: m_jobSystem(jobSystem)
+	, m_pickMode(PickMode_Nearest)
+	, m_topKHitsNum(DefaultTopKHitsNum)
+{
+}
+
+const char* MyPointPicker::GetPickModeName(PickMode mode)
+{
+	switch (mode)
+	{
+	case PickMode_Nearest: return "Nearest";
+	case PickMode_TopK: return "TopK";
+	case PickMode_All: return "All";
+	default: return "";
+	}
+}
+
+size_t MyPointPicker::GetMaxHitsNum() const
+{
+	switch (m_pickMode)
+	{
+	case PickMode_Nearest: return 1;
+	case PickMode_TopK: return m_topKHitsNum;
+	default: return SIZE_MAX;
+	}
+}
+
+void MyPointPicker::CalcUnProjectedRayPositions(const MyMatrix4x4F& matUnproj, float screenX, float screenY,
+	MyVector3F& outWCoord0, MyVector3F& outWCoord1)
+{
+	// マウス位置 vS をワールド座標 vW に変換するには、
+	// vS = Mviewport * Mproj * Mview * vW であることから、
+	// vW = Mview^-1 * Mproj^-1 * Mviewport^-1 * vS を計算してやればよい。
+	// 逆プロジェクション変換を行なうユーティリティは、GLU の gluUnProject() や GLM の glm::unProject() が存在する。
+	// ここではビューポート設定値などをもとに計算した逆プロジェクション行列そのものを使う。
+	// なお、一般的な各種 3D 変換行列の計算アルゴリズムは、GLM のヘッダーにすべて書かれてある。
+
+	// 変換行列の計算を含めて、CPU プログラム側で完全にオフスクリーン実行すれば、OpenGL ES のバージョンにも依存しないし、Direct3D でも使える。
+	// なお、変換結果はここで入力する仮想深度値に左右されるので注意。
+	// 変換結果の座標値をそのまま利用するのではなく、交差判定に使う無限直線を算出するために Near 側と Far 側をペアで使う。
+	//
+	// もし最前面にある物体のみを取得したい場合、OpenGL レンダリングを実行した後で glReadPixels() を使って、
+	// あるピクセル位置に書き込まれた深度情報を取得して利用することもできる。
+	// もしくは glSelectBuffer(), glRenderMode(GL_SELECT), gluPickMatrix() を使う方法もある。
+	// ただしこれらの方法が OpenGL ES でも利用できるとは限らないので注意。
+	outWCoord0 = MyGLHelper::TransformVector3Coord(matUnproj, MyVector3F(screenX, screenY, 0));
+	outWCoord1 = MyGLHelper::TransformVector3Coord(matUnproj, MyVector3F(screenX, screenY, 1));
+}
+
+void MyPointPicker::QueryPointsInWorld(const MyPointCloudStore& store, const MyPointOctree& octree,
+	const MyVector3F& vWCoord0, const MyVector3F& vWCoord1, float intersectMargin, std::vector<uint32_t>& outIndices)
+{
+	if (m_pickMode == PickMode_All)
+	{
+		// 画面を貫く無限直線と、ターゲット位置を中心とし交差マージンを半径とする球の交差を、八分木を使って調べる。
+		octree.QueryLineIntersectWithSphere(vWCoord0, vWCoord1, intersectMargin,
+			store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), outIndices);
+		return;
+	}
+	octree.QueryRayNearestHits(vWCoord0, vWCoord1, intersectMargin,
+		store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), this->GetMaxHitsNum(), m_rayHits);
+	outIndices.resize(m_rayHits.size());
+	for (size_t i = 0; i < m_rayHits.size(); ++i)
+	{
+		outIndices[i] = m_rayHits[i].PointIndex;
+	}
+}
+
+void MyPointPicker::QueryPointsInScreen(const MyPointCloudStore& store, const MyMatrix4x4F& matToScreen, int viewportWidth, int viewportHeight,
+	float targetX, float targetY, float tolerance,
+	const MyVector3F& vWCoord0, const MyVector3F& vWCoord1, std::vector<uint32_t>& outIndices)
+{
+	const size_t pointsNum = store.GetPointsNum();
+	const size_t gridPointsNum = m_screenTileGrid.GetPointsNum();
+	if (gridPointsNum < pointsNum &&
+		m_screenTileGrid.IsBuiltWith(matToScreen, viewportWidth, viewportHeight, gridPointsNum, store.GetPositionsVersion()))
+	{
+		m_screenTileGrid.AppendPoints(store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(),
+			gridPointsNum, pointsNum - gridPointsNum);
+	}
+	else if (!m_screenTileGrid.IsBuiltWith(matToScreen, viewportWidth, viewportHeight, pointsNum, store.GetPositionsVersion()))
+	{
+		m_screenTileGrid.Build(matToScreen, viewportWidth, viewportHeight,
+			store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), pointsNum,
+			store.GetPositionsVersion());
+	}
+	m_screenTileGrid.QueryPointsNearScreenPos(targetX, targetY, tolerance, outIndices);
+	this->KeepFrontMostHits(outIndices, vWCoord0, vWCoord1, [&store](uint32_t index) { return store.GetPosition(index); });
+}
+
+void MyPointPicker::CheckPointsIntersectWithScreenPosParallel(const MyPointCloudStore& store, const MyMatrix4x4F& matToScreen,
+	float targetX, float targetY, float tolerance, uint64_t* pOutHitMaskWords)
+{
+	m_jobSystem.ParallelFor(store.GetPointsNum(), ParallelChunkPointsNum, [&](size_t beginIndex, size_t endIndex)
+	{
+		MyGLHelper::TransformVector3CoordAndCheckIntersectWithPointBatch(matToScreen,
+			store.GetPositionsX() + beginIndex, store.GetPositionsY() + beginIndex, store.GetPositionsZ() + beginIndex, endIndex - beginIndex,
+			targetX, targetY, tolerance,
+			pOutHitMaskWords + beginIndex / MyPointCloudStore::BitsPerSelectionWord);
+	});
+}
+
+void MyPointPicker::ApplyHitMask(MyPointCloudStore& store, MyBitsetOps::SetOperation op)
+{
+	// 交差した点が疎なら配列コンテナになるので、選択状態への反映は交差した点の数に比例する時間で済む。
+	m_hitSet.AssignDenseWords(m_hitMaskWords.data(), store.GetSelectionWordsNum());
+	store.ApplySelection(op, m_hitSet, &m_changedSet);
+}
+
+void MyPointPicker::SelectPoints(MyPointCloudStore& store, const std::vector<uint32_t>& indices, MyBitsetOps::SetOperation op)
+{
+	m_hitSet.AssignIndices(indices.data(), indices.size());
+	store.ApplySelection(op, m_hitSet, &m_changedSet);
+}
+
+void MyPointPicker::SelectPointsIntersectWithScreenPosParallel(MyPointCloudStore& store, const MyMatrix4x4F& matToScreen,
+	float targetX, float targetY, float tolerance, MyBitsetOps::SetOperation op)
+{
+	m_hitMaskWords.resize(store.GetSelectionWordsNum());
+	this->CheckPointsIntersectWithScreenPosParallel(store, matToScreen, targetX, targetY, tolerance, m_hitMaskWords.data());
+	this->ApplyHitMask(store, op);
+}
+
+void MyPointPicker::SelectPointsIntersectWithScreenRectParallel(MyPointCloudStore& store, const MyMatrix4x4F& matToScreen,
+	int rectL, int rectT, int rectR, int rectB, MyBitsetOps::SetOperation op)
+{
+	m_hitMaskWords.resize(store.GetSelectionWordsNum());
+	uint64_t* pHitMaskWords = m_hitMaskWords.data();
+	m_jobSystem.ParallelFor(store.GetPointsNum(), ParallelChunkPointsNum, [&](size_t beginIndex, size_t endIndex)
+	{
+		MyGLHelper::TransformVector3CoordAndCheckIntersectWithRectBatch(matToScreen,
+			store.GetPositionsX() + beginIndex, store.GetPositionsY() + beginIndex, store.GetPositionsZ() + beginIndex, endIndex - beginIndex,
+			rectL, rectT, rectR, rectB,
+			pHitMaskWords + beginIndex / MyPointCloudStore::BitsPerSelectionWord);
+	});
+	this->ApplyHitMask(store, op);
+}
+
+bool MyPointPicker::CheckPointIntersectWithScreenRect(const MyMatrix4x4F& matToScreen, const MyVector3F& pos,
+	int rectL, int rectT, int rectR, int rectB)
+{
+	const MyVector4F vClip = matToScreen * MyVector4F(pos, 1);
+	if (vClip.w <= 0)
+	{
+		return false;
+	}
+	const MyVector3F vScreen = MyVector3F(vClip.x / vClip.w, vClip.y / vClip.w, vClip.z / vClip.w);
+	return MyCollision::CheckIntersectWithAABBparameterizedMinMax2D(int(vScreen.x), int(vScreen.y), rectL, rectT, rectR, rectB);
+}
+
+void MyPointPicker::SelectPointsIntersectWithScreenRectByFrustum(MyPointCloudStore& store, const MyPointOctree& octree,
+	const MyMatrix4x4F& matToScreen, const MyMatrix4x4F& matUnproj,
+	int rectL, int rectT, int rectR, int rectB, MyBitsetOps::SetOperation op)
+{
+	m_hitMaskWords.assign(store.GetSelectionWordsNum(), 0);
+	// 整数に切り捨てた座標が矩形の内側（境界を含まない）に入りうるのは、幅と高さが 2 以上の場合だけ。
+	if (rectR - rectL < 2 || rectB - rectT < 2)
+	{
+		this->ApplyHitMask(store, op);
+		return;
+	}
+
+	// 交差する点のスクリーン座標 (x, y) は rectL < x < rectR を満たし、
+	// rectL + 1 < x < rectR - 1 を満たす点は必ず交差する（y も同様）。
+	// 浮動小数点の丸め誤差と、一括判定での w の逆数の近似誤差を考慮して、棄却用の視錐台は 1 ピクセル広げ、採択用の視錐台は 1.5 ピクセル狭める。
+	MyVector4F outerPlanes[4];
+	MyGLHelper::CreateFrustumPlanesFromScreenRect(outerPlanes, matUnproj,
+		float(rectL - 1), float(rectT - 1), float(rectR + 1), float(rectB + 1));
+	const float innerMargin = 1.5f;
+	const bool hasInnerFrustum = (rectR - rectL > 2 * innerMargin) && (rectB - rectT > 2 * innerMargin);
+	MyVector4F innerPlanes[4];
+	if (hasInnerFrustum)
+	{
+		MyGLHelper::CreateFrustumPlanesFromScreenRect(innerPlanes, matUnproj,
+			rectL + innerMargin, rectT + innerMargin, rectR - innerMargin, rectB - innerMargin);
+	}
+
+	octree.QueryConvexRegion([&](const MyVector3F& aabbMin, const MyVector3F& aabbMax)
+	{
+		if (MyCollision::ClassifyAABBWithPlanes(aabbMin, aabbMax, outerPlanes, 4) == MyCollision::ContainmentType_Disjoint)
+		{
+			return MyCollision::ContainmentType_Disjoint;
+		}
+		if (hasInnerFrustum && MyCollision::ClassifyAABBWithPlanes(aabbMin, aabbMax, innerPlanes, 4) == MyCollision::ContainmentType_Contains)
+		{
+			return MyCollision::ContainmentType_Contains;
+		}
+		return MyCollision::ContainmentType_Intersects;
+	}, m_frustumInsideNodes, m_frustumBoundaryLeaves);
+
+	// 境界にかかる葉ノードの点を含むワードの範囲を集めて、インデックス順に並べ、重なる範囲や隣接する範囲をまとめる。
+	// 一括判定はワード単位で結果を書き込むので、範囲はワード境界まで広げる。広げた範囲に入る他のノードの点も正しく判定される。
+	const uint32_t bitsPerWord = MyPointCloudStore::BitsPerSelectionWord;
+	m_frustumBoundaryWordRanges.clear();
+	for (auto nodeIndex : m_frustumBoundaryLeaves)
+	{
+		octree.EnumerateSubtreePointRanges(nodeIndex, [this, bitsPerWord](uint32_t beginIndex, uint32_t endIndex)
+		{
+			m_frustumBoundaryWordRanges.push_back(WordRange(beginIndex / bitsPerWord, (endIndex + bitsPerWord - 1) / bitsPerWord));
+		});
+	}
+	std::sort(m_frustumBoundaryWordRanges.begin(), m_frustumBoundaryWordRanges.end());
+	size_t mergedRangesNum = 0;
+	for (const auto& range : m_frustumBoundaryWordRanges)
+	{
+		if (mergedRangesNum > 0 && range.first <= m_frustumBoundaryWordRanges[mergedRangesNum - 1].second)
+		{
+			auto& lastRange = m_frustumBoundaryWordRanges[mergedRangesNum - 1];
+			lastRange.second = std::max(lastRange.second, range.second);
+		}
+		else
+		{
+			m_frustumBoundaryWordRanges[mergedRangesNum++] = range;
+		}
+	}
+	m_frustumBoundaryWordRanges.resize(mergedRangesNum);
+
+	// 境界の点を SelectPointsIntersectWithScreenRectParallel() と同じ一括判定で並列に調べる。
+	// 全点を ParallelChunkPointsNum 点ずつのチャンクに分け、各チャンクではそれに重なる範囲だけを判定する。
+	const size_t pointsNum = store.GetPointsNum();
+	uint64_t* pHitMaskWords = m_hitMaskWords.data();
+	m_jobSystem.ParallelFor(store.GetSelectionWordsNum(), ParallelChunkPointsNum / bitsPerWord, [&](size_t beginWord, size_t endWord)
+	{
+		auto it = std::upper_bound(m_frustumBoundaryWordRanges.begin(), m_frustumBoundaryWordRanges.end(), beginWord,
+			[](size_t word, const WordRange& range) { return word < range.second; });
+		for (; it != m_frustumBoundaryWordRanges.end() && it->first < endWord; ++it)
+		{
+			const size_t beginIndex = std::max<size_t>(it->first, beginWord) * bitsPerWord;
+			const size_t endIndex = std::min(std::min<size_t>(it->second, endWord) * bitsPerWord, pointsNum);
+			MyGLHelper::TransformVector3CoordAndCheckIntersectWithRectBatch(matToScreen,
+				store.GetPositionsX() + beginIndex, store.GetPositionsY() + beginIndex, store.GetPositionsZ() + beginIndex, endIndex - beginIndex,
+				rectL, rectT, rectR, rectB,
+				pHitMaskWords + beginIndex / bitsPerWord);
+		}
+	});
+
+	// 内側のノードの点は、インデックスの連番の範囲ごとにワード単位でビットを立てる。一括判定の結果とは OR で合わせる。
+	for (auto nodeIndex : m_frustumInsideNodes)
+	{
+		octree.EnumerateSubtreePointRanges(nodeIndex, [pHitMaskWords](uint32_t beginIndex, uint32_t endIndex)
+		{
+			SetBitRange(pHitMaskWords, beginIndex, endIndex);
+		});
+	}
+	this->ApplyHitMask(store, op);
+}
+
+size_t MyPointPicker::GetMemoryBytes() const
+{
+	return
+		m_screenTileGrid.GetMemoryBytes() +
+		m_rayHits.capacity() * sizeof(MyPointOctree::RayHit) +
+		(m_frustumInsideNodes.capacity() + m_frustumBoundaryLeaves.capacity()) * sizeof(uint32_t) +
+		m_frustumBoundaryWordRanges.capacity() * sizeof(WordRange) +
+		m_hitMaskWords.capacity() * sizeof(uint64_t) +
+		m_hitSet.GetMemoryBytes() + m_changedSet.GetMemoryBytes();
+}
@@ -0,0 +1,159 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+#include "MyPointOctree.hpp"
+#include "MyScreenTileGrid.hpp"
+#include "MyJobSystem.hpp"
+
+
+//! @brief  点群のピッキング（マウス位置の点の列挙、クリックでの選択の反転、矩形選択）。<br>
+//! 変換行列と点群、空間インデックスだけを入力とし、OpenGL には依存しないので、ウィンドウなしでも計測・検証できる。<br>
+//! ワールド座標系での判定は、マウス位置を通るレイと、点を中心とし交差マージンを半径とする球との交差判定を八分木で行なう。<br>
+//! スクリーン座標系での判定は、各点をスクリーン座標変換してマウス位置との距離を調べる。<br>
+//! ホバー判定ではタイル グリッドにキャッシュして、カメラが動かない限りマウス位置の近傍のタイルだけを調べる。<br>
+//! 判定結果の作業領域を保持するので、同一のインスタンスを複数のスレッドから同時に使わないこと。<br>
+class MyPointPicker
+{
+public:
+	//! @brief  クリックとホバーで対象とする点。<br>
+	enum PickMode
+	{
+		PickMode_Nearest, //!< 最も手前の 1 点。<br>
+		PickMode_TopK, //!< 手前から GetTopKHitsNum() 点。<br>
+		PickMode_All, //!< 交差マージン内のすべての点（レイの奥にある点も含む）。<br>
+		PickMode_Count,
+	};
+
+	static const size_t DefaultTopKHitsNum = 8;
+
+	//! @brief  スクリーン座標系での交差判定を並列化する際の 1 チャンクあたりの点数。<br>
+	//! 選択状態のビットセットのワード境界に揃えることで、各チャンクが書き込むワードは互いに重ならない。<br>
+	//! したがって、結果はスレッド数やチャンクの処理順に依存しない。<br>
+	static const size_t ParallelChunkPointsNum = 1024 * MyPointCloudStore::BitsPerSelectionWord;
+
+private:
+	typedef std::pair<uint32_t, uint32_t> WordRange; //!< 選択状態のビットセットのワードの半開区間 [first, second)。<br>
+
+private:
+	MyJobSystem& m_jobSystem;
+	PickMode m_pickMode;
+	size_t m_topKHitsNum;
+	MyScreenTileGrid m_screenTileGrid;
+	std::vector<MyPointOctree::RayHit> m_rayHits;
+	std::vector<uint32_t> m_frustumInsideNodes;
+	std::vector<uint32_t> m_frustumBoundaryLeaves;
+	std::vector<WordRange> m_frustumBoundaryWordRanges;
+	std::vector<uint64_t> m_hitMaskWords;
+	MySelectionSet m_hitSet;
+	MySelectionSet m_changedSet;
+
+public:
+	explicit MyPointPicker(MyJobSystem& jobSystem);
+
+public:
+	PickMode GetPickMode() const { return m_pickMode; }
+	void SetPickMode(PickMode mode) { m_pickMode = mode; }
+	size_t GetTopKHitsNum() const { return m_topKHitsNum; }
+	void SetTopKHitsNum(size_t hitsNum) { m_topKHitsNum = hitsNum; }
+	static const char* GetPickModeName(PickMode mode);
+
+	//! @brief  現在のピッキング モードで列挙する最大点数。PickMode_All の場合は SIZE_MAX。<br>
+	size_t GetMaxHitsNum() const;
+
+	const MyScreenTileGrid& GetScreenTileGrid() const { return m_screenTileGrid; }
+
+	//! @brief  スクリーン位置 (screenX, screenY) を通り画面に直交するレイを、Near 側 (z = 0) と Far 側 (z = 1) のワールド座標で求める。<br>
+	//! matUnproj は MyGLHelper::CreateMatrixUnProjectionScreenCoordToWorldCoord() で作成した逆プロジェクション行列。<br>
+	static void CalcUnProjectedRayPositions(const MyMatrix4x4F& matUnproj, float screenX, float screenY,
+		MyVector3F& outWCoord0, MyVector3F& outWCoord1);
+
+	//! @brief  ワールド座標系でのピッキング。レイと交差する点を、ピッキング モードに従って列挙する。<br>
+	//! 手前の点だけが必要な場合は、八分木を手前から走査して、必要な点数が見つかった時点で打ち切る。出力はそのとき手前の順。<br>
+	void QueryPointsInWorld(const MyPointCloudStore& store, const MyPointOctree& octree,
+		const MyVector3F& vWCoord0, const MyVector3F& vWCoord1, float intersectMargin, std::vector<uint32_t>& outIndices);
+
+	//! @brief  スクリーン座標系でのピッキング。タイル グリッドをカメラに合わせて更新してから、(targetX, targetY) の近傍の点を列挙する。<br>
+	//! 点群の末尾に点が追加されただけなら、追加分だけを変換してタイルに加える。<br>
+	//! 手前の点だけが必要な場合は、同じスクリーン位置を通るレイ (vWCoord0, vWCoord1) 上の位置で並べ替える。<br>
+	void QueryPointsInScreen(const MyPointCloudStore& store, const MyMatrix4x4F& matToScreen, int viewportWidth, int viewportHeight,
+		float targetX, float targetY, float tolerance,
+		const MyVector3F& vWCoord0, const MyVector3F& vWCoord1, std::vector<uint32_t>& outIndices);
+
+	//! @brief  交差した点のインデックスを、レイ上の位置が手前の順に並べ替えて、手前から GetMaxHitsNum() 点だけを残す。<br>
+	//! 八分木を使えない交差判定（スクリーン座標系、ページングされた点群）の結果に使う。PickMode_All の場合は何もしない。<br>
+	template<typename TPositionGetter> void KeepFrontMostHits(std::vector<uint32_t>& indices,
+		const MyVector3F& vWCoord0, const MyVector3F& vWCoord1, TPositionGetter getPosition)
+	{
+		if (m_pickMode == PickMode_All)
+		{
+			return;
+		}
+		m_rayHits.clear();
+		for (auto index : indices)
+		{
+			const MyPointOctree::RayHit hit = { index, MyCollision::GetLineParameterOfClosestPoint(vWCoord0, vWCoord1, getPosition(index)) };
+			if (hit.RayParam >= 0)
+			{
+				m_rayHits.push_back(hit);
+			}
+		}
+		const size_t keptNum = std::min(m_rayHits.size(), this->GetMaxHitsNum());
+		std::partial_sort(m_rayHits.begin(), m_rayHits.begin() + keptNum, m_rayHits.end(), MyPointOctree::RayHit::IsNearer);
+		indices.resize(keptNum);
+		for (size_t i = 0; i < keptNum; ++i)
+		{
+			indices[i] = m_rayHits[i].PointIndex;
+		}
+	}
+
+	//! @brief  点群の各点をスクリーン座標変換し、指定スクリーン位置と交差するかどうかのビットマスクを並列に求める。<br>
+	//! pOutHitMaskWords には store.GetSelectionWordsNum() ワード分の領域が必要。<br>
+	void CheckPointsIntersectWithScreenPosParallel(const MyPointCloudStore& store, const MyMatrix4x4F& matToScreen,
+		float targetX, float targetY, float tolerance, uint64_t* pOutHitMaskWords);
+
+	//! @brief  以下の Select* は、交差した点の集合（GetLastHitSet()）を作り、選択状態を (選択状態) op (交差した点の集合) に更新する。<br>
+	//! op が SetOperation_Replace なら交差した点だけを選択、Union なら追加、Difference なら解除、Intersection なら絞り込み、<br>
+	//! SymmetricDifference なら交差した点の選択状態を反転する。<br>
+	const MySelectionSet& GetLastHitSet() const { return m_hitSet; }
+
+	//! @brief  直前の Select* で選択状態が変わった点の集合。取り消し用の差分として MySelectionHistory に記録する。<br>
+	const MySelectionSet& GetLastChangedSet() const { return m_changedSet; }
+
+	//! @brief  インデックスを列挙済みの点（QueryPointsInWorld() などの結果）で選択状態を更新する。<br>
+	void SelectPoints(MyPointCloudStore& store, const std::vector<uint32_t>& indices, MyBitsetOps::SetOperation op);
+
+	//! @brief  指定スクリーン位置と交差する点で選択状態を並列に更新する。ピッキング モードによらず、交差するすべての点が対象。<br>
+	void SelectPointsIntersectWithScreenPosParallel(MyPointCloudStore& store, const MyMatrix4x4F& matToScreen,
+		float targetX, float targetY, float tolerance, MyBitsetOps::SetOperation op);
+
+	//! @brief  スクリーン矩形と交差する点で選択状態を更新する。判定結果のビットマスクを並列に求める。<br>
+	//! 判定には MyGLHelper::TransformVector3CoordAndCheckIntersectWithRectBatch() を使う。<br>
+	void SelectPointsIntersectWithScreenRectParallel(MyPointCloudStore& store, const MyMatrix4x4F& matToScreen,
+		int rectL, int rectT, int rectR, int rectB, MyBitsetOps::SetOperation op);
+
+	//! @brief  スクリーン矩形と交差する点で選択状態を更新する。<br>
+	//! 矩形をワールド座標系の視錐台（側面 4 平面）に変換し、八分木のノード単位で包含判定する。<br>
+	//! 完全に内側のノードは点を調べずにすべて選択し、完全に外側のノードは点ごと棄却するので、<br>
+	//! スクリーン座標変換するのは視錐台の境界にかかる葉ノードの点（を含むワード）だけで済む。境界の点は並列に一括判定する。<br>
+	//! 内側のノードの点は、インデックスが連番になっている部分木ごとにワード単位でビットを立てるので、<br>
+	//! 点群を Morton 順に並べ替えてあれば、点ごとの処理は境界の点だけになる。<br>
+	//! 判定基準は SelectPointsIntersectWithScreenRectParallel() と同じで、結果も一致する。<br>
+	void SelectPointsIntersectWithScreenRectByFrustum(MyPointCloudStore& store, const MyPointOctree& octree,
+		const MyMatrix4x4F& matToScreen, const MyMatrix4x4F& matUnproj,
+		int rectL, int rectT, int rectR, int rectB, MyBitsetOps::SetOperation op);
+
+	//! @brief  点をスクリーン座標変換し、スクリーン矩形との交差判定を行なう。<br>
+	//! スクリーン座標を整数に切り捨てた上で、矩形の内側（境界を含まない）にあれば交差とみなす。視点の後方（w <= 0）にある点は交差しない。<br>
+	static bool CheckPointIntersectWithScreenRect(const MyMatrix4x4F& matToScreen, const MyVector3F& pos,
+		int rectL, int rectT, int rectR, int rectB);
+
+	//! @brief  作業領域とタイル グリッドが確保しているメモリ量[Bytes]の概算。<br>
+	size_t GetMemoryBytes() const;
+
+private:
+	//! @brief  m_hitMaskWords から交差した点の集合を作り、選択状態に反映する。<br>
+	void ApplyHitMask(MyPointCloudStore& store, MyBitsetOps::SetOperation op);
+
+	MyPointPicker(const MyPointPicker&) = delete;
+	MyPointPicker& operator=(const MyPointPicker&) = delete;
+};
@@ -0,0 +1,237 @@
+﻿#include "stdafx.h"
+#include "MyRandom.hpp"
+
+#include <immintrin.h>
+
+
+// 各カーネルは、SIMD レーンごとに 1 ブロックを担当して GeneratePhilox4x32Block() と同じ演算を行なう。
+// 32bit x 32bit → 64bit の乗算命令 (pmuludq) は 64bit レーンの偶数側 32bit しか読まないので、
+// 奇数レーンは 32bit 右シフトしてから乗算し、上位・下位の 32bit をそれぞれ組み立て直す。
+
+namespace
+{
+	using MyRandom::Philox4x32Counter;
+	using namespace MyRandom::Detail;
+
+	typedef void(*BatchKernel)(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4]);
+
+	void GenerateBatchScalar(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4])
+	{
+		Philox4x32Counter counter = firstCounter;
+		for (size_t i = 0; i < count; ++i, ++counter.Index)
+		{
+			uint32_t words[4];
+			MyRandom::GeneratePhilox4x32(seed, counter, words);
+			for (int j = 0; j < 4; ++j)
+			{
+				ppOutWords[j][i] = words[j];
+			}
+		}
+	}
+
+#pragma region // SSE2 //
+
+	inline void MultiplyHiLoSSE2(__m128i a, __m128i multiplier, __m128i& outHi, __m128i& outLo)
+	{
+		const __m128i maskLo = _mm_set1_epi64x(0xFFFFFFFF);
+		const __m128i even = _mm_mul_epu32(a, multiplier);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), multiplier);
+		outLo = _mm_or_si128(_mm_and_si128(even, maskLo), _mm_slli_epi64(odd, 32));
+		outHi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(maskLo, odd));
+	}
+
+	void GenerateBatchSSE2(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4])
+	{
+		const __m128i multiplier0 = _mm_set1_epi32(int(PhiloxMultiplier0));
+		const __m128i multiplier1 = _mm_set1_epi32(int(PhiloxMultiplier1));
+		const size_t simdCount = count & ~size_t(3);
+		for (size_t i = 0; i < simdCount; i += 4)
+		{
+			const uint64_t index = firstCounter.Index + i;
+			__m128i w0 = _mm_setr_epi32(int(uint32_t(index)), int(uint32_t(index + 1)), int(uint32_t(index + 2)), int(uint32_t(index + 3)));
+			__m128i w1 = _mm_setr_epi32(int(uint32_t(index >> 32)), int(uint32_t((index + 1) >> 32)), int(uint32_t((index + 2) >> 32)), int(uint32_t((index + 3) >> 32)));
+			__m128i w2 = _mm_set1_epi32(int(firstCounter.Stream));
+			__m128i w3 = _mm_set1_epi32(int(firstCounter.Substream));
+			uint32_t key0 = uint32_t(seed);
+			uint32_t key1 = uint32_t(seed >> 32);
+			for (int round = 0; round < PhiloxRoundsNum; ++round)
+			{
+				if (round > 0)
+				{
+					key0 += PhiloxWeyl0;
+					key1 += PhiloxWeyl1;
+				}
+				__m128i hi0, lo0, hi1, lo1;
+				MultiplyHiLoSSE2(w0, multiplier0, hi0, lo0);
+				MultiplyHiLoSSE2(w2, multiplier1, hi1, lo1);
+				w0 = _mm_xor_si128(_mm_xor_si128(hi1, w1), _mm_set1_epi32(int(key0)));
+				w1 = lo1;
+				w2 = _mm_xor_si128(_mm_xor_si128(hi0, w3), _mm_set1_epi32(int(key1)));
+				w3 = lo0;
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ppOutWords[0] + i), w0);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ppOutWords[1] + i), w1);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ppOutWords[2] + i), w2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(ppOutWords[3] + i), w3);
+		}
+		if (simdCount < count)
+		{
+			Philox4x32Counter restCounter = firstCounter;
+			restCounter.Index += simdCount;
+			uint32_t* const ppRestWords[4] = { ppOutWords[0] + simdCount, ppOutWords[1] + simdCount, ppOutWords[2] + simdCount, ppOutWords[3] + simdCount };
+			GenerateBatchScalar(seed, restCounter, count - simdCount, ppRestWords);
+		}
+	}
+
+#pragma endregion
+
+#pragma region // AVX2 //
+
+	MY_SIMD_TARGET_AVX2 inline void MultiplyHiLoAVX2(__m256i a, __m256i multiplier, __m256i& outHi, __m256i& outLo)
+	{
+		const __m256i even = _mm256_mul_epu32(a, multiplier);
+		const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), multiplier);
+		outLo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+		outHi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+	}
+
+	MY_SIMD_TARGET_AVX2 void GenerateBatchAVX2(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4])
+	{
+		const __m256i multiplier0 = _mm256_set1_epi32(int(PhiloxMultiplier0));
+		const __m256i multiplier1 = _mm256_set1_epi32(int(PhiloxMultiplier1));
+		const __m256i laneOffsets = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const size_t simdCount = count & ~size_t(7);
+		for (size_t i = 0; i < simdCount; i += 8)
+		{
+			const uint64_t index = firstCounter.Index + i;
+			// 8 ブロックの途中で下位 32bit が桁あふれする場合だけ、上位ワードがレーンごとに異なる。
+			__m256i w0 = _mm256_add_epi32(_mm256_set1_epi32(int(uint32_t(index))), laneOffsets);
+			__m256i w1 = (uint32_t(index) <= UINT32_MAX - 7)
+				? _mm256_set1_epi32(int(uint32_t(index >> 32)))
+				: _mm256_setr_epi32(
+					int(uint32_t(index >> 32)), int(uint32_t((index + 1) >> 32)), int(uint32_t((index + 2) >> 32)), int(uint32_t((index + 3) >> 32)),
+					int(uint32_t((index + 4) >> 32)), int(uint32_t((index + 5) >> 32)), int(uint32_t((index + 6) >> 32)), int(uint32_t((index + 7) >> 32)));
+			__m256i w2 = _mm256_set1_epi32(int(firstCounter.Stream));
+			__m256i w3 = _mm256_set1_epi32(int(firstCounter.Substream));
+			uint32_t key0 = uint32_t(seed);
+			uint32_t key1 = uint32_t(seed >> 32);
+			for (int round = 0; round < PhiloxRoundsNum; ++round)
+			{
+				if (round > 0)
+				{
+					key0 += PhiloxWeyl0;
+					key1 += PhiloxWeyl1;
+				}
+				__m256i hi0, lo0, hi1, lo1;
+				MultiplyHiLoAVX2(w0, multiplier0, hi0, lo0);
+				MultiplyHiLoAVX2(w2, multiplier1, hi1, lo1);
+				w0 = _mm256_xor_si256(_mm256_xor_si256(hi1, w1), _mm256_set1_epi32(int(key0)));
+				w1 = lo1;
+				w2 = _mm256_xor_si256(_mm256_xor_si256(hi0, w3), _mm256_set1_epi32(int(key1)));
+				w3 = lo0;
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(ppOutWords[0] + i), w0);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(ppOutWords[1] + i), w1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(ppOutWords[2] + i), w2);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(ppOutWords[3] + i), w3);
+		}
+		if (simdCount < count)
+		{
+			Philox4x32Counter restCounter = firstCounter;
+			restCounter.Index += simdCount;
+			uint32_t* const ppRestWords[4] = { ppOutWords[0] + simdCount, ppOutWords[1] + simdCount, ppOutWords[2] + simdCount, ppOutWords[3] + simdCount };
+			GenerateBatchScalar(seed, restCounter, count - simdCount, ppRestWords);
+		}
+	}
+
+#pragma endregion
+
+#ifdef MY_SIMD_SUPPORTS_AVX512
+#pragma region // AVX-512 //
+
+	MY_SIMD_TARGET_AVX512 inline void MultiplyHiLoAVX512(__m512i a, __m512i multiplier, __m512i& outHi, __m512i& outLo)
+	{
+		const __m512i even = _mm512_mul_epu32(a, multiplier);
+		const __m512i odd = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), multiplier);
+		outLo = _mm512_mask_blend_epi32(0xAAAA, even, _mm512_slli_epi64(odd, 32));
+		outHi = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, 32), odd);
+	}
+
+	MY_SIMD_TARGET_AVX512 void GenerateBatchAVX512(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4])
+	{
+		const __m512i multiplier0 = _mm512_set1_epi32(int(PhiloxMultiplier0));
+		const __m512i multiplier1 = _mm512_set1_epi32(int(PhiloxMultiplier1));
+		const __m512i laneOffsets = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+		const size_t simdCount = count & ~size_t(15);
+		for (size_t i = 0; i < simdCount; i += 16)
+		{
+			const uint64_t index = firstCounter.Index + i;
+			__m512i w0 = _mm512_add_epi32(_mm512_set1_epi32(int(uint32_t(index))), laneOffsets);
+			__m512i w1 = _mm512_set1_epi32(int(uint32_t(index >> 32)));
+			if (uint32_t(index) > UINT32_MAX - 15)
+			{
+				// 下位 32bit が桁あふれしたレーン（加算結果が元の値より小さいレーン）だけ、上位ワードに 1 を足す。
+				const __mmask16 carryMask = _mm512_cmplt_epu32_mask(w0, _mm512_set1_epi32(int(uint32_t(index))));
+				w1 = _mm512_mask_add_epi32(w1, carryMask, w1, _mm512_set1_epi32(1));
+			}
+			__m512i w2 = _mm512_set1_epi32(int(firstCounter.Stream));
+			__m512i w3 = _mm512_set1_epi32(int(firstCounter.Substream));
+			uint32_t key0 = uint32_t(seed);
+			uint32_t key1 = uint32_t(seed >> 32);
+			for (int round = 0; round < PhiloxRoundsNum; ++round)
+			{
+				if (round > 0)
+				{
+					key0 += PhiloxWeyl0;
+					key1 += PhiloxWeyl1;
+				}
+				__m512i hi0, lo0, hi1, lo1;
+				MultiplyHiLoAVX512(w0, multiplier0, hi0, lo0);
+				MultiplyHiLoAVX512(w2, multiplier1, hi1, lo1);
+				w0 = _mm512_xor_si512(_mm512_xor_si512(hi1, w1), _mm512_set1_epi32(int(key0)));
+				w1 = lo1;
+				w2 = _mm512_xor_si512(_mm512_xor_si512(hi0, w3), _mm512_set1_epi32(int(key1)));
+				w3 = lo0;
+			}
+			_mm512_storeu_si512(ppOutWords[0] + i, w0);
+			_mm512_storeu_si512(ppOutWords[1] + i, w1);
+			_mm512_storeu_si512(ppOutWords[2] + i, w2);
+			_mm512_storeu_si512(ppOutWords[3] + i, w3);
+		}
+		if (simdCount < count)
+		{
+			Philox4x32Counter restCounter = firstCounter;
+			restCounter.Index += simdCount;
+			uint32_t* const ppRestWords[4] = { ppOutWords[0] + simdCount, ppOutWords[1] + simdCount, ppOutWords[2] + simdCount, ppOutWords[3] + simdCount };
+			GenerateBatchScalar(seed, restCounter, count - simdCount, ppRestWords);
+		}
+	}
+
+#pragma endregion
+#endif
+
+	BatchKernel GetBatchKernel()
+	{
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+#ifdef MY_SIMD_SUPPORTS_AVX512
+		case MyCpuFeatures::SimdLevel_AVX512:
+			return GenerateBatchAVX512;
+#endif
+		case MyCpuFeatures::SimdLevel_AVX2:
+			return GenerateBatchAVX2;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			return GenerateBatchSSE2;
+		default:
+			return GenerateBatchScalar;
+		}
+	}
+} // end of namespace
+
+namespace MyRandom
+{
+	void GeneratePhilox4x32Batch(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4])
+	{
+		GetBatchKernel()(seed, firstCounter, count, ppOutWords);
+	}
+}
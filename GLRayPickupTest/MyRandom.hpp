@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "MyCpuFeatures.hpp"
+
+
+//! @brief  カウンター ベースの乱数生成器 Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC'11)。<br>
+//! 内部状態を持たず、(シード, カウンター) から 32bit 整数 4 個を直接計算する。<br>
+//! 点のインデックスをカウンターにすれば、どの点をどのスレッドがどの順序で生成しても結果は同じになる。<br>
+//! 整数の乗算・排他的論理和・加算しか使わないので、コンパイラやプラットフォームによらずビット単位で同じ結果になる。<br>
+namespace MyRandom
+{
+	//! @brief  Philox4x32 のカウンター。<br>
+	//! (Index, Stream, Substream) として使い分ける。Index には点のインデックスなど、Stream には用途の識別子を入れる。<br>
+	//! Substream は、1 つの Index に対して 4 個より多くの乱数が必要な場合（棄却法のやり直しなど）に使う。<br>
+	struct Philox4x32Counter
+	{
+		uint64_t Index;
+		uint32_t Stream;
+		uint32_t Substream;
+	};
+
+	namespace Detail
+	{
+		const uint32_t PhiloxMultiplier0 = 0xD2511F53;
+		const uint32_t PhiloxMultiplier1 = 0xCD9E8D57;
+		const uint32_t PhiloxWeyl0 = 0x9E3779B9; //!< 黄金比。<br>
+		const uint32_t PhiloxWeyl1 = 0xBB67AE85; //!< sqrt(3) - 1。<br>
+		const int PhiloxRoundsNum = 10;
+
+		inline void MultiplyHiLo(uint32_t a, uint32_t b, uint32_t& outHi, uint32_t& outLo)
+		{
+			const uint64_t product = uint64_t(a) * b;
+			outHi = uint32_t(product >> 32);
+			outLo = uint32_t(product);
+		}
+	}
+
+	//! @brief  1 ブロック（32bit 整数 4 個）を生成する。<br>
+	//! words は入力のカウンター（4 ワード）で、出力で上書きされる。key はシード（2 ワード）。<br>
+	inline void GeneratePhilox4x32Block(uint32_t words[4], uint32_t key0, uint32_t key1)
+	{
+		using namespace Detail;
+		for (int round = 0; round < PhiloxRoundsNum; ++round)
+		{
+			if (round > 0)
+			{
+				key0 += PhiloxWeyl0;
+				key1 += PhiloxWeyl1;
+			}
+			uint32_t hi0, lo0, hi1, lo1;
+			MultiplyHiLo(PhiloxMultiplier0, words[0], hi0, lo0);
+			MultiplyHiLo(PhiloxMultiplier1, words[2], hi1, lo1);
+			const uint32_t w1 = words[1];
+			const uint32_t w3 = words[3];
+			words[0] = hi1 ^ w1 ^ key0;
+			words[1] = lo1;
+			words[2] = hi0 ^ w3 ^ key1;
+			words[3] = lo0;
+		}
+	}
+
+	//! @brief  シード seed とカウンター counter に対応する 32bit 整数 4 個を生成する。<br>
+	inline void GeneratePhilox4x32(uint64_t seed, const Philox4x32Counter& counter, uint32_t outWords[4])
+	{
+		outWords[0] = uint32_t(counter.Index);
+		outWords[1] = uint32_t(counter.Index >> 32);
+		outWords[2] = counter.Stream;
+		outWords[3] = counter.Substream;
+		GeneratePhilox4x32Block(outWords, uint32_t(seed), uint32_t(seed >> 32));
+	}
+
+	//! @brief  カウンターの Index が firstCounter.Index から連続する count ブロックを一括生成する。<br>
+	//! 出力は SoA で、i 番目のブロックの j 番目のワードを ppOutWords[j][i] に書き込む。<br>
+	//! 使用する SIMD 命令セットは MyCpuFeatures::GetActiveSimdLevel() による。結果は GeneratePhilox4x32() と完全に一致する。<br>
+	void GeneratePhilox4x32Batch(uint64_t seed, const Philox4x32Counter& firstCounter, size_t count, uint32_t* const ppOutWords[4]);
+
+	//! @brief  32bit 整数の上位 24bit を [0, 1) の float に変換する。float の仮数部に収まるので丸め誤差は生じない。<br>
+	inline float ConvertToUnitFloat(uint32_t bits)
+	{
+		return float(bits >> 8) * (1.0f / 16777216.0f);
+	}
+
+	//! @brief  32bit 整数の上位 24bit を [-1, 1) の float に変換する。丸め誤差は生じない。<br>
+	inline float ConvertToSignedUnitFloat(uint32_t bits)
+	{
+		return float(bits >> 8) * (1.0f / 8388608.0f) - 1.0f;
+	}
+
+	//! @brief  32bit 整数の上位 24bit を (0, 1] の float に変換する。対数を取る場合に 0 を避けるために使う。<br>
+	inline float ConvertToPositiveUnitFloat(uint32_t bits)
+	{
+		return float((bits >> 8) + 1) * (1.0f / 16777216.0f);
+	}
+}
@@ -0,0 +1,234 @@
+﻿#include "stdafx.h"
+#include "MyScreenTileGrid.hpp"
+#include "MyGLHelperBatch.hpp"
+
+
+MyScreenTileGrid::MyScreenTileGrid()
+	: m_tilesNumX()
+	, m_tilesNumY()
+	, m_originX()
+	, m_originY()
+	, m_buildKey()
+	, m_isBuilt()
+	, m_buildsCount()
+{
+}
+
+bool MyScreenTileGrid::IsBuiltWith(const MyMatrix4x4F& matToScreen, int viewportWidth, int viewportHeight, size_t pointsNum, uint64_t positionsVersion) const
+{
+	return m_isBuilt &&
+		m_buildKey.MatToScreen == matToScreen &&
+		m_buildKey.ViewportWidth == viewportWidth &&
+		m_buildKey.ViewportHeight == viewportHeight &&
+		m_buildKey.PointsNum == pointsNum &&
+		m_buildKey.PositionsVersion == positionsVersion;
+}
+
+int MyScreenTileGrid::CalcTileX(float screenX) const
+{
+	// 減算と正の定数の乗算は単調なので、screenX の大小関係はタイル番号の大小関係に保存される。
+	// 整数への変換でオーバーフローしないよう、グリッドの 1 タイル外側までに制限してから変換する。
+	const float clamped = std::min(std::max(screenX, m_originX - TileSizeInPixels), m_originX + float((m_tilesNumX + 1) * TileSizeInPixels));
+	return int(std::floor((clamped - m_originX) * (1.0f / TileSizeInPixels)));
+}
+
+int MyScreenTileGrid::CalcTileY(float screenY) const
+{
+	const float clamped = std::min(std::max(screenY, m_originY - TileSizeInPixels), m_originY + float((m_tilesNumY + 1) * TileSizeInPixels));
+	return int(std::floor((clamped - m_originY) * (1.0f / TileSizeInPixels)));
+}
+
+uint32_t MyScreenTileGrid::CalcTileIndex(float screenX, float screenY) const
+{
+	const float gridMaxX = m_originX + float(m_tilesNumX * TileSizeInPixels);
+	const float gridMaxY = m_originY + float(m_tilesNumY * TileSizeInPixels);
+	// NaN は比較が常に偽になるので、範囲外として扱われる。
+	const bool isInside =
+		(screenX >= m_originX) && (screenX < gridMaxX) &&
+		(screenY >= m_originY) && (screenY < gridMaxY);
+	if (!isInside)
+	{
+		return UINT32_MAX;
+	}
+	// グリッド右端・下端の丸め誤差で範囲を超えないようにする。
+	const int tileX = std::min(CalcTileX(screenX), m_tilesNumX - 1);
+	const int tileY = std::min(CalcTileY(screenY), m_tilesNumY - 1);
+	return uint32_t(tileY * m_tilesNumX + tileX);
+}
+
+void MyScreenTileGrid::Build(const MyMatrix4x4F& matToScreen, int viewportWidth, int viewportHeight,
+	const float* pPosX, const float* pPosY, const float* pPosZ, size_t pointsNum, uint64_t positionsVersion)
+{
+	m_buildKey.MatToScreen = matToScreen;
+	m_buildKey.ViewportWidth = viewportWidth;
+	m_buildKey.ViewportHeight = viewportHeight;
+	m_buildKey.PointsNum = pointsNum;
+	m_buildKey.PositionsVersion = positionsVersion;
+	m_isBuilt = true;
+	++m_buildsCount;
+
+	m_originX = float(-MarginInPixels);
+	m_originY = float(-MarginInPixels);
+	m_tilesNumX = (std::max(viewportWidth, 1) + 2 * MarginInPixels + TileSizeInPixels - 1) / TileSizeInPixels;
+	m_tilesNumY = (std::max(viewportHeight, 1) + 2 * MarginInPixels + TileSizeInPixels - 1) / TileSizeInPixels;
+	const uint32_t tilesNum = uint32_t(m_tilesNumX * m_tilesNumY);
+
+	// 追加リストは容量を残したまま空にする。
+	m_appendedTileEntries.resize(tilesNum);
+	for (auto& entries : m_appendedTileEntries)
+	{
+		entries.clear();
+	}
+
+	m_scratchX.resize(pointsNum);
+	m_scratchY.resize(pointsNum);
+	m_scratchZ.resize(pointsNum);
+	MyGLHelper::TransformVector3CoordBatch(matToScreen, pPosX, pPosY, pPosZ, pointsNum,
+		m_scratchX.data(), m_scratchY.data(), m_scratchZ.data());
+
+	// 計数ソートでタイルごとに振り分ける。グリッド範囲外の点は別のリストに入れる。
+	m_tileOffsets.assign(tilesNum + 1, 0);
+	m_scratchTileIndices.resize(pointsNum);
+	m_outsideEntries.clear();
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		const float sx = m_scratchX[i];
+		const float sy = m_scratchY[i];
+		const uint32_t tileIndex = this->CalcTileIndex(sx, sy);
+		m_scratchTileIndices[i] = tileIndex;
+		if (tileIndex != UINT32_MAX)
+		{
+			++m_tileOffsets[tileIndex + 1];
+		}
+		else
+		{
+			const Entry entry = { uint32_t(i), sx, sy };
+			m_outsideEntries.push_back(entry);
+		}
+	}
+	for (uint32_t t = 0; t < tilesNum; ++t)
+	{
+		m_tileOffsets[t + 1] += m_tileOffsets[t];
+	}
+	m_entries.resize(m_tileOffsets[tilesNum]);
+	std::vector<uint32_t> writePositions(m_tileOffsets.begin(), m_tileOffsets.end() - 1);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		const uint32_t tileIndex = m_scratchTileIndices[i];
+		if (tileIndex != UINT32_MAX)
+		{
+			Entry& entry = m_entries[writePositions[tileIndex]++];
+			entry.PointIndex = uint32_t(i);
+			entry.ScreenX = m_scratchX[i];
+			entry.ScreenY = m_scratchY[i];
+		}
+	}
+}
+
+void MyScreenTileGrid::AppendPoints(const float* pPosX, const float* pPosY, const float* pPosZ, size_t firstIndex, size_t count)
+{
+	assert(m_isBuilt && firstIndex == m_buildKey.PointsNum);
+	m_buildKey.PointsNum = firstIndex + count;
+
+	m_scratchX.resize(count);
+	m_scratchY.resize(count);
+	m_scratchZ.resize(count);
+	MyGLHelper::TransformVector3CoordBatch(m_buildKey.MatToScreen, pPosX + firstIndex, pPosY + firstIndex, pPosZ + firstIndex, count,
+		m_scratchX.data(), m_scratchY.data(), m_scratchZ.data());
+	for (size_t i = 0; i < count; ++i)
+	{
+		const Entry entry = { uint32_t(firstIndex + i), m_scratchX[i], m_scratchY[i] };
+		const uint32_t tileIndex = this->CalcTileIndex(entry.ScreenX, entry.ScreenY);
+		if (tileIndex != UINT32_MAX)
+		{
+			m_appendedTileEntries[tileIndex].push_back(entry);
+		}
+		else
+		{
+			m_outsideEntries.push_back(entry);
+		}
+	}
+}
+
+void MyScreenTileGrid::QueryPointsNearScreenPos(float targetX, float targetY, float tolerance, std::vector<uint32_t>& outIndices) const
+{
+	outIndices.clear();
+	if (!m_isBuilt)
+	{
+		return;
+	}
+
+	// TransformVector3CoordAndCheckIntersectWithPointBatch() と同じ式で判定する。
+	const auto intersects = [&](const Entry& entry)
+	{
+		return
+			(targetX > entry.ScreenX - tolerance) &&
+			(targetX < entry.ScreenX + tolerance) &&
+			(targetY > entry.ScreenY - tolerance) &&
+			(targetY < entry.ScreenY + tolerance);
+	};
+
+	// 交差する点のスクリーン座標は (target - tolerance, target + tolerance) の範囲にあるので、
+	// その範囲を覆うタイルだけを調べればよい。丸め誤差を考慮して 1 ピクセル広げておく。
+	const float queryMinX = targetX - tolerance - 1;
+	const float queryMaxX = targetX + tolerance + 1;
+	const float queryMinY = targetY - tolerance - 1;
+	const float queryMaxY = targetY + tolerance + 1;
+	const float gridMaxX = m_originX + float(m_tilesNumX * TileSizeInPixels);
+	const float gridMaxY = m_originY + float(m_tilesNumY * TileSizeInPixels);
+	const int tileMinX = std::max(CalcTileX(queryMinX), 0);
+	const int tileMaxX = std::min(CalcTileX(queryMaxX), m_tilesNumX - 1);
+	const int tileMinY = std::max(CalcTileY(queryMinY), 0);
+	const int tileMaxY = std::min(CalcTileY(queryMaxY), m_tilesNumY - 1);
+	for (int tileY = tileMinY; tileY <= tileMaxY; ++tileY)
+	{
+		for (int tileX = tileMinX; tileX <= tileMaxX; ++tileX)
+		{
+			const uint32_t tileIndex = uint32_t(tileY * m_tilesNumX + tileX);
+			for (uint32_t e = m_tileOffsets[tileIndex]; e < m_tileOffsets[tileIndex + 1]; ++e)
+			{
+				if (intersects(m_entries[e]))
+				{
+					outIndices.push_back(m_entries[e].PointIndex);
+				}
+			}
+			for (const auto& entry : m_appendedTileEntries[tileIndex])
+			{
+				if (intersects(entry))
+				{
+					outIndices.push_back(entry.PointIndex);
+				}
+			}
+		}
+	}
+
+	// 問い合わせ範囲がグリッドからはみ出す場合だけ、範囲外の点も調べる。
+	const bool isQueryInsideGrid =
+		(queryMinX >= m_originX) && (queryMaxX < gridMaxX) &&
+		(queryMinY >= m_originY) && (queryMaxY < gridMaxY);
+	if (!isQueryInsideGrid)
+	{
+		for (const auto& entry : m_outsideEntries)
+		{
+			if (intersects(entry))
+			{
+				outIndices.push_back(entry.PointIndex);
+			}
+		}
+	}
+}
+
+size_t MyScreenTileGrid::GetMemoryBytes() const
+{
+	size_t bytes =
+		m_tileOffsets.capacity() * sizeof(uint32_t) +
+		(m_entries.capacity() + m_outsideEntries.capacity()) * sizeof(Entry) +
+		(m_scratchX.capacity() + m_scratchY.capacity() + m_scratchZ.capacity()) * sizeof(float) +
+		m_scratchTileIndices.capacity() * sizeof(uint32_t) +
+		m_appendedTileEntries.capacity() * sizeof(std::vector<Entry>);
+	for (const auto& entries : m_appendedTileEntries)
+	{
+		bytes += entries.capacity() * sizeof(Entry);
+	}
+	return bytes;
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+
+
+//! @brief  スクリーン座標系のタイル グリッド。点群の各点をスクリーン座標変換し、その位置のタイルに振り分けて保持する。<br>
+//! カメラやビューポートが変化しない限り、マウス位置の近傍のタイルだけを調べればホバー判定ができるので、<br>
+//! 毎フレーム全点をスクリーン座標変換する必要がなくなる。判定コストは点群全体の点数ではなく、カーソル近傍の点の密度に比例する。<br>
+//! スクリーン座標変換には MyGLHelper::TransformVector3CoordBatch() を使うので、<br>
+//! MyGLHelper::TransformVector3CoordAndCheckIntersectWithPointBatch() と完全に同じ判定結果になる。<br>
+class MyScreenTileGrid
+{
+public:
+	static const int TileSizeInPixels = 16;
+	static const int MarginInPixels = 64; //!< ビューポートの外側にもこの幅だけタイルを用意する。<br>
+
+private:
+	// タイルに振り分けた点。同じタイルの点は連続して格納される。
+	struct Entry
+	{
+		uint32_t PointIndex;
+		float ScreenX, ScreenY;
+	};
+
+	// 構築時の条件。これが一致する限り、再構築は不要。
+	struct BuildKey
+	{
+		MyMatrix4x4F MatToScreen;
+		int ViewportWidth, ViewportHeight;
+		size_t PointsNum;
+		uint64_t PositionsVersion;
+	};
+
+private:
+	int m_tilesNumX, m_tilesNumY;
+	float m_originX, m_originY; //!< タイル (0, 0) の左上のスクリーン座標。<br>
+	std::vector<uint32_t> m_tileOffsets; //!< タイル t の点は m_entries[m_tileOffsets[t], m_tileOffsets[t + 1])。<br>
+	std::vector<Entry> m_entries;
+	std::vector<Entry> m_outsideEntries; //!< グリッド範囲外（非有限値を含む）に射影された点。<br>
+	std::vector<std::vector<Entry>> m_appendedTileEntries; //!< 構築後に AppendPoints() で追加された点の、タイルごとのリスト。<br>
+	std::vector<float> m_scratchX, m_scratchY, m_scratchZ;
+	std::vector<uint32_t> m_scratchTileIndices;
+	BuildKey m_buildKey;
+	bool m_isBuilt;
+	uint32_t m_buildsCount;
+
+public:
+	MyScreenTileGrid();
+
+public:
+	//! @brief  指定された条件で構築済みか否か。<br>
+	bool IsBuiltWith(const MyMatrix4x4F& matToScreen, int viewportWidth, int viewportHeight, size_t pointsNum, uint64_t positionsVersion) const;
+
+	//! @brief  点群の各点をスクリーン座標変換し、タイルに振り分ける。<br>
+	//! positionsVersion は位置座標の変更を検知するための値で、IsBuiltWith() との照合にだけ使う。<br>
+	void Build(const MyMatrix4x4F& matToScreen, int viewportWidth, int viewportHeight,
+		const float* pPosX, const float* pPosY, const float* pPosZ, size_t pointsNum, uint64_t positionsVersion);
+
+	//! @brief  構築済みのグリッドに、点群の末尾に追加された点 [firstIndex, firstIndex + count) を振り分ける。<br>
+	//! 構築時と同じ変換行列で変換してタイルごとの追加リストに入れるので、再構築せずにホバー判定の対象にできる。<br>
+	//! 呼び出し後は pointsNum = firstIndex + count として IsBuiltWith() が成り立つ。firstIndex は GetPointsNum() と一致すること。<br>
+	void AppendPoints(const float* pPosX, const float* pPosY, const float* pPosZ, size_t firstIndex, size_t count);
+
+	//! @brief  振り分け済みの点数。<br>
+	size_t GetPointsNum() const { return m_buildKey.PointsNum; }
+
+	//! @brief  (targetX, targetY) を中心とし tolerance を半径とする正方形の内側（境界を含まない）に射影された点を列挙する。<br>
+	//! 各点のスクリーン位置を中心とする正方形の内側に (targetX, targetY) があるかどうか、と同値。outIndices はクリアされる。出力の順序は不定。<br>
+	void QueryPointsNearScreenPos(float targetX, float targetY, float tolerance, std::vector<uint32_t>& outIndices) const;
+
+	//! @brief  構築した回数。再構築の頻度の確認用。<br>
+	uint32_t GetBuildsCount() const { return m_buildsCount; }
+
+	//! @brief  確保しているメモリ量[Bytes]。<br>
+	size_t GetMemoryBytes() const;
+
+private:
+	int CalcTileX(float screenX) const;
+	int CalcTileY(float screenY) const;
+	//! スクリーン座標のタイル番号。グリッド範囲外の場合は UINT32_MAX。<br>
+	uint32_t CalcTileIndex(float screenX, float screenY) const;
+};
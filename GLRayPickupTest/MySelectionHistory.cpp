@@ -0,0 +1,98 @@
+﻿#include "stdafx.h"
+#include "MySelectionHistory.hpp"
+
+
+void MySelectionHistory::Clear()
+{
+	m_entries.clear();
+	m_appliedEntriesNum = 0;
+	m_memoryBytes = 0;
+}
+
+void MySelectionHistory::SetMemoryBudgetBytes(size_t bytes)
+{
+	m_memoryBudgetBytes = bytes;
+	// 取り消し可能な操作は古い順に捨てる。
+	// やり直し可能な操作は順に適用しないと意味がないので、それしか残っていなければ新しい順に捨てる。
+	while (!m_entries.empty() && m_memoryBytes > m_memoryBudgetBytes)
+	{
+		if (m_appliedEntriesNum > 0)
+		{
+			m_memoryBytes -= m_entries.front().Bytes;
+			m_entries.pop_front();
+			--m_appliedEntriesNum;
+		}
+		else
+		{
+			m_memoryBytes -= m_entries.back().Bytes;
+			m_entries.pop_back();
+		}
+		++m_discardedEntriesNum;
+	}
+}
+
+void MySelectionHistory::PushEntry(Entry&& entry)
+{
+	// やり直し可能な操作は、新しい操作で上書きされる。
+	while (m_entries.size() > m_appliedEntriesNum)
+	{
+		m_memoryBytes -= m_entries.back().Bytes;
+		m_entries.pop_back();
+	}
+	m_memoryBytes += entry.Bytes;
+	m_entries.push_back(std::move(entry));
+	++m_appliedEntriesNum;
+	// 1 操作だけで上限を超える場合は、その操作も取り消せなくなる。
+	this->SetMemoryBudgetBytes(m_memoryBudgetBytes);
+}
+
+void MySelectionHistory::Record(const MySelectionSet& changes, const char* pLabel)
+{
+	if (changes.IsEmpty())
+	{
+		return;
+	}
+	Entry entry = { changes, false, 0, pLabel, 0 };
+	entry.Bytes = sizeof(Entry) + entry.Changes.GetMemoryBytes();
+	this->PushEntry(std::move(entry));
+}
+
+void MySelectionHistory::RecordInvertAll(size_t pointsNum, const char* pLabel)
+{
+	Entry entry = { MySelectionSet(), true, pointsNum, pLabel, sizeof(Entry) };
+	this->PushEntry(std::move(entry));
+}
+
+void MySelectionHistory::ApplyEntry(const Entry& entry, MyPointCloudStore& store)
+{
+	if (entry.InvertsAll)
+	{
+		store.InvertSelection(entry.InvertedPointsNum);
+	}
+	else
+	{
+		store.ApplySelection(MyBitsetOps::SetOperation_SymmetricDifference, entry.Changes);
+	}
+}
+
+const char* MySelectionHistory::Undo(MyPointCloudStore& store)
+{
+	if (!this->CanUndo())
+	{
+		return nullptr;
+	}
+	const Entry& entry = m_entries[--m_appliedEntriesNum];
+	ApplyEntry(entry, store);
+	return entry.pLabel;
+}
+
+const char* MySelectionHistory::Redo(MyPointCloudStore& store)
+{
+	if (!this->CanRedo())
+	{
+		return nullptr;
+	}
+	const Entry& entry = m_entries[m_appliedEntriesNum++];
+	ApplyEntry(entry, store);
+	return entry.pLabel;
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "MyPointCloudStore.hpp"
+
+
+//! @brief  選択操作の取り消し・やり直しの履歴。<br>
+//! 操作ごとに選択状態のスナップショットを持つと 1 操作あたり点数 / 8 バイトかかるので、<br>
+//! 操作の前後で所属が変わった点の集合（前後の状態の XOR）だけを圧縮ビットセット（MySelectionSet）で持つ。<br>
+//! XOR は自己逆なので、取り消しもやり直しも同じ差分を対称差で適用するだけで済み、時間は変化した点の数（ビットマップ コンテナならその範囲）に比例する。<br>
+//! 全点の反転は差分を持たず、反転したことだけを記録する。<br>
+//! 差分の合計が上限を超えたら、古い操作から捨てる。<br>
+class MySelectionHistory
+{
+public:
+	static const size_t DefaultMemoryBudgetBytes = 64 * 1024 * 1024;
+
+private:
+	struct Entry
+	{
+		MySelectionSet Changes;
+		bool InvertsAll; //!< 先頭の InvertedPointsNum 点の反転。Changes は空。<br>
+		size_t InvertedPointsNum; //!< 反転したときの点数。後から追加された点は反転の対象外。<br>
+		const char* pLabel;
+		size_t Bytes;
+	};
+
+private:
+	std::deque<Entry> m_entries; //!< 古い順。<br>
+	size_t m_appliedEntriesNum; //!< 先頭からこの数までが取り消し可能、残りはやり直し可能。<br>
+	size_t m_memoryBudgetBytes;
+	size_t m_memoryBytes;
+	size_t m_discardedEntriesNum; //!< 上限を超えたために捨てた操作の累計。<br>
+
+public:
+	explicit MySelectionHistory(size_t memoryBudgetBytes = DefaultMemoryBudgetBytes)
+		: m_appliedEntriesNum()
+		, m_memoryBudgetBytes(memoryBudgetBytes)
+		, m_memoryBytes()
+		, m_discardedEntriesNum()
+	{}
+
+public:
+	//! @brief  点群を読み込み直すなど、インデックスの意味が変わったときに呼ぶ。<br>
+	void Clear();
+
+	//! @brief  差分の合計の上限を設定する。超えている分は古い操作から捨てる。<br>
+	void SetMemoryBudgetBytes(size_t bytes);
+	size_t GetMemoryBudgetBytes() const { return m_memoryBudgetBytes; }
+	size_t GetMemoryBytes() const { return m_memoryBytes; }
+
+	//! @brief  選択状態を変えた操作を記録する。changes は所属が変わった点の集合（MySelectionSet::ApplyTo() の出力）。<br>
+	//! 変化がなければ何も記録しない。記録するとやり直し可能な操作は捨てる。<br>
+	//! pLabel は静的な文字列であること。<br>
+	void Record(const MySelectionSet& changes, const char* pLabel);
+
+	//! @brief  全点（pointsNum 点）の選択状態を反転した操作を記録する。<br>
+	//! 取り消し・やり直しでは、その後に点が追加されていても先頭の pointsNum 点だけを反転する。<br>
+	void RecordInvertAll(size_t pointsNum, const char* pLabel);
+
+	bool CanUndo() const { return m_appliedEntriesNum > 0; }
+	bool CanRedo() const { return m_appliedEntriesNum < m_entries.size(); }
+	size_t GetUndoableNum() const { return m_appliedEntriesNum; }
+	size_t GetRedoableNum() const { return m_entries.size() - m_appliedEntriesNum; }
+	size_t GetDiscardedEntriesNum() const { return m_discardedEntriesNum; }
+
+	//! @brief  直前の操作を取り消す。取り消した操作のラベルを返す。取り消せなければ nullptr。<br>
+	const char* Undo(MyPointCloudStore& store);
+
+	//! @brief  取り消した操作をやり直す。やり直した操作のラベルを返す。やり直せなければ nullptr。<br>
+	const char* Redo(MyPointCloudStore& store);
+
+private:
+	void PushEntry(Entry&& entry);
+	static void ApplyEntry(const Entry& entry, MyPointCloudStore& store);
+
+	MySelectionHistory(const MySelectionHistory&) = delete;
+	MySelectionHistory& operator=(const MySelectionHistory&) = delete;
+};
@@ -0,0 +1,865 @@
+﻿#include "stdafx.h"
+#include "MySelectionSet.hpp"
+#include "MyCpuFeatures.hpp"
+
+#include <immintrin.h>
+
+
+namespace
+{
+	using MyBitsetOps::SetOperation;
+
+	typedef void(*ApplyKernel)(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum);
+	typedef void(*InvertKernel)(uint64_t* pDst, size_t wordsNum);
+	typedef size_t(*CountKernel)(const uint64_t* pWords, size_t wordsNum);
+
+	inline uint64_t CombineWord(SetOperation op, uint64_t a, uint64_t b)
+	{
+		switch (op)
+		{
+		case MyBitsetOps::SetOperation_Replace:
+			return b;
+		case MyBitsetOps::SetOperation_Union:
+			return a | b;
+		case MyBitsetOps::SetOperation_Difference:
+			return a & ~b;
+		case MyBitsetOps::SetOperation_Intersection:
+			return a & b;
+		default:
+			return a ^ b;
+		}
+	}
+
+	void ApplyScalar(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum)
+	{
+		for (size_t i = 0; i < wordsNum; ++i)
+		{
+			pDst[i] = CombineWord(op, pDst[i], pSrc[i]);
+		}
+	}
+
+	void InvertScalar(uint64_t* pDst, size_t wordsNum)
+	{
+		for (size_t i = 0; i < wordsNum; ++i)
+		{
+			pDst[i] = ~pDst[i];
+		}
+	}
+
+	size_t CountScalar(const uint64_t* pWords, size_t wordsNum)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < wordsNum; ++i)
+		{
+			count += MyMath::GetSetBitsCount(pWords[i]);
+		}
+		return count;
+	}
+
+#pragma region // SSE2 //
+
+	inline __m128i CombineSSE2(SetOperation op, __m128i a, __m128i b)
+	{
+		switch (op)
+		{
+		case MyBitsetOps::SetOperation_Replace:
+			return b;
+		case MyBitsetOps::SetOperation_Union:
+			return _mm_or_si128(a, b);
+		case MyBitsetOps::SetOperation_Difference:
+			return _mm_andnot_si128(b, a);
+		case MyBitsetOps::SetOperation_Intersection:
+			return _mm_and_si128(a, b);
+		default:
+			return _mm_xor_si128(a, b);
+		}
+	}
+
+	void ApplySSE2(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum)
+	{
+		size_t i = 0;
+		for (; i + 2 <= wordsNum; i += 2)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pDst + i));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), CombineSSE2(op, a, b));
+		}
+		ApplyScalar(op, pDst + i, pSrc + i, wordsNum - i);
+	}
+
+	void InvertSSE2(uint64_t* pDst, size_t wordsNum)
+	{
+		const __m128i allOnes = _mm_set1_epi32(-1);
+		size_t i = 0;
+		for (; i + 2 <= wordsNum; i += 2)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pDst + i));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm_xor_si128(a, allOnes));
+		}
+		InvertScalar(pDst + i, wordsNum - i);
+	}
+
+	// 各バイトのビット数をビット演算で求め、PSADBW で 64bit レーンごとに合計する。
+	size_t CountSSE2(const uint64_t* pWords, size_t wordsNum)
+	{
+		const __m128i mask1 = _mm_set1_epi8(0x55);
+		const __m128i mask2 = _mm_set1_epi8(0x33);
+		const __m128i mask4 = _mm_set1_epi8(0x0F);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i total = zero;
+		size_t i = 0;
+		for (; i + 2 <= wordsNum; i += 2)
+		{
+			__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pWords + i));
+			x = _mm_sub_epi8(x, _mm_and_si128(_mm_srli_epi64(x, 1), mask1));
+			x = _mm_add_epi8(_mm_and_si128(x, mask2), _mm_and_si128(_mm_srli_epi64(x, 2), mask2));
+			x = _mm_and_si128(_mm_add_epi8(x, _mm_srli_epi64(x, 4)), mask4);
+			total = _mm_add_epi64(total, _mm_sad_epu8(x, zero));
+		}
+		uint64_t lanes[2];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), total);
+		return size_t(lanes[0] + lanes[1]) + CountScalar(pWords + i, wordsNum - i);
+	}
+
+#pragma endregion
+
+#pragma region // AVX2 //
+
+	MY_SIMD_TARGET_AVX2 inline __m256i CombineAVX2(SetOperation op, __m256i a, __m256i b)
+	{
+		switch (op)
+		{
+		case MyBitsetOps::SetOperation_Replace:
+			return b;
+		case MyBitsetOps::SetOperation_Union:
+			return _mm256_or_si256(a, b);
+		case MyBitsetOps::SetOperation_Difference:
+			return _mm256_andnot_si256(b, a);
+		case MyBitsetOps::SetOperation_Intersection:
+			return _mm256_and_si256(a, b);
+		default:
+			return _mm256_xor_si256(a, b);
+		}
+	}
+
+	MY_SIMD_TARGET_AVX2 void ApplyAVX2(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum)
+	{
+		size_t i = 0;
+		for (; i + 4 <= wordsNum; i += 4)
+		{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pDst + i));
+			const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSrc + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), CombineAVX2(op, a, b));
+		}
+		ApplyScalar(op, pDst + i, pSrc + i, wordsNum - i);
+	}
+
+	MY_SIMD_TARGET_AVX2 void InvertAVX2(uint64_t* pDst, size_t wordsNum)
+	{
+		const __m256i allOnes = _mm256_set1_epi32(-1);
+		size_t i = 0;
+		for (; i + 4 <= wordsNum; i += 4)
+		{
+			const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pDst + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(pDst + i), _mm256_xor_si256(a, allOnes));
+		}
+		InvertScalar(pDst + i, wordsNum - i);
+	}
+
+	// 4bit ごとのビット数を PSHUFB の表引きで求め (Mula et al., "Faster Population Counts Using AVX2 Instructions", 2018)、
+	// PSADBW で 64bit レーンごとに合計する。
+	MY_SIMD_TARGET_AVX2 size_t CountAVX2(const uint64_t* pWords, size_t wordsNum)
+	{
+		const __m256i table = _mm256_setr_epi8(
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i mask4 = _mm256_set1_epi8(0x0F);
+		const __m256i zero = _mm256_setzero_si256();
+		__m256i total = zero;
+		size_t i = 0;
+		for (; i + 4 <= wordsNum; i += 4)
+		{
+			const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pWords + i));
+			const __m256i countLo = _mm256_shuffle_epi8(table, _mm256_and_si256(x, mask4));
+			const __m256i countHi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask4));
+			total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(countLo, countHi), zero));
+		}
+		uint64_t lanes[4];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+		return size_t(lanes[0] + lanes[1] + lanes[2] + lanes[3]) + CountScalar(pWords + i, wordsNum - i);
+	}
+
+#pragma endregion
+
+#ifdef MY_SIMD_SUPPORTS_AVX512
+#pragma region // AVX-512 //
+
+	MY_SIMD_TARGET_AVX512 inline __m512i CombineAVX512(SetOperation op, __m512i a, __m512i b)
+	{
+		switch (op)
+		{
+		case MyBitsetOps::SetOperation_Replace:
+			return b;
+		case MyBitsetOps::SetOperation_Union:
+			return _mm512_or_si512(a, b);
+		case MyBitsetOps::SetOperation_Difference:
+			return _mm512_andnot_si512(b, a);
+		case MyBitsetOps::SetOperation_Intersection:
+			return _mm512_and_si512(a, b);
+		default:
+			return _mm512_xor_si512(a, b);
+		}
+	}
+
+	MY_SIMD_TARGET_AVX512 void ApplyAVX512(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum)
+	{
+		size_t i = 0;
+		for (; i + 8 <= wordsNum; i += 8)
+		{
+			const __m512i a = _mm512_loadu_si512(pDst + i);
+			const __m512i b = _mm512_loadu_si512(pSrc + i);
+			_mm512_storeu_si512(pDst + i, CombineAVX512(op, a, b));
+		}
+		ApplyScalar(op, pDst + i, pSrc + i, wordsNum - i);
+	}
+
+	MY_SIMD_TARGET_AVX512 void InvertAVX512(uint64_t* pDst, size_t wordsNum)
+	{
+		const __m512i allOnes = _mm512_set1_epi32(-1);
+		size_t i = 0;
+		for (; i + 8 <= wordsNum; i += 8)
+		{
+			const __m512i a = _mm512_loadu_si512(pDst + i);
+			_mm512_storeu_si512(pDst + i, _mm512_xor_si512(a, allOnes));
+		}
+		InvertScalar(pDst + i, wordsNum - i);
+	}
+
+	// ビット数の計数に使える VPOPCNTQ は AVX-512F には含まれない（AVX512_VPOPCNTDQ 拡張）ので、AVX-512 の水準でも AVX2 版を使う。
+
+#pragma endregion
+#endif
+
+	ApplyKernel GetApplyKernel()
+	{
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+#ifdef MY_SIMD_SUPPORTS_AVX512
+		case MyCpuFeatures::SimdLevel_AVX512:
+			return ApplyAVX512;
+#endif
+		case MyCpuFeatures::SimdLevel_AVX2:
+			return ApplyAVX2;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			return ApplySSE2;
+		default:
+			return ApplyScalar;
+		}
+	}
+
+	InvertKernel GetInvertKernel()
+	{
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+#ifdef MY_SIMD_SUPPORTS_AVX512
+		case MyCpuFeatures::SimdLevel_AVX512:
+			return InvertAVX512;
+#endif
+		case MyCpuFeatures::SimdLevel_AVX2:
+			return InvertAVX2;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			return InvertSSE2;
+		default:
+			return InvertScalar;
+		}
+	}
+
+	CountKernel GetCountKernel()
+	{
+		switch (MyCpuFeatures::GetActiveSimdLevel())
+		{
+		case MyCpuFeatures::SimdLevel_AVX512:
+		case MyCpuFeatures::SimdLevel_AVX2:
+			return CountAVX2;
+		case MyCpuFeatures::SimdLevel_SSE2:
+			return CountSSE2;
+		default:
+			return CountScalar;
+		}
+	}
+
+	inline uint32_t GetContainerKey(uint32_t index)
+	{ return index / MySelectionSet::PointsPerContainer; }
+
+	inline uint16_t GetContainerValue(uint32_t index)
+	{ return uint16_t(index % MySelectionSet::PointsPerContainer); }
+
+	inline bool TestBit(const uint64_t* pWords, uint32_t value)
+	{ return ((pWords[value / 64] >> (value % 64)) & 1) != 0; }
+} // end of namespace
+
+namespace MyBitsetOps
+{
+	const char* GetSetOperationName(SetOperation op)
+	{
+		switch (op)
+		{
+		case SetOperation_Replace:
+			return "Replace";
+		case SetOperation_Union:
+			return "Union";
+		case SetOperation_Difference:
+			return "Difference";
+		case SetOperation_Intersection:
+			return "Intersection";
+		case SetOperation_SymmetricDifference:
+			return "SymmetricDifference";
+		default:
+			return "Unknown";
+		}
+	}
+
+	void ApplyWords(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum)
+	{
+		GetApplyKernel()(op, pDst, pSrc, wordsNum);
+	}
+
+	void InvertWords(uint64_t* pDst, size_t wordsNum)
+	{
+		GetInvertKernel()(pDst, wordsNum);
+	}
+
+	size_t CountBits(const uint64_t* pWords, size_t wordsNum)
+	{
+		return GetCountKernel()(pWords, wordsNum);
+	}
+}
+
+size_t MySelectionSet::GetCardinality() const
+{
+	size_t cardinality = 0;
+	for (const auto& container : m_containers)
+	{
+		cardinality += container.Cardinality;
+	}
+	return cardinality;
+}
+
+size_t MySelectionSet::GetBitmapContainersNum() const
+{
+	return size_t(std::count_if(m_containers.begin(), m_containers.end(), [](const Container& container) { return container.IsBitmap(); }));
+}
+
+size_t MySelectionSet::GetMemoryBytes() const
+{
+	size_t bytes = m_containers.capacity() * sizeof(Container) +
+		m_scratchValues.capacity() * sizeof(uint16_t) + m_scratchIndices.capacity() * sizeof(uint32_t);
+	for (const auto& container : m_containers)
+	{
+		bytes += container.Values.capacity() * sizeof(uint16_t) + container.Words.capacity() * sizeof(uint64_t);
+	}
+	return bytes;
+}
+
+MySelectionSet::Container* MySelectionSet::FindContainer(uint32_t key)
+{
+	auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container& container, uint32_t k) { return container.Key < k; });
+	return (it != m_containers.end() && it->Key == key) ? &*it : nullptr;
+}
+
+const MySelectionSet::Container* MySelectionSet::FindContainer(uint32_t key) const
+{
+	return const_cast<MySelectionSet*>(this)->FindContainer(key);
+}
+
+MySelectionSet::Container& MySelectionSet::FindOrInsertContainer(uint32_t key)
+{
+	auto it = std::lower_bound(m_containers.begin(), m_containers.end(), key, [](const Container& container, uint32_t k) { return container.Key < k; });
+	if (it == m_containers.end() || it->Key != key)
+	{
+		Container container = { key, 0, std::vector<uint16_t>(), std::vector<uint64_t>() };
+		it = m_containers.insert(it, std::move(container));
+	}
+	return *it;
+}
+
+void MySelectionSet::ConvertToBitmap(Container& container)
+{
+	if (container.IsBitmap())
+	{
+		return;
+	}
+	container.Words.assign(WordsPerContainer, 0);
+	for (auto value : container.Values)
+	{
+		container.Words[value / 64] |= uint64_t(1) << (value % 64);
+	}
+	std::vector<uint16_t>().swap(container.Values);
+}
+
+void MySelectionSet::NormalizeContainer(Container& container)
+{
+	if (container.IsBitmap())
+	{
+		container.Cardinality = uint32_t(MyBitsetOps::CountBits(container.Words.data(), WordsPerContainer));
+		if (container.Cardinality <= MaxArrayCardinality)
+		{
+			container.Values.clear();
+			container.Values.reserve(container.Cardinality);
+			for (size_t w = 0; w < WordsPerContainer; ++w)
+			{
+				uint64_t bits = container.Words[w];
+				while (bits != 0)
+				{
+					container.Values.push_back(uint16_t(w * 64 + MyMath::GetLowestSetBitIndex(bits)));
+					bits &= bits - 1;
+				}
+			}
+			std::vector<uint64_t>().swap(container.Words);
+		}
+	}
+	else
+	{
+		container.Cardinality = uint32_t(container.Values.size());
+		if (container.Cardinality > MaxArrayCardinality)
+		{
+			ConvertToBitmap(container);
+		}
+	}
+}
+
+bool MySelectionSet::Contains(uint32_t index) const
+{
+	const Container* pContainer = this->FindContainer(GetContainerKey(index));
+	if (!pContainer)
+	{
+		return false;
+	}
+	const uint16_t value = GetContainerValue(index);
+	return pContainer->IsBitmap() ?
+		TestBit(pContainer->Words.data(), value) :
+		std::binary_search(pContainer->Values.begin(), pContainer->Values.end(), value);
+}
+
+void MySelectionSet::Add(uint32_t index)
+{
+	Container& container = this->FindOrInsertContainer(GetContainerKey(index));
+	const uint16_t value = GetContainerValue(index);
+	if (container.IsBitmap())
+	{
+		uint64_t& word = container.Words[value / 64];
+		const uint64_t bit = uint64_t(1) << (value % 64);
+		container.Cardinality += (word & bit) ? 0 : 1;
+		word |= bit;
+		return;
+	}
+	auto it = std::lower_bound(container.Values.begin(), container.Values.end(), value);
+	if (it == container.Values.end() || *it != value)
+	{
+		container.Values.insert(it, value);
+		++container.Cardinality;
+		if (container.Cardinality > MaxArrayCardinality)
+		{
+			ConvertToBitmap(container);
+		}
+	}
+}
+
+void MySelectionSet::Remove(uint32_t index)
+{
+	Container* pContainer = this->FindContainer(GetContainerKey(index));
+	if (!pContainer)
+	{
+		return;
+	}
+	const uint16_t value = GetContainerValue(index);
+	if (pContainer->IsBitmap())
+	{
+		uint64_t& word = pContainer->Words[value / 64];
+		const uint64_t bit = uint64_t(1) << (value % 64);
+		if (word & bit)
+		{
+			word &= ~bit;
+			if (--pContainer->Cardinality <= MaxArrayCardinality)
+			{
+				NormalizeContainer(*pContainer);
+			}
+		}
+	}
+	else
+	{
+		auto it = std::lower_bound(pContainer->Values.begin(), pContainer->Values.end(), value);
+		if (it != pContainer->Values.end() && *it == value)
+		{
+			pContainer->Values.erase(it);
+			--pContainer->Cardinality;
+		}
+	}
+	if (pContainer->Cardinality == 0)
+	{
+		m_containers.erase(m_containers.begin() + (pContainer - m_containers.data()));
+	}
+}
+
+void MySelectionSet::Toggle(uint32_t index)
+{
+	if (this->Contains(index))
+	{
+		this->Remove(index);
+	}
+	else
+	{
+		this->Add(index);
+	}
+}
+
+void MySelectionSet::AssignIndices(const uint32_t* pIndices, size_t indicesNum)
+{
+	m_scratchIndices.assign(pIndices, pIndices + indicesNum);
+	std::sort(m_scratchIndices.begin(), m_scratchIndices.end());
+	m_scratchIndices.erase(std::unique(m_scratchIndices.begin(), m_scratchIndices.end()), m_scratchIndices.end());
+	m_containers.clear();
+	for (size_t begin = 0; begin < m_scratchIndices.size();)
+	{
+		const uint32_t key = GetContainerKey(m_scratchIndices[begin]);
+		size_t end = begin + 1;
+		while (end < m_scratchIndices.size() && GetContainerKey(m_scratchIndices[end]) == key)
+		{
+			++end;
+		}
+		Container container = { key, uint32_t(end - begin), std::vector<uint16_t>(), std::vector<uint64_t>() };
+		container.Values.reserve(end - begin);
+		for (size_t i = begin; i < end; ++i)
+		{
+			container.Values.push_back(GetContainerValue(m_scratchIndices[i]));
+		}
+		NormalizeContainer(container);
+		m_containers.push_back(std::move(container));
+		begin = end;
+	}
+}
+
+void MySelectionSet::AppendDenseBlock(uint32_t key, const uint64_t* pBlockWords, size_t blockWordsNum)
+{
+	assert(m_containers.empty() || m_containers.back().Key < key);
+	if (MyBitsetOps::CountBits(pBlockWords, blockWordsNum) == 0)
+	{
+		return;
+	}
+	Container container = { key, 0, std::vector<uint16_t>(), std::vector<uint64_t>() };
+	container.Words.assign(WordsPerContainer, 0);
+	std::copy(pBlockWords, pBlockWords + blockWordsNum, container.Words.begin());
+	NormalizeContainer(container);
+	m_containers.push_back(std::move(container));
+}
+
+void MySelectionSet::AppendArrayBlock(uint32_t key, const std::vector<uint16_t>& values)
+{
+	assert(m_containers.empty() || m_containers.back().Key < key);
+	if (values.empty())
+	{
+		return;
+	}
+	Container container = { key, 0, std::vector<uint16_t>(), std::vector<uint64_t>() };
+	container.Values = values;
+	NormalizeContainer(container);
+	m_containers.push_back(std::move(container));
+}
+
+void MySelectionSet::AssignDenseWords(const uint64_t* pWords, size_t wordsNum)
+{
+	m_containers.clear();
+	for (size_t base = 0; base < wordsNum; base += WordsPerContainer)
+	{
+		this->AppendDenseBlock(uint32_t(base / WordsPerContainer), pWords + base, std::min(WordsPerContainer, wordsNum - base));
+	}
+}
+
+void MySelectionSet::ExportDenseWords(uint64_t* pWords, size_t wordsNum) const
+{
+	this->ApplyTo(MyBitsetOps::SetOperation_Replace, pWords, wordsNum * 64);
+}
+
+void MySelectionSet::ApplyTo(MyBitsetOps::SetOperation op, uint64_t* pWords, size_t pointsNum, MySelectionSet* pOutChanges) const
+{
+	assert(pOutChanges != this);
+	if (pOutChanges)
+	{
+		pOutChanges->Clear();
+	}
+	const size_t wordsNum = (pointsNum + 63) / 64;
+	const bool clearsOutside = (op == MyBitsetOps::SetOperation_Replace || op == MyBitsetOps::SetOperation_Intersection);
+	// ブロック全体を書き換える場合の変化は、演算前のブロックとの XOR で求める。
+	std::vector<uint64_t> previousWords(pOutChanges ? WordsPerContainer : 0);
+	std::vector<uint16_t> changedValues;
+	auto it = m_containers.begin();
+	for (size_t base = 0; base < wordsNum; base += WordsPerContainer)
+	{
+		const size_t blockWordsNum = std::min(WordsPerContainer, wordsNum - base);
+		uint64_t* pBlock = pWords + base;
+		const uint32_t key = uint32_t(base / WordsPerContainer);
+		if (it == m_containers.end() || it->Key != key)
+		{
+			// 空のコンテナとの演算。置換と積では、ブロック内の選択されていた点がすべて変化する。
+			if (clearsOutside)
+			{
+				if (pOutChanges)
+				{
+					pOutChanges->AppendDenseBlock(key, pBlock, blockWordsNum);
+				}
+				std::fill(pBlock, pBlock + blockWordsNum, uint64_t(0));
+			}
+			continue;
+		}
+		const Container& container = *it++;
+		const auto& values = container.Values;
+		if (container.IsBitmap() || clearsOutside)
+		{
+			if (pOutChanges)
+			{
+				std::copy(pBlock, pBlock + blockWordsNum, previousWords.begin());
+			}
+			if (container.IsBitmap())
+			{
+				MyBitsetOps::ApplyWords(op, pBlock, container.Words.data(), blockWordsNum);
+			}
+			else if (op == MyBitsetOps::SetOperation_Replace)
+			{
+				std::fill(pBlock, pBlock + blockWordsNum, uint64_t(0));
+				for (size_t i = 0; i < values.size() && values[i] / 64 < blockWordsNum; ++i)
+				{
+					pBlock[values[i] / 64] |= uint64_t(1) << (values[i] % 64);
+				}
+			}
+			else
+			{
+				for (size_t w = 0, i = 0; w < blockWordsNum; ++w)
+				{
+					uint64_t mask = 0;
+					for (; i < values.size() && values[i] / 64 == w; ++i)
+					{
+						mask |= uint64_t(1) << (values[i] % 64);
+					}
+					pBlock[w] &= mask;
+				}
+			}
+			if (pOutChanges)
+			{
+				MyBitsetOps::ApplyWords(MyBitsetOps::SetOperation_SymmetricDifference, previousWords.data(), pBlock, blockWordsNum);
+				pOutChanges->AppendDenseBlock(key, previousWords.data(), blockWordsNum);
+			}
+			continue;
+		}
+
+		// 和・差・対称差の配列コンテナは要素のビットだけを操作するので、変化も要素ごとに判定できる。
+		// 要素は昇順なので、範囲外の要素が現れたら打ち切る。
+		changedValues.clear();
+		for (size_t i = 0; i < values.size() && values[i] / 64 < blockWordsNum; ++i)
+		{
+			uint64_t& word = pBlock[values[i] / 64];
+			const uint64_t bit = uint64_t(1) << (values[i] % 64);
+			const uint64_t previousWord = word;
+			word =
+				(op == MyBitsetOps::SetOperation_Union) ? (word | bit) :
+				(op == MyBitsetOps::SetOperation_Difference) ? (word & ~bit) :
+				(word ^ bit);
+			if (pOutChanges && word != previousWord)
+			{
+				changedValues.push_back(values[i]);
+			}
+		}
+		if (pOutChanges)
+		{
+			pOutChanges->AppendArrayBlock(key, changedValues);
+		}
+	}
+}
+
+void MySelectionSet::CombineContainer(MyBitsetOps::SetOperation op, Container& dst, const Container& src)
+{
+	if (dst.IsBitmap() && src.IsBitmap())
+	{
+		MyBitsetOps::ApplyWords(op, dst.Words.data(), src.Words.data(), WordsPerContainer);
+	}
+	else if (!dst.IsBitmap() && !src.IsBitmap())
+	{
+		m_scratchValues.clear();
+		const auto dstBegin = dst.Values.begin();
+		const auto dstEnd = dst.Values.end();
+		const auto srcBegin = src.Values.begin();
+		const auto srcEnd = src.Values.end();
+		auto out = std::back_inserter(m_scratchValues);
+		switch (op)
+		{
+		case MyBitsetOps::SetOperation_Union:
+			std::set_union(dstBegin, dstEnd, srcBegin, srcEnd, out);
+			break;
+		case MyBitsetOps::SetOperation_Difference:
+			std::set_difference(dstBegin, dstEnd, srcBegin, srcEnd, out);
+			break;
+		case MyBitsetOps::SetOperation_Intersection:
+			std::set_intersection(dstBegin, dstEnd, srcBegin, srcEnd, out);
+			break;
+		default:
+			std::set_symmetric_difference(dstBegin, dstEnd, srcBegin, srcEnd, out);
+			break;
+		}
+		dst.Values.assign(m_scratchValues.begin(), m_scratchValues.end());
+	}
+	else if (op == MyBitsetOps::SetOperation_Intersection || op == MyBitsetOps::SetOperation_Difference)
+	{
+		// 積と差の結果は配列側の要素数以下なので、配列を走査して残す要素を選ぶ。
+		const Container& arrayContainer = dst.IsBitmap() ? src : dst;
+		const Container& bitmapContainer = dst.IsBitmap() ? dst : src;
+		const bool keepsContained = (op == MyBitsetOps::SetOperation_Intersection);
+		if (!dst.IsBitmap())
+		{
+			// dst が配列: dst の要素のうち src に含まれる（差では含まれない）ものを残す。
+			m_scratchValues.clear();
+			for (auto value : dst.Values)
+			{
+				if (TestBit(src.Words.data(), value) == keepsContained)
+				{
+					m_scratchValues.push_back(value);
+				}
+			}
+			dst.Values.assign(m_scratchValues.begin(), m_scratchValues.end());
+		}
+		else if (keepsContained)
+		{
+			// dst がビットマップの積: src の要素のうち dst に含まれるものが結果になる。
+			m_scratchValues.clear();
+			for (auto value : arrayContainer.Values)
+			{
+				if (TestBit(bitmapContainer.Words.data(), value))
+				{
+					m_scratchValues.push_back(value);
+				}
+			}
+			std::vector<uint64_t>().swap(dst.Words);
+			dst.Values.assign(m_scratchValues.begin(), m_scratchValues.end());
+		}
+		else
+		{
+			// dst がビットマップの差: src の要素のビットを落とす。
+			for (auto value : src.Values)
+			{
+				dst.Words[value / 64] &= ~(uint64_t(1) << (value % 64));
+			}
+		}
+	}
+	else
+	{
+		// 和と対称差: ビットマップに配列の要素を反映する。dst が配列なら、src のビットマップを複製した上に dst の要素を反映する。
+		if (!dst.IsBitmap())
+		{
+			m_scratchValues.swap(dst.Values);
+			dst.Values.clear();
+			dst.Words = src.Words;
+		}
+		const auto& values = src.IsBitmap() ? m_scratchValues : src.Values;
+		for (auto value : values)
+		{
+			const uint64_t bit = uint64_t(1) << (value % 64);
+			if (op == MyBitsetOps::SetOperation_Union)
+			{
+				dst.Words[value / 64] |= bit;
+			}
+			else
+			{
+				dst.Words[value / 64] ^= bit;
+			}
+		}
+	}
+	NormalizeContainer(dst);
+}
+
+void MySelectionSet::Combine(MyBitsetOps::SetOperation op, const MySelectionSet& other)
+{
+	if (&other == this)
+	{
+		if (op == MyBitsetOps::SetOperation_Difference || op == MyBitsetOps::SetOperation_SymmetricDifference)
+		{
+			m_containers.clear();
+		}
+		return;
+	}
+	if (op == MyBitsetOps::SetOperation_Replace)
+	{
+		m_containers = other.m_containers;
+		return;
+	}
+
+	// キーの昇順に両方のコンテナを突き合わせる。片方にしかないキーは、演算の種類に応じて残すか捨てる。
+	const bool keepsOnlyThis = (op != MyBitsetOps::SetOperation_Intersection);
+	const bool keepsOnlyOther = (op == MyBitsetOps::SetOperation_Union || op == MyBitsetOps::SetOperation_SymmetricDifference);
+	std::vector<Container> results;
+	results.reserve(m_containers.size() + (keepsOnlyOther ? other.m_containers.size() : 0));
+	size_t i = 0;
+	size_t j = 0;
+	while (i < m_containers.size() || j < other.m_containers.size())
+	{
+		if (j == other.m_containers.size() || (i < m_containers.size() && m_containers[i].Key < other.m_containers[j].Key))
+		{
+			if (keepsOnlyThis)
+			{
+				results.push_back(std::move(m_containers[i]));
+			}
+			++i;
+		}
+		else if (i == m_containers.size() || other.m_containers[j].Key < m_containers[i].Key)
+		{
+			if (keepsOnlyOther)
+			{
+				results.push_back(other.m_containers[j]);
+			}
+			++j;
+		}
+		else
+		{
+			this->CombineContainer(op, m_containers[i], other.m_containers[j]);
+			if (m_containers[i].Cardinality > 0)
+			{
+				results.push_back(std::move(m_containers[i]));
+			}
+			++i;
+			++j;
+		}
+	}
+	m_containers.swap(results);
+}
+
+void MySelectionSet::Invert(size_t pointsNum)
+{
+	assert(pointsNum <= size_t(UINT32_MAX) + 1);
+	const size_t keysNum = (pointsNum + PointsPerContainer - 1) / PointsPerContainer;
+	std::vector<Container> results;
+	results.reserve(keysNum);
+	auto it = m_containers.begin();
+	for (size_t key = 0; key < keysNum; ++key)
+	{
+		const size_t rangePointsNum = std::min(size_t(PointsPerContainer), pointsNum - key * PointsPerContainer);
+		Container container = { uint32_t(key), 0, std::vector<uint16_t>(), std::vector<uint64_t>() };
+		if (it != m_containers.end() && it->Key == key)
+		{
+			container = std::move(*it++);
+			ConvertToBitmap(container);
+			MyBitsetOps::InvertWords(container.Words.data(), WordsPerContainer);
+		}
+		else
+		{
+			container.Words.assign(WordsPerContainer, ~uint64_t(0));
+		}
+		// 範囲外のビットを落とす。
+		for (size_t w = rangePointsNum / 64; w < WordsPerContainer; ++w)
+		{
+			container.Words[w] &= (w == rangePointsNum / 64) ? ((uint64_t(1) << (rangePointsNum % 64)) - 1) : 0;
+		}
+		NormalizeContainer(container);
+		if (container.Cardinality > 0)
+		{
+			results.push_back(std::move(container));
+		}
+	}
+	m_containers.swap(results);
+}
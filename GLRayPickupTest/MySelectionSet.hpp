@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+
+
+//! @brief  64 点単位のワードで表した密なビットセット（MyPointCloudStore の選択状態など）に対する一括演算。<br>
+//! 使用する SIMD 命令セットは MyCpuFeatures::GetActiveSimdLevel() による。結果は命令セットによらず同じ。<br>
+namespace MyBitsetOps
+{
+	//! @brief  集合演算の種類。pDst = pDst (演算) pSrc の形で使う。<br>
+	enum SetOperation
+	{
+		SetOperation_Replace, //!< pSrc で置き換える。<br>
+		SetOperation_Union, //!< 和集合。<br>
+		SetOperation_Difference, //!< 差集合（pDst から pSrc を除く）。<br>
+		SetOperation_Intersection, //!< 積集合。<br>
+		SetOperation_SymmetricDifference, //!< 対称差（pSrc の要素の所属を反転する）。<br>
+		SetOperation_Count,
+	};
+
+	const char* GetSetOperationName(SetOperation op);
+
+	//! @brief  wordsNum ワードについて pDst = pDst (op) pSrc を計算する。<br>
+	void ApplyWords(SetOperation op, uint64_t* pDst, const uint64_t* pSrc, size_t wordsNum);
+
+	//! @brief  wordsNum ワードのビットをすべて反転する。範囲外のビット（最終ワードの余り）の後始末は呼び出し側で行なうこと。<br>
+	void InvertWords(uint64_t* pDst, size_t wordsNum);
+
+	//! @brief  wordsNum ワードのセットされたビットの総数を数える。<br>
+	size_t CountBits(const uint64_t* pWords, size_t wordsNum);
+}
+
+
+//! @brief  点のインデックスの集合を表す圧縮ビットセット（Roaring ビットマップ: Chambi et al., "Better bitmap performance with Roaring bitmaps", 2016）。<br>
+//! インデックスの上位 16bit ごとに 65536 点のコンテナに分け、コンテナ内の要素数が少なければソート済みの 16bit 値の配列、<br>
+//! 多ければ 1024 ワードのビットマップで持つ。空のコンテナは持たない。<br>
+//! クリックや小さな矩形で選んだ疎な集合は要素数に比例するメモリと時間で扱え、密な集合のビットマップ同士の演算は MyBitsetOps の SIMD カーネルで行なう。<br>
+//! 描画や交差判定のカーネルは密なビットセットを読み書きするので、選択操作の結果は ApplyTo() で点群の選択状態に反映する。<br>
+class MySelectionSet
+{
+public:
+	static const uint32_t PointsPerContainer = 65536;
+	static const size_t WordsPerContainer = PointsPerContainer / 64;
+	//! @brief  配列コンテナの最大要素数。これを超えるとビットマップ（8KB）のほうが小さくなる。<br>
+	static const uint32_t MaxArrayCardinality = 4096;
+
+private:
+	struct Container
+	{
+		uint32_t Key; //!< インデックスの上位 16bit。<br>
+		uint32_t Cardinality;
+		std::vector<uint16_t> Values; //!< 配列コンテナの要素（昇順）。ビットマップ コンテナでは空。<br>
+		std::vector<uint64_t> Words; //!< ビットマップ コンテナのワード。配列コンテナでは空。<br>
+
+		bool IsBitmap() const { return !Words.empty(); }
+	};
+
+private:
+	std::vector<Container> m_containers; //!< Key の昇順。<br>
+	std::vector<uint16_t> m_scratchValues;
+	std::vector<uint32_t> m_scratchIndices;
+
+public:
+	MySelectionSet() {}
+
+public:
+	void Clear() { m_containers.clear(); }
+	bool IsEmpty() const { return m_containers.empty(); }
+
+	//! @brief  要素数。<br>
+	size_t GetCardinality() const;
+
+	size_t GetContainersNum() const { return m_containers.size(); }
+	size_t GetBitmapContainersNum() const;
+
+	//! @brief  確保しているメモリ量[Bytes]の概算。<br>
+	size_t GetMemoryBytes() const;
+
+	bool Contains(uint32_t index) const;
+	void Add(uint32_t index);
+	void Remove(uint32_t index);
+	void Toggle(uint32_t index);
+
+	//! @brief  インデックスの列（順不同、重複可）から集合を作り直す。<br>
+	void AssignIndices(const uint32_t* pIndices, size_t indicesNum);
+
+	//! @brief  密なビットセットから集合を作り直す。コンテナごとにビット数を数えて、配列かビットマップかを選ぶ。<br>
+	void AssignDenseWords(const uint64_t* pWords, size_t wordsNum);
+
+	//! @brief  密なビットセットに書き出す。pWords の wordsNum ワードは上書きされる。<br>
+	void ExportDenseWords(uint64_t* pWords, size_t wordsNum) const;
+
+	//! @brief  密なビットセット pWords（pointsNum 点分）に対して、pWords = pWords (op) this を計算する。<br>
+	//! 和・差・対称差では、この集合を含むコンテナの範囲しか触らない。置換と積では、それ以外の範囲を 0 にする。<br>
+	//! pOutChanges を指定すると、演算で所属が変わった点の集合（演算前と演算後の対称差）を書き出す。<br>
+	//! 変化の記録にかかる時間は演算そのものと同程度なので、操作の取り消し用の差分を、演算前の状態を複製せずに得られる。<br>
+	void ApplyTo(MyBitsetOps::SetOperation op, uint64_t* pWords, size_t pointsNum, MySelectionSet* pOutChanges = nullptr) const;
+
+	//! @brief  this = this (op) other を計算する。<br>
+	void Combine(MyBitsetOps::SetOperation op, const MySelectionSet& other);
+
+	//! @brief  [0, pointsNum) の範囲で補集合にする。<br>
+	void Invert(size_t pointsNum);
+
+	//! @brief  要素を昇順に列挙する。<br>
+	template<typename TFunc> void ForEach(TFunc func) const
+	{
+		for (const auto& container : m_containers)
+		{
+			const uint32_t base = container.Key * PointsPerContainer;
+			if (container.IsBitmap())
+			{
+				for (size_t w = 0; w < WordsPerContainer; ++w)
+				{
+					uint64_t bits = container.Words[w];
+					while (bits != 0)
+					{
+						func(base + uint32_t(w * 64 + MyMath::GetLowestSetBitIndex(bits)));
+						bits &= bits - 1;
+					}
+				}
+			}
+			else
+			{
+				for (auto value : container.Values)
+				{
+					func(base + value);
+				}
+			}
+		}
+	}
+
+private:
+	Container* FindContainer(uint32_t key);
+	const Container* FindContainer(uint32_t key) const;
+	Container& FindOrInsertContainer(uint32_t key);
+	static void ConvertToBitmap(Container& container);
+	//! @brief  要素数を数え直し、要素数に適した形式に変換する。<br>
+	static void NormalizeContainer(Container& container);
+	//! @brief  キー key のコンテナを、密なビットセットのブロックまたは昇順の値の列から作って末尾に追加する。空なら追加しない。<br>
+	void AppendDenseBlock(uint32_t key, const uint64_t* pBlockWords, size_t blockWordsNum);
+	void AppendArrayBlock(uint32_t key, const std::vector<uint16_t>& values);
+	void CombineContainer(MyBitsetOps::SetOperation op, Container& dst, const Container& src);
+};
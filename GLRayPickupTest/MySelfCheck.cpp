@@ -0,0 +1,1038 @@
+﻿#include "stdafx.h"
+#include "MySelfCheck.hpp"
+
+#ifdef _DEBUG
+
+#include "MyCollisionHelper.hpp"
+#include "MyCollisionBatch.hpp"
+#include "MyGLHelper.hpp"
+#include "MyGLHelperBatch.hpp"
+#include "MyPagedPointCloud.hpp"
+#include "MyRandom.hpp"
+#include "MyPointGenerator.hpp"
+#include "MyMortonOrder.hpp"
+#include "MySelectionHistory.hpp"
+#include "MyFrameScheduler.hpp"
+
+
+namespace
+{
+	// 64 点単位のビットマスクで、index 番目の点のビットが立っているか否か。
+	bool IsBitSet(const uint64_t* pWords, size_t index)
+	{ return ((pWords[index / MyPointCloudStore::BitsPerSelectionWord] >> (index % MyPointCloudStore::BitsPerSelectionWord)) & 1) != 0; }
+
+	// 直線から半径 radius 以内にある点を、全点を 1 点ずつ判定する総当たりで求める。outIndices は昇順になる。
+	void QueryLineIntersectWithSphereByBruteForce(const MyPointCloudStore& store, const MyVector3F& linePos1, const MyVector3F& linePos2, float radius,
+		std::vector<uint32_t>& outIndices)
+	{
+		outIndices.clear();
+		const size_t pointsNum = store.GetPointsNum();
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			if (MyCollision::CheckLineIntersectWithSphere(linePos1, linePos2, store.GetPosition(i), radius))
+			{
+				outIndices.push_back(uint32_t(i));
+			}
+		}
+	}
+
+	// 交差判定で列挙した点の集合を、順序によらずに比べる。両方とも昇順に並べ替えられる。
+	// 一致しなければ、検証の名前と問い合わせの番号を表示して false を返す。
+	bool IsSameHitSet(std::vector<uint32_t>& expected, std::vector<uint32_t>& actual, const char* pCheckName, int queryIndex)
+	{
+		std::sort(expected.begin(), expected.end());
+		std::sort(actual.begin(), actual.end());
+		if (actual != expected)
+		{
+			printf("%s mismatch: query #%d, expected %d hits, actual %d hits.\n", pCheckName, queryIndex, int(expected.size()), int(actual.size()));
+			return false;
+		}
+		return true;
+	}
+
+	// 八分木のノードの点数とインデックスの範囲が、子孫の葉ノードの点と一致するかどうかを、ルートとランダムに選んだノードで検証する。
+	// インデックスの連番の範囲ごとに列挙した結果も、葉ノードの点と一致しなければならない。
+	bool VerifyOctreePointRanges(const MyPointOctree& octree, const char* pOctreeName)
+	{
+		const auto& nodes = octree.GetNodes();
+		std::vector<uint32_t> expected, actual;
+		for (int q = 0; q < 200; ++q)
+		{
+			const uint32_t nodeIndex = (q == 0) ? 0 : uint32_t(std::rand() % nodes.size());
+			expected.clear();
+			std::vector<uint32_t> stack(1, nodeIndex);
+			while (!stack.empty())
+			{
+				const MyPointOctree::Node& node = nodes[stack.back()];
+				stack.pop_back();
+				if (node.IsLeaf())
+				{
+					expected.insert(expected.end(), node.PointIndices.begin(), node.PointIndices.end());
+					continue;
+				}
+				for (uint32_t c = 0; c < 8; ++c)
+				{
+					stack.push_back(node.FirstChild + c);
+				}
+			}
+			actual.clear();
+			octree.EnumerateSubtreePointRanges(nodeIndex, [&](uint32_t beginIndex, uint32_t endIndex)
+			{
+				for (uint32_t index = beginIndex; index < endIndex; ++index)
+				{
+					actual.push_back(index);
+				}
+			});
+			std::sort(expected.begin(), expected.end());
+			std::sort(actual.begin(), actual.end());
+			const MyPointOctree::Node& node = nodes[nodeIndex];
+			if (actual != expected || node.PointsNum != expected.size() ||
+				(!expected.empty() && (node.MinPointIndex != expected.front() || node.MaxPointIndex != expected.back())))
+			{
+				printf("%s octree point range mismatch: node #%d, expected %d points, actual %d points.\n",
+					pOctreeName, int(nodeIndex), int(expected.size()), int(actual.size()));
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+MySelfCheck::MySelfCheck(MyJobSystem& jobSystem, MyPointCloudStore& pointCloud, const MyPointOctree& pointOctree, MyPointPicker& pointPicker,
+	const MyMatrix4x4F& matFixedWorldToScreen, float intersectMarginInWorld, float intersectMarginInScreen, float generatedPointCloudRadius)
+	: m_jobSystem(jobSystem)
+	, m_pointCloud(pointCloud)
+	, m_pointOctree(pointOctree)
+	, m_pointPicker(pointPicker)
+	, m_matFixedWorldToScreen(matFixedWorldToScreen)
+	, m_intersectMarginInWorld(intersectMarginInWorld)
+	, m_intersectMarginInScreen(intersectMarginInScreen)
+	, m_generatedPointCloudRadius(generatedPointCloudRadius)
+{
+}
+
+bool MySelfCheck::VerifyGeneratedPointCloud()
+{
+	bool isValid = true;
+	isValid = this->VerifyPointGeneratorDeterminism() && isValid;
+	isValid = this->VerifyMortonOrderAgainstSort() && isValid;
+	isValid = this->VerifyPaletteColors() && isValid;
+	isValid = this->VerifyCollisionBatchAgainstScalar() && isValid;
+	isValid = this->VerifyScreenProjectionBatchAgainstScalar() && isValid;
+	isValid = this->VerifyPointOctreeAgainstBruteForce() && isValid;
+	isValid = this->VerifyFrustumSelectionAgainstBruteForce() && isValid;
+	isValid = this->VerifySelectionSetAgainstDense() && isValid;
+	isValid = this->VerifySelectionHistory() && isValid;
+	isValid = this->VerifyScreenTileGridAgainstBatch() && isValid;
+	isValid = this->VerifyIncrementalIndexAgainstBuild() && isValid;
+	isValid = this->VerifyRayNearestHitsAgainstBruteForce() && isValid;
+	isValid = this->VerifyInverseMatrixByStructure() && isValid;
+	isValid = this->VerifyFrameScheduler() && isValid;
+	return isValid;
+}
+
+bool MySelfCheck::VerifyPointCache(const MyPointCache& pointCache, const char* pCacheFilePath)
+{
+	bool isValid = true;
+	isValid = this->VerifyPointCacheAgainstOctree(pointCache) && isValid;
+	isValid = this->VerifyPagedPointCloudAgainstPointCache(pointCache, pCacheFilePath) && isValid;
+	return isValid;
+}
+
+// 八分木による交差判定の結果が、総当たりの結果と一致するかどうかを検証する。
+bool MySelfCheck::VerifyPointOctreeAgainstBruteForce()
+{
+	const int raysNum = 100;
+	std::vector<uint32_t> expected;
+	for (int r = 0; r < raysNum; ++r)
+	{
+		// 点群のいずれかの点の近傍を通る、ランダムな向きの直線を作る。
+		const MyVector3F target = m_pointCloud.GetPosition(std::rand() % m_pointCloud.GetPointsNum());
+		const MyVector3F vDir(MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF());
+		if (MyMath::GetVectorLengthSquared(vDir) == 0)
+		{
+			continue;
+		}
+		const MyVector3F linePos1 = target - vDir * 50.0f;
+		const MyVector3F linePos2 = target + vDir * 50.0f;
+
+		QueryLineIntersectWithSphereByBruteForce(m_pointCloud, linePos1, linePos2, m_intersectMarginInWorld, expected);
+		m_pointOctree.QueryLineIntersectWithSphere(linePos1, linePos2, m_intersectMarginInWorld,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), m_hitIndices);
+		if (!IsSameHitSet(expected, m_hitIndices, "Octree", r))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// SIMD による一括交差判定の結果が、各命令セットでスカラー版の結果と一致するかどうかを検証する。
+bool MySelfCheck::VerifyCollisionBatchAgainstScalar()
+{
+	const MyCpuFeatures::SimdLevel originalLevel = MyCpuFeatures::GetActiveSimdLevel();
+	const MyCpuFeatures::SimdLevel supportedLevel = MyCpuFeatures::GetSupportedSimdLevel();
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	const int raysNum = 20;
+	std::vector<uint32_t> expected;
+	bool isValid = true;
+	for (int r = 0; r < raysNum && isValid; ++r)
+	{
+		const MyVector3F target = m_pointCloud.GetPosition(std::rand() % pointsNum);
+		const MyVector3F vDir(MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF());
+		if (MyMath::GetVectorLengthSquared(vDir) == 0)
+		{
+			continue;
+		}
+		const MyVector3F linePos1 = target - vDir * 50.0f;
+		const MyVector3F linePos2 = target + vDir * 50.0f;
+
+		QueryLineIntersectWithSphereByBruteForce(m_pointCloud, linePos1, linePos2, m_intersectMarginInWorld, expected);
+		const MyCollision::LineSphereBatchQuery query(linePos1, linePos2, m_intersectMarginInWorld);
+		for (int level = MyCpuFeatures::SimdLevel_Scalar; level <= supportedLevel; ++level)
+		{
+			MyCpuFeatures::SetActiveSimdLevel(MyCpuFeatures::SimdLevel(level));
+			m_hitIndices.clear();
+			MyCollision::CheckLineIntersectWithSphereBatch(query,
+				m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), 0, pointsNum, m_hitIndices);
+			const std::string checkName = std::string("Batch intersection (") + MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::SimdLevel(level)) + ")";
+			isValid = IsSameHitSet(expected, m_hitIndices, checkName.c_str(), r) && isValid;
+		}
+	}
+	MyCpuFeatures::SetActiveSimdLevel(originalLevel);
+	return isValid;
+}
+
+// SIMD 版のスクリーン座標一括変換が、スカラー版 TransformVector3Coord() と許容誤差内で一致するかどうかを検証する。
+// w の逆数を近似で求めているので、ビット単位では一致しない。
+bool MySelfCheck::VerifyScreenProjectionBatchAgainstScalar()
+{
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	const MyMatrix4x4F& matToScreen = m_matFixedWorldToScreen;
+
+	std::vector<float> outX(pointsNum), outY(pointsNum), outZ(pointsNum);
+	const auto originalLevel = MyCpuFeatures::GetActiveSimdLevel();
+	const auto supportedLevel = MyCpuFeatures::GetSupportedSimdLevel();
+	bool isValid = true;
+	for (int level = MyCpuFeatures::SimdLevel_Scalar; level <= supportedLevel && isValid; ++level)
+	{
+		MyCpuFeatures::SetActiveSimdLevel(MyCpuFeatures::SimdLevel(level));
+		MyGLHelper::TransformVector3CoordBatch(matToScreen,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), pointsNum,
+			outX.data(), outY.data(), outZ.data());
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			const MyVector3F expected = MyGLHelper::TransformVector3Coord(matToScreen, m_pointCloud.GetPosition(i));
+			const MyVector3F actual(outX[i], outY[i], outZ[i]);
+			const float tolerance = 1e-4f * std::max(1.0f, std::max(std::abs(expected.x), std::abs(expected.y)));
+			if (std::abs(actual.x - expected.x) > tolerance || std::abs(actual.y - expected.y) > tolerance || std::abs(actual.z - expected.z) > 1e-4f)
+			{
+				printf("Batch projection mismatch: %s, point #%d, expected (%f, %f, %f), actual (%f, %f, %f).\n",
+					MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::SimdLevel(level)), int(i),
+					expected.x, expected.y, expected.z, actual.x, actual.y, actual.z);
+				isValid = false;
+				break;
+			}
+		}
+	}
+	MyCpuFeatures::SetActiveSimdLevel(originalLevel);
+	return isValid;
+}
+
+// タイル グリッドによるホバー判定の結果が、全点を一括処理した結果と一致するかどうかを検証する。
+bool MySelfCheck::VerifyScreenTileGridAgainstBatch()
+{
+	const MyMatrix4x4F& matToScreen = m_matFixedWorldToScreen;
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	MyScreenTileGrid grid;
+	grid.Build(matToScreen, 800, 600,
+		m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), pointsNum,
+		m_pointCloud.GetPositionsVersion());
+	std::vector<uint64_t> expectedMaskWords(m_pointCloud.GetSelectionWordsNum());
+	std::vector<uint32_t> expected;
+	const int queriesNum = 200;
+	for (int q = 0; q < queriesNum; ++q)
+	{
+		// 点の近傍を狙う問い合わせと、ビューポートの外側も含むランダムな問い合わせを半々にする。
+		float targetX = float(std::rand() % 1200 - 200);
+		float targetY = float(std::rand() % 1000 - 200);
+		if (q % 2 == 0)
+		{
+			const MyVector3F vScreen = MyGLHelper::TransformVector3Coord(matToScreen, m_pointCloud.GetPosition(std::rand() % pointsNum));
+			targetX = std::floor(vScreen.x) + float(std::rand() % 5 - 2);
+			targetY = std::floor(vScreen.y) + float(std::rand() % 5 - 2);
+		}
+		MyGLHelper::TransformVector3CoordAndCheckIntersectWithPointBatch(matToScreen,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), pointsNum,
+			targetX, targetY, m_intersectMarginInScreen, expectedMaskWords.data());
+		expected.clear();
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			if (IsBitSet(expectedMaskWords.data(), i))
+			{
+				expected.push_back(uint32_t(i));
+			}
+		}
+		grid.QueryPointsNearScreenPos(targetX, targetY, m_intersectMarginInScreen, m_hitIndices);
+		if (!IsSameHitSet(expected, m_hitIndices, "Screen tile grid", q))
+		{
+			printf("Screen tile grid query position = (%.1f, %.1f).\n", targetX, targetY);
+			return false;
+		}
+	}
+	return true;
+}
+
+// 八分木を手前から走査するピッキングの結果が、総当たりの交差判定の結果を手前の順に並べたものと一致するかどうかを検証する。
+bool MySelfCheck::VerifyRayNearestHitsAgainstBruteForce()
+{
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	std::vector<MyPointOctree::RayHit> expected;
+	std::vector<MyPointOctree::RayHit> actual;
+	const size_t maxHitsNums[] = { 1, 5, MyPointPicker::DefaultTopKHitsNum, pointsNum };
+	for (int r = 0; r < 100; ++r)
+	{
+		const MyVector3F target = m_pointCloud.GetPosition(std::rand() % pointsNum);
+		const MyVector3F vDir(MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF());
+		// 始点を点群の内側に置くこともあるので、始点より後ろの点を除外する処理も検証される。
+		const MyVector3F linePos1 = target - vDir * float(std::rand() % 50);
+		const MyVector3F linePos2 = linePos1 + vDir;
+		expected.clear();
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			const MyVector3F pos = m_pointCloud.GetPosition(i);
+			if (MyCollision::CheckLineIntersectWithSphere(linePos1, linePos2, pos, m_intersectMarginInWorld))
+			{
+				const MyPointOctree::RayHit hit = { uint32_t(i), MyCollision::GetLineParameterOfClosestPoint(linePos1, linePos2, pos) };
+				if (hit.RayParam >= 0)
+				{
+					expected.push_back(hit);
+				}
+			}
+		}
+		std::sort(expected.begin(), expected.end(), MyPointOctree::RayHit::IsNearer);
+		for (auto maxHitsNum : maxHitsNums)
+		{
+			m_pointOctree.QueryRayNearestHits(linePos1, linePos2, m_intersectMarginInWorld,
+				m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), maxHitsNum, actual);
+			const size_t expectedNum = std::min(maxHitsNum, expected.size());
+			bool isSame = (actual.size() == expectedNum);
+			for (size_t i = 0; isSame && i < expectedNum; ++i)
+			{
+				isSame = (actual[i].PointIndex == expected[i].PointIndex && actual[i].RayParam == expected[i].RayParam);
+			}
+			if (!isSame)
+			{
+				printf("Nearest hits mismatch: ray #%d, k = %d, expected %d hits, actual %d hits.\n",
+					r, int(maxHitsNum), int(expectedNum), int(actual.size()));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// 1 点ずつ追加して作った八分木とタイル グリッドが、全点から構築したものと同じ判定結果になるかどうかを検証する。
+// 八分木はノードの点数とインデックスの範囲も検証する。
+bool MySelfCheck::VerifyIncrementalIndexAgainstBuild()
+{
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	// 八分木は空の状態から追加していくので、ルートのセルの拡大と葉ノードの分割の両方を通る。
+	MyPointOctree octree;
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		octree.Insert(uint32_t(i), [this](uint32_t index) { return m_pointCloud.GetPosition(index); });
+	}
+	if (!VerifyOctreePointRanges(m_pointOctree, "Built") || !VerifyOctreePointRanges(octree, "Incremental"))
+	{
+		return false;
+	}
+	if (octree.GetPointsNum() != pointsNum)
+	{
+		printf("Incremental octree mismatch: expected %d points, actual %d points.\n", int(pointsNum), int(octree.GetPointsNum()));
+		return false;
+	}
+	std::vector<uint32_t> expected;
+	for (int r = 0; r < 100; ++r)
+	{
+		const MyVector3F target = m_pointCloud.GetPosition(std::rand() % pointsNum);
+		const MyVector3F vDir(MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF());
+		const MyVector3F linePos1 = target - vDir * 50.0f;
+		const MyVector3F linePos2 = target + vDir * 50.0f;
+		m_pointOctree.QueryLineIntersectWithSphere(linePos1, linePos2, m_intersectMarginInWorld,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), expected);
+		octree.QueryLineIntersectWithSphere(linePos1, linePos2, m_intersectMarginInWorld,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), m_hitIndices);
+		if (!IsSameHitSet(expected, m_hitIndices, "Incremental octree", r))
+		{
+			return false;
+		}
+	}
+
+	// タイル グリッドは半数の点で構築して、残りを追加する。
+	const MyMatrix4x4F& matToScreen = m_matFixedWorldToScreen;
+	MyScreenTileGrid builtGrid, appendedGrid;
+	builtGrid.Build(matToScreen, 800, 600,
+		m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), pointsNum,
+		m_pointCloud.GetPositionsVersion());
+	appendedGrid.Build(matToScreen, 800, 600,
+		m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), pointsNum / 2,
+		m_pointCloud.GetPositionsVersion());
+	appendedGrid.AppendPoints(m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(),
+		pointsNum / 2, pointsNum - pointsNum / 2);
+	if (!appendedGrid.IsBuiltWith(matToScreen, 800, 600, pointsNum, m_pointCloud.GetPositionsVersion()))
+	{
+		puts("Incremental screen tile grid mismatch: build key.");
+		return false;
+	}
+	for (int q = 0; q < 200; ++q)
+	{
+		const MyVector3F vScreen = MyGLHelper::TransformVector3Coord(matToScreen, m_pointCloud.GetPosition(std::rand() % pointsNum));
+		const float targetX = std::floor(vScreen.x) + float(std::rand() % 5 - 2);
+		const float targetY = std::floor(vScreen.y) + float(std::rand() % 5 - 2);
+		builtGrid.QueryPointsNearScreenPos(targetX, targetY, m_intersectMarginInScreen, expected);
+		appendedGrid.QueryPointsNearScreenPos(targetX, targetY, m_intersectMarginInScreen, m_hitIndices);
+		if (!IsSameHitSet(expected, m_hitIndices, "Incremental screen tile grid", q))
+		{
+			printf("Incremental screen tile grid query position = (%.1f, %.1f).\n", targetX, targetY);
+			return false;
+		}
+	}
+	return true;
+}
+
+// 量子化キャッシュのチャンク単位の遅延デコードによる交差判定が、デコード済みの点群に対する八分木の結果と一致するかどうかを検証する。
+// キャッシュに格納した元のインデックスが、デコード済みの点群に復元された順列であることも確かめる。
+bool MySelfCheck::VerifyPointCacheAgainstOctree(const MyPointCache& pointCache)
+{
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	std::vector<bool> isOriginalIndexUsed(pointsNum, false);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		const uint32_t originalIndex = pointCache.GetOriginalIndices()[i];
+		if (originalIndex >= pointsNum || isOriginalIndexUsed[originalIndex] || m_pointCloud.GetOriginalIndex(i) != originalIndex)
+		{
+			printf("Point cache original index mismatch: #%d.\n", int(i));
+			return false;
+		}
+		isOriginalIndexUsed[originalIndex] = true;
+	}
+	std::vector<uint32_t> expected;
+	for (int r = 0; r < 100; ++r)
+	{
+		// 点群中のランダムな点の近くを、ランダムな方向に通る直線。
+		const MyVector3F vTarget = m_pointCloud.GetPosition((size_t(std::rand()) * (size_t(RAND_MAX) + 1) + size_t(std::rand())) % pointsNum);
+		const MyVector3F vDir(MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF(), MyMath::GetMyNormalRandF());
+		const MyVector3F vPos1 = vTarget + MyVector3F(m_intersectMarginInWorld * 0.5f, 0, 0);
+		const MyVector3F vPos2 = vPos1 + vDir;
+		m_pointOctree.QueryLineIntersectWithSphere(vPos1, vPos2, m_intersectMarginInWorld,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), expected);
+		pointCache.QueryLineIntersectWithSphere(vPos1, vPos2, m_intersectMarginInWorld, m_hitIndices);
+		if (!IsSameHitSet(expected, m_hitIndices, "Point cache", r))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// ページングされた点群が、少ないスロット数でチャンクを追い出しながら読み込んだ内容が、量子化キャッシュのデコード結果と一致するかどうかを検証する。
+bool MySelfCheck::VerifyPagedPointCloudAgainstPointCache(const MyPointCache& pointCache, const char* pCacheFilePath)
+{
+	const uint32_t slotsNum = 8;
+	MyPagedPointCloud paged;
+	if (!paged.Open(pCacheFilePath, slotsNum * MyPagedPointCloud::SlotBytes))
+	{
+		printf("Paged point cloud mismatch: failed to open \"%s\".\n", pCacheFilePath);
+		return false;
+	}
+	const uint32_t chunksNum = std::min<uint32_t>(paged.GetChunksNum(), 256);
+	std::vector<float> expectedX(MyPointCache::ChunkPointsNum), expectedY(MyPointCache::ChunkPointsNum), expectedZ(MyPointCache::ChunkPointsNum);
+	for (uint32_t c = 0; c < chunksNum; ++c)
+	{
+		// 読み込みが完了するまでフレームを進める。
+		paged.BeginFrame();
+		while (!paged.RequestChunk(c))
+		{
+			std::this_thread::yield();
+			paged.BeginFrame();
+		}
+		const MyPointCache::ChunkInfo& chunk = pointCache.GetChunk(c);
+		pointCache.DecodeChunkPositions(c, expectedX.data(), expectedY.data(), expectedZ.data());
+		const uint32_t slotIndex = paged.GetResidentSlot(c);
+		if (memcmp(paged.GetSlotPositionsX(slotIndex), expectedX.data(), chunk.PointsNum * sizeof(float)) != 0 ||
+			memcmp(paged.GetSlotPositionsY(slotIndex), expectedY.data(), chunk.PointsNum * sizeof(float)) != 0 ||
+			memcmp(paged.GetSlotPositionsZ(slotIndex), expectedZ.data(), chunk.PointsNum * sizeof(float)) != 0 ||
+			memcmp(paged.GetSlotColors(slotIndex), pointCache.GetPackedColors() + chunk.FirstPoint, chunk.PointsNum * sizeof(uint32_t)) != 0)
+		{
+			printf("Paged point cloud mismatch: chunk #%u.\n", c);
+			return false;
+		}
+	}
+	// スロット数を超えたぶんだけ、古いチャンクが追い出されているはず。
+	const MyPagedPointCloud::Stats& stats = paged.GetStats();
+	const uint32_t expectedEvictionsNum = chunksNum - std::min(chunksNum, paged.GetSlotsNum());
+	if (stats.LoadsNum != chunksNum || stats.EvictionsNum != expectedEvictionsNum || paged.GetResidentChunksNum() != std::min(chunksNum, paged.GetSlotsNum()))
+	{
+		printf("Paged point cloud mismatch: %u loads, %u evictions, %u resident chunks.\n",
+			unsigned(stats.LoadsNum), unsigned(stats.EvictionsNum), paged.GetResidentChunksNum());
+		return false;
+	}
+	return true;
+}
+
+// 構造を利用した逆行列が、一般の逆行列 glm::inverse() と一致するかどうかを検証する。
+bool MySelfCheck::VerifyInverseMatrixByStructure()
+{
+	const auto isNearlyEqual = [](const MyMatrix4x4F& matA, const MyMatrix4x4F& matB)
+	{
+		for (int col = 0; col < 4; ++col)
+		{
+			for (int row = 0; row < 4; ++row)
+			{
+				const float scale = std::max(1.0f, std::max(std::abs(matA[col][row]), std::abs(matB[col][row])));
+				if (std::abs(matA[col][row] - matB[col][row]) > 1e-4f * scale)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	};
+
+	const MyGLHelper::Viewport viewport = { 0, 0, 800, 600, 0, 1 };
+	const MyGLHelper::PerspectiveParam persParam = { 45.0f, 0.5f, 1000.0f };
+	const MyMatrix4x4F matProjs[] =
+	{
+		MyGLHelper::CreateMatrixPerspectiveFov(viewport, persParam),
+		MyGLHelper::CreateMatrixOrotho(-400, +400, -300, +300, persParam.Near, persParam.Far),
+	};
+	const MyMatrix4x4F matViewport = MyGLHelper::CreateViewportMatrix(viewport);
+	for (int i = 0; i < 20; ++i)
+	{
+		const MyVector3F vEye(float(std::rand() % 61 - 30), float(std::rand() % 61 - 30), float(std::rand() % 61 + 5));
+		const MyVector3F vUp(float(std::rand() % 9 - 4), float(std::rand() % 9 - 4), 1.0f);
+		const MyMatrix4x4F matView = glm::lookAt(vEye, MyVector3F(0, 0, 0), vUp);
+		if (!MyGLHelper::IsAffineMatrix(matView) ||
+			!isNearlyEqual(MyGLHelper::InverseMatrixByStructure(matView), glm::inverse(matView)))
+		{
+			printf("Structured inverse mismatch: view matrix #%d.\n", i);
+			return false;
+		}
+		for (const auto& matProj : matProjs)
+		{
+			if (!isNearlyEqual(MyGLHelper::InverseMatrixByStructure(matProj), glm::inverse(matProj)))
+			{
+				printf("Structured inverse mismatch: projection matrix.\n");
+				return false;
+			}
+			// 逆プロジェクション行列は、スクリーン位置をワールド座標に戻してから再度スクリーン座標変換すると元に戻るはず。
+			MyMatrix4x4F matUnproj;
+			MyGLHelper::CreateMatrixUnProjectionScreenCoordToWorldCoord(matUnproj, matView, matProj, viewport);
+			const MyMatrix4x4F matToScreen = matViewport * matProj * matView;
+			const MyVector3F vScreen(float(std::rand() % 800), float(std::rand() % 600), 0.5f);
+			const MyVector3F vRoundTrip = MyGLHelper::TransformVector3Coord(matToScreen, MyGLHelper::TransformVector3Coord(matUnproj, vScreen));
+			if (std::abs(vRoundTrip.x - vScreen.x) > 0.01f || std::abs(vRoundTrip.y - vScreen.y) > 0.01f)
+			{
+				printf("Unprojection round trip mismatch: (%.2f, %.2f) -> (%.2f, %.2f).\n", vScreen.x, vScreen.y, vRoundTrip.x, vRoundTrip.y);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// 乱数生成器が既知の出力（Random123 の Philox4x32-10 のテスト ベクトル）を再現すること、
+// 一括生成の結果が各命令セットで 1 ブロックずつの生成と一致すること、
+// 点群の生成結果がスレッド数によらずビット単位で一致することを検証する。
+bool MySelfCheck::VerifyPointGeneratorDeterminism()
+{
+	struct KnownAnswer
+	{
+		uint32_t Counter[4];
+		uint32_t Key[2];
+		uint32_t Expected[4];
+	};
+	const KnownAnswer knownAnswers[] =
+	{
+		{ { 0, 0, 0, 0 }, { 0, 0 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+	};
+	for (const auto& answer : knownAnswers)
+	{
+		uint32_t words[4] = { answer.Counter[0], answer.Counter[1], answer.Counter[2], answer.Counter[3] };
+		MyRandom::GeneratePhilox4x32Block(words, answer.Key[0], answer.Key[1]);
+		if (!std::equal(words, words + 4, answer.Expected))
+		{
+			printf("Philox4x32-10 mismatch: %08x %08x %08x %08x.\n", words[0], words[1], words[2], words[3]);
+			return false;
+		}
+	}
+
+	// 下位 32bit の桁あふれをまたぐカウンターで、端数の出る個数を一括生成する。
+	const uint64_t seed = 0x0123456789ABCDEFull;
+	const MyRandom::Philox4x32Counter firstCounter = { 0xFFFFFFFFull - 100, 3, 5 };
+	const size_t blocksNum = 1003;
+	std::vector<uint32_t> batchWords(blocksNum * 4);
+	uint32_t* const ppBatchWords[4] = { &batchWords[0], &batchWords[blocksNum], &batchWords[blocksNum * 2], &batchWords[blocksNum * 3] };
+	const MyCpuFeatures::SimdLevel originalLevel = MyCpuFeatures::GetActiveSimdLevel();
+	bool isValid = true;
+	for (int level = MyCpuFeatures::SimdLevel_Scalar; level <= MyCpuFeatures::GetSupportedSimdLevel() && isValid; ++level)
+	{
+		MyCpuFeatures::SetActiveSimdLevel(MyCpuFeatures::SimdLevel(level));
+		MyRandom::GeneratePhilox4x32Batch(seed, firstCounter, blocksNum, ppBatchWords);
+		for (size_t i = 0; i < blocksNum && isValid; ++i)
+		{
+			MyRandom::Philox4x32Counter counter = firstCounter;
+			counter.Index += i;
+			uint32_t words[4];
+			MyRandom::GeneratePhilox4x32(seed, counter, words);
+			for (int j = 0; j < 4; ++j)
+			{
+				if (ppBatchWords[j][i] != words[j])
+				{
+					printf("Philox4x32 batch mismatch (%s): block #%d.\n", MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::SimdLevel(level)), int(i));
+					isValid = false;
+					break;
+				}
+			}
+		}
+	}
+	MyCpuFeatures::SetActiveSimdLevel(originalLevel);
+
+	// チャンク境界をまたぐ点数で、1 スレッドと最大スレッド数の生成結果を比べる。
+	const size_t pointsNum = MyPointGenerator::ChunkPointsNum * 3 + 123;
+	const unsigned originalThreadsNum = m_jobSystem.GetActiveThreadsNum();
+	for (int d = 0; d < MyPointGenerator::Distribution_Count && isValid; ++d)
+	{
+		const MyPointGenerator::Distribution distribution = MyPointGenerator::Distribution(d);
+		MyPointCloudStore expected;
+		MyPointCloudStore actual;
+		m_jobSystem.SetActiveThreadsNum(1);
+		MyPointGenerator::GeneratePointsParallel(m_jobSystem, expected, pointsNum, distribution, m_generatedPointCloudRadius, seed);
+		m_jobSystem.SetActiveThreadsNum(m_jobSystem.GetMaxThreadsNum());
+		MyPointGenerator::GeneratePointsParallel(m_jobSystem, actual, pointsNum, distribution, m_generatedPointCloudRadius, seed);
+		const size_t bytesNum = pointsNum * sizeof(float);
+		if (memcmp(expected.GetPositionsX(), actual.GetPositionsX(), bytesNum) != 0 ||
+			memcmp(expected.GetPositionsY(), actual.GetPositionsY(), bytesNum) != 0 ||
+			memcmp(expected.GetPositionsZ(), actual.GetPositionsZ(), bytesNum) != 0)
+		{
+			printf("Point generator mismatch: %s differs between 1 and %u threads.\n",
+				MyPointGenerator::GetDistributionName(distribution), m_jobSystem.GetMaxThreadsNum());
+			isValid = false;
+		}
+	}
+	m_jobSystem.SetActiveThreadsNum(originalThreadsNum);
+	return isValid;
+}
+
+// 基数ソートによる Morton 順が、(コード, インデックス) の組を比較ソートした結果と一致すること、
+// 並べ替えた点群の各属性と元のインデックスの表が、並べ替え前の点を正しく指すことを検証する。
+bool MySelfCheck::VerifyMortonOrderAgainstSort()
+{
+	const size_t pointsNum = MyPointGenerator::ChunkPointsNum * 3 + 123;
+	MyPointCloudStore store;
+	MyPointGenerator::GeneratePointsParallel(m_jobSystem, store, pointsNum, MyPointGenerator::Distribution_GaussianClusters, m_generatedPointCloudRadius, 7);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		store.GetPackedColors()[i] = uint32_t(i);
+		store.SetSelected(i, (i % 3) == 0);
+	}
+
+	std::vector<uint32_t> order;
+	MyMortonOrder::SortByMortonCodeParallel(m_jobSystem, store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), pointsNum, order);
+
+	MyVector3F boundsMin(+std::numeric_limits<float>::infinity());
+	MyVector3F boundsMax(-std::numeric_limits<float>::infinity());
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		boundsMin = glm::min(boundsMin, store.GetPosition(i));
+		boundsMax = glm::max(boundsMax, store.GetPosition(i));
+	}
+	MyVector3F gridMin, invCellSize;
+	MyMortonOrder::CalcCubicGrid(boundsMin, boundsMax, gridMin, invCellSize);
+	std::vector<uint64_t> sortKeys(pointsNum);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		sortKeys[i] = (uint64_t(MyMortonOrder::CalcMortonCode(store.GetPosition(i), gridMin, invCellSize)) << 32) | i;
+	}
+	std::sort(sortKeys.begin(), sortKeys.end());
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		if (order[i] != uint32_t(sortKeys[i]))
+		{
+			printf("Morton order mismatch: #%d is %u, expected %u.\n", int(i), order[i], uint32_t(sortKeys[i]));
+			return false;
+		}
+	}
+
+	const MyPointCloudStore original = store;
+	MyMortonOrder::ReorderStoreParallel(m_jobSystem, store, order);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		const uint32_t source = store.GetOriginalIndex(i);
+		if (source != order[i] || store.GetPosition(i) != original.GetPosition(source) ||
+			store.GetPackedColor(i) != source || store.IsSelected(i) != original.IsSelected(source))
+		{
+			printf("Morton reorder mismatch: #%d.\n", int(i));
+			return false;
+		}
+	}
+	return true;
+}
+
+// フレームの描画要求が 1 フレームにまとめられ、ダーティ フラグが合成されること、
+// フレーム レートの上限がある場合は前のフレームの開始から最小間隔が経つまで遅らされることを検証する。
+bool MySelfCheck::VerifyFrameScheduler()
+{
+	typedef MyFrameScheduler::Clock Clock;
+	MyFrameScheduler scheduler;
+	Clock::time_point now = Clock::now();
+	double delaySeconds = 0;
+	scheduler.BeginFrame(now);
+	if (scheduler.Invalidate(MyFrameScheduler::DirtyFlag_Hover, now, delaySeconds) != MyFrameScheduler::FrameRequest_PostNow ||
+		scheduler.Invalidate(MyFrameScheduler::DirtyFlag_Camera, now, delaySeconds) != MyFrameScheduler::FrameRequest_None ||
+		scheduler.BeginFrame(now) != (MyFrameScheduler::DirtyFlag_Hover | MyFrameScheduler::DirtyFlag_Camera) ||
+		scheduler.GetStats().CoalescedNum != 1)
+	{
+		puts("Frame scheduler failed to coalesce requests.");
+		return false;
+	}
+	scheduler.EndFrame(now + std::chrono::milliseconds(20));
+	scheduler.SetFrameRateCap(50, false);
+	now += std::chrono::milliseconds(5);
+	if (scheduler.Invalidate(MyFrameScheduler::DirtyFlag_Hover, now, delaySeconds) != MyFrameScheduler::FrameRequest_PostLater ||
+		std::abs(delaySeconds - 0.015) > 1e-6)
+	{
+		puts("Frame scheduler failed to cap the frame rate.");
+		return false;
+	}
+	// 処理時間 20ms のフレームが続くと、適応モードではフレーム間隔を 40ms に広げる。
+	scheduler.SetFrameRateCap(50, true);
+	if (std::abs(scheduler.GetMinFrameIntervalSeconds() - 0.020 / MyFrameScheduler::AdaptiveBusyRatio) > 1e-6 ||
+		scheduler.BeginFrame(now + std::chrono::milliseconds(15)) != MyFrameScheduler::DirtyFlag_Hover)
+	{
+		puts("Frame scheduler failed to adapt the frame rate.");
+		return false;
+	}
+	return true;
+}
+
+// 色のパレットへの変換と RGBA8 への展開で色が変わらないこと、パレットのまま並べ替えた結果が RGBA8 で並べ替えた結果と一致すること、
+// パレットに収まらない色を追加すると RGBA8 に展開されることを検証する。
+bool MySelfCheck::VerifyPaletteColors()
+{
+	const size_t pointsNum = MyPointGenerator::ChunkPointsNum * 2 + 45;
+	MyPointCloudStore store;
+	MyPointGenerator::GeneratePointsParallel(m_jobSystem, store, pointsNum, MyPointGenerator::Distribution_UniformBox, m_generatedPointCloudRadius, 11);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		store.GetPackedColors()[i] = uint32_t((i * 7919) % MyPointCloudStore::MaxPaletteColorsNum) * 0x01010101u;
+	}
+	const MyPointCloudStore original = store;
+	if (!store.CompactColors() || store.GetPalette().size() != MyPointCloudStore::MaxPaletteColorsNum ||
+		store.GetMemoryBytes() >= original.GetMemoryBytes())
+	{
+		printf("Palette compaction failed.\n");
+		return false;
+	}
+
+	std::vector<uint32_t> order;
+	MyMortonOrder::SortByMortonCodeParallel(m_jobSystem, store.GetPositionsX(), store.GetPositionsY(), store.GetPositionsZ(), pointsNum, order);
+	MyPointCloudStore reordered = original;
+	MyMortonOrder::ReorderStoreParallel(m_jobSystem, store, order);
+	MyMortonOrder::ReorderStoreParallel(m_jobSystem, reordered, order);
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		if (store.GetPackedColor(i) != reordered.GetPackedColor(i) || store.GetPackedColor(i) != original.GetPackedColor(order[i]))
+		{
+			printf("Palette reorder mismatch: #%d.\n", int(i));
+			return false;
+		}
+	}
+
+	store.AppendPoint(MyVector3F(0), original.GetPackedColor(0));
+	if (!store.UsesPalette())
+	{
+		printf("Palette expanded unexpectedly.\n");
+		return false;
+	}
+	store.AppendPoint(MyVector3F(0), 0x12345678u);
+	if (store.UsesPalette() || store.GetPackedColor(pointsNum) != original.GetPackedColor(0) || store.GetPackedColor(pointsNum + 1) != 0x12345678u)
+	{
+		printf("Palette overflow failed.\n");
+		return false;
+	}
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		if (store.GetPackedColor(i) != reordered.GetPackedColor(i))
+		{
+			printf("Palette expansion mismatch: #%d.\n", int(i));
+			return false;
+		}
+	}
+	return true;
+}
+
+// 視錐台と八分木による矩形選択の結果が、全点を一括判定した総当たりの結果と一致するかどうかを検証する。
+// 矩形ごとに集合演算の種類と SIMD 命令セットを変えて、直前の選択状態との演算結果も確かめる。
+bool MySelfCheck::VerifyFrustumSelectionAgainstBruteForce()
+{
+	const MyMatrix4x4F& matToScreen = m_matFixedWorldToScreen;
+	const MyMatrix4x4F matUnproj = glm::inverse(matToScreen);
+	const size_t pointsNum = m_pointCloud.GetPointsNum();
+	const std::vector<uint64_t> originalSelection(m_pointCloud.GetSelectionWords(), m_pointCloud.GetSelectionWords() + m_pointCloud.GetSelectionWordsNum());
+	std::vector<uint64_t> hitWords(m_pointCloud.GetSelectionWordsNum());
+	const auto originalLevel = MyCpuFeatures::GetActiveSimdLevel();
+	const int levelsNum = MyCpuFeatures::GetSupportedSimdLevel() + 1;
+	const int rectsNum = 100;
+	bool isValid = true;
+	for (int r = 0; r < rectsNum && isValid; ++r)
+	{
+		const auto level = MyCpuFeatures::SimdLevel(r % levelsNum);
+		MyCpuFeatures::SetActiveSimdLevel(level);
+		// 800x600 のビューポートを少しはみ出す範囲で、ランダムな矩形を作る。
+		const int x0 = std::rand() % 1000 - 100;
+		const int y0 = std::rand() % 800 - 100;
+		const int x1 = std::rand() % 1000 - 100;
+		const int y1 = std::rand() % 800 - 100;
+		const int rectL = std::min(x0, x1);
+		const int rectT = std::min(y0, y1);
+		const int rectR = std::max(x0, x1);
+		const int rectB = std::max(y0, y1);
+		const auto op = MyBitsetOps::SetOperation(r % MyBitsetOps::SetOperation_Count);
+		const std::vector<uint64_t> previousSelection(m_pointCloud.GetSelectionWords(), m_pointCloud.GetSelectionWords() + m_pointCloud.GetSelectionWordsNum());
+		m_pointPicker.SelectPointsIntersectWithScreenRectByFrustum(m_pointCloud, m_pointOctree, matToScreen, matUnproj, rectL, rectT, rectR, rectB, op);
+		MyGLHelper::TransformVector3CoordAndCheckIntersectWithRectBatch(matToScreen,
+			m_pointCloud.GetPositionsX(), m_pointCloud.GetPositionsY(), m_pointCloud.GetPositionsZ(), pointsNum,
+			rectL, rectT, rectR, rectB, hitWords.data());
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			const bool isHit = IsBitSet(hitWords.data(), i);
+			const bool wasSelected = IsBitSet(previousSelection.data(), i);
+			const bool expected =
+				(op == MyBitsetOps::SetOperation_Replace) ? isHit :
+				(op == MyBitsetOps::SetOperation_Union) ? (wasSelected || isHit) :
+				(op == MyBitsetOps::SetOperation_Difference) ? (wasSelected && !isHit) :
+				(op == MyBitsetOps::SetOperation_Intersection) ? (wasSelected && isHit) :
+				(wasSelected != isHit);
+			if (m_pointCloud.IsSelected(i) != expected)
+			{
+				printf("Frustum selection mismatch (%s, %s): rect #%d (%d, %d, %d, %d), point #%d, expected %d.\n",
+					MyBitsetOps::GetSetOperationName(op), MyCpuFeatures::GetSimdLevelName(level), r, rectL, rectT, rectR, rectB, int(i), expected);
+				isValid = false;
+				break;
+			}
+		}
+	}
+	MyCpuFeatures::SetActiveSimdLevel(originalLevel);
+	std::copy(originalSelection.begin(), originalSelection.end(), m_pointCloud.GetSelectionWords());
+	return isValid;
+}
+
+// 圧縮ビットセットの集合演算が、密なビットセットのワード単位の演算と一致するかどうかを、各 SIMD 命令セットで検証する。
+// コンテナが配列になる疎な範囲とビットマップになる密な範囲が混ざるように、65536 点ごとに密度を変えた集合を使う。
+bool MySelfCheck::VerifySelectionSetAgainstDense()
+{
+	const size_t pointsNum = MySelectionSet::PointsPerContainer * 5 + 123;
+	const size_t wordsNum = MyPointCloudStore::GetSelectionWordsNum(pointsNum);
+	const auto createDenseWords = [&](int densityShift)
+	{
+		std::vector<uint64_t> words(wordsNum);
+		for (size_t i = 0; i < pointsNum; ++i)
+		{
+			// コンテナごとに、全点から 1/4096 までの密度にする。
+			const int shift = (int(i / MySelectionSet::PointsPerContainer) * 5 + densityShift) % 13;
+			if (std::rand() % (1 << shift) == 0)
+			{
+				words[i / 64] |= uint64_t(1) << (i % 64);
+			}
+		}
+		return words;
+	};
+	const std::vector<uint64_t> wordsA = createDenseWords(1);
+	const std::vector<uint64_t> wordsB = createDenseWords(7);
+	std::vector<uint32_t> indicesB;
+	for (size_t i = 0; i < pointsNum; ++i)
+	{
+		if ((wordsB[i / 64] >> (i % 64)) & 1)
+		{
+			indicesB.push_back(uint32_t(i));
+		}
+	}
+	std::reverse(indicesB.begin(), indicesB.end());
+
+	const MyCpuFeatures::SimdLevel originalLevel = MyCpuFeatures::GetActiveSimdLevel();
+	bool isValid = true;
+	for (int level = MyCpuFeatures::SimdLevel_Scalar; level <= MyCpuFeatures::GetSupportedSimdLevel() && isValid; ++level)
+	{
+		MyCpuFeatures::SetActiveSimdLevel(MyCpuFeatures::SimdLevel(level));
+		const char* pLevelName = MyCpuFeatures::GetSimdLevelName(MyCpuFeatures::SimdLevel(level));
+		MySelectionSet setA, setB;
+		setA.AssignDenseWords(wordsA.data(), wordsNum);
+		setB.AssignIndices(indicesB.data(), indicesB.size());
+		std::vector<uint64_t> actual(wordsNum);
+		for (int op = 0; op < MyBitsetOps::SetOperation_Count && isValid; ++op)
+		{
+			std::vector<uint64_t> expected(wordsA);
+			size_t expectedCount = 0;
+			for (size_t w = 0; w < wordsNum; ++w)
+			{
+				const uint64_t a = wordsA[w];
+				const uint64_t b = wordsB[w];
+				expected[w] =
+					(op == MyBitsetOps::SetOperation_Replace) ? b :
+					(op == MyBitsetOps::SetOperation_Union) ? (a | b) :
+					(op == MyBitsetOps::SetOperation_Difference) ? (a & ~b) :
+					(op == MyBitsetOps::SetOperation_Intersection) ? (a & b) :
+					(a ^ b);
+				expectedCount += MyMath::GetSetBitsCount(expected[w]);
+			}
+
+			// 密なビットセット同士、密なビットセットと圧縮ビットセット、圧縮ビットセット同士の 3 通り。
+			actual = wordsA;
+			MyBitsetOps::ApplyWords(MyBitsetOps::SetOperation(op), actual.data(), wordsB.data(), wordsNum);
+			const bool isWordsValid = (actual == expected) && (MyBitsetOps::CountBits(actual.data(), wordsNum) == expectedCount);
+			actual = wordsA;
+			setB.ApplyTo(MyBitsetOps::SetOperation(op), actual.data(), pointsNum);
+			const bool isApplyValid = (actual == expected);
+			MySelectionSet combined = setA;
+			combined.Combine(MyBitsetOps::SetOperation(op), setB);
+			combined.ExportDenseWords(actual.data(), wordsNum);
+			const bool isCombineValid = (actual == expected) && (combined.GetCardinality() == expectedCount);
+			if (!isWordsValid || !isApplyValid || !isCombineValid)
+			{
+				printf("Selection set mismatch (%s, %s): words = %d, apply = %d, combine = %d.\n",
+					pLevelName, MyBitsetOps::GetSetOperationName(MyBitsetOps::SetOperation(op)), isWordsValid, isApplyValid, isCombineValid);
+				isValid = false;
+			}
+		}
+
+		// 補集合は範囲外のビットを立てないこと。
+		MySelectionSet inverted = setA;
+		inverted.Invert(pointsNum);
+		inverted.ExportDenseWords(actual.data(), wordsNum);
+		for (size_t w = 0; w < wordsNum && isValid; ++w)
+		{
+			const uint64_t validMask = (w + 1 < wordsNum || pointsNum % 64 == 0) ? ~uint64_t(0) : (uint64_t(1) << (pointsNum % 64)) - 1;
+			if (actual[w] != (~wordsA[w] & validMask))
+			{
+				printf("Selection set mismatch (%s, Invert): word #%d.\n", pLevelName, int(w));
+				isValid = false;
+			}
+		}
+	}
+	MyCpuFeatures::SetActiveSimdLevel(originalLevel);
+	return isValid;
+}
+
+// 選択操作の履歴を取り消し・やり直しして、各時点の選択状態が操作時と一致するかどうかを検証する。
+// メモリ量の上限を超えた古い操作が捨てられても、残った操作は正しく取り消せることも確かめる。
+bool MySelfCheck::VerifySelectionHistory()
+{
+	const size_t pointsNum = MySelectionSet::PointsPerContainer * 3 + 45;
+	const int operationsNum = 40;
+	MyPointCloudStore store;
+	store.Resize(pointsNum);
+	MySelectionHistory history;
+	MySelectionSet operand;
+	MySelectionSet changes;
+	std::vector<uint32_t> indices;
+	// 記録された操作の後の選択状態。先頭は操作前。
+	std::vector<std::vector<uint64_t>> snapshots;
+	const auto takeSnapshot = [&store]() { return std::vector<uint64_t>(store.GetSelectionWords(), store.GetSelectionWords() + store.GetSelectionWordsNum()); };
+	snapshots.push_back(takeSnapshot());
+	for (int i = 0; i < operationsNum; ++i)
+	{
+		if (i % 7 == 6)
+		{
+			store.InvertSelection();
+			history.RecordInvertAll(store.GetPointsNum(), "Invert");
+		}
+		else
+		{
+			// クリックのような数点から、矩形選択のような数万点までの操作を混ぜる。
+			indices.resize(size_t(1) << (std::rand() % 16));
+			for (auto& index : indices)
+			{
+				index = (uint32_t(std::rand()) * 32768u + uint32_t(std::rand())) % uint32_t(pointsNum);
+			}
+			operand.AssignIndices(indices.data(), indices.size());
+			store.ApplySelection(MyBitsetOps::SetOperation(i % MyBitsetOps::SetOperation_Count), operand, &changes);
+			history.Record(changes, "Select");
+			if (changes.IsEmpty())
+			{
+				// 変化のない操作は記録されない。
+				continue;
+			}
+		}
+		snapshots.push_back(takeSnapshot());
+	}
+
+	const size_t recordedNum = snapshots.size() - 1;
+	if (history.GetUndoableNum() != recordedNum)
+	{
+		printf("Selection history mismatch: %d operations recorded, %d undoable.\n", int(recordedNum), int(history.GetUndoableNum()));
+		return false;
+	}
+	for (size_t i = 1; i <= recordedNum; ++i)
+	{
+		history.Undo(store);
+		if (takeSnapshot() != snapshots[recordedNum - i])
+		{
+			printf("Selection history mismatch: undo #%d.\n", int(i));
+			return false;
+		}
+	}
+	for (size_t i = 1; i <= recordedNum; ++i)
+	{
+		history.Redo(store);
+		if (takeSnapshot() != snapshots[i])
+		{
+			printf("Selection history mismatch: redo #%d.\n", int(i));
+			return false;
+		}
+	}
+
+	// 上限を小さくすると古い操作から捨てられ、新しい操作は取り消せる。
+	history.SetMemoryBudgetBytes(history.GetMemoryBytes() / 2);
+	const size_t keptNum = history.GetUndoableNum();
+	if (keptNum >= recordedNum || history.GetMemoryBytes() > history.GetMemoryBudgetBytes())
+	{
+		printf("Selection history mismatch: %d operations kept after trimming.\n", int(keptNum));
+		return false;
+	}
+	for (size_t i = 1; i <= keptNum; ++i)
+	{
+		history.Undo(store);
+		if (takeSnapshot() != snapshots[recordedNum - i])
+		{
+			printf("Selection history mismatch: undo #%d after trimming.\n", int(i));
+			return false;
+		}
+	}
+	if (history.CanUndo())
+	{
+		return false;
+	}
+
+	// 反転の後に追加された点は、反転の取り消しの対象にならない。
+	const auto beforeInvert = takeSnapshot();
+	store.InvertSelection();
+	history.RecordInvertAll(store.GetPointsNum(), "Invert");
+	const size_t appendedIndex = pointsNum + 5;
+	store.Resize(pointsNum + 100);
+	store.SetSelected(appendedIndex, true);
+	history.Undo(store);
+	if (!store.IsSelected(appendedIndex) || store.CountSelected() != MyBitsetOps::CountBits(beforeInvert.data(), beforeInvert.size()) + 1)
+	{
+		printf("Selection history mismatch: undo of invert touched appended points.\n");
+		return false;
+	}
+	store.SetSelected(appendedIndex, false);
+	store.Resize(pointsNum);
+	return takeSnapshot() == beforeInvert;
+}
+
+#endif
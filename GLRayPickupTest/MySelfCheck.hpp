@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include "MyPointPicker.hpp"
+#include "MyPointCache.hpp"
+
+
+#ifdef _DEBUG
+
+//! @brief  デバッグ ビルドの起動時に行なう自己診断。<br>
+//! 高速化した各処理の結果が、総当たりやスカラー版などの素朴な実装の結果と一致するかどうかを検証する。<br>
+//! 各 Verify*() は不一致を見つけると、その内容を標準出力に書き出して false を返す。<br>
+//! 総当たりとの比較は点数に比例して時間がかかるので、生成した小さな点群に対してのみ行なうこと。<br>
+class MySelfCheck
+{
+private:
+	MyJobSystem& m_jobSystem;
+	MyPointCloudStore& m_pointCloud;
+	const MyPointOctree& m_pointOctree;
+	MyPointPicker& m_pointPicker;
+	MyMatrix4x4F m_matFixedWorldToScreen;
+	float m_intersectMarginInWorld;
+	float m_intersectMarginInScreen;
+	float m_generatedPointCloudRadius;
+	std::vector<uint32_t> m_hitIndices;
+
+public:
+	//! @brief  pointOctree は pointCloud から構築しておくこと。交差マージンと点群の半径は GLRayPickupTest と同じ値を指定すること。<br>
+	//! matFixedWorldToScreen は 800x600 のビューポートに写す、固定カメラのワールド→スクリーン変換行列。<br>
+	MySelfCheck(MyJobSystem& jobSystem, MyPointCloudStore& pointCloud, const MyPointOctree& pointOctree, MyPointPicker& pointPicker,
+		const MyMatrix4x4F& matFixedWorldToScreen, float intersectMarginInWorld, float intersectMarginInScreen, float generatedPointCloudRadius);
+
+public:
+	//! @brief  生成した点群と八分木、およびそれらによらない各処理を検証する。<br>
+	//! 途中で不一致が見つかっても残りの検証を続け、すべて一致した場合だけ true を返す。点群の選択状態は元に戻される。<br>
+	bool VerifyGeneratedPointCloud();
+	//! @brief  点群のデコード元の量子化キャッシュと、それをページングして読み込んだ結果を検証する。<br>
+	bool VerifyPointCache(const MyPointCache& pointCache, const char* pCacheFilePath);
+
+private:
+	bool VerifyPointOctreeAgainstBruteForce();
+	bool VerifyCollisionBatchAgainstScalar();
+	bool VerifyScreenProjectionBatchAgainstScalar();
+	bool VerifyScreenTileGridAgainstBatch();
+	bool VerifyRayNearestHitsAgainstBruteForce();
+	bool VerifyIncrementalIndexAgainstBuild();
+	bool VerifyPointCacheAgainstOctree(const MyPointCache& pointCache);
+	bool VerifyPagedPointCloudAgainstPointCache(const MyPointCache& pointCache, const char* pCacheFilePath);
+	bool VerifyInverseMatrixByStructure();
+	bool VerifyPointGeneratorDeterminism();
+	bool VerifyMortonOrderAgainstSort();
+	bool VerifyFrameScheduler();
+	bool VerifyPaletteColors();
+	bool VerifyFrustumSelectionAgainstBruteForce();
+	bool VerifySelectionSetAgainstDense();
+	bool VerifySelectionHistory();
+
+	MySelfCheck(const MySelfCheck&) = delete;
+	MySelfCheck& operator=(const MySelfCheck&) = delete;
+};
+
+#endif
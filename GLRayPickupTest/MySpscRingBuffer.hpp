@@ -0,0 +1,116 @@
+﻿#pragma once
+
+
+//! @brief  単一の生産者スレッドと単一の消費者スレッドの間で要素を受け渡す、ロックフリーのリング バッファ。<br>
+//! 生産者は TryPush() だけを、消費者は TryPop() だけを呼ぶこと。どちらも待機せず、空き（または要素）がなければ 0 を返す。<br>
+//! 書き込み位置と読み出し位置は別々のキャッシュ ラインに置き、相手側の位置はキャッシュしておいて、<br>
+//! 空きや要素が足りなくなったときだけ読み直すので、コア間のキャッシュ ラインの行き来は一括転送ごとに高々 1 回で済む。<br>
+//! T はトリビアルにコピーできる型であること。<br>
+template<typename T> class MySpscRingBuffer
+{
+public:
+	static const size_t CacheLineSize = 64;
+
+private:
+	std::unique_ptr<T[]> m_buffer;
+	size_t m_capacity; //!< 2 のべき乗。<br>
+	size_t m_mask;
+
+	// 位置は要素数の通算値で、バッファ上の位置は m_mask との論理積で求める。
+	// new で確保しても整列が保証されるように、alignas ではなく詰め物でキャッシュ ラインを分ける。
+	char m_padding0[CacheLineSize];
+	std::atomic<size_t> m_writePos; //!< 生産者だけが書き込む。<br>
+	size_t m_cachedReadPos; //!< 生産者が最後に読んだ m_readPos。<br>
+	char m_padding1[CacheLineSize];
+	std::atomic<size_t> m_readPos; //!< 消費者だけが書き込む。<br>
+	size_t m_cachedWritePos; //!< 消費者が最後に読んだ m_writePos。<br>
+	char m_padding2[CacheLineSize];
+
+public:
+	//! @brief  minCapacity 以上の 2 のべき乗の要素数のバッファを確保する。<br>
+	explicit MySpscRingBuffer(size_t minCapacity)
+		: m_capacity(1)
+		, m_writePos(0)
+		, m_cachedReadPos(0)
+		, m_readPos(0)
+		, m_cachedWritePos(0)
+	{
+		while (m_capacity < minCapacity)
+		{
+			m_capacity *= 2;
+		}
+		m_mask = m_capacity - 1;
+		m_buffer.reset(new T[m_capacity]);
+	}
+
+public:
+	size_t GetCapacity() const { return m_capacity; }
+
+	//! @brief  現在の要素数の概算。相手側のスレッドが同時に操作していれば、呼び出し直後に変化しうる。<br>
+	size_t GetSizeApprox() const
+	{ return m_writePos.load(std::memory_order_acquire) - m_readPos.load(std::memory_order_acquire); }
+
+	//! @brief  生産者スレッドから、最大 count 個の要素を追加する。実際に追加した個数を返す。<br>
+	size_t TryPush(const T* pItems, size_t count)
+	{
+		const size_t writePos = m_writePos.load(std::memory_order_relaxed);
+		size_t freeNum = m_capacity - (writePos - m_cachedReadPos);
+		if (freeNum < count)
+		{
+			// 消費者の進み具合を読み直す。acquire により、消費者が読み終えた領域への上書きが読み出しより後になる。
+			m_cachedReadPos = m_readPos.load(std::memory_order_acquire);
+			freeNum = m_capacity - (writePos - m_cachedReadPos);
+		}
+		const size_t pushNum = std::min(count, freeNum);
+		this->CopyIn(writePos, pItems, pushNum);
+		// release により、要素の書き込みが消費者から見えるようになってから位置を公開する。
+		m_writePos.store(writePos + pushNum, std::memory_order_release);
+		return pushNum;
+	}
+
+	//! @brief  消費者スレッドから、最大 maxCount 個の要素を取り出す。実際に取り出した個数を返す。<br>
+	size_t TryPop(T* pOutItems, size_t maxCount)
+	{
+		const size_t readPos = m_readPos.load(std::memory_order_relaxed);
+		size_t availableNum = m_cachedWritePos - readPos;
+		if (availableNum < maxCount)
+		{
+			m_cachedWritePos = m_writePos.load(std::memory_order_acquire);
+			availableNum = m_cachedWritePos - readPos;
+		}
+		const size_t popNum = std::min(maxCount, availableNum);
+		this->CopyOut(readPos, pOutItems, popNum);
+		m_readPos.store(readPos + popNum, std::memory_order_release);
+		return popNum;
+	}
+
+	//! @brief  消費者スレッドから、現在の要素をすべて取り出さずに捨てる。捨てた個数を返す。<br>
+	size_t DiscardAll()
+	{
+		const size_t readPos = m_readPos.load(std::memory_order_relaxed);
+		m_cachedWritePos = m_writePos.load(std::memory_order_acquire);
+		m_readPos.store(m_cachedWritePos, std::memory_order_release);
+		return m_cachedWritePos - readPos;
+	}
+
+private:
+	MySpscRingBuffer(const MySpscRingBuffer&) = delete;
+	MySpscRingBuffer& operator=(const MySpscRingBuffer&) = delete;
+
+	// バッファの末尾で折り返す場合は 2 回に分けてコピーする。
+	void CopyIn(size_t pos, const T* pItems, size_t count)
+	{
+		const size_t begin = pos & m_mask;
+		const size_t firstNum = std::min(count, m_capacity - begin);
+		std::copy(pItems, pItems + firstNum, &m_buffer[begin]);
+		std::copy(pItems + firstNum, pItems + count, &m_buffer[0]);
+	}
+
+	void CopyOut(size_t pos, T* pOutItems, size_t count) const
+	{
+		const size_t begin = pos & m_mask;
+		const size_t firstNum = std::min(count, m_capacity - begin);
+		std::copy(&m_buffer[begin], &m_buffer[begin] + firstNum, pOutItems);
+		std::copy(&m_buffer[0], &m_buffer[0] + (count - firstNum), pOutItems + firstNum);
+	}
+};
@@ -0,0 +1,352 @@
+﻿#include "stdafx.h"
+#include "MyTextOverlay.hpp"
+
+
+namespace
+{
+	const int GlyphsNum = MyTextOverlay::LastGlyphChar - MyTextOverlay::FirstGlyphChar + 1;
+
+	// グリフ アトラスのテクスチャ。OpenGL 1.x でも使えるように 2 のべき乗の大きさにして、左上から 16 文字ずつ並べる。
+	const int AtlasGlyphsPerRow = 16;
+	const int AtlasWidth = 256;
+	const int AtlasHeight = 128;
+	static_assert(AtlasGlyphsPerRow * MyTextOverlay::GlyphWidth <= AtlasWidth, "The atlas is too narrow.");
+	static_assert((GlyphsNum + AtlasGlyphsPerRow - 1) / AtlasGlyphsPerRow * MyTextOverlay::GlyphHeight <= AtlasHeight, "The atlas is too short.");
+
+	// GLUT_BITMAP_9_BY_15（X11 の -misc-fixed-medium-r-normal--15-140-75-75-C-90-iso8859-1）と同じグリフ。
+	// 1 文字につき上から 16 行、各行は下位 9 ビットで、最上位ビット（0x100）が左端のピクセル。
+	const uint16_t FixedFont9x15Glyphs[GlyphsNum][MyTextOverlay::GlyphHeight] =
+	{
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // ' '
+		{ 0x000, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x000, 0x000, 0x010, 0x010, 0x000, 0x000, 0x000, 0x000 }, // '!'
+		{ 0x000, 0x000, 0x024, 0x024, 0x024, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '"'
+		{ 0x000, 0x000, 0x000, 0x048, 0x048, 0x0FC, 0x048, 0x048, 0x0FC, 0x048, 0x048, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '#'
+		{ 0x000, 0x010, 0x07C, 0x092, 0x090, 0x050, 0x038, 0x014, 0x012, 0x012, 0x092, 0x07C, 0x010, 0x000, 0x000, 0x000 }, // '$'
+		{ 0x000, 0x000, 0x042, 0x0A4, 0x0A4, 0x048, 0x010, 0x010, 0x024, 0x04A, 0x04A, 0x084, 0x000, 0x000, 0x000, 0x000 }, // '%'
+		{ 0x000, 0x000, 0x060, 0x090, 0x090, 0x090, 0x060, 0x062, 0x094, 0x088, 0x094, 0x062, 0x000, 0x000, 0x000, 0x000 }, // '&'
+		{ 0x000, 0x000, 0x00C, 0x008, 0x010, 0x020, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '\''
+		{ 0x000, 0x008, 0x010, 0x010, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x010, 0x010, 0x008, 0x000, 0x000, 0x000 }, // '('
+		{ 0x000, 0x020, 0x010, 0x010, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x010, 0x010, 0x020, 0x000, 0x000, 0x000 }, // ')'
+		{ 0x000, 0x000, 0x000, 0x000, 0x010, 0x092, 0x054, 0x038, 0x054, 0x092, 0x010, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '*'
+		{ 0x000, 0x000, 0x000, 0x000, 0x010, 0x010, 0x010, 0x0FE, 0x010, 0x010, 0x010, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '+'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x018, 0x018, 0x008, 0x008, 0x010, 0x000 }, // ','
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x0FE, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '-'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x018, 0x018, 0x000, 0x000, 0x000, 0x000 }, // '.'
+		{ 0x000, 0x000, 0x002, 0x004, 0x004, 0x008, 0x010, 0x010, 0x020, 0x040, 0x040, 0x080, 0x000, 0x000, 0x000, 0x000 }, // '/'
+		{ 0x000, 0x000, 0x038, 0x044, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x044, 0x038, 0x000, 0x000, 0x000, 0x000 }, // '0'
+		{ 0x000, 0x000, 0x010, 0x030, 0x050, 0x090, 0x010, 0x010, 0x010, 0x010, 0x010, 0x0FE, 0x000, 0x000, 0x000, 0x000 }, // '1'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x004, 0x008, 0x010, 0x020, 0x040, 0x080, 0x0FE, 0x000, 0x000, 0x000, 0x000 }, // '2'
+		{ 0x000, 0x000, 0x0FE, 0x002, 0x004, 0x008, 0x01C, 0x002, 0x002, 0x002, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // '3'
+		{ 0x000, 0x000, 0x004, 0x00C, 0x014, 0x024, 0x044, 0x084, 0x0FE, 0x004, 0x004, 0x004, 0x000, 0x000, 0x000, 0x000 }, // '4'
+		{ 0x000, 0x000, 0x0FE, 0x080, 0x080, 0x0BC, 0x0C2, 0x002, 0x002, 0x002, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // '5'
+		{ 0x000, 0x000, 0x03C, 0x040, 0x080, 0x080, 0x0BC, 0x0C2, 0x082, 0x082, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // '6'
+		{ 0x000, 0x000, 0x0FE, 0x002, 0x002, 0x004, 0x008, 0x010, 0x020, 0x020, 0x040, 0x040, 0x000, 0x000, 0x000, 0x000 }, // '7'
+		{ 0x000, 0x000, 0x038, 0x044, 0x082, 0x044, 0x038, 0x044, 0x082, 0x082, 0x044, 0x038, 0x000, 0x000, 0x000, 0x000 }, // '8'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x082, 0x086, 0x07A, 0x002, 0x002, 0x004, 0x078, 0x000, 0x000, 0x000, 0x000 }, // '9'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x018, 0x018, 0x000, 0x000, 0x000, 0x018, 0x018, 0x000, 0x000, 0x000, 0x000 }, // ':'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x018, 0x018, 0x000, 0x000, 0x000, 0x018, 0x018, 0x008, 0x008, 0x010, 0x000 }, // ';'
+		{ 0x000, 0x000, 0x004, 0x008, 0x010, 0x020, 0x040, 0x040, 0x020, 0x010, 0x008, 0x004, 0x000, 0x000, 0x000, 0x000 }, // '<'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x0FE, 0x000, 0x000, 0x0FE, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '='
+		{ 0x000, 0x000, 0x040, 0x020, 0x010, 0x008, 0x004, 0x004, 0x008, 0x010, 0x020, 0x040, 0x000, 0x000, 0x000, 0x000 }, // '>'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x002, 0x004, 0x008, 0x010, 0x010, 0x000, 0x010, 0x000, 0x000, 0x000, 0x000 }, // '?'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x09E, 0x0A2, 0x0A6, 0x09A, 0x080, 0x080, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // '@'
+		{ 0x000, 0x000, 0x010, 0x028, 0x044, 0x082, 0x082, 0x082, 0x0FE, 0x082, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'A'
+		{ 0x000, 0x000, 0x0FC, 0x042, 0x042, 0x042, 0x0FC, 0x042, 0x042, 0x042, 0x042, 0x0FC, 0x000, 0x000, 0x000, 0x000 }, // 'B'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'C'
+		{ 0x000, 0x000, 0x0FC, 0x042, 0x042, 0x042, 0x042, 0x042, 0x042, 0x042, 0x042, 0x0FC, 0x000, 0x000, 0x000, 0x000 }, // 'D'
+		{ 0x000, 0x000, 0x0FE, 0x040, 0x040, 0x040, 0x078, 0x040, 0x040, 0x040, 0x040, 0x0FE, 0x000, 0x000, 0x000, 0x000 }, // 'E'
+		{ 0x000, 0x000, 0x0FE, 0x040, 0x040, 0x040, 0x078, 0x040, 0x040, 0x040, 0x040, 0x040, 0x000, 0x000, 0x000, 0x000 }, // 'F'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x080, 0x080, 0x080, 0x08E, 0x082, 0x082, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'G'
+		{ 0x000, 0x000, 0x082, 0x082, 0x082, 0x082, 0x0FE, 0x082, 0x082, 0x082, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'H'
+		{ 0x000, 0x000, 0x07C, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'I'
+		{ 0x000, 0x000, 0x01F, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x004, 0x084, 0x078, 0x000, 0x000, 0x000, 0x000 }, // 'J'
+		{ 0x000, 0x000, 0x082, 0x084, 0x088, 0x090, 0x0E0, 0x0A0, 0x090, 0x088, 0x084, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'K'
+		{ 0x000, 0x000, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x080, 0x0FE, 0x000, 0x000, 0x000, 0x000 }, // 'L'
+		{ 0x000, 0x000, 0x082, 0x082, 0x0C6, 0x0AA, 0x0AA, 0x092, 0x092, 0x082, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'M'
+		{ 0x000, 0x000, 0x082, 0x082, 0x0C2, 0x0A2, 0x092, 0x08A, 0x086, 0x082, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'N'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'O'
+		{ 0x000, 0x000, 0x0FC, 0x082, 0x082, 0x082, 0x0FC, 0x080, 0x080, 0x080, 0x080, 0x080, 0x000, 0x000, 0x000, 0x000 }, // 'P'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x0A2, 0x092, 0x07C, 0x008, 0x006, 0x000, 0x000 }, // 'Q'
+		{ 0x000, 0x000, 0x0FC, 0x082, 0x082, 0x082, 0x0FC, 0x090, 0x088, 0x084, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'R'
+		{ 0x000, 0x000, 0x07C, 0x082, 0x082, 0x080, 0x070, 0x00C, 0x002, 0x082, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'S'
+		{ 0x000, 0x000, 0x0FE, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x000, 0x000, 0x000, 0x000 }, // 'T'
+		{ 0x000, 0x000, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'U'
+		{ 0x000, 0x000, 0x082, 0x082, 0x082, 0x044, 0x044, 0x044, 0x028, 0x028, 0x028, 0x010, 0x000, 0x000, 0x000, 0x000 }, // 'V'
+		{ 0x000, 0x000, 0x082, 0x082, 0x082, 0x082, 0x092, 0x092, 0x092, 0x092, 0x0AA, 0x044, 0x000, 0x000, 0x000, 0x000 }, // 'W'
+		{ 0x000, 0x000, 0x082, 0x082, 0x044, 0x028, 0x010, 0x010, 0x028, 0x044, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'X'
+		{ 0x000, 0x000, 0x082, 0x082, 0x044, 0x028, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x000, 0x000, 0x000, 0x000 }, // 'Y'
+		{ 0x000, 0x000, 0x0FE, 0x002, 0x004, 0x008, 0x010, 0x020, 0x040, 0x080, 0x080, 0x0FE, 0x000, 0x000, 0x000, 0x000 }, // 'Z'
+		{ 0x000, 0x03C, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x020, 0x03C, 0x000, 0x000, 0x000 }, // '['
+		{ 0x000, 0x000, 0x080, 0x040, 0x040, 0x020, 0x010, 0x010, 0x008, 0x004, 0x004, 0x002, 0x000, 0x000, 0x000, 0x000 }, // '\\'
+		{ 0x000, 0x078, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x008, 0x078, 0x000, 0x000, 0x000 }, // ']'
+		{ 0x000, 0x000, 0x010, 0x028, 0x044, 0x082, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '^'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x1FE, 0x000, 0x000, 0x000 }, // '_'
+		{ 0x000, 0x060, 0x020, 0x010, 0x008, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '`'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07C, 0x002, 0x002, 0x07E, 0x082, 0x086, 0x07A, 0x000, 0x000, 0x000, 0x000 }, // 'a'
+		{ 0x000, 0x000, 0x080, 0x080, 0x080, 0x0BC, 0x0C2, 0x082, 0x082, 0x082, 0x0C2, 0x0BC, 0x000, 0x000, 0x000, 0x000 }, // 'b'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07C, 0x082, 0x080, 0x080, 0x080, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'c'
+		{ 0x000, 0x000, 0x002, 0x002, 0x002, 0x07A, 0x086, 0x082, 0x082, 0x082, 0x086, 0x07A, 0x000, 0x000, 0x000, 0x000 }, // 'd'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07C, 0x082, 0x082, 0x0FE, 0x080, 0x080, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'e'
+		{ 0x000, 0x000, 0x01C, 0x022, 0x022, 0x020, 0x020, 0x0F8, 0x020, 0x020, 0x020, 0x020, 0x000, 0x000, 0x000, 0x000 }, // 'f'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07A, 0x084, 0x084, 0x084, 0x078, 0x080, 0x07C, 0x082, 0x082, 0x07C, 0x000 }, // 'g'
+		{ 0x000, 0x000, 0x080, 0x080, 0x080, 0x0BC, 0x0C2, 0x082, 0x082, 0x082, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'h'
+		{ 0x000, 0x000, 0x030, 0x000, 0x000, 0x070, 0x010, 0x010, 0x010, 0x010, 0x010, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'i'
+		{ 0x000, 0x000, 0x00C, 0x000, 0x000, 0x01C, 0x004, 0x004, 0x004, 0x004, 0x004, 0x084, 0x084, 0x084, 0x078, 0x000 }, // 'j'
+		{ 0x000, 0x000, 0x080, 0x080, 0x080, 0x082, 0x08C, 0x0B0, 0x0C0, 0x0B0, 0x08C, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'k'
+		{ 0x000, 0x000, 0x070, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'l'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x0EC, 0x092, 0x092, 0x092, 0x092, 0x092, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'm'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x0BC, 0x0C2, 0x082, 0x082, 0x082, 0x082, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'n'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07C, 0x082, 0x082, 0x082, 0x082, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 'o'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x0BC, 0x0C2, 0x082, 0x082, 0x082, 0x0C2, 0x0BC, 0x080, 0x080, 0x080, 0x000 }, // 'p'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07A, 0x086, 0x082, 0x082, 0x082, 0x086, 0x07A, 0x002, 0x002, 0x002, 0x000 }, // 'q'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x09C, 0x062, 0x042, 0x040, 0x040, 0x040, 0x040, 0x000, 0x000, 0x000, 0x000 }, // 'r'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x07C, 0x082, 0x080, 0x07C, 0x002, 0x082, 0x07C, 0x000, 0x000, 0x000, 0x000 }, // 's'
+		{ 0x000, 0x000, 0x000, 0x020, 0x020, 0x0FC, 0x020, 0x020, 0x020, 0x020, 0x022, 0x01C, 0x000, 0x000, 0x000, 0x000 }, // 't'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x084, 0x084, 0x084, 0x084, 0x084, 0x084, 0x07A, 0x000, 0x000, 0x000, 0x000 }, // 'u'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x082, 0x082, 0x044, 0x044, 0x028, 0x028, 0x010, 0x000, 0x000, 0x000, 0x000 }, // 'v'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x082, 0x082, 0x092, 0x092, 0x092, 0x0AA, 0x044, 0x000, 0x000, 0x000, 0x000 }, // 'w'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x082, 0x044, 0x028, 0x010, 0x028, 0x044, 0x082, 0x000, 0x000, 0x000, 0x000 }, // 'x'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x084, 0x084, 0x084, 0x084, 0x084, 0x08C, 0x074, 0x004, 0x084, 0x078, 0x000 }, // 'y'
+		{ 0x000, 0x000, 0x000, 0x000, 0x000, 0x0FE, 0x004, 0x008, 0x010, 0x020, 0x040, 0x0FE, 0x000, 0x000, 0x000, 0x000 }, // 'z'
+		{ 0x000, 0x00E, 0x010, 0x010, 0x010, 0x008, 0x030, 0x030, 0x008, 0x010, 0x010, 0x010, 0x00E, 0x000, 0x000, 0x000 }, // '{'
+		{ 0x000, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x010, 0x000, 0x000, 0x000 }, // '|'
+		{ 0x000, 0x0E0, 0x010, 0x010, 0x010, 0x020, 0x018, 0x018, 0x020, 0x010, 0x010, 0x010, 0x0E0, 0x000, 0x000, 0x000 }, // '}'
+		{ 0x000, 0x000, 0x062, 0x092, 0x08C, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 }, // '~'
+	};
+
+	bool IsGlyphChar(char c)
+	{
+		return c >= MyTextOverlay::FirstGlyphChar && c <= MyTextOverlay::LastGlyphChar;
+	}
+}
+
+MyTextOverlay::MyTextOverlay()
+	: m_atlasTexture()
+	, m_vertexBuffer()
+	, m_vertexBufferCapacity()
+	, m_uploadedVerticesNum()
+	, m_isDirty()
+	, m_uploadsNum()
+{
+}
+
+MyTextOverlay::~MyTextOverlay()
+{
+	// OpenGL コンテキストが破棄された後の可能性があるので、ここでは GL 関数を呼ばない。
+	assert(m_atlasTexture == 0 && m_vertexBuffer == 0);
+}
+
+void MyTextOverlay::Initialize()
+{
+	assert(m_atlasTexture == 0);
+	// 1 テクセル 1 バイトのアルファ テクスチャにする。描画時は頂点カラーとアルファを掛け合わせる。
+	std::vector<uint8_t> texels(AtlasWidth * AtlasHeight);
+	for (int g = 0; g < GlyphsNum; ++g)
+	{
+		const int cellX = (g % AtlasGlyphsPerRow) * GlyphWidth;
+		const int cellY = (g / AtlasGlyphsPerRow) * GlyphHeight;
+		for (int y = 0; y < GlyphHeight; ++y)
+		{
+			const uint16_t bits = FixedFont9x15Glyphs[g][y];
+			for (int x = 0; x < GlyphWidth; ++x)
+			{
+				if (bits & (1 << (GlyphWidth - 1 - x)))
+				{
+					texels[(cellY + y) * AtlasWidth + cellX + x] = 0xFF;
+				}
+			}
+		}
+	}
+	glGenTextures(1, &m_atlasTexture);
+	glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+	// ピクセルの格子に合わせて描画するので、補間しない。
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, AtlasWidth, AtlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, texels.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	m_isDirty = true;
+}
+
+void MyTextOverlay::Release()
+{
+	if (m_atlasTexture)
+	{
+		glDeleteTextures(1, &m_atlasTexture);
+		m_atlasTexture = 0;
+	}
+	if (m_vertexBuffer)
+	{
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	m_vertexBufferCapacity = 0;
+	m_uploadedVerticesNum = 0;
+	m_isDirty = true;
+}
+
+MyTextOverlay::Line& MyTextOverlay::GetLine(size_t row)
+{
+	if (row >= m_lines.size())
+	{
+		const Line hiddenLine = {};
+		m_lines.resize(row + 1, hiddenLine);
+	}
+	return m_lines[row];
+}
+
+bool MyTextOverlay::UpdateLineKey(size_t row, const void* pKey, size_t keyBytes)
+{
+	Line& line = this->GetLine(row);
+	if (line.IsVisible && line.KeyBytes == keyBytes && memcmp(line.Key, pKey, keyBytes) == 0)
+	{
+		return false;
+	}
+	memcpy(line.Key, pKey, keyBytes);
+	line.KeyBytes = keyBytes;
+	return true;
+}
+
+void MyTextOverlay::SetLine(size_t row, int x, int baselineY, const char* pText, const MyVector4F& color)
+{
+	Line& line = this->GetLine(row);
+	const uint32_t packedColor = MyMath::PackColorToRGBA8(color);
+	if (line.IsVisible && line.X == x && line.BaselineY == baselineY && line.PackedColor == packedColor && line.Text == pText)
+	{
+		return;
+	}
+	line.Text = pText;
+	line.PackedColor = packedColor;
+	line.X = x;
+	line.BaselineY = baselineY;
+	line.IsVisible = true;
+	m_isDirty = true;
+}
+
+void MyTextOverlay::HideLine(size_t row)
+{
+	if (row < m_lines.size())
+	{
+		Line& line = m_lines[row];
+		m_isDirty |= line.IsVisible;
+		line.IsVisible = false;
+		line.KeyBytes = 0;
+	}
+}
+
+void MyTextOverlay::UploadVertices()
+{
+	// 空白以外の文字ごとに四角形（GL_QUADS の 4 頂点）を作る。
+	m_scratchVertices.clear();
+	const float texelU = 1.0f / AtlasWidth;
+	const float texelV = 1.0f / AtlasHeight;
+	for (const auto& line : m_lines)
+	{
+		if (!line.IsVisible)
+		{
+			continue;
+		}
+		const float top = float(line.BaselineY - (GlyphHeight - GlyphDescent));
+		const float bottom = top + GlyphHeight;
+		for (size_t i = 0; i < line.Text.size(); ++i)
+		{
+			const char c = line.Text[i];
+			if (!IsGlyphChar(c) || c == ' ')
+			{
+				continue;
+			}
+			const int g = c - FirstGlyphChar;
+			const float left = float(line.X + int(i) * GlyphWidth);
+			const float right = left + GlyphWidth;
+			const float u0 = (g % AtlasGlyphsPerRow) * GlyphWidth * texelU;
+			const float v0 = (g / AtlasGlyphsPerRow) * GlyphHeight * texelV;
+			const float u1 = u0 + GlyphWidth * texelU;
+			const float v1 = v0 + GlyphHeight * texelV;
+			const Vertex quad[4] =
+			{
+				{ left, top, u0, v0, line.PackedColor },
+				{ left, bottom, u0, v1, line.PackedColor },
+				{ right, bottom, u1, v1, line.PackedColor },
+				{ right, top, u1, v0, line.PackedColor },
+			};
+			m_scratchVertices.insert(m_scratchVertices.end(), quad, quad + 4);
+		}
+	}
+
+	if (!m_vertexBuffer)
+	{
+		glGenBuffers(1, &m_vertexBuffer);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	if (m_scratchVertices.size() > m_vertexBufferCapacity)
+	{
+		// 文字数の増減のたびに作り直さないように、倍々で確保する。
+		m_vertexBufferCapacity = std::max<size_t>(m_scratchVertices.size(), m_vertexBufferCapacity * 2);
+		glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(m_vertexBufferCapacity * sizeof(Vertex)), nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (!m_scratchVertices.empty())
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(m_scratchVertices.size() * sizeof(Vertex)), m_scratchVertices.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_uploadedVerticesNum = m_scratchVertices.size();
+	m_isDirty = false;
+	++m_uploadsNum;
+}
+
+void MyTextOverlay::Draw(int viewportWidth, int viewportHeight)
+{
+	assert(m_atlasTexture != 0);
+	if (m_isDirty)
+	{
+		this->UploadVertices();
+	}
+	if (m_uploadedVerticesNum == 0)
+	{
+		return;
+	}
+
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT | GL_DEPTH_BUFFER_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(false);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, m_atlasTexture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+	// 左上を原点とするピクセル座標で描画する。
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0, viewportWidth, viewportHeight, 0, -1, 1);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, X)));
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, U)));
+	glEnableClientState(GL_COLOR_ARRAY);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), reinterpret_cast<const void*>(offsetof(Vertex, PackedColor)));
+
+	glDrawArrays(GL_QUADS, 0, GLsizei(m_uploadedVerticesNum));
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+}
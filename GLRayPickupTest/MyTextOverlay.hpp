@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include "MyMath.hpp"
+
+
+//! @brief  画面に重ねて表示する文字列を、グリフ アトラスのテクスチャとバッファ オブジェクト（VBO）で、glDrawArrays() 1 回でまとめて描画するクラス。<br>
+//! glutBitmapCharacter() のように 1 文字ごとに GL を呼ばないので、ソフトウェア実装やリモート デスクトップの OpenGL でも文字数に比例した負荷がかからない。<br>
+//! グリフは GLUT_BITMAP_9_BY_15 と同じ 9x15 の固定幅フォント（ASCII の印字可能文字）で、ソースに埋め込んだビットマップからアトラスを作る。<br>
+//! 文字列は行（row）ごとに保持し、いずれかの行の文字列・色・位置が変わったときだけ頂点を作り直してアップロードする。<br>
+//! 行の値を比較用のキーで覚えておけるので（IsLineKeyChanged()）、呼び出し側は値が変わったときだけ文字列を整形し直せばよい。<br>
+//! OpenGL コンテキストの作成後に Initialize() を呼び、コンテキストの破棄前に Release() を呼ぶこと。<br>
+class MyTextOverlay
+{
+public:
+	static const int GlyphWidth = 9;
+	static const int GlyphHeight = 16; //!< セルの高さ。ベースラインから下に GlyphDescent ピクセルを含む。<br>
+	static const int GlyphDescent = 4;
+	static const char FirstGlyphChar = ' ';
+	static const char LastGlyphChar = '~';
+	//! @brief  IsLineKeyChanged() に渡せるキーの大きさの上限[bytes]。<br>
+	static const size_t MaxLineKeyBytes = 64;
+
+private:
+	struct Line
+	{
+		std::string Text;
+		uint32_t PackedColor;
+		int X;
+		int BaselineY; //!< ウィンドウの上端からのベースラインの位置。<br>
+		bool IsVisible;
+		size_t KeyBytes;
+		uint8_t Key[MaxLineKeyBytes];
+	};
+
+	struct Vertex
+	{
+		float X, Y;
+		float U, V;
+		uint32_t PackedColor;
+	};
+
+private:
+	GLuint m_atlasTexture;
+	GLuint m_vertexBuffer;
+	size_t m_vertexBufferCapacity; //!< バッファに確保した頂点数。<br>
+	size_t m_uploadedVerticesNum;
+	std::vector<Line> m_lines;
+	std::vector<Vertex> m_scratchVertices;
+	bool m_isDirty;
+	uint64_t m_uploadsNum;
+
+public:
+	MyTextOverlay();
+	~MyTextOverlay();
+
+public:
+	//! @brief  グリフ アトラスのテクスチャを作成する。GLEW の初期化後に呼ぶこと。<br>
+	void Initialize();
+
+	//! @brief  テクスチャとバッファ オブジェクトを破棄する。OpenGL コンテキストが有効なうちに呼ぶこと。<br>
+	void Release();
+
+	//! @brief  行 row の前回のキーと key を比べて、異なれば key を覚えて true を返す。<br>
+	//! 行が非表示になっていた場合も true を返す。key はパディングを含まない、memcmp() で比較できる型であること。<br>
+	template<typename TKey> bool IsLineKeyChanged(size_t row, const TKey& key)
+	{
+		static_assert(sizeof(TKey) <= MaxLineKeyBytes, "The key is too large.");
+		return this->UpdateLineKey(row, &key, sizeof(TKey));
+	}
+
+	//! @brief  行 row の文字列を設定して表示する。印字可能でない文字は空白として描画する。<br>
+	//! x, baselineY はウィンドウの左上を原点とするピクセル座標。<br>
+	void SetLine(size_t row, int x, int baselineY, const char* pText, const MyVector4F& color);
+
+	//! @brief  行 row を非表示にする。キーも忘れる。<br>
+	void HideLine(size_t row);
+
+	//! @brief  表示中の全行を描画する。現在の行列やライティングなどの状態は変えずに戻す。<br>
+	void Draw(int viewportWidth, int viewportHeight);
+
+	//! @brief  頂点をアップロードした回数。文字列が変わらないフレームでは増えない。<br>
+	uint64_t GetUploadsNum() const { return m_uploadsNum; }
+
+private:
+	Line& GetLine(size_t row);
+	bool UpdateLineKey(size_t row, const void* pKey, size_t keyBytes);
+	void UploadVertices();
+
+	MyTextOverlay(const MyTextOverlay&) = delete;
+	MyTextOverlay& operator=(const MyTextOverlay&) = delete;
+};
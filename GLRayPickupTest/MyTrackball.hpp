@@ -1,28 +1,40 @@
-﻿#pragma once
-
-#include "MyMath.hpp"
-
-
-//! @brief  簡易トラックボール処理クラス。<br>
-class MyTrackball
-{
-	MyVector2I m_dragStartPos; //!< ドラッグ開始位置。<br>
-	MyVector2F m_scalingVal; //!< マウスの絶対位置→ウィンドウ内での相対位置の換算係数。<br>
-	MyQuaternion4F m_cq; //!< 回転の初期値（クォータニオン）。<br>
-	MyQuaternion4F m_tq; //!< ドラッグ中の回転（クォータニオン）。<br>
-	MyMatrix4x4F m_rotMatrix; //!< 回転の変換行列。<br>
-	bool m_isDragging; //!< ドラッグ中か否か。<br>
-public:
-	MyTrackball();
-	void OnResize(int w, int h); //!< トラックボール処理の範囲指定。<br>
-	void OnMouseDragStart(int x, int y); //!< トラックボール処理の開始。<br>
-	void OnMouseDragging(int x, int y); //!< 回転の変換行列の計算。<br>
-	void OnMouseDragStop(int x, int y); //!< トラックボール処理の停止。<br>
-
-	//! @brief  回転行列を取得する。<br>
-	//! 戻り値を glMultMatrixf() などで使用してカメラもしくはオブジェクトを回転する。<br>
-	const float* GetRotationMatrixAsArray() const
-	{ return &m_rotMatrix[0].x; }
-	const MyMatrix4x4F& GetRotationMatrix() const
-	{ return m_rotMatrix; }
-};
+﻿#pragma once
+
+#include "MyMath.hpp"
+
+
+//! @brief  簡易トラックボール処理クラス。<br>
+class MyTrackball
+{
+	MyVector2I m_dragStartPos; //!< ドラッグ開始位置。<br>
+	MyVector2F m_scalingVal; //!< マウスの絶対位置→ウィンドウ内での相対位置の換算係数。<br>
+	MyQuaternion4F m_cq; //!< 回転の初期値（クォータニオン）。<br>
+	MyQuaternion4F m_tq; //!< ドラッグ中の回転（クォータニオン）。<br>
+	MyMatrix4x4F m_rotMatrix; //!< 回転の変換行列。<br>
+	bool m_isDragging; //!< ドラッグ中か否か。<br>
+	uint64_t m_rotationVersion; //!< 回転行列が更新されるたびに増える。<br>
+public:
+	MyTrackball();
+	void OnResize(int w, int h); //!< トラックボール処理の範囲指定。<br>
+	void OnMouseDragStart(int x, int y); //!< トラックボール処理の開始。<br>
+	void OnMouseDragging(int x, int y); //!< 回転の変換行列の計算。<br>
+	void OnMouseDragStop(int x, int y); //!< トラックボール処理の停止。<br>
+
+	//! @brief  回転行列を取得する。<br>
+	//! 戻り値を glMultMatrixf() などで使用してカメラもしくはオブジェクトを回転する。<br>
+	const float* GetRotationMatrixAsArray() const
+	{ return &m_rotMatrix[0].x; }
+	const MyMatrix4x4F& GetRotationMatrix() const
+	{ return m_rotMatrix; }
+
+	//! @brief  現在の回転を取得する。ドラッグ中はドラッグ中の回転。<br>
+	const MyQuaternion4F& GetRotation() const
+	{ return m_tq; }
+
+	//! @brief  回転を設定する。入力の記録を再生する際に、記録開始時の回転を復元するために使う。ドラッグ中でないこと。<br>
+	void SetRotation(const MyQuaternion4F& rotation);
+
+	//! @brief  回転行列のバージョン番号を取得する。回転行列に依存するキャッシュの無効化判定に使う。<br>
+	uint64_t GetRotationVersion() const
+	{ return m_rotationVersion; }
+};
@@ -0,0 +1,167 @@
+﻿#pragma once
+
+#include "MyGLHelper.hpp"
+#include "MyTrackball.hpp"
+
+
+//! @brief  ビュー行列、プロジェクション行列、およびそれらの積や逆行列のキャッシュ。<br>
+//! カメラ、ビューポート、投影パラメータ、トラックボールの回転のバージョン番号をキーとして、<br>
+//! 依存する行列は参照された時点で、変更 1 回につき 1 度だけ計算する。<br>
+//! カメラ、ビューポート、投影パラメータは参照として保持するので、変更した際は対応する Invalidate*() を呼ぶこと。<br>
+//! トラックボールの回転は MyTrackball::GetRotationVersion() で変更を検知する。<br>
+class MyTransformCache
+{
+public:
+	enum ProjectionType
+	{
+		ProjectionType_Perspective,
+		ProjectionType_Orthographic,
+	};
+
+private:
+	// 各行列の計算時点での、入力のバージョン番号。
+	struct SourceVersions
+	{
+		uint64_t Camera, Viewport, Projection, Trackball;
+	};
+
+	// キャッシュされた行列と、その計算に使った入力のバージョン番号。
+	struct CachedMatrix
+	{
+		MyMatrix4x4F Matrix;
+		SourceVersions Versions;
+		bool IsValid;
+		CachedMatrix() : Matrix(1), Versions(), IsValid() {}
+	};
+
+private:
+	const MyGLHelper::CameraParam& m_camera;
+	const MyGLHelper::Viewport& m_viewport;
+	const MyGLHelper::PerspectiveParam& m_persParam;
+	const MyTrackball& m_trackball;
+	const ProjectionType m_projectionType;
+
+	uint64_t m_cameraVersion;
+	uint64_t m_viewportVersion;
+	uint64_t m_projectionVersion;
+
+	CachedMatrix m_matView;
+	CachedMatrix m_matProj;
+	CachedMatrix m_matWorldToScreen;
+	CachedMatrix m_matScreenToWorld;
+	uint32_t m_recalcCount; //!< 行列を計算した回数（合計）。キャッシュの効果の確認用。<br>
+
+public:
+	MyTransformCache(
+		const MyGLHelper::CameraParam& camera,
+		const MyGLHelper::Viewport& viewport,
+		const MyGLHelper::PerspectiveParam& persParam,
+		const MyTrackball& trackball,
+		ProjectionType projectionType)
+		: m_camera(camera)
+		, m_viewport(viewport)
+		, m_persParam(persParam)
+		, m_trackball(trackball)
+		, m_projectionType(projectionType)
+		, m_cameraVersion()
+		, m_viewportVersion()
+		, m_projectionVersion()
+		, m_recalcCount()
+	{}
+
+public:
+	void InvalidateCamera() { ++m_cameraVersion; }
+	void InvalidateViewport() { ++m_viewportVersion; }
+	void InvalidateProjection() { ++m_projectionVersion; }
+
+	uint32_t GetRecalcCount() const { return m_recalcCount; }
+
+	//! @brief  ビュー行列（カメラ × トラックボールの回転）を取得する。<br>
+	const MyMatrix4x4F& GetViewMatrix()
+	{
+		const SourceVersions current = this->GetCurrentVersions();
+		if (!m_matView.IsValid ||
+			m_matView.Versions.Camera != current.Camera ||
+			m_matView.Versions.Trackball != current.Trackball)
+		{
+			m_matView.Matrix = MyGLHelper::CreateMatrixLookAt(m_camera) * m_trackball.GetRotationMatrix();
+			this->MarkUpdated(m_matView, current);
+		}
+		return m_matView.Matrix;
+	}
+
+	//! @brief  プロジェクション行列を取得する。<br>
+	const MyMatrix4x4F& GetProjectionMatrix()
+	{
+		const SourceVersions current = this->GetCurrentVersions();
+		if (!m_matProj.IsValid ||
+			m_matProj.Versions.Viewport != current.Viewport ||
+			m_matProj.Versions.Projection != current.Projection)
+		{
+			if (m_projectionType == ProjectionType_Perspective)
+			{
+				m_matProj.Matrix = MyGLHelper::CreateMatrixPerspectiveFov(m_viewport, m_persParam);
+			}
+			else
+			{
+				m_matProj.Matrix = MyGLHelper::CreateMatrixOrotho(
+					-m_viewport.Width * 0.5f, +m_viewport.Width * 0.5f, -m_viewport.Height * 0.5f, +m_viewport.Height * 0.5f,
+					m_persParam.Near, m_persParam.Far);
+			}
+			this->MarkUpdated(m_matProj, current);
+		}
+		return m_matProj.Matrix;
+	}
+
+	//! @brief  ワールド座標をスクリーン位置へ変換する行列を取得する。<br>
+	const MyMatrix4x4F& GetWorldToScreenMatrix()
+	{
+		const SourceVersions current = this->GetCurrentVersions();
+		if (!this->IsUpToDateWithAll(m_matWorldToScreen, current))
+		{
+			m_matWorldToScreen.Matrix = MyGLHelper::CreateMatrixTransformWorldCoordToScreenCoord(
+				this->GetViewMatrix(), this->GetProjectionMatrix(), m_viewport);
+			this->MarkUpdated(m_matWorldToScreen, current);
+		}
+		return m_matWorldToScreen.Matrix;
+	}
+
+	//! @brief  スクリーン位置をワールド座標へ変換する行列（逆プロジェクション行列）を取得する。<br>
+	const MyMatrix4x4F& GetScreenToWorldMatrix()
+	{
+		const SourceVersions current = this->GetCurrentVersions();
+		if (!this->IsUpToDateWithAll(m_matScreenToWorld, current))
+		{
+			MyGLHelper::CreateMatrixUnProjectionScreenCoordToWorldCoord(m_matScreenToWorld.Matrix,
+				this->GetViewMatrix(), this->GetProjectionMatrix(), m_viewport);
+			this->MarkUpdated(m_matScreenToWorld, current);
+		}
+		return m_matScreenToWorld.Matrix;
+	}
+
+private:
+	MyTransformCache(const MyTransformCache&) = delete;
+	MyTransformCache& operator=(const MyTransformCache&) = delete;
+
+	SourceVersions GetCurrentVersions() const
+	{
+		const SourceVersions versions = { m_cameraVersion, m_viewportVersion, m_projectionVersion, m_trackball.GetRotationVersion() };
+		return versions;
+	}
+
+	static bool IsUpToDateWithAll(const CachedMatrix& cached, const SourceVersions& current)
+	{
+		return cached.IsValid &&
+			cached.Versions.Camera == current.Camera &&
+			cached.Versions.Viewport == current.Viewport &&
+			cached.Versions.Projection == current.Projection &&
+			cached.Versions.Trackball == current.Trackball;
+	}
+
+	void MarkUpdated(CachedMatrix& cached, const SourceVersions& current)
+	{
+		cached.Versions = current;
+		cached.IsValid = true;
+		++m_recalcCount;
+	}
+};
@@ -1,24 +1,41 @@
-﻿#pragma once
-
-
-#define _CRTDBG_MAP_ALLOC
-#include <cstdlib>
-#include <crtdbg.h>
-
-
-#include <glm/glm.hpp>
-#include <glm/gtc/quaternion.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-//#include <glm/gtx/rotate_vector.hpp>
-
-#include <GL/glew.h>
-#include <GL/freeglut.h>
-
-#include <cmath>
-#include <cassert>
-#include <climits>
-#include <vector>
-#include <string>
-#include <memory>
-#include <algorithm>
-#include <conio.h>
+﻿#pragma once
+
+
+#define _CRTDBG_MAP_ALLOC
+#include <cstdlib>
+#include <crtdbg.h>
+
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+//#include <glm/gtx/rotate_vector.hpp>
+
+// OpenGL を使わないピッキングのベンチマーク（GLRayPickupBench）は、MY_NO_OPENGL を定義して同じソース ファイルをビルドする。
+#ifndef MY_NO_OPENGL
+#include <GL/glew.h>
+#include <GL/freeglut.h>
+#endif
+
+#include <cmath>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <conio.h>
+#include <intrin.h>